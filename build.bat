@@ -14,7 +14,7 @@ if "%Platform%" neq "x64" (
 
 set "ignored_warnings=/wd4201 /wd4200 /wd4100"
 set "common_compile_options= /nologo /W4 %ignored_warnings% /arch:AVX2 /I.. /I../vendor"
-set "common_link_options= /incremental:no /opt:ref /subsystem:windows user32.lib gdi32.lib opengl32.lib"
+set "common_link_options= /incremental:no /opt:ref user32.lib gdi32.lib shell32.lib winmm.lib opengl32.lib"
 
 if "%1"=="debug" (
 	set "compile_options=%common_compile_options% /Od /Z7 /Zo /RTC1 /DAZUR_DEBUG"
@@ -22,20 +22,34 @@ if "%1"=="debug" (
 ) else if "%1"=="release" (
 	set "compile_options=%common_compile_options% /O2 /Z7 /Zo"
 	set "link_options=%common_link_options% libvcruntime.lib"
+) else if "%1"=="profile" (
+	set "compile_options=%common_compile_options% /O2 /Z7 /Zo /DAZUR_PROFILE"
+	set "link_options=%common_link_options% libvcruntime.lib"
+) else if "%1"=="trace" (
+	set "compile_options=%common_compile_options% /O2 /Z7 /Zo /DAZUR_BUMP_TRACE"
+	set "link_options=%common_link_options% libvcruntime.lib"
 ) else (
 	goto invalid_arguments
 )
 
 set /A build_platform=0
-set /A build_engine=0
+set /A build_game=0
+set /A build_bench=0
+set /A build_bake=0
 
 if "%2"=="platform" (
 	set /A build_platform=1
-) else if "%2"=="engine" (
-	set /A build_engine=1
+) else if "%2"=="game" (
+	set /A build_game=1
+) else if "%2"=="bench" (
+	set /A build_bench=1
+) else if "%2"=="bake" (
+	set /A build_bake=1
 ) else if "%2"=="all" (
 	set /A build_platform=1
-	set /A build_engine=1
+	set /A build_game=1
+	set /A build_bench=1
+	set /A build_bake=1
 ) else (
 	goto invalid_arguments
 )
@@ -43,17 +57,29 @@ if "%2"=="platform" (
 if "%3" neq "" goto invalid_arguments
 
 if /I "%build_platform%" equ "1" (
-	cl %compile_options% ..\src\platform.c /link %link_options% /pdb:azur.pdb /out:azur.exe
+	cl %compile_options% ..\src\platform.c /link %link_options% /subsystem:windows /pdb:azur.pdb /out:azur.exe
 )
 
-if /I "%build_platform%" equ "1" (
-	cl %compile_options% ..\src\game.c /LD /link %link_options% /pdb:azur_game.pdb /out:azur_game.dll
+rem NOTE: a running azur.exe reloads azur_game.dll when it changes, a debugger attached to it keeps the PDB of the
+rem       loaded module locked, so every build gets a PDB of its own and the unlocked old ones are cleaned up
+if /I "%build_game%" equ "1" (
+	del azur_game_*.pdb > NUL 2> NUL
+	cl %compile_options% ..\src\game.c /LD /link %link_options% /pdb:azur_game_%random%.pdb /out:azur_game.dll
+)
+
+if /I "%build_bench%" equ "1" (
+	cl %compile_options% ..\src\bench.c /link %link_options% /subsystem:console /pdb:azur_bench.pdb /out:azur_bench.exe
+)
+
+if /I "%build_bake%" equ "1" (
+	cl %compile_options% ..\src\bake.c /link %link_options% /subsystem:console /pdb:azur_bake.pdb /out:azur_bake.exe
+	azur_bake.exe azur.pack ..\run_cycle.aseprite
 )
 
 goto end
 
 :invalid_arguments
-echo Invalid arguments^. Usage: build ^[debug ^| release^] ^[platform ^| game ^| all^]
+echo Invalid arguments^. Usage: build ^[debug ^| release ^| profile ^| trace^] ^[platform ^| game ^| bench ^| bake ^| all^]
 goto end
 
 :end
@@ -0,0 +1,68 @@
+#!/bin/sh
+
+cd "$(dirname "$0")"
+
+mkdir -p build
+cd build
+
+invalid_arguments()
+{
+	echo "Invalid arguments. Usage: build.sh [debug | release | profile | trace] [platform | game | bench | bake | all]"
+	exit 1
+}
+
+common_compile_options="-std=gnu11 -Wall -Wextra -Wno-unused-parameter -Wno-missing-field-initializers -Wno-unused-function -mavx2 -I.. -I../vendor"
+common_link_options="-ldl -lm -pthread"
+
+if [ "$1" = "debug" ]; then
+	compile_options="$common_compile_options -O0 -g -DAZUR_DEBUG"
+elif [ "$1" = "release" ]; then
+	compile_options="$common_compile_options -O2 -g"
+elif [ "$1" = "profile" ]; then
+	compile_options="$common_compile_options -O2 -g -DAZUR_PROFILE"
+elif [ "$1" = "trace" ]; then
+	compile_options="$common_compile_options -O2 -g -DAZUR_BUMP_TRACE"
+else
+	invalid_arguments
+fi
+
+build_platform=0
+build_game=0
+build_bench=0
+build_bake=0
+
+if [ "$2" = "platform" ]; then
+	build_platform=1
+elif [ "$2" = "game" ]; then
+	build_game=1
+elif [ "$2" = "bench" ]; then
+	build_bench=1
+elif [ "$2" = "bake" ]; then
+	build_bake=1
+elif [ "$2" = "all" ]; then
+	build_platform=1
+	build_game=1
+	build_bench=1
+	build_bake=1
+else
+	invalid_arguments
+fi
+
+if [ -n "$3" ]; then invalid_arguments; fi
+
+if [ "$build_platform" = "1" ]; then
+	cc $compile_options ../src/platform_linux_headless.c -o azur_headless $common_link_options || exit 1
+fi
+
+if [ "$build_game" = "1" ]; then
+	cc $compile_options -fPIC -shared -fvisibility=hidden ../src/game.c -o azur_game.so $common_link_options || exit 1
+fi
+
+if [ "$build_bench" = "1" ]; then
+	cc $compile_options ../src/bench.c -o azur_bench $common_link_options || exit 1
+fi
+
+if [ "$build_bake" = "1" ]; then
+	cc $compile_options ../src/bake.c -o azur_bake $common_link_options || exit 1
+	./azur_bake azur.pack ../run_cycle.aseprite || exit 1
+fi
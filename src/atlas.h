@@ -0,0 +1,240 @@
+// NOTE: Baked sprite atlas, produced offline by bake.c and mapped into memory as is. Every table and frame is aligned
+//       so the platform can hand out pointers into the mapping directly, nothing is decoded or copied at load time.
+//
+//       Layout: Atlas_Header, Atlas_Sprite[sprite_count], Atlas_Frame[frame_count], Atlas_Tag[tag_count], then one
+//       block of width*height palette indices per frame, each starting on an ATLAS_ALIGNMENT boundary.
+//
+//       Requires intern.h.
+
+#define ATLAS_MAGIC             0x534C5441 // "ATLS"
+#define ATLAS_VERSION           1
+#define ATLAS_ALIGNMENT         64
+#define ATLAS_TRANSPARENT_INDEX 8
+
+typedef struct Atlas_Name
+{
+	u8 len;
+	u8 data[31];
+} Atlas_Name;
+
+typedef struct Atlas_Header
+{
+	u32 magic;
+	u32 version;
+	u64 file_size;
+	u32 sprite_count;
+	u32 frame_count;
+	u32 tag_count;
+	u32 reserved;
+	u64 sprite_offset;
+	u64 frame_offset;
+	u64 tag_offset;
+	u64 pixel_offset;
+} Atlas_Header;
+
+typedef struct Atlas_Sprite
+{
+	Atlas_Name name;
+	u16 width;
+	u16 height;
+	u32 first_frame;
+	u32 frame_count;
+	u32 first_tag;
+	u32 tag_count;
+	u32 total_duration_ms;
+} Atlas_Sprite;
+
+typedef struct Atlas_Frame
+{
+	u64 pixel_offset;
+	u32 duration_ms;
+	u32 reserved;
+} Atlas_Frame;
+
+typedef enum ATLAS_DIRECTION
+{
+	ATLAS_DIRECTION_FORWARD = 0,
+	ATLAS_DIRECTION_REVERSE,
+	ATLAS_DIRECTION_PING_PONG,
+	ATLAS_DIRECTION_PING_PONG_REVERSE,
+} ATLAS_DIRECTION;
+
+// NOTE: from and to are frame indices relative to the first frame of the owning sprite, both inclusive
+typedef struct Atlas_Tag
+{
+	Atlas_Name name;
+	u16 from;
+	u16 to;
+	u8 direction;
+	u8 reserved;
+	u16 repeat;
+} Atlas_Tag;
+
+static String
+Atlas_NameString(Atlas_Name* name)
+{
+	return (String){ .data = name->data, .len = name->len };
+}
+
+static Atlas_Sprite*
+Atlas_Sprites(Atlas_Header* atlas)
+{
+	return (Atlas_Sprite*)((u8*)atlas + atlas->sprite_offset);
+}
+
+static Atlas_Frame*
+Atlas_Frames(Atlas_Header* atlas)
+{
+	return (Atlas_Frame*)((u8*)atlas + atlas->frame_offset);
+}
+
+static Atlas_Tag*
+Atlas_Tags(Atlas_Header* atlas)
+{
+	return (Atlas_Tag*)((u8*)atlas + atlas->tag_offset);
+}
+
+static Atlas_Sprite*
+Atlas_FindSprite(Atlas_Header* atlas, String name)
+{
+	Atlas_Sprite* result = 0;
+
+	Atlas_Sprite* sprites = Atlas_Sprites(atlas);
+	for (u32 i = 0; i < atlas->sprite_count && result == 0; ++i)
+	{
+		if (String_Equal(Atlas_NameString(&sprites[i].name), name)) result = &sprites[i];
+	}
+
+	return result;
+}
+
+// NOTE: Sprite names interned once, so code that looks a sprite up every frame can keep its ID and skip the string
+//       compare. Holds sprite indices, not pointers, it stays valid when the same atlas is mapped somewhere else.
+typedef struct Atlas_Index
+{
+	Intern_Table names;
+	u32* sprites; // NOTE: indexed by String_ID, the first sprite with that name
+} Atlas_Index;
+
+static void
+Atlas_CreateIndex(Atlas_Index* index, Atlas_Header* atlas, Bump* bump)
+{
+	Intern_Create(&index->names, bump, atlas->sprite_count);
+	index->sprites = Bump_Push(bump, ((umm)atlas->sprite_count + 1)*sizeof(u32), 4);
+
+	Atlas_Sprite* sprites = Atlas_Sprites(atlas);
+	for (u32 i = 0; i < atlas->sprite_count; ++i)
+	{
+		u32 count = index->names.count;
+
+		String_ID id = Intern_Add(&index->names, bump, Atlas_NameString(&sprites[i].name));
+		if (index->names.count != count) index->sprites[id] = i;
+	}
+}
+
+static String_ID
+Atlas_FindSpriteID(Atlas_Index* index, String name)
+{
+	return Intern_Find(&index->names, name);
+}
+
+static Atlas_Sprite*
+Atlas_SpriteByID(Atlas_Header* atlas, Atlas_Index* index, String_ID id)
+{
+	return (id != 0 ? &Atlas_Sprites(atlas)[index->sprites[id]] : 0);
+}
+
+static Atlas_Tag*
+Atlas_FindTag(Atlas_Header* atlas, Atlas_Sprite* sprite, String name)
+{
+	Atlas_Tag* result = 0;
+
+	Atlas_Tag* tags = Atlas_Tags(atlas) + sprite->first_tag;
+	for (u32 i = 0; i < sprite->tag_count && result == 0; ++i)
+	{
+		if (String_Equal(Atlas_NameString(&tags[i].name), name)) result = &tags[i];
+	}
+
+	return result;
+}
+
+static Sprite
+Atlas_FrameSprite(Atlas_Header* atlas, Atlas_Sprite* sprite, u32 frame)
+{
+	ASSERT(frame < sprite->frame_count);
+
+	Atlas_Frame* atlas_frame = &Atlas_Frames(atlas)[sprite->first_frame + frame];
+
+	return (Sprite){
+		.pixels    = (u8*)atlas + atlas_frame->pixel_offset,
+		.width     = sprite->width,
+		.height    = sprite->height,
+		.stride    = sprite->width,
+		.color_key = ATLAS_TRANSPARENT_INDEX,
+	};
+}
+
+// NOTE: Maps a time since the start of the animation to a frame index relative to the sprite, looping forever
+static u32
+Atlas_FrameAtTime(Atlas_Header* atlas, Atlas_Sprite* sprite, u32 time_ms)
+{
+	u32 frame = 0;
+
+	if (sprite->total_duration_ms != 0)
+	{
+		Atlas_Frame* frames = Atlas_Frames(atlas) + sprite->first_frame;
+
+		u32 t = time_ms % sprite->total_duration_ms;
+		while (frame + 1 < sprite->frame_count && t >= frames[frame].duration_ms)
+		{
+			t -= frames[frame].duration_ms;
+			frame += 1;
+		}
+	}
+
+	return frame;
+}
+
+// NOTE: Bounds checks the tables of a freshly mapped atlas, so the accessors above can trust every offset in it
+static bool
+Atlas_Validate(void* memory, u64 size)
+{
+	Atlas_Header* atlas = memory;
+
+	if (size < sizeof(Atlas_Header) || ((umm)memory & (ATLAS_ALIGNMENT-1)) != 0) return false;
+	if (atlas->magic != ATLAS_MAGIC || atlas->version != ATLAS_VERSION || atlas->file_size != size) return false;
+
+	if (atlas->sprite_offset > size || (size - atlas->sprite_offset)/sizeof(Atlas_Sprite) < atlas->sprite_count) return false;
+	if (atlas->frame_offset  > size || (size - atlas->frame_offset)/sizeof(Atlas_Frame)   < atlas->frame_count)  return false;
+	if (atlas->tag_offset    > size || (size - atlas->tag_offset)/sizeof(Atlas_Tag)       < atlas->tag_count)    return false;
+
+	if ((atlas->sprite_offset | atlas->frame_offset | atlas->tag_offset | atlas->pixel_offset) & (ATLAS_ALIGNMENT-1)) return false;
+
+	Atlas_Sprite* sprites = Atlas_Sprites(atlas);
+	Atlas_Frame* frames   = Atlas_Frames(atlas);
+	Atlas_Tag* tags       = Atlas_Tags(atlas);
+
+	for (u32 i = 0; i < atlas->sprite_count; ++i)
+	{
+		Atlas_Sprite* sprite = &sprites[i];
+
+		if (sprite->name.len > sizeof(sprite->name.data)) return false;
+		if (sprite->first_frame > atlas->frame_count || atlas->frame_count - sprite->first_frame < sprite->frame_count) return false;
+		if (sprite->first_tag   > atlas->tag_count   || atlas->tag_count   - sprite->first_tag   < sprite->tag_count)   return false;
+
+		u64 frame_size = (u64)sprite->width*sprite->height;
+		for (u32 j = 0; j < sprite->frame_count; ++j)
+		{
+			u64 offset = frames[sprite->first_frame + j].pixel_offset;
+			if (offset < atlas->pixel_offset || offset > size || size - offset < frame_size) return false;
+		}
+
+		for (u32 j = 0; j < sprite->tag_count; ++j)
+		{
+			Atlas_Tag* tag = &tags[sprite->first_tag + j];
+			if (tag->name.len > sizeof(tag->name.data) || tag->from > tag->to || tag->to >= sprite->frame_count) return false;
+		}
+	}
+
+	return true;
+}
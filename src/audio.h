@@ -0,0 +1,165 @@
+// NOTE: Audio as the game sees it: sounds, and a queue of commands to the mixer in mixer.h. The game queues play, stop
+//       and volume commands from the thread calling Tick into a single-producer/single-consumer ring, the mixer thread
+//       applies them before it mixes its next period. Queueing never waits, a command that finds the ring full is
+//       dropped and counted, and a dropped play hands back 0 instead of a voice.
+//
+//       Sounds are 16 bit mono at AUDIO_SAMPLE_RATE. The mixer reads them in place for as long as they play, so they
+//       have to live somewhere that stays put, like the persistent bump, never a frame bump.
+
+#define AUDIO_SAMPLE_RATE   48000
+#define AUDIO_MAX_VOICES    256
+#define AUDIO_COMMAND_COUNT 1024      // NOTE: a power of two
+#define AUDIO_UNITY_GAIN    (1 << 15)
+#define AUDIO_MAX_PITCH     8
+#define AUDIO_SOUND_PADDING 8         // NOTE: samples past the end, the mixer reads whole vectors
+
+typedef u32 Audio_Voice; // NOTE: 0 is never a voice
+
+// NOTE: samples holds AUDIO_SOUND_PADDING more samples than frame_count. The first of them is a copy of the first
+//       sample, interpolating the last frame reads it and a looping sound wraps around without a click.
+typedef struct Audio_Sound
+{
+	s16* samples;
+	u32 frame_count;
+} Audio_Sound;
+
+typedef enum AUDIO_COMMAND
+{
+	AUDIO_COMMAND_PLAY = 0,
+	AUDIO_COMMAND_STOP,
+	AUDIO_COMMAND_VOLUME,
+} AUDIO_COMMAND;
+
+typedef struct Audio_Command
+{
+	u32 kind;
+	Audio_Voice voice;
+	s16* samples;
+	u32 frame_count;
+	u32 step;       // NOTE: 16.16 frames of the sound per output frame
+	s32 gain_left;  // NOTE: AUDIO_UNITY_GAIN is 1
+	s32 gain_right;
+	bool loop;
+} Audio_Command;
+
+typedef struct Audio_Queue
+{
+	Audio_Command* commands;
+	volatile u32 read_index;
+	volatile u32 write_index;
+
+	/// Game thread
+	u32 next_voice;
+	u64 queued;
+	u64 dropped;
+} Audio_Queue;
+
+// NOTE: Copies frame_count samples onto bump
+static Audio_Sound
+Audio_PushSound(Bump* bump, s16* samples, u32 frame_count)
+{
+	ASSERT(frame_count != 0);
+
+	Audio_Sound sound = {
+		.samples     = Bump_Push(bump, ((umm)frame_count + AUDIO_SOUND_PADDING)*sizeof(s16), 4),
+		.frame_count = frame_count,
+	};
+
+	memcpy(sound.samples, samples, (umm)frame_count*sizeof(s16));
+	memset(sound.samples + frame_count, 0, AUDIO_SOUND_PADDING*sizeof(s16));
+	sound.samples[frame_count] = samples[0];
+
+	return sound;
+}
+
+static bool
+Audio_PushCommand(Audio_Queue* queue, Audio_Command* command)
+{
+	u32 write_index = queue->write_index;
+
+	if (write_index - Atomic_LoadAcquire32(&queue->read_index) == AUDIO_COMMAND_COUNT)
+	{
+		queue->dropped += 1;
+		return false;
+	}
+
+	queue->commands[write_index & (AUDIO_COMMAND_COUNT - 1)] = *command;
+	Atomic_StoreRelease32(&queue->write_index, write_index + 1);
+
+	queue->queued += 1;
+	return true;
+}
+
+// NOTE: Called by the mixer thread only
+static bool
+Audio_PopCommand(Audio_Queue* queue, Audio_Command* command)
+{
+	u32 read_index = queue->read_index;
+	if (read_index == Atomic_LoadAcquire32(&queue->write_index)) return false;
+
+	*command = queue->commands[read_index & (AUDIO_COMMAND_COUNT - 1)];
+	Atomic_StoreRelease32(&queue->read_index, read_index + 1);
+
+	return true;
+}
+
+// NOTE: volume is clamped to [0, 1], pan to [-1, 1]. A centered sound plays at full volume on both sides, panning
+//       turns the other side down.
+static void
+Audio_Gains(f32 volume, f32 pan, s32* gain_left, s32* gain_right)
+{
+	if (!(volume > 0)) volume = 0;
+	if (volume > 1)    volume = 1;
+	if (!(pan > -1))   pan = -1;
+	if (pan > 1)       pan = 1;
+
+	*gain_left  = (s32)(volume*(pan > 0 ? 1 - pan : 1)*AUDIO_UNITY_GAIN + 0.5f);
+	*gain_right = (s32)(volume*(pan < 0 ? 1 + pan : 1)*AUDIO_UNITY_GAIN + 0.5f);
+}
+
+// NOTE: pitch scales the playback rate, 1 plays the sound as is. Returns 0 when the queue is full.
+static Audio_Voice
+Audio_Play(Audio_Queue* queue, Audio_Sound* sound, f32 volume, f32 pan, f32 pitch, bool loop)
+{
+	if (!(pitch >= 1.0f/65536)) pitch = 1.0f/65536;
+	if (pitch > AUDIO_MAX_PITCH) pitch = AUDIO_MAX_PITCH;
+
+	queue->next_voice += 1;
+	if (queue->next_voice == 0) queue->next_voice = 1;
+
+	Audio_Command command = {
+		.kind        = AUDIO_COMMAND_PLAY,
+		.voice       = queue->next_voice,
+		.samples     = sound->samples,
+		.frame_count = sound->frame_count,
+		.step        = (u32)(pitch*65536 + 0.5f),
+		.loop        = loop,
+	};
+	Audio_Gains(volume, pan, &command.gain_left, &command.gain_right);
+
+	return (Audio_PushCommand(queue, &command) ? command.voice : 0);
+}
+
+// NOTE: Stopping a voice that already finished does nothing
+static void
+Audio_Stop(Audio_Queue* queue, Audio_Voice voice)
+{
+	Audio_Command command = {
+		.kind  = AUDIO_COMMAND_STOP,
+		.voice = voice,
+	};
+
+	Audio_PushCommand(queue, &command);
+}
+
+static void
+Audio_SetVolume(Audio_Queue* queue, Audio_Voice voice, f32 volume, f32 pan)
+{
+	Audio_Command command = {
+		.kind  = AUDIO_COMMAND_VOLUME,
+		.voice = voice,
+	};
+	Audio_Gains(volume, pan, &command.gain_left, &command.gain_right);
+
+	Audio_PushCommand(queue, &command);
+}
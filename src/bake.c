@@ -0,0 +1,976 @@
+#ifdef _WIN32
+#define STRICT 1
+#define UNICODE 1
+#define NOMINMAX 1
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#undef STRICT
+#undef UNICODE
+#undef NOMINMAX
+#undef WIN32_LEAN_AND_MEAN
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "os.h"
+#include "blit.h"
+#include "intern.h"
+#include "atlas.h"
+#include "pack.h"
+
+// NOTE: Offline asset baker. Reads .aseprite files, flattens the visible layers of every frame, quantizes the result
+//       to the default palette and lays everything out as a single atlas (see atlas.h), which goes into the asset
+//       pack as the entry "atlas" (see pack.h).
+//       Format reference: https://github.com/aseprite/aseprite/blob/main/docs/ase-file-specs.md
+
+static void
+Bake_Error(const char* path, const char* message)
+{
+	fprintf(stderr, "%s: %s\n", path, message);
+}
+
+/// Inflate (RFC 1950/1951), cels are stored as zlib streams
+
+typedef struct Inflate_Huffman
+{
+	u16 count[16];
+	u16 symbol[288];
+} Inflate_Huffman;
+
+typedef struct Inflate_State
+{
+	u8* in;
+	umm in_len;
+	umm in_pos;
+	u32 bit_buffer;
+	u32 bit_count;
+	u8* out;
+	umm out_len;
+	umm out_pos;
+	bool error;
+} Inflate_State;
+
+static u32
+Inflate_Bits(Inflate_State* state, u32 count)
+{
+	while (state->bit_count < count)
+	{
+		if (state->in_pos == state->in_len)
+		{
+			state->error = true;
+			return 0;
+		}
+
+		state->bit_buffer |= (u32)state->in[state->in_pos++] << state->bit_count;
+		state->bit_count  += 8;
+	}
+
+	u32 result = state->bit_buffer & ((1u << count) - 1);
+	state->bit_buffer >>= count;
+	state->bit_count   -= count;
+
+	return result;
+}
+
+static bool
+Inflate_Construct(Inflate_Huffman* huffman, u8* lengths, u32 count)
+{
+	for (u32 i = 0; i < 16; ++i) huffman->count[i] = 0;
+	for (u32 i = 0; i < count; ++i) huffman->count[lengths[i]] += 1;
+
+	// NOTE: reject over-subscribed codes, incomplete codes are allowed (e.g. a single distance code)
+	s32 left = 1;
+	for (u32 len = 1; len < 16; ++len)
+	{
+		left = (left << 1) - huffman->count[len];
+		if (left < 0) return false;
+	}
+
+	u16 offsets[16];
+	offsets[1] = 0;
+	for (u32 len = 1; len < 15; ++len) offsets[len + 1] = offsets[len] + huffman->count[len];
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (lengths[i] != 0) huffman->symbol[offsets[lengths[i]]++] = (u16)i;
+	}
+
+	return true;
+}
+
+static s32
+Inflate_Decode(Inflate_State* state, Inflate_Huffman* huffman)
+{
+	s32 code  = 0;
+	s32 first = 0;
+	s32 index = 0;
+
+	for (u32 len = 1; len < 16; ++len)
+	{
+		code |= (s32)Inflate_Bits(state, 1);
+
+		s32 count = huffman->count[len];
+		if (code - count < first) return huffman->symbol[index + (code - first)];
+
+		index += count;
+		first  = (first + count) << 1;
+		code <<= 1;
+	}
+
+	state->error = true;
+	return -1;
+}
+
+static bool
+Inflate_Codes(Inflate_State* state, Inflate_Huffman* lengths, Inflate_Huffman* distances)
+{
+	static const u16 length_base[29]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const u8 length_extra[29]  = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const u16 distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const u8 distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	for (;;)
+	{
+		s32 symbol = Inflate_Decode(state, lengths);
+		if (state->error) return false;
+
+		if (symbol < 256)
+		{
+			if (state->out_pos == state->out_len) return false;
+			state->out[state->out_pos++] = (u8)symbol;
+		}
+		else if (symbol == 256)
+		{
+			return true;
+		}
+		else
+		{
+			symbol -= 257;
+			if (symbol >= 29) return false;
+
+			umm length = length_base[symbol] + Inflate_Bits(state, length_extra[symbol]);
+
+			s32 distance_symbol = Inflate_Decode(state, distances);
+			if (state->error || distance_symbol < 0 || distance_symbol >= 30) return false;
+
+			umm distance = distance_base[distance_symbol] + Inflate_Bits(state, distance_extra[distance_symbol]);
+
+			if (state->error || distance > state->out_pos || length > state->out_len - state->out_pos) return false;
+
+			for (umm i = 0; i < length; ++i, ++state->out_pos)
+			{
+				state->out[state->out_pos] = state->out[state->out_pos - distance];
+			}
+		}
+	}
+}
+
+static bool
+Inflate(u8* in, umm in_len, u8* out, umm out_len)
+{
+	Inflate_State state = {
+		.in      = in,
+		.in_len  = in_len,
+		.out     = out,
+		.out_len = out_len,
+	};
+
+	// NOTE: zlib header, only deflate without a preset dictionary is valid
+	if (in_len < 2 || (in[0] & 0x0F) != 8 || ((in[0] << 8) | in[1]) % 31 != 0 || (in[1] & 0x20)) return false;
+	state.in_pos = 2;
+
+	Inflate_Huffman lengths;
+	Inflate_Huffman distances;
+
+	for (bool last = false; !last;)
+	{
+		last = (bool)Inflate_Bits(&state, 1);
+		u32 type = Inflate_Bits(&state, 2);
+
+		if (state.error) return false;
+
+		if (type == 0)
+		{
+			state.bit_buffer = 0;
+			state.bit_count  = 0;
+
+			if (in_len - state.in_pos < 4) return false;
+			u32 len  = in[state.in_pos] | (in[state.in_pos+1] << 8);
+			u32 nlen = in[state.in_pos+2] | (in[state.in_pos+3] << 8);
+			state.in_pos += 4;
+
+			if (len != (~nlen & 0xFFFF) || in_len - state.in_pos < len || out_len - state.out_pos < len) return false;
+
+			memcpy(out + state.out_pos, in + state.in_pos, len);
+			state.in_pos  += len;
+			state.out_pos += len;
+		}
+		else if (type == 1)
+		{
+			u8 code_lengths[288 + 30];
+			u32 i = 0;
+			for (; i < 144; ++i) code_lengths[i] = 8;
+			for (; i < 256; ++i) code_lengths[i] = 9;
+			for (; i < 280; ++i) code_lengths[i] = 7;
+			for (; i < 288; ++i) code_lengths[i] = 8;
+			for (; i < 288 + 30; ++i) code_lengths[i] = 5;
+
+			Inflate_Construct(&lengths, code_lengths, 288);
+			Inflate_Construct(&distances, code_lengths + 288, 30);
+
+			if (!Inflate_Codes(&state, &lengths, &distances)) return false;
+		}
+		else if (type == 2)
+		{
+			static const u8 order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+			u32 length_count   = Inflate_Bits(&state, 5) + 257;
+			u32 distance_count = Inflate_Bits(&state, 5) + 1;
+			u32 code_count     = Inflate_Bits(&state, 4) + 4;
+
+			if (state.error || length_count > 286 || distance_count > 30) return false;
+
+			u8 code_lengths[288 + 30] = {0};
+			for (u32 i = 0; i < code_count; ++i) code_lengths[order[i]] = (u8)Inflate_Bits(&state, 3);
+
+			if (!Inflate_Construct(&lengths, code_lengths, 19)) return false;
+
+			for (u32 i = 0; i < length_count + distance_count;)
+			{
+				s32 symbol = Inflate_Decode(&state, &lengths);
+				if (state.error) return false;
+
+				if (symbol < 16)
+				{
+					code_lengths[i++] = (u8)symbol;
+				}
+				else
+				{
+					u8 value  = 0;
+					u32 count = 0;
+
+					if (symbol == 16)
+					{
+						if (i == 0) return false;
+						value = code_lengths[i - 1];
+						count = 3 + Inflate_Bits(&state, 2);
+					}
+					else if (symbol == 17) count = 3  + Inflate_Bits(&state, 3);
+					else                   count = 11 + Inflate_Bits(&state, 7);
+
+					if (state.error || i + count > length_count + distance_count) return false;
+					while (count--) code_lengths[i++] = value;
+				}
+			}
+
+			if (code_lengths[256] == 0) return false;
+
+			if (!Inflate_Construct(&lengths, code_lengths, length_count))                    return false;
+			if (!Inflate_Construct(&distances, code_lengths + length_count, distance_count)) return false;
+
+			if (!Inflate_Codes(&state, &lengths, &distances)) return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return (state.out_pos == out_len);
+}
+
+/// Aseprite parsing
+
+#define ASE_HEADER_MAGIC 0xA5E0
+#define ASE_FRAME_MAGIC  0xF1FA
+
+#define ASE_CHUNK_OLD_PALETTE_256 0x0004
+#define ASE_CHUNK_OLD_PALETTE_64  0x0011
+#define ASE_CHUNK_LAYER           0x2004
+#define ASE_CHUNK_CEL             0x2005
+#define ASE_CHUNK_TAGS            0x2018
+#define ASE_CHUNK_PALETTE         0x2019
+
+#define ASE_LAYER_VISIBLE    0x0001
+#define ASE_LAYER_BACKGROUND 0x0008
+#define ASE_LAYER_REFERENCE  0x0040
+
+#define ASE_MAX_LAYERS 256
+#define ASE_MAX_FRAMES 1024
+
+typedef struct Ase_Reader
+{
+	u8* data;
+	umm len;
+	umm pos;
+	bool error;
+} Ase_Reader;
+
+static u8
+Ase_U8(Ase_Reader* reader)
+{
+	if (reader->len - reader->pos < 1) { reader->error = true; return 0; }
+	return reader->data[reader->pos++];
+}
+
+static u16
+Ase_U16(Ase_Reader* reader)
+{
+	if (reader->len - reader->pos < 2) { reader->error = true; return 0; }
+	u16 result = (u16)(reader->data[reader->pos] | (reader->data[reader->pos+1] << 8));
+	reader->pos += 2;
+	return result;
+}
+
+static u32
+Ase_U32(Ase_Reader* reader)
+{
+	u32 lo = Ase_U16(reader);
+	u32 hi = Ase_U16(reader);
+	return lo | (hi << 16);
+}
+
+static void
+Ase_Skip(Ase_Reader* reader, umm count)
+{
+	if (reader->len - reader->pos < count) { reader->error = true; reader->pos = reader->len; }
+	else reader->pos += count;
+}
+
+static String
+Ase_String(Ase_Reader* reader)
+{
+	u16 len = Ase_U16(reader);
+	String result = { .data = reader->data + reader->pos, .len = len };
+	Ase_Skip(reader, len);
+	return (reader->error ? (String){0} : result);
+}
+
+typedef struct Ase_Layer
+{
+	u16 flags;
+	u16 type;
+	u16 child_level;
+	u8 opacity;
+	bool visible;
+} Ase_Layer;
+
+typedef struct Ase_Cel
+{
+	s16 x;
+	s16 y;
+	u16 width;
+	u16 height;
+	u8 opacity;
+	u8* pixels;
+} Ase_Cel;
+
+typedef struct Ase_File
+{
+	u16 width;
+	u16 height;
+	u16 depth;
+	u8 transparent_index;
+	u32 palette[256];
+	u32 frame_count;
+	u16 durations[ASE_MAX_FRAMES];
+	u32 layer_count;
+	Ase_Layer layers[ASE_MAX_LAYERS];
+	Ase_Cel* cels; // NOTE: frame_count*layer_count, linked cels are resolved while parsing
+	u32 tag_count;
+	Atlas_Tag tags[256];
+} Ase_File;
+
+static bool
+Ase_SetName(Atlas_Name* name, String string)
+{
+	bool fits = (string.len <= sizeof(name->data));
+
+	name->len = (u8)(fits ? string.len : sizeof(name->data));
+	memcpy(name->data, string.data, name->len);
+
+	return fits;
+}
+
+static void
+Ase_ParsePalette(Ase_Reader* reader, u16 type, Ase_File* file)
+{
+	if (type == ASE_CHUNK_PALETTE)
+	{
+		u32 size  = Ase_U32(reader);
+		u32 first = Ase_U32(reader);
+		u32 last  = Ase_U32(reader);
+		Ase_Skip(reader, 8);
+
+		for (u32 i = first; i <= last && i < size && !reader->error; ++i)
+		{
+			u16 flags = Ase_U16(reader);
+			u8 r = Ase_U8(reader), g = Ase_U8(reader), b = Ase_U8(reader), a = Ase_U8(reader);
+			if (flags & 1) Ase_String(reader);
+
+			if (i < 256) file->palette[i] = ((u32)a << 24) | ((u32)r << 16) | ((u32)g << 8) | b;
+		}
+	}
+	else
+	{
+		u16 packets = Ase_U16(reader);
+
+		u32 index = 0;
+		for (u32 i = 0; i < packets && !reader->error; ++i)
+		{
+			index += Ase_U8(reader);
+			u32 count = Ase_U8(reader);
+			if (count == 0) count = 256;
+
+			for (u32 j = 0; j < count && !reader->error; ++j, ++index)
+			{
+				u32 r = Ase_U8(reader), g = Ase_U8(reader), b = Ase_U8(reader);
+				if (type == ASE_CHUNK_OLD_PALETTE_64) r = r*255/63, g = g*255/63, b = b*255/63;
+
+				if (index < 256) file->palette[index] = 0xFF000000 | (r << 16) | (g << 8) | b;
+			}
+		}
+	}
+}
+
+static bool
+Ase_Parse(const char* path, u8* data, umm len, Bump* bump, Ase_File* file)
+{
+	Ase_Reader reader = { .data = data, .len = len };
+
+	Ase_U32(&reader);
+	u16 magic          = Ase_U16(&reader);
+	file->frame_count  = Ase_U16(&reader);
+	file->width        = Ase_U16(&reader);
+	file->height       = Ase_U16(&reader);
+	file->depth        = Ase_U16(&reader);
+	u32 flags          = Ase_U32(&reader);
+	Ase_Skip(&reader, 2 + 4 + 4);
+	file->transparent_index = Ase_U8(&reader);
+
+	if (reader.error || magic != ASE_HEADER_MAGIC)
+	{
+		Bake_Error(path, "not an aseprite file");
+		return false;
+	}
+
+	if (file->depth != 32 && file->depth != 16 && file->depth != 8)
+	{
+		Bake_Error(path, "unsupported color depth");
+		return false;
+	}
+
+	if (file->frame_count > ASE_MAX_FRAMES)
+	{
+		Bake_Error(path, "too many frames");
+		return false;
+	}
+
+	bool layer_opacity_valid = (flags & 1);
+
+	u32 bytes_per_pixel = file->depth/8;
+
+	// NOTE: layers are only declared in the first frame, the cel table is sized once all of them are known
+	file->cels = 0;
+
+	reader.pos = 128;
+	for (u32 frame = 0; frame < file->frame_count; ++frame)
+	{
+		umm frame_start = reader.pos;
+		u32 frame_size  = Ase_U32(&reader);
+		u16 frame_magic = Ase_U16(&reader);
+		u16 old_chunks  = Ase_U16(&reader);
+		file->durations[frame] = Ase_U16(&reader);
+		Ase_Skip(&reader, 2);
+		u32 new_chunks  = Ase_U32(&reader);
+
+		if (reader.error || frame_magic != ASE_FRAME_MAGIC || frame_size > len - frame_start)
+		{
+			Bake_Error(path, "corrupt frame header");
+			return false;
+		}
+
+		u32 chunk_count = (new_chunks != 0 ? new_chunks : old_chunks);
+
+		for (u32 chunk = 0; chunk < chunk_count; ++chunk)
+		{
+			umm chunk_start = reader.pos;
+			u32 chunk_size  = Ase_U32(&reader);
+			u16 chunk_type  = Ase_U16(&reader);
+
+			if (reader.error || chunk_size < 6 || chunk_size > frame_start + frame_size - chunk_start)
+			{
+				Bake_Error(path, "corrupt chunk header");
+				return false;
+			}
+
+			Ase_Reader chunk_reader = { .data = data, .len = chunk_start + chunk_size, .pos = reader.pos };
+
+			if (chunk_type == ASE_CHUNK_LAYER)
+			{
+				if (file->layer_count == ASE_MAX_LAYERS || file->cels != 0)
+				{
+					Bake_Error(path, "too many layers, or layers declared after the first frame");
+					return false;
+				}
+
+				Ase_Layer* layer = &file->layers[file->layer_count++];
+				layer->flags       = Ase_U16(&chunk_reader);
+				layer->type        = Ase_U16(&chunk_reader);
+				layer->child_level = Ase_U16(&chunk_reader);
+				Ase_Skip(&chunk_reader, 2 + 2 + 2);
+				layer->opacity     = Ase_U8(&chunk_reader);
+
+				if (!layer_opacity_valid) layer->opacity = 255;
+
+				// NOTE: a layer inside a hidden group is hidden, walk back to the closest enclosing group
+				layer->visible = ((layer->flags & ASE_LAYER_VISIBLE) && !(layer->flags & ASE_LAYER_REFERENCE));
+				for (u32 i = file->layer_count-1; i-- > 0 && layer->child_level > 0;)
+				{
+					if (file->layers[i].child_level < layer->child_level)
+					{
+						layer->visible = layer->visible && file->layers[i].visible;
+						break;
+					}
+				}
+
+				if (layer->type == 2) fprintf(stderr, "%s: tilemap layers are not supported and will be skipped\n", path);
+			}
+			else if (chunk_type == ASE_CHUNK_CEL)
+			{
+				if (file->cels == 0)
+				{
+					file->cels = Bump_Push(bump, (umm)file->frame_count*file->layer_count*sizeof(Ase_Cel), 8);
+					memset(file->cels, 0, (umm)file->frame_count*file->layer_count*sizeof(Ase_Cel));
+				}
+
+				u16 layer_index = Ase_U16(&chunk_reader);
+				s16 x           = (s16)Ase_U16(&chunk_reader);
+				s16 y           = (s16)Ase_U16(&chunk_reader);
+				u8 opacity      = Ase_U8(&chunk_reader);
+				u16 cel_type    = Ase_U16(&chunk_reader);
+				Ase_Skip(&chunk_reader, 2 + 5);
+
+				if (chunk_reader.error || layer_index >= file->layer_count)
+				{
+					Bake_Error(path, "corrupt cel");
+					return false;
+				}
+
+				Ase_Cel* cel = &file->cels[frame*file->layer_count + layer_index];
+
+				if (cel_type == 1)
+				{
+					u16 linked_frame = Ase_U16(&chunk_reader);
+					if (chunk_reader.error || linked_frame >= frame)
+					{
+						Bake_Error(path, "corrupt linked cel");
+						return false;
+					}
+
+					*cel = file->cels[linked_frame*file->layer_count + layer_index];
+				}
+				else if (cel_type == 0 || cel_type == 2)
+				{
+					u16 width  = Ase_U16(&chunk_reader);
+					u16 height = Ase_U16(&chunk_reader);
+
+					umm size = (umm)width*height*bytes_per_pixel;
+					u8* pixels = Bump_Push(bump, size, 8);
+
+					u8* payload = chunk_reader.data + chunk_reader.pos;
+					umm payload_len = chunk_reader.len - chunk_reader.pos;
+
+					if (chunk_reader.error || (cel_type == 0 ? payload_len < size : !Inflate(payload, payload_len, pixels, size)))
+					{
+						Bake_Error(path, "corrupt cel pixel data");
+						return false;
+					}
+
+					if (cel_type == 0) memcpy(pixels, payload, size);
+
+					*cel = (Ase_Cel){
+						.x       = x,
+						.y       = y,
+						.width   = width,
+						.height  = height,
+						.opacity = opacity,
+						.pixels  = pixels,
+					};
+				}
+			}
+			else if (chunk_type == ASE_CHUNK_TAGS)
+			{
+				u16 tag_count = Ase_U16(&chunk_reader);
+				Ase_Skip(&chunk_reader, 8);
+
+				for (u32 i = 0; i < tag_count && !chunk_reader.error; ++i)
+				{
+					u16 from      = Ase_U16(&chunk_reader);
+					u16 to        = Ase_U16(&chunk_reader);
+					u8 direction  = Ase_U8(&chunk_reader);
+					u16 repeat    = Ase_U16(&chunk_reader);
+					Ase_Skip(&chunk_reader, 6 + 3 + 1);
+					String name   = Ase_String(&chunk_reader);
+
+					if (chunk_reader.error || from > to || to >= file->frame_count || file->tag_count == 256)
+					{
+						Bake_Error(path, "corrupt or too many tags");
+						return false;
+					}
+
+					Atlas_Tag* tag = &file->tags[file->tag_count++];
+					*tag = (Atlas_Tag){
+						.from      = from,
+						.to        = to,
+						.direction = (direction <= ATLAS_DIRECTION_PING_PONG_REVERSE ? direction : ATLAS_DIRECTION_FORWARD),
+						.repeat    = repeat,
+					};
+
+					if (!Ase_SetName(&tag->name, name)) fprintf(stderr, "%s: tag name \"%.*s\" truncated\n", path, (int)name.len, name.data);
+				}
+			}
+			else if (chunk_type == ASE_CHUNK_PALETTE || chunk_type == ASE_CHUNK_OLD_PALETTE_256 || chunk_type == ASE_CHUNK_OLD_PALETTE_64)
+			{
+				// NOTE: new files carry both, the new chunk follows the old one and wins
+				Ase_ParsePalette(&chunk_reader, chunk_type, file);
+			}
+
+			if (chunk_reader.error)
+			{
+				Bake_Error(path, "truncated chunk");
+				return false;
+			}
+
+			reader.pos = chunk_start + chunk_size;
+		}
+
+		reader.pos = frame_start + frame_size;
+	}
+
+	if (file->cels == 0)
+	{
+		file->cels = Bump_Push(bump, (umm)file->frame_count*file->layer_count*sizeof(Ase_Cel) + 1, 8);
+		memset(file->cels, 0, (umm)file->frame_count*file->layer_count*sizeof(Ase_Cel));
+	}
+
+	return true;
+}
+
+/// Flattening and quantization
+
+static u32
+Ase_PixelColor(Ase_File* file, Ase_Layer* layer, u8* pixel)
+{
+	u32 result = 0;
+
+	if (file->depth == 32)
+	{
+		result = ((u32)pixel[3] << 24) | ((u32)pixel[0] << 16) | ((u32)pixel[1] << 8) | pixel[2];
+	}
+	else if (file->depth == 16)
+	{
+		result = ((u32)pixel[1] << 24) | ((u32)pixel[0] << 16) | ((u32)pixel[0] << 8) | pixel[0];
+	}
+	else if (pixel[0] != file->transparent_index || (layer->flags & ASE_LAYER_BACKGROUND))
+	{
+		result = file->palette[pixel[0]] | 0xFF000000;
+	}
+
+	return result;
+}
+
+// NOTE: Composites with the normal blend mode, other blend modes are treated as normal since the result is reduced
+//       to 8 colors anyway
+static void
+Ase_FlattenFrame(Ase_File* file, u32 frame, f32* canvas)
+{
+	u32 bytes_per_pixel = file->depth/8;
+
+	memset(canvas, 0, (umm)file->width*file->height*4*sizeof(f32));
+
+	for (u32 layer_index = 0; layer_index < file->layer_count; ++layer_index)
+	{
+		Ase_Layer* layer = &file->layers[layer_index];
+		Ase_Cel* cel     = &file->cels[frame*file->layer_count + layer_index];
+
+		if (!layer->visible || layer->type != 0 || cel->pixels == 0) continue;
+
+		f32 opacity = (layer->opacity/255.0f)*(cel->opacity/255.0f);
+
+		for (s32 j = 0; j < cel->height; ++j)
+		{
+			s32 y = cel->y + j;
+			if (y < 0 || y >= file->height) continue;
+
+			for (s32 i = 0; i < cel->width; ++i)
+			{
+				s32 x = cel->x + i;
+				if (x < 0 || x >= file->width) continue;
+
+				u32 color = Ase_PixelColor(file, layer, cel->pixels + ((umm)j*cel->width + i)*bytes_per_pixel);
+
+				f32 src_a = (color >> 24)/255.0f*opacity;
+				f32* dst  = canvas + ((umm)y*file->width + x)*4;
+				f32 out_a = src_a + dst[3]*(1 - src_a);
+
+				if (out_a > 0)
+				{
+					for (u32 c = 0; c < 3; ++c)
+					{
+						f32 src_c = ((color >> (16 - 8*c)) & 0xFF)/255.0f;
+						dst[c] = (src_c*src_a + dst[c]*dst[3]*(1 - src_a))/out_a;
+					}
+				}
+
+				dst[3] = out_a;
+			}
+		}
+	}
+}
+
+static u8
+Quantize(f32* color, u32* palette, u32 palette_size)
+{
+	if (color[3] < 0.5f) return ATLAS_TRANSPARENT_INDEX;
+
+	u8 best_index = 0;
+	f32 best_dist = 1e30f;
+
+	for (u32 i = 0; i < palette_size; ++i)
+	{
+		f32 dist = 0;
+		for (u32 c = 0; c < 3; ++c)
+		{
+			f32 d = color[c]*255.0f - (f32)((palette[i] >> (16 - 8*c)) & 0xFF);
+			dist += d*d;
+		}
+
+		if (dist < best_dist)
+		{
+			best_dist  = dist;
+			best_index = (u8)i;
+		}
+	}
+
+	return best_index;
+}
+
+/// Atlas output
+
+typedef struct Bake_Output
+{
+	Bump sprites;
+	Bump frames;
+	Bump tags;
+	Bump pixels;
+	u32 sprite_count;
+	u32 frame_count;
+	u32 tag_count;
+} Bake_Output;
+
+static bool
+ReadEntireFile(const char* path, Bump* bump, u8** data, umm* len)
+{
+	bool succeeded = false;
+
+	FILE* file = fopen(path, "rb");
+	if (file != 0)
+	{
+		if (fseek(file, 0, SEEK_END) == 0)
+		{
+			long size = ftell(file);
+			if (size >= 0 && (u64)size < bump->reserved - bump->cursor && fseek(file, 0, SEEK_SET) == 0)
+			{
+				*data = Bump_Push(bump, (umm)size, 8);
+				*len  = (umm)size;
+
+				succeeded = (fread(*data, 1, (umm)size, file) == (umm)size);
+			}
+		}
+
+		fclose(file);
+	}
+
+	return succeeded;
+}
+
+static bool
+BakeAseprite(const char* path, Bump* scratch, Bake_Output* output)
+{
+	Bump_Mark mark = Bump_GetMark(scratch);
+
+	u8* data;
+	umm len;
+	if (!ReadEntireFile(path, scratch, &data, &len))
+	{
+		Bake_Error(path, "failed to read file");
+		return false;
+	}
+
+	Ase_File* file = Bump_Push(scratch, sizeof(Ase_File), 8);
+	memset(file, 0, sizeof(Ase_File));
+
+	if (!Ase_Parse(path, data, len, scratch, file)) return false;
+
+	u32 palette[8] = AZUR_DEFAULT_PALETTE;
+
+	/// Sprite name is the file name without directory and extension
+	String name = { .data = (u8*)path, .len = (u32)strlen(path) };
+	for (u32 i = name.len; i > 0; --i)
+	{
+		if (path[i-1] == '/' || path[i-1] == '\\')
+		{
+			name.data += i;
+			name.len  -= i;
+			break;
+		}
+	}
+	for (u32 i = name.len; i > 0; --i)
+	{
+		if (name.data[i-1] == '.')
+		{
+			name.len = i-1;
+			break;
+		}
+	}
+
+	Atlas_Sprite* sprite = Bump_Push(&output->sprites, sizeof(Atlas_Sprite), 8);
+	*sprite = (Atlas_Sprite){
+		.width       = file->width,
+		.height      = file->height,
+		.first_frame = output->frame_count,
+		.frame_count = file->frame_count,
+		.first_tag   = output->tag_count,
+		.tag_count   = file->tag_count,
+	};
+
+	if (!Ase_SetName(&sprite->name, name)) fprintf(stderr, "%s: sprite name truncated\n", path);
+
+	f32* canvas = Bump_Push(scratch, (umm)file->width*file->height*4*sizeof(f32), 16);
+
+	for (u32 frame = 0; frame < file->frame_count; ++frame)
+	{
+		Ase_FlattenFrame(file, frame, canvas);
+
+		u8* pixels = Bump_Push(&output->pixels, (umm)file->width*file->height, ATLAS_ALIGNMENT);
+		for (umm i = 0; i < (umm)file->width*file->height; ++i) pixels[i] = Quantize(canvas + i*4, palette, 8);
+
+		Atlas_Frame* atlas_frame = Bump_Push(&output->frames, sizeof(Atlas_Frame), 8);
+		*atlas_frame = (Atlas_Frame){
+			.pixel_offset = (u64)(pixels - output->pixels.memory), // NOTE: rebased when the file is written
+			.duration_ms  = file->durations[frame],
+		};
+
+		sprite->total_duration_ms += file->durations[frame];
+	}
+
+	for (u32 i = 0; i < file->tag_count; ++i)
+	{
+		Atlas_Tag* tag = Bump_Push(&output->tags, sizeof(Atlas_Tag), 8);
+		*tag = file->tags[i];
+	}
+
+	output->sprite_count += 1;
+	output->frame_count  += file->frame_count;
+	output->tag_count    += file->tag_count;
+
+	Bump_PopToMark(scratch, mark);
+
+	return true;
+}
+
+static u64
+AlignUp(u64 value, u64 alignment)
+{
+	return (value + (alignment-1)) & ~(alignment-1);
+}
+
+// NOTE: Lays out the atlas on bump and returns its size
+static u64
+BuildAtlas(Bump* bump, Bake_Output* output, u8** atlas)
+{
+	Atlas_Header header = {
+		.magic        = ATLAS_MAGIC,
+		.version      = ATLAS_VERSION,
+		.sprite_count = output->sprite_count,
+		.frame_count  = output->frame_count,
+		.tag_count    = output->tag_count,
+	};
+
+	header.sprite_offset = AlignUp(sizeof(Atlas_Header), ATLAS_ALIGNMENT);
+	header.frame_offset  = AlignUp(header.sprite_offset + output->sprites.cursor, ATLAS_ALIGNMENT);
+	header.tag_offset    = AlignUp(header.frame_offset  + output->frames.cursor,  ATLAS_ALIGNMENT);
+	header.pixel_offset  = AlignUp(header.tag_offset    + output->tags.cursor,    ATLAS_ALIGNMENT);
+	header.file_size     = AlignUp(header.pixel_offset  + output->pixels.cursor,  ATLAS_ALIGNMENT);
+
+	Atlas_Frame* frames = (Atlas_Frame*)output->frames.memory;
+	for (u32 i = 0; i < output->frame_count; ++i) frames[i].pixel_offset += header.pixel_offset;
+
+	*atlas = Bump_Push(bump, (umm)header.file_size, ATLAS_ALIGNMENT);
+	memset(*atlas, 0, (umm)header.file_size);
+
+	memcpy(*atlas,                        &header,                sizeof(header));
+	memcpy(*atlas + header.sprite_offset, output->sprites.memory, (umm)output->sprites.cursor);
+	memcpy(*atlas + header.frame_offset,  output->frames.memory,  (umm)output->frames.cursor);
+	memcpy(*atlas + header.tag_offset,    output->tags.memory,    (umm)output->tags.cursor);
+	memcpy(*atlas + header.pixel_offset,  output->pixels.memory,  (umm)output->pixels.cursor);
+
+	return header.file_size;
+}
+
+int
+main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s OUTPUT.pack INPUT.aseprite...\n", argv[0]);
+		return 1;
+	}
+
+	Bump scratch;
+	Bump image;
+	Bake_Output output = {0};
+	if (!Bump_Create(1ULL << 32, BUMP_DEFAULT_COMMIT_CHUNK, 0, &scratch)        ||
+	    !Bump_Create(1ULL << 34, BUMP_DEFAULT_COMMIT_CHUNK, 0, &image)          ||
+	    !Bump_Create(1ULL << 24, BUMP_DEFAULT_COMMIT_CHUNK, 0, &output.sprites) ||
+	    !Bump_Create(1ULL << 24, BUMP_DEFAULT_COMMIT_CHUNK, 0, &output.frames)  ||
+	    !Bump_Create(1ULL << 24, BUMP_DEFAULT_COMMIT_CHUNK, 0, &output.tags)    ||
+	    !Bump_Create(1ULL << 32, BUMP_DEFAULT_COMMIT_CHUNK, 0, &output.pixels))
+	{
+		fprintf(stderr, "Failed to allocate memory\n");
+		return 1;
+	}
+
+	for (int i = 2; i < argc; ++i)
+	{
+		if (!BakeAseprite(argv[i], &scratch, &output)) return 1;
+	}
+
+	u8* atlas;
+	u64 atlas_size = BuildAtlas(&scratch, &output, &atlas);
+
+	String names[] = { STRING("atlas") };
+	u8* data[]     = { atlas };
+	u64 sizes[]    = { atlas_size };
+
+	Pack_Header* pack = Pack_Build(&image, &scratch, names, data, sizes, sizeof(names)/sizeof(names[0]));
+
+	FILE* file = fopen(argv[1], "wb");
+	bool succeeded = (file != 0 && fwrite(pack, 1, (umm)pack->file_size, file) == pack->file_size);
+	if (file != 0) succeeded &= (fclose(file) == 0);
+
+	if (!succeeded)
+	{
+		Bake_Error(argv[1], "failed to write pack");
+		return 1;
+	}
+
+	printf("%s: %u sprites, %u frames, %u tags, atlas of %llu bytes packed into %llu\n", argv[1], output.sprite_count,
+	       output.frame_count, output.tag_count, (unsigned long long)atlas_size, (unsigned long long)Pack_Entries(pack)[0].packed_size);
+
+	return 0;
+}
@@ -0,0 +1,2582 @@
+#ifdef _WIN32
+#define STRICT 1
+#define UNICODE 1
+#define NOMINMAX 1
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#undef STRICT
+#undef UNICODE
+#undef NOMINMAX
+#undef WIN32_LEAN_AND_MEAN
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "blit.h"
+#include "tilemap.h"
+#include "font.h"
+#include "intern.h"
+#include "entity.h"
+#include "spatial.h"
+#include "audio.h"
+#include "atlas.h"
+#include "pack.h"
+#include "os.h"
+#include "profile.h"
+#include "jobs.h"
+#include "replay.h"
+#include "present.h"
+#include "mixer.h"
+#include "rewind.h"
+#include "framequeue.h"
+#include "bench.h"
+
+static u32
+Random(u32* state)
+{
+	u32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// NOTE: The obvious per-pixel loop, every pixel is clipped, flipped and keyed on its own
+static void
+BlitNaive(Framebuffer* framebuffer, Sprite* sprite, s32 x, s32 y, u32 flags, Blit_Remap* remap)
+{
+	for (s32 j = 0; j < (s32)sprite->height; ++j)
+	{
+		for (s32 i = 0; i < (s32)sprite->width; ++i)
+		{
+			s32 dx = x + i;
+			s32 dy = y + j;
+			if (dx < 0 || dx >= AZUR_WIDTH || dy < 0 || dy >= AZUR_HEIGHT) continue;
+
+			s32 sx = ((flags & BLIT_FLIP_X) ? (s32)sprite->width  - 1 - i : i);
+			s32 sy = ((flags & BLIT_FLIP_Y) ? (s32)sprite->height - 1 - j : j);
+
+			u8 index = sprite->pixels[sy*sprite->stride + sx];
+			if (!(flags & BLIT_OPAQUE) && index == sprite->color_key) continue;
+
+			framebuffer->pixels[dy][dx] = (remap != 0 ? Blit_RemapIndex(remap, index) : index);
+		}
+	}
+
+	if (x < AZUR_WIDTH && x + (s32)sprite->width > 0) Framebuffer_MarkRows(framebuffer, y, (s32)sprite->height);
+}
+
+typedef void Blit_Func(Framebuffer* framebuffer, Sprite* sprite, s32 x, s32 y, u32 flags, Blit_Remap* remap);
+
+typedef struct Blit_Command
+{
+	s32 x;
+	s32 y;
+	u32 flags;
+} Blit_Command;
+
+#define BLIT_COMMAND_COUNT 4096
+
+static Framebuffer Framebuffers[2];
+static Blit_Command Commands[BLIT_COMMAND_COUNT];
+static u8 SpritePixels[128*128];
+
+typedef struct Blit_Case
+{
+	Blit_Func* func;
+	Framebuffer* framebuffer;
+	Sprite* sprite;
+	Blit_Remap* remap;
+} Blit_Case;
+
+static void
+BenchBlitCommands(void* data, u64 count)
+{
+	Blit_Case* blit_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		Blit_Command* command = &Commands[i % BLIT_COMMAND_COUNT];
+		blit_case->func(blit_case->framebuffer, blit_case->sprite, command->x, command->y, command->flags, blit_case->remap);
+	}
+}
+
+static bool
+BenchBlit(u32 size, u32 flags, bool remapped)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "blit/%s%s%s/%ux%u/",
+	         ((flags & BLIT_OPAQUE) ? "opaque" : "keyed"),
+	         ((flags & BLIT_FLIP_X) ? "_flip" : ""),
+	         (remapped ? "_remap" : ""), size, size);
+
+	if (!Bench_Enabled(name)) return true;
+
+	u32 seed = 0x1234567 + size*31 + flags;
+
+	// NOTE: 8 opaque colors plus the color key, roughly a quarter of the sprite is transparent
+	for (u32 i = 0; i < size*size; ++i)
+	{
+		u32 r = Random(&seed);
+		SpritePixels[i] = ((r & 0x30) == 0 ? 8 : (u8)(r & 0x7));
+	}
+
+	Sprite sprite = {
+		.pixels    = SpritePixels,
+		.width     = size,
+		.height    = size,
+		.stride    = size,
+		.color_key = 8,
+	};
+
+	Blit_Remap remap = { .map = { 7, 6, 5, 4, 3, 2, 1, 0, 8, 9, 10, 11, 12, 13, 14, 15 } };
+
+	u64 pixels = 0;
+	for (u32 i = 0; i < BLIT_COMMAND_COUNT; ++i)
+	{
+		Commands[i] = (Blit_Command){
+			.x     = (s32)(Random(&seed) % (AZUR_WIDTH  + size)) - (s32)size,
+			.y     = (s32)(Random(&seed) % (AZUR_HEIGHT + size)) - (s32)size,
+			.flags = flags,
+		};
+
+		Blit_Rect rect;
+		if (Blit_Clip(&sprite, Commands[i].x, Commands[i].y, flags, &rect)) pixels += (u64)rect.width*rect.height;
+	}
+
+	Blit_Remap* remap_ptr = (remapped ? &remap : 0);
+
+	/// Verify
+	Blit_Case naive  = { BlitNaive,         &Framebuffers[0], &sprite, remap_ptr };
+	Blit_Case scalar = { Blit_SpriteScalar, &Framebuffers[1], &sprite, remap_ptr };
+	Blit_Case fast   = { Blit_Sprite,       &Framebuffers[1], &sprite, remap_ptr };
+
+	memset(Framebuffers, 0, sizeof(Framebuffers));
+	BenchBlitCommands(&naive, BLIT_COMMAND_COUNT);
+	BenchBlitCommands(&fast,  BLIT_COMMAND_COUNT);
+
+	if (memcmp(&Framebuffers[0], &Framebuffers[1], sizeof(Framebuffer)) != 0)
+	{
+		fprintf(stderr, "%s: output differs from naive loop\n", name);
+		return false;
+	}
+
+	// NOTE: pixels are one byte, so GB/s reads as pixels per nanosecond
+	f64 pixels_per_blit = (f64)pixels/BLIT_COMMAND_COUNT;
+	umm name_len = strlen(name);
+
+	snprintf(name + name_len, sizeof(name) - name_len, "naive");
+	Bench_Run(name, BenchBlitCommands, &naive, pixels_per_blit);
+	snprintf(name + name_len, sizeof(name) - name_len, "scalar");
+	Bench_Run(name, BenchBlitCommands, &scalar, pixels_per_blit);
+	snprintf(name + name_len, sizeof(name) - name_len, "simd");
+	Bench_Run(name, BenchBlitCommands, &fast, pixels_per_blit);
+
+	return true;
+}
+
+/// Bump
+
+typedef struct Bump_Case
+{
+	Bump* bump;
+	umm size;
+	u8 alignment;
+} Bump_Case;
+
+static void
+BenchBumpPush(void* data, u64 count)
+{
+	Bump_Case* bump_case = data;
+	Bump* bump = bump_case->bump;
+
+	// NOTE: the arena is committed up front and wraps around, so no push in the timed loop goes to the OS
+	for (u64 i = 0; i < count; ++i)
+	{
+		if (bump->cursor > bump->reserved/2) bump->cursor = 0;
+		BenchSink = (u64)(umm)Bump_Push(bump, bump_case->size, bump_case->alignment);
+	}
+}
+
+static void
+BenchBumpMark(void* data, u64 count)
+{
+	Bump_Case* bump_case = data;
+	Bump* bump = bump_case->bump;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		Bump_Mark mark = Bump_GetMark(bump);
+		BenchSink = (u64)(umm)Bump_Push(bump, bump_case->size, bump_case->alignment);
+		Bump_PopToMark(bump, mark);
+	}
+}
+
+static bool
+BenchBump(void)
+{
+	Bump bump;
+	if (!Bump_Create(1ULL << 26, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_COMMIT_ALL, &bump)) return false;
+
+	umm sizes[]      = { 16, 256 };
+	u8 alignments[]  = { 1, 8, 16, 64 };
+
+	for (umm i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i)
+	{
+		for (umm j = 0; j < sizeof(alignments)/sizeof(alignments[0]); ++j)
+		{
+			// NOTE: an odd cursor makes every aligned push actually align
+			bump.cursor = 1;
+
+			Bump_Case bump_case = { &bump, sizes[i], alignments[j] };
+
+			char name[64];
+			snprintf(name, sizeof(name), "bump/push/size=%u/align=%u", (u32)sizes[i], alignments[j]);
+			Bench_Run(name, BenchBumpPush, &bump_case, 0);
+		}
+	}
+
+	bump.cursor = 0;
+	Bump_Case mark_case = { &bump, 256, 16 };
+	Bench_Run("bump/push_pop_to_mark/size=256", BenchBumpMark, &mark_case, 0);
+
+	Bump_Destroy(&bump);
+
+	return true;
+}
+
+/// String
+
+typedef struct String_Case
+{
+	String strings[2];
+} String_Case;
+
+// NOTE: The byte loop String_Equal used to be, kept as the baseline
+static bool
+StringEqualBytewise(String s0, String s1)
+{
+	bool result = (s0.len == s1.len);
+
+	for (umm i = 0; i < s0.len && result; ++i)
+	{
+		if (s0.data[i] != s1.data[i])
+		{
+			result = false;
+		}
+	}
+
+	return result;
+}
+
+static void
+BenchStringEqualBytewise(void* data, u64 count)
+{
+	u64 equal = 0;
+	for (u64 i = 0; i < count; ++i)
+	{
+		String_Case* opaque = Bench_Opaque(data);
+		equal += StringEqualBytewise(opaque->strings[0], opaque->strings[1]);
+	}
+
+	BenchSink = equal;
+}
+
+static void
+BenchStringEqual(void* data, u64 count)
+{
+	u64 equal = 0;
+	for (u64 i = 0; i < count; ++i)
+	{
+		String_Case* opaque = Bench_Opaque(data);
+		equal += String_Equal(opaque->strings[0], opaque->strings[1]);
+	}
+
+	BenchSink = equal;
+}
+
+static void
+BenchStringCompare(void* data, u64 count)
+{
+	s64 order = 0;
+	for (u64 i = 0; i < count; ++i)
+	{
+		String_Case* opaque = Bench_Opaque(data);
+		order += String_Compare(opaque->strings[0], opaque->strings[1]);
+	}
+
+	BenchSink = (u64)order;
+}
+
+static void
+BenchStringHash(void* data, u64 count)
+{
+	u32 hash = 0;
+	for (u64 i = 0; i < count; ++i)
+	{
+		String_Case* opaque = Bench_Opaque(data);
+		hash ^= String_Hash(opaque->strings[0]);
+	}
+
+	BenchSink = hash;
+}
+
+static s32
+SignOf(s32 x)
+{
+	return (x > 0) - (x < 0);
+}
+
+// NOTE: checks the fast paths against the byte loop and memcmp for every length and position of a difference up to
+//       a few vectors, so each tail and overlap case is covered
+static bool
+VerifyString(u8* a, u8* b)
+{
+	bool succeeded = true;
+
+	for (u32 len = 0; len <= 100 && succeeded; ++len)
+	{
+		for (u32 diff = 0; diff <= len && succeeded; ++diff)
+		{
+			memcpy(b, a, len);
+			if (diff < len) b[diff] ^= 0x80;
+
+			for (u32 other_len = (len > 0 ? len - 1 : 0); other_len <= len + 1 && succeeded; ++other_len)
+			{
+				String s0 = { a, len };
+				String s1 = { b, other_len };
+
+				s32 expected = memcmp(a, b, (len < other_len ? len : other_len));
+				if (expected == 0) expected = (len > other_len) - (len < other_len);
+
+				succeeded = (String_Equal(s0, s1) == StringEqualBytewise(s0, s1) &&
+				             SignOf(String_Compare(s0, s1)) == SignOf(expected) &&
+				             (!String_Equal(s0, s1) || String_Hash(s0) == String_Hash(s1)));
+			}
+		}
+	}
+
+	if (!succeeded) fprintf(stderr, "string: fast paths disagree with the byte loop\n");
+
+	return succeeded;
+}
+
+static bool
+BenchString(void)
+{
+	static u8 buffers[2][4096];
+
+	u32 seed = 0x5EED;
+	for (umm i = 0; i < sizeof(buffers[0]); ++i) buffers[0][i] = (u8)('a' + Random(&seed) % 26);
+
+	if (!VerifyString(buffers[0], buffers[1])) return false;
+
+	memcpy(buffers[1], buffers[0], sizeof(buffers[0]));
+
+	umm lengths[] = { 4, 16, 64, 256, 1024, 4096 };
+	for (umm i = 0; i < sizeof(lengths)/sizeof(lengths[0]); ++i)
+	{
+		// NOTE: separate buffers with the same contents, the worst case of comparing every byte
+		String_Case string_case = { { { buffers[0], lengths[i] }, { buffers[1], lengths[i] } } };
+
+		char name[64];
+		snprintf(name, sizeof(name), "string/equal_bytewise/len=%u", (u32)lengths[i]);
+		Bench_Run(name, BenchStringEqualBytewise, &string_case, (f64)lengths[i]);
+		snprintf(name, sizeof(name), "string/equal/len=%u", (u32)lengths[i]);
+		Bench_Run(name, BenchStringEqual, &string_case, (f64)lengths[i]);
+		snprintf(name, sizeof(name), "string/compare/len=%u", (u32)lengths[i]);
+		Bench_Run(name, BenchStringCompare, &string_case, (f64)lengths[i]);
+		snprintf(name, sizeof(name), "string/hash/len=%u", (u32)lengths[i]);
+		Bench_Run(name, BenchStringHash, &string_case, (f64)lengths[i]);
+	}
+
+	buffers[1][0] ^= 1;
+	String_Case differ_case = { { { buffers[0], 1024 }, { buffers[1], 1024 } } };
+	Bench_Run("string/equal/len=1024/differ_first", BenchStringEqual, &differ_case, 0);
+	buffers[1][0] ^= 1;
+
+	String_Case length_case = { { { buffers[0], 1024 }, { buffers[1], 1023 } } };
+	Bench_Run("string/equal/len=1024/differ_len", BenchStringEqual, &length_case, 0);
+
+	return true;
+}
+
+/// Intern
+
+#define BENCH_NAME_COUNT 256
+
+typedef struct Name_Case
+{
+	String names[BENCH_NAME_COUNT];
+	String queries[BENCH_NAME_COUNT]; // NOTE: copies of names in another order, or names that are not in the table
+	Intern_Table table;
+} Name_Case;
+
+// NOTE: what Atlas_FindSprite does, a compare against every name until one matches
+static void
+BenchNameLinear(void* data, u64 count)
+{
+	Name_Case* name_case = data;
+
+	u64 found = 0;
+	for (u64 i = 0; i < count; ++i)
+	{
+		String query = name_case->queries[i % BENCH_NAME_COUNT];
+
+		u32 j = 0;
+		while (j < BENCH_NAME_COUNT && !String_Equal(name_case->names[j], query)) ++j;
+		found += j;
+	}
+
+	BenchSink = found;
+}
+
+static void
+BenchNameIntern(void* data, u64 count)
+{
+	Name_Case* name_case = data;
+
+	u64 found = 0;
+	for (u64 i = 0; i < count; ++i) found += Intern_Find(&name_case->table, name_case->queries[i % BENCH_NAME_COUNT]);
+
+	BenchSink = found;
+}
+
+static bool
+BenchIntern(void)
+{
+	if (!Bench_Enabled("intern/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 24, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	static Name_Case name_case;
+
+	// NOTE: names like sprite and tag names, a shared prefix and a short suffix
+	u32 seed = 0xA71A5;
+	for (u32 i = 0; i < BENCH_NAME_COUNT; ++i)
+	{
+		char* name = Bump_Push(&bump, 32, 1);
+		u32 len    = (u32)snprintf(name, 32, "sprite_%c%c_%u", 'a' + Random(&seed) % 26, 'a' + Random(&seed) % 26, i);
+
+		name_case.names[i] = (String){ .data = (u8*)name, .len = len };
+	}
+
+	Intern_Create(&name_case.table, &bump, 16);
+	for (u32 i = 0; i < BENCH_NAME_COUNT; ++i)
+	{
+		if (Intern_Add(&name_case.table, &bump, name_case.names[i]) != i + 1)
+		{
+			fprintf(stderr, "intern: IDs are not handed out in order\n");
+			return false;
+		}
+	}
+
+	/// Hits, queries are copies so every compare reads the bytes
+	for (u32 i = 0; i < BENCH_NAME_COUNT; ++i)
+	{
+		String name = name_case.names[(i*97) % BENCH_NAME_COUNT];
+
+		u8* copy = Bump_Push(&bump, name.len, 1);
+		memcpy(copy, name.data, name.len);
+		name_case.queries[i] = (String){ .data = copy, .len = name.len };
+
+		if (Intern_Find(&name_case.table, name_case.queries[i]) != (i*97) % BENCH_NAME_COUNT + 1)
+		{
+			fprintf(stderr, "intern: lookup returned the wrong ID\n");
+			return false;
+		}
+	}
+
+	Bench_Run("intern/find_hit/names=256/linear", BenchNameLinear, &name_case, 0);
+	Bench_Run("intern/find_hit/names=256/intern", BenchNameIntern, &name_case, 0);
+
+	/// Misses
+	for (u32 i = 0; i < BENCH_NAME_COUNT; ++i) name_case.queries[i].data[name_case.queries[i].len - 1] = 'x';
+
+	Bench_Run("intern/find_miss/names=256/linear", BenchNameLinear, &name_case, 0);
+	Bench_Run("intern/find_miss/names=256/intern", BenchNameIntern, &name_case, 0);
+
+	Bump_Destroy(&bump);
+
+	return true;
+}
+
+/// Framebuffer
+
+static void
+BenchFrameFill(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i)
+	{
+		Framebuffer* framebuffer = Bench_Opaque(data);
+		Blit_FillRect(framebuffer, 0, 0, AZUR_WIDTH, AZUR_HEIGHT, (u8)i);
+	}
+}
+
+static void
+BenchFrameCopy(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i)
+	{
+		Framebuffer* framebuffers = Bench_Opaque(data);
+		memcpy(framebuffers[1].pixels, framebuffers[0].pixels, sizeof(framebuffers[0].pixels));
+	}
+}
+
+// NOTE: What the Win32 host does per frame minus the driver: walk the dirty spans and copy them out, here into a
+//       second framebuffer standing in for the texture. Every row is dirty, the worst case
+static void
+BenchFrameUpload(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i)
+	{
+		Framebuffer* framebuffers = Bench_Opaque(data);
+		Framebuffer* framebuffer  = &framebuffers[0];
+
+		Framebuffer_MarkAll(framebuffer);
+
+		for (u32 row = 0, row_count = 0; Framebuffer_NextDirtySpan(framebuffer, &row, &row_count); row += row_count)
+		{
+			memcpy(framebuffers[1].pixels[row], framebuffer->pixels[row], (umm)row_count*AZUR_WIDTH);
+		}
+
+		Framebuffer_ClearDirty(framebuffer);
+	}
+}
+
+static void
+BenchFrameHash(void* data, u64 count)
+{
+	static Palette palette;
+
+	u64 hash = 0;
+	for (u64 i = 0; i < count; ++i) hash ^= Replay_HashFrame(Bench_Opaque(data), &palette);
+
+	BenchSink = hash;
+}
+
+static bool
+BenchFrame(void)
+{
+	f64 frame_size = (f64)sizeof(Framebuffers[0].pixels);
+
+	Bench_Run("frame/fill",   BenchFrameFill,   &Framebuffers[0], frame_size);
+	Bench_Run("frame/copy",   BenchFrameCopy,   Framebuffers,     frame_size);
+	Bench_Run("frame/upload", BenchFrameUpload, Framebuffers,     frame_size);
+	Bench_Run("frame/hash",   BenchFrameHash,   &Framebuffers[0], frame_size + sizeof(((Palette*)0)->colors));
+
+	return true;
+}
+
+/// Profiler
+
+static void
+BenchTSC(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i) BenchSink = __rdtsc();
+}
+
+static void
+BenchZone(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i)
+	{
+		static u32 site = 0;
+		u64 begin = Profile_Begin(&site, "BenchZone");
+		Profile_End(site, begin);
+	}
+}
+
+// NOTE: Calls the functions behind PROFILE_BEGIN/PROFILE_END directly, so the cost is measured in release builds too.
+//       A zone reads the TSC twice, under some hypervisors that alone costs tens of nanoseconds.
+static bool
+BenchProfileZone(void)
+{
+	umm size = Profile_MemorySize();
+	Bump bump = { .memory = malloc(size), .committed = size, .reserved = size };
+	if (bump.memory == 0) return false;
+
+	// NOTE: the TSC frequency only matters for exporting
+	Profiler* profiler = Profile_Create(&bump, 1, Profile_GetThread);
+	ProfilerInstance = profiler;
+	Profile_RegisterThread(profiler, "bench");
+
+	Bench_Run("profile/rdtsc",          BenchTSC,  0, 0);
+	Bench_Run("profile/zone_begin_end", BenchZone, 0, 0);
+
+	ProfileThread    = 0;
+	ProfilerInstance = 0;
+	free(bump.memory);
+
+	return true;
+}
+
+/// Jobs
+
+#define BENCH_JOB_ITEMS (1 << 14)
+
+// NOTE: Stands in for per-row work like rasterizing a band of the framebuffer, every item costs about the same
+static void
+BenchJobItems(void* data, u32 first, u32 count, Bump* scratch)
+{
+	u32* results = data;
+
+	for (u32 i = first; i < first + count; ++i)
+	{
+		u32 x = i + 1;
+		for (u32 j = 0; j < 1024; ++j) x = Random(&x) + j;
+		results[i] = x;
+	}
+}
+
+static void
+BenchJobsParallelFor(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i)
+	{
+		Job_Counter counter = {0};
+		Jobs_ParallelFor(BenchJobItems, data, BENCH_JOB_ITEMS, 0, &counter);
+		Jobs_Wait(&counter);
+	}
+}
+
+static bool
+BenchJobs(void)
+{
+	if (!Bench_Enabled("jobs/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 24, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	u32* results = Bump_Push(&bump, BENCH_JOB_ITEMS*sizeof(u32), 64);
+
+	// NOTE: doubles the workers up to the processor count, the scaling shows in ns/op going down
+	u32 processor_count = OS_GetProcessorCount();
+	for (u32 worker_count = 1; worker_count <= JOBS_MAX_WORKERS; worker_count *= 2)
+	{
+		Bump_Mark mark = Bump_GetMark(&bump);
+
+		Job_System jobs;
+		if (!Jobs_Create(&jobs, &bump, worker_count)) return false;
+
+		char name[64];
+		snprintf(name, sizeof(name), "jobs/parallel_for/items=%u/workers=%u", BENCH_JOB_ITEMS, worker_count);
+		Bench_RunCount(name, BenchJobsParallelFor, results, 0, 1, 0);
+
+		Jobs_Destroy(&jobs);
+		Bump_PopToMark(&bump, mark);
+
+		if (worker_count >= processor_count) break;
+	}
+
+	Bump_Destroy(&bump);
+
+	return true;
+}
+
+/// Entity
+
+#define BENCH_ENTITY_COUNT (1 << 16)
+
+// NOTE: The layout the store replaces, one struct per entity allocated wherever and reached through a pointer
+typedef struct Bench_Entity
+{
+	f32 x;
+	f32 y;
+	f32 vx;
+	f32 vy;
+	u32 flags;
+	u32 sprite;
+	u8 other[40]; // NOTE: what else an entity struct ends up holding, the update pulls it in with the position
+} Bench_Entity;
+
+typedef struct Entity_Case
+{
+	Entity_Store* store;
+	Bench_Entity** pointers;
+	Entity* handles;
+	u32 seed;
+} Entity_Case;
+
+static void
+BenchEntityIntegratePointers(void* data, u64 count)
+{
+	Entity_Case* entity_case = data;
+	Bench_Entity** pointers  = Bench_Opaque(entity_case->pointers);
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		for (u32 j = 0; j < BENCH_ENTITY_COUNT; ++j)
+		{
+			Bench_Entity* entity = pointers[j];
+			entity->x += entity->vx*(1.0f/60);
+			entity->y += entity->vy*(1.0f/60);
+		}
+	}
+}
+
+static void
+BenchEntityIntegrate(void* data, u64 count)
+{
+	Entity_Case* entity_case = data;
+	Entity_Store* store      = Bench_Opaque(entity_case->store);
+
+	for (u64 i = 0; i < count; ++i) Entity_Integrate(store, 0, store->count, 1.0f/60);
+}
+
+// NOTE: one operation destroys a random live entity and creates one in its place
+static void
+BenchEntityChurn(void* data, u64 count)
+{
+	Entity_Case* entity_case = data;
+	Entity_Store* store      = entity_case->store;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		u32 j = Random(&entity_case->seed) % BENCH_ENTITY_COUNT;
+
+		Entity_Destroy(store, entity_case->handles[j]);
+		entity_case->handles[j] = Entity_Create(store);
+	}
+}
+
+static void
+BenchEntityLookup(void* data, u64 count)
+{
+	Entity_Case* entity_case = data;
+	Entity_Store* store      = entity_case->store;
+
+	f32 sum = 0;
+	for (u64 i = 0; i < count; ++i)
+	{
+		Entity entity = entity_case->handles[Random(&entity_case->seed) % BENCH_ENTITY_COUNT];
+		sum += store->x[Entity_Index(store, entity)];
+	}
+
+	BenchSink = (u64)sum;
+}
+
+// NOTE: Random creates and destroys against a list of what should be alive. Every live entity keeps its handle in a
+//       column and its slot in x, so a swap that loses track of an entity shows up as a mismatch.
+static bool
+VerifyEntities(Bump* bump)
+{
+	Bump_Mark mark = Bump_GetMark(bump);
+
+	Entity_Store store;
+	Entity_CreateStore(&store, bump, 1000);
+
+	u32 column = Entity_AddColumn(&store, bump, sizeof(Entity));
+	Entity* owners = Entity_ColumnData(&store, column);
+
+	Entity* live  = Bump_Push(bump, store.capacity*sizeof(Entity), 4);
+	Entity* stale = Bump_Push(bump, 100000*sizeof(Entity), 4);
+	u32 live_count  = 0;
+	u32 stale_count = 0;
+
+	bool succeeded = true;
+
+	u32 seed = 0xE7717E5;
+	for (u32 i = 0; i < 100000 && succeeded; ++i)
+	{
+		if (live_count == 0 || (Random(&seed) % 8 < 5 && live_count < store.capacity))
+		{
+			Entity entity = Entity_Create(&store);
+
+			u32 index = Entity_Index(&store, entity);
+			succeeded &= (entity != 0 && index != U32_MAX && owners[index] == 0 && store.x[index] == 0);
+
+			owners[index]  = entity;
+			store.x[index] = (f32)Entity_Slot(entity);
+
+			live[live_count++] = entity;
+		}
+		else
+		{
+			u32 j = Random(&seed) % live_count;
+
+			Entity_Destroy(&store, live[j]);
+			stale[stale_count++] = live[j];
+			live[j] = live[--live_count];
+		}
+	}
+
+	succeeded &= (store.count == live_count);
+
+	for (u32 i = 0; i < live_count && succeeded; ++i)
+	{
+		u32 index = Entity_Index(&store, live[i]);
+		succeeded &= (index < store.count && owners[index] == live[i] && store.x[index] == (f32)Entity_Slot(live[i]));
+	}
+
+	// NOTE: 100000 operations cannot take a slot through every generation
+	for (u32 i = 0; i < stale_count && succeeded; ++i) succeeded &= !Entity_Alive(&store, stale[i]);
+
+	if (!succeeded) fprintf(stderr, "entity: handles and dense arrays went out of step\n");
+
+	Bump_PopToMark(bump, mark);
+
+	return succeeded;
+}
+
+static bool
+BenchEntity(void)
+{
+	if (!Bench_Enabled("entity/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 28, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	bool succeeded = VerifyEntities(&bump);
+
+	static Entity_Store store;
+	Entity_CreateStore(&store, &bump, BENCH_ENTITY_COUNT);
+
+	Entity* handles = Bump_Push(&bump, BENCH_ENTITY_COUNT*sizeof(Entity), 4);
+
+	// NOTE: the structs are pushed in one block and then shuffled, like a heap that has seen some churn
+	Bench_Entity* structs   = Bump_Push(&bump, BENCH_ENTITY_COUNT*sizeof(Bench_Entity), 64);
+	Bench_Entity** pointers = Bump_Push(&bump, BENCH_ENTITY_COUNT*sizeof(Bench_Entity*), 8);
+
+	u32 seed = 0x5EED;
+	for (u32 i = 0; i < BENCH_ENTITY_COUNT; ++i)
+	{
+		f32 vx = (f32)(Random(&seed) % 200) - 100;
+		f32 vy = (f32)(Random(&seed) % 200) - 100;
+
+		handles[i] = Entity_Create(&store);
+
+		u32 index = Entity_Index(&store, handles[i]);
+		store.vx[index] = vx;
+		store.vy[index] = vy;
+
+		structs[i]  = (Bench_Entity){ .vx = vx, .vy = vy };
+		pointers[i] = &structs[i];
+	}
+
+	for (u32 i = BENCH_ENTITY_COUNT - 1; i > 0; --i)
+	{
+		u32 j = Random(&seed) % (i + 1);
+
+		Bench_Entity* swap = pointers[i];
+		pointers[i] = pointers[j];
+		pointers[j] = swap;
+	}
+
+	/// Integrate, both layouts have to agree
+	Entity_Case entity_case = { &store, pointers, handles, seed };
+
+	BenchEntityIntegrate(&entity_case, 3);
+	BenchEntityIntegratePointers(&entity_case, 3);
+
+	for (u32 i = 0; i < BENCH_ENTITY_COUNT && succeeded; ++i)
+	{
+		u32 index = Entity_Index(&store, handles[i]);
+		succeeded &= (store.x[index] == structs[i].x && store.y[index] == structs[i].y);
+	}
+
+	if (!succeeded) fprintf(stderr, "entity: structure of arrays and pointers moved entities differently\n");
+
+	if (succeeded)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "entity/integrate/count=%u/pointers", BENCH_ENTITY_COUNT);
+		Bench_Run(name, BenchEntityIntegratePointers, &entity_case, BENCH_ENTITY_COUNT*4*sizeof(f32));
+		snprintf(name, sizeof(name), "entity/integrate/count=%u/soa", BENCH_ENTITY_COUNT);
+		Bench_Run(name, BenchEntityIntegrate, &entity_case, BENCH_ENTITY_COUNT*4*sizeof(f32));
+		snprintf(name, sizeof(name), "entity/lookup/count=%u", BENCH_ENTITY_COUNT);
+		Bench_Run(name, BenchEntityLookup, &entity_case, 0);
+		snprintf(name, sizeof(name), "entity/destroy_create/count=%u", BENCH_ENTITY_COUNT);
+		Bench_Run(name, BenchEntityChurn, &entity_case, 0);
+	}
+
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+/// Spatial
+
+#define BENCH_SPATIAL_COUNT 20000
+
+typedef struct Spatial_Case
+{
+	Bump* bump;
+	f32* x;
+	f32* y;
+	f32* width;
+	f32* height;
+	u32 count;
+	Spatial_Grid grid;
+	Job_Parallel_For_Func* parallel_for;
+	Job_Wait_Func* wait;
+} Spatial_Case;
+
+// NOTE: every box against every other one, in the order Spatial_FindPairs sorts to
+static u32
+SpatialNaivePairs(Spatial_Case* spatial_case, Spatial_Pair* pairs)
+{
+	f32* x = spatial_case->x;
+	f32* y = spatial_case->y;
+	f32* w = spatial_case->width;
+	f32* h = spatial_case->height;
+
+	u32 count = 0;
+	for (u32 i = 0; i < spatial_case->count; ++i)
+	{
+		for (u32 j = i + 1; j < spatial_case->count; ++j)
+		{
+			if (x[j] < x[i] + w[i] && x[i] < x[j] + w[j] && y[j] < y[i] + h[i] && y[i] < y[j] + h[j])
+			{
+				if (pairs != 0) pairs[count] = (Spatial_Pair){ .a = i, .b = j };
+				count += 1;
+			}
+		}
+	}
+
+	return count;
+}
+
+static void
+BenchSpatialNaive(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i) BenchSink = SpatialNaivePairs(Bench_Opaque(data), 0);
+}
+
+static void
+BenchSpatialBuild(void* data, u64 count)
+{
+	Spatial_Case* spatial_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		Bump_Mark mark = Bump_GetMark(spatial_case->bump);
+		Spatial_Build(&spatial_case->grid, spatial_case->bump, spatial_case->x, spatial_case->y, spatial_case->width,
+		              spatial_case->height, spatial_case->count, SPATIAL_DEFAULT_CELL_SHIFT);
+		Bump_PopToMark(spatial_case->bump, mark);
+	}
+}
+
+// NOTE: what a frame pays, building the grid and finding every pair
+static void
+BenchSpatialFrame(void* data, u64 count)
+{
+	Spatial_Case* spatial_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		Bump_Mark mark = Bump_GetMark(spatial_case->bump);
+		Spatial_Build(&spatial_case->grid, spatial_case->bump, spatial_case->x, spatial_case->y, spatial_case->width,
+		              spatial_case->height, spatial_case->count, SPATIAL_DEFAULT_CELL_SHIFT);
+
+		u32 pair_count;
+		BenchSink = (u64)(umm)Spatial_FindPairs(&spatial_case->grid, spatial_case->bump, spatial_case->parallel_for, spatial_case->wait, &pair_count);
+		Bump_PopToMark(spatial_case->bump, mark);
+	}
+}
+
+static void
+BenchSpatialQueryRect(void* data, u64 count)
+{
+	Spatial_Case* spatial_case = data;
+
+	u32 results[64];
+	u32 seed  = 0x9E3779B9;
+	u64 found = 0;
+	for (u64 i = 0; i < count; ++i)
+	{
+		f32 x = (f32)(Random(&seed) % AZUR_WIDTH);
+		f32 y = (f32)(Random(&seed) % AZUR_HEIGHT);
+		found += Spatial_QueryRect(&spatial_case->grid, x, y, 16, 16, results, 64);
+	}
+
+	BenchSink = found;
+}
+
+static void
+BenchSpatialRaycast(void* data, u64 count)
+{
+	Spatial_Case* spatial_case = data;
+
+	u32 seed  = 0x9E3779B9;
+	u64 found = 0;
+	for (u64 i = 0; i < count; ++i)
+	{
+		f32 x  = (f32)(Random(&seed) % AZUR_WIDTH);
+		f32 dx = (f32)(Random(&seed) % 200) - 100;
+		f32 dy = (f32)(Random(&seed) % 200) - 100;
+
+		f32 t;
+		found += Spatial_Raycast(&spatial_case->grid, x, AZUR_HEIGHT/2, dx, dy, 1, &t);
+	}
+
+	BenchSink = found;
+}
+
+static int
+SpatialComparePairs(const void* a, const void* b)
+{
+	const Spatial_Pair* pa = a;
+	const Spatial_Pair* pb = b;
+	return (pa->a != pb->a ? (pa->a < pb->a ? -1 : 1) : (pa->b < pb->b ? -1 : (pa->b > pb->b)));
+}
+
+// NOTE: Pairs and queries against testing every box. Raycasts only have to agree on where the first hit is, boxes
+//       that get hit at the same t may come back in any order.
+static bool
+VerifySpatial(Spatial_Case* spatial_case)
+{
+	Bump* bump = spatial_case->bump;
+	Bump_Mark mark = Bump_GetMark(bump);
+
+	f32* x = spatial_case->x;
+	f32* y = spatial_case->y;
+	f32* w = spatial_case->width;
+	f32* h = spatial_case->height;
+
+	Spatial_Build(&spatial_case->grid, bump, x, y, w, h, spatial_case->count, SPATIAL_DEFAULT_CELL_SHIFT);
+
+	u32 pair_count;
+	Spatial_Pair* pairs = Spatial_FindPairs(&spatial_case->grid, bump, spatial_case->parallel_for, spatial_case->wait, &pair_count);
+	qsort(pairs, pair_count, sizeof(Spatial_Pair), SpatialComparePairs);
+
+	u32 naive_count = SpatialNaivePairs(spatial_case, 0);
+	Spatial_Pair* naive = Bump_Push(bump, ((umm)naive_count + 1)*sizeof(Spatial_Pair), 4);
+	SpatialNaivePairs(spatial_case, naive);
+
+	bool succeeded = (pair_count == naive_count && memcmp(pairs, naive, pair_count*sizeof(Spatial_Pair)) == 0);
+
+	u32 seed = 0x51A7;
+	for (u32 i = 0; i < 2000 && succeeded; ++i)
+	{
+		/// Rects and points, some past the edges of the playfield
+		f32 qx = (f32)(Random(&seed) % (AZUR_WIDTH + 64)) - 32 + 0.25f;
+		f32 qy = (f32)(Random(&seed) % (AZUR_HEIGHT + 64)) - 32 + 0.5f;
+		f32 qw = (f32)(Random(&seed) % 40);
+		f32 qh = (f32)(Random(&seed) % 40);
+
+		u32 results[1024];
+		u32 rect_count  = Spatial_QueryRect(&spatial_case->grid, qx, qy, qw, qh, results, 1024);
+		u32 point_count = Spatial_QueryPoint(&spatial_case->grid, qx, qy, results + rect_count, 1024 - rect_count);
+
+		u32 rect_expected  = 0;
+		u32 point_expected = 0;
+		u32 matched        = 0;
+		for (u32 j = 0; j < spatial_case->count; ++j)
+		{
+			bool in_rect  = (x[j] < qx + qw && qx < x[j] + w[j] && y[j] < qy + qh && qy < y[j] + h[j]);
+			bool in_point = (x[j] <= qx && qx < x[j] + w[j] && y[j] <= qy && qy < y[j] + h[j]);
+
+			rect_expected  += in_rect;
+			point_expected += in_point;
+
+			for (u32 k = 0; k < rect_count; ++k) matched += (in_rect && results[k] == j);
+			for (u32 k = rect_count; k < rect_count + point_count; ++k) matched += (in_point && results[k] == j);
+		}
+
+		succeeded &= (rect_count == rect_expected && point_count == point_expected && matched == rect_count + point_count);
+
+		/// Rays from inside the playfield
+		f32 ox = (f32)(Random(&seed) % AZUR_WIDTH) + 0.5f;
+		f32 oy = (f32)(Random(&seed) % AZUR_HEIGHT) + 0.25f;
+		f32 dx = (f32)(Random(&seed) % 400) - 200;
+		f32 dy = (f32)(Random(&seed) % 400) - 200;
+		if (i % 16 == 0) dy = 0;
+
+		f32 expected_t = 2;
+		for (u32 j = 0; j < spatial_case->count; ++j)
+		{
+			f32 t0 = 0;
+			f32 t1 = 1;
+			if (Spatial_ClipSlab(ox, dx, x[j], x[j] + w[j], &t0, &t1) && Spatial_ClipSlab(oy, dy, y[j], y[j] + h[j], &t0, &t1) &&
+			    t0 < expected_t)
+			{
+				expected_t = t0;
+			}
+		}
+
+		f32 t = 2;
+		u32 hit = Spatial_Raycast(&spatial_case->grid, ox, oy, dx, dy, 1, &t);
+
+		f32 error = t - expected_t;
+		succeeded &= ((hit == SPATIAL_NO_ITEM) == (expected_t == 2) && error < 1e-5f && error > -1e-5f);
+	}
+
+	if (!succeeded) fprintf(stderr, "spatial: the grid disagrees with testing every box\n");
+
+	Bump_PopToMark(bump, mark);
+
+	return succeeded;
+}
+
+static bool
+BenchSpatial(void)
+{
+	if (!Bench_Enabled("spatial/")) return true;
+
+	// NOTE: committed up front like a frame bump that has warmed up, popping never gives pages back between frames
+	Bump bump;
+	if (!Bump_Create(1ULL << 28, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_COMMIT_ALL, &bump)) return false;
+
+	// NOTE: bullets of 2 to 5 pixels, spread over the playfield and a little past it
+	Spatial_Case spatial_case = {
+		.bump   = &bump,
+		.x      = Bump_Push(&bump, BENCH_SPATIAL_COUNT*sizeof(f32), 32),
+		.y      = Bump_Push(&bump, BENCH_SPATIAL_COUNT*sizeof(f32), 32),
+		.width  = Bump_Push(&bump, BENCH_SPATIAL_COUNT*sizeof(f32), 32),
+		.height = Bump_Push(&bump, BENCH_SPATIAL_COUNT*sizeof(f32), 32),
+		.count  = BENCH_SPATIAL_COUNT,
+	};
+
+	u32 seed = 0xB0115;
+	for (u32 i = 0; i < BENCH_SPATIAL_COUNT; ++i)
+	{
+		spatial_case.x[i]      = (f32)(Random(&seed) % ((AZUR_WIDTH  + 16)*16))/16 - 8;
+		spatial_case.y[i]      = (f32)(Random(&seed) % ((AZUR_HEIGHT + 16)*16))/16 - 8;
+		spatial_case.width[i]  = (f32)(2 + Random(&seed) % 4);
+		spatial_case.height[i] = (f32)(2 + Random(&seed) % 4);
+	}
+
+	bool succeeded = VerifySpatial(&spatial_case);
+
+	if (succeeded)
+	{
+		// NOTE: a second a call, a few samples of one call are plenty
+		Bench_RunCount("spatial/pairs/count=20000/naive", BenchSpatialNaive, &spatial_case, 0, 1, 5);
+		Bench_Run("spatial/build/count=20000", BenchSpatialBuild, &spatial_case, 0);
+		Bench_Run("spatial/build_and_pairs/count=20000", BenchSpatialFrame, &spatial_case, 0);
+
+		Spatial_Build(&spatial_case.grid, &bump, spatial_case.x, spatial_case.y, spatial_case.width, spatial_case.height,
+		              spatial_case.count, SPATIAL_DEFAULT_CELL_SHIFT);
+		Bench_Run("spatial/query_rect/16x16", BenchSpatialQueryRect, &spatial_case, 0);
+		Bench_Run("spatial/raycast", BenchSpatialRaycast, &spatial_case, 0);
+	}
+
+	// NOTE: doubles the workers up to the processor count, like the jobs cases
+	u32 processor_count = OS_GetProcessorCount();
+	for (u32 worker_count = 2; succeeded && worker_count <= JOBS_MAX_WORKERS && worker_count <= processor_count; worker_count *= 2)
+	{
+		Bump_Mark mark = Bump_GetMark(&bump);
+
+		Job_System jobs;
+		if (!Jobs_Create(&jobs, &bump, worker_count)) return false;
+
+		spatial_case.parallel_for = Jobs_ParallelFor;
+		spatial_case.wait         = Jobs_Wait;
+
+		succeeded = VerifySpatial(&spatial_case);
+
+		char name[64];
+		snprintf(name, sizeof(name), "spatial/build_and_pairs/count=20000/workers=%u", worker_count);
+		if (succeeded) Bench_Run(name, BenchSpatialFrame, &spatial_case, 0);
+
+		Jobs_Destroy(&jobs);
+		Bump_PopToMark(&bump, mark);
+	}
+
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+/// Audio
+
+#define BENCH_AUDIO_SOUND_FRAMES AUDIO_SAMPLE_RATE
+
+typedef struct Audio_Case
+{
+	Mixer_Voice* voices;
+	u32 voice_count;
+	s32* left;
+	s32* right;
+	s16* out;
+	Audio_Queue* queue;
+} Audio_Case;
+
+// NOTE: One voice at a time and one frame at a time, checking for the end of the sound on every frame
+static void
+AudioMixNaive(Mixer_Voice* voices, u32* voice_count, s16* out)
+{
+	s32 left[AUDIO_PERIOD_FRAMES]  = {0};
+	s32 right[AUDIO_PERIOD_FRAMES] = {0};
+
+	for (u32 i = 0; i < *voice_count; )
+	{
+		Mixer_Voice* voice = &voices[i];
+		u64 end = (u64)voice->frame_count << 16;
+
+		bool done = false;
+		for (u32 j = 0; j < AUDIO_PERIOD_FRAMES && !done; ++j)
+		{
+			if (voice->position >= end && voice->loop) voice->position %= end;
+			done = (voice->position >= end);
+
+			if (!done)
+			{
+				s16* pair  = voice->samples + (voice->position >> 16);
+				s32 frac   = (s32)(voice->position & 0xFFFF) >> 1;
+				s32 sample = pair[0] + (((pair[1] - pair[0])*frac) >> 15);
+
+				left[j]  += (sample*voice->gain_left)  >> 15;
+				right[j] += (sample*voice->gain_right) >> 15;
+
+				voice->position += voice->step;
+			}
+		}
+
+		if (done || (!voice->loop && voice->position >= end)) voices[i] = voices[--*voice_count];
+		else                                                    i += 1;
+	}
+
+	for (u32 j = 0; j < AUDIO_PERIOD_FRAMES; ++j)
+	{
+		out[j*2 + 0] = (s16)(left[j]  < S16_MIN ? S16_MIN : (left[j]  > S16_MAX ? S16_MAX : left[j]));
+		out[j*2 + 1] = (s16)(right[j] < S16_MIN ? S16_MIN : (right[j] > S16_MAX ? S16_MAX : right[j]));
+	}
+}
+
+static void
+BenchAudioMixNaive(void* data, u64 count)
+{
+	Audio_Case* audio_case = data;
+
+	for (u64 i = 0; i < count; ++i) AudioMixNaive(audio_case->voices, &audio_case->voice_count, audio_case->out);
+}
+
+static void
+BenchAudioMix(void* data, u64 count)
+{
+	Audio_Case* audio_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		Mixer_MixPeriod(audio_case->voices, &audio_case->voice_count, audio_case->left, audio_case->right, audio_case->out);
+	}
+}
+
+// NOTE: one operation is a command going through the ring, from the game's end to the mixer's
+static void
+BenchAudioQueue(void* data, u64 count)
+{
+	Audio_Case* audio_case = data;
+	Audio_Queue* queue     = audio_case->queue;
+
+	Audio_Command command = {0};
+	for (u64 i = 0; i < count; ++i)
+	{
+		Audio_SetVolume(queue, (Audio_Voice)i, 0.5f, 0);
+		Audio_PopCommand(queue, &command);
+	}
+
+	BenchSink = command.gain_left;
+}
+
+// NOTE: half of the voices play at pitch 1 or below, the rest up to AUDIO_MAX_PITCH
+static Mixer_Voice
+RandomVoice(u32* seed, Audio_Sound* sounds, u32 sound_count, bool loop)
+{
+	Audio_Sound* sound = &sounds[Random(seed) % sound_count];
+	u32 max_step       = (Random(seed) % 2 ? AUDIO_MAX_PITCH << 16 : 1 << 16);
+
+	Mixer_Voice voice = {
+		.samples     = sound->samples,
+		.frame_count = sound->frame_count,
+		.step        = 1 + Random(seed) % max_step,
+		.gain_left   = (s32)(Random(seed) % (AUDIO_UNITY_GAIN + 1)),
+		.gain_right  = (s32)(Random(seed) % (AUDIO_UNITY_GAIN + 1)),
+		.loop        = loop,
+	};
+
+	voice.position = ((u64)(Random(seed) % sound->frame_count) << 16) | (Random(seed) & 0xFFFF);
+
+	return voice;
+}
+
+// NOTE: Voices of every pitch, some looping and some running out, over sounds as short as a few frames. Loud enough
+//       together that the output saturates, so clamping is covered too.
+static bool
+VerifyAudio(Audio_Case* audio_case, Audio_Sound* sounds, u32 sound_count)
+{
+	static Mixer_Voice voices[2][AUDIO_MAX_VOICES];
+	u32 voice_count[2] = { AUDIO_MAX_VOICES, AUDIO_MAX_VOICES };
+
+	u32 seed = 0xA0D10;
+	for (u32 i = 0; i < AUDIO_MAX_VOICES; ++i)
+	{
+		voices[0][i] = RandomVoice(&seed, sounds, sound_count, Random(&seed) % 2);
+		voices[1][i] = voices[0][i];
+	}
+
+	s16 expected[AUDIO_PERIOD_FRAMES*2];
+	s16 mixed[AUDIO_PERIOD_FRAMES*2];
+
+	bool succeeded = true;
+	for (u32 period = 0; period < 1000 && succeeded; ++period)
+	{
+		AudioMixNaive(voices[0], &voice_count[0], expected);
+		Mixer_MixPeriod(voices[1], &voice_count[1], audio_case->left, audio_case->right, mixed);
+
+		succeeded &= (voice_count[0] == voice_count[1] && memcmp(expected, mixed, sizeof(mixed)) == 0);
+		for (u32 i = 0; i < voice_count[0] && succeeded; ++i) succeeded &= (voices[0][i].position == voices[1][i].position);
+	}
+
+	if (!succeeded) fprintf(stderr, "audio: the mixer and the frame by frame loop mixed different samples\n");
+
+	return succeeded;
+}
+
+static bool
+BenchAudio(void)
+{
+	if (!Bench_Enabled("audio/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 26, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	// NOTE: noise, full scale, from a few frames to a second long
+	u32 seed = 0x50D;
+	s16* noise = Bump_Push(&bump, BENCH_AUDIO_SOUND_FRAMES*sizeof(s16), 4);
+	for (u32 i = 0; i < BENCH_AUDIO_SOUND_FRAMES; ++i) noise[i] = (s16)Random(&seed);
+
+	Audio_Sound sounds[8];
+	u32 sound_count = sizeof(sounds)/sizeof(sounds[0]);
+	for (u32 i = 0; i < sound_count; ++i) sounds[i] = Audio_PushSound(&bump, noise, BENCH_AUDIO_SOUND_FRAMES >> (i*2));
+
+	Audio_Queue queue = {
+		.commands = Bump_Push(&bump, AUDIO_COMMAND_COUNT*sizeof(Audio_Command), 64),
+	};
+
+	Audio_Case audio_case = {
+		.voices = Bump_Push(&bump, AUDIO_MAX_VOICES*sizeof(Mixer_Voice), 64),
+		.left   = Bump_Push(&bump, AUDIO_PERIOD_FRAMES*sizeof(s32), 64),
+		.right  = Bump_Push(&bump, AUDIO_PERIOD_FRAMES*sizeof(s32), 64),
+		.out    = Bump_Push(&bump, AUDIO_PERIOD_FRAMES*2*sizeof(s16), 64),
+		.queue  = &queue,
+	};
+
+	bool succeeded = VerifyAudio(&audio_case, sounds, sound_count);
+
+	if (succeeded)
+	{
+		// NOTE: every voice loops over the second long sound, so there are as many voices for every sample
+		audio_case.voice_count = AUDIO_MAX_VOICES;
+		for (u32 i = 0; i < AUDIO_MAX_VOICES; ++i) audio_case.voices[i] = RandomVoice(&seed, sounds, 1, true);
+
+		char name[64];
+		snprintf(name, sizeof(name), "audio/mix_period/voices=%u/naive", AUDIO_MAX_VOICES);
+		Bench_Run(name, BenchAudioMixNaive, &audio_case, AUDIO_PERIOD_FRAMES*2*sizeof(s16));
+		snprintf(name, sizeof(name), "audio/mix_period/voices=%u", AUDIO_MAX_VOICES);
+		Bench_Run(name, BenchAudioMix, &audio_case, AUDIO_PERIOD_FRAMES*2*sizeof(s16));
+		Bench_Run("audio/command_round_trip", BenchAudioQueue, &audio_case, sizeof(Audio_Command));
+	}
+
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+/// Pack
+
+#define BENCH_PACK_SIZE (1 << 22)
+
+typedef struct Pack_Case
+{
+	u8* raw;
+	u8* block;          // NOTE: what the round trips compress, raw stays as it went into the pack
+	u8* packed;         // NOTE: every block, each at PACK_BLOCK_SIZE*i
+	umm* packed_sizes;
+	u8* out;
+	u32* table;
+	u32 block_count;
+	Pack_Header* pack;
+	Bump* bump;
+} Pack_Case;
+
+// NOTE: Palette indices laid out like a sheet of 8x8 tiles, a handful of tile patterns repeated with the odd stray
+//       pixel, which is roughly what the atlas looks like
+static void
+FillTiles(u8* data, umm size, u32 seed)
+{
+	u32 width = 1024;
+
+	for (umm i = 0; i < size; ++i)
+	{
+		u32 x = (u32)(i % width);
+		u32 y = (u32)(i / width);
+
+		u32 tile = ((x >> 3)*7 + (y >> 3)*13) % 5;
+		data[i]  = (u8)(tile*16 + (((x ^ y) & 7) < tile ? x & 3 : 0));
+
+		if (Random(&seed) % 64 == 0) data[i] = (u8)Random(&seed);
+	}
+}
+
+static void
+BenchPackDecompress(void* data, u64 count)
+{
+	Pack_Case* pack_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		for (u32 j = 0; j < pack_case->block_count; ++j)
+		{
+			umm offset = (umm)j*PACK_BLOCK_SIZE;
+			Pack_Decompress(pack_case->packed + offset, pack_case->packed_sizes[j], pack_case->out + offset, PACK_BLOCK_SIZE);
+		}
+	}
+}
+
+// NOTE: the floor for decompressing, the same bytes moved without decoding anything
+static void
+BenchPackCopy(void* data, u64 count)
+{
+	Pack_Case* pack_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		memcpy(pack_case->out, pack_case->raw, (umm)pack_case->block_count*PACK_BLOCK_SIZE);
+		Bench_Opaque(pack_case->out);
+	}
+}
+
+static void
+BenchPackCompress(void* data, u64 count)
+{
+	Pack_Case* pack_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		for (u32 j = 0; j < pack_case->block_count; ++j)
+		{
+			umm offset = (umm)j*PACK_BLOCK_SIZE;
+			BenchSink  = Pack_Compress(pack_case->raw + offset, PACK_BLOCK_SIZE, pack_case->packed + offset, pack_case->table);
+		}
+	}
+}
+
+static void
+BenchPackLoad(void* data, u64 count)
+{
+	Pack_Case* pack_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		Bump_Mark mark = Bump_GetMark(pack_case->bump);
+
+		Job_Counter counter = {0};
+		Pack_Asset* asset = Pack_Load(pack_case->pack, STRING("tiles"), pack_case->bump, Jobs_ParallelFor, &counter);
+		Jobs_Wait(&counter);
+
+		BenchSink = asset->data[0];
+		Bump_PopToMark(pack_case->bump, mark);
+	}
+}
+
+// NOTE: Round trips tiles, zeros and noise, block sizes that are not a multiple of anything, and damaged blocks. A
+//       damaged block may decode to something, but never past the end of the buffer it was given.
+static bool
+VerifyPack(Pack_Case* pack_case)
+{
+	bool succeeded = true;
+
+	u8* raw    = pack_case->block;
+	u8* packed = pack_case->packed;
+	u8* out    = pack_case->out;
+
+	u32 seed = 0xBAC;
+	for (u32 kind = 0; kind < 3 && succeeded; ++kind)
+	{
+		if      (kind == 0) FillTiles(raw, PACK_BLOCK_SIZE, seed);
+		else if (kind == 1) memset(raw, 0, PACK_BLOCK_SIZE);
+		else                for (umm i = 0; i < PACK_BLOCK_SIZE; ++i) raw[i] = (u8)Random(&seed);
+
+		umm sizes[] = { 0, 1, 3, 4, 5, 31, 32, 33, 100, 4097, PACK_BLOCK_SIZE - 1, PACK_BLOCK_SIZE };
+		for (u32 i = 0; i < sizeof(sizes)/sizeof(sizes[0]) && succeeded; ++i)
+		{
+			umm packed_size = Pack_Compress(raw, sizes[i], packed, pack_case->table);
+
+			memset(out, 0xCD, sizes[i] + 64);
+			succeeded &= (packed_size <= Pack_CompressBound(sizes[i]) && Pack_Decompress(packed, packed_size, out, sizes[i]) &&
+			              memcmp(out, raw, sizes[i]) == 0 && out[sizes[i]] == 0xCD && out[sizes[i] + 63] == 0xCD);
+		}
+
+		if (!succeeded) fprintf(stderr, "pack: a block did not decompress to what was compressed\n");
+
+		// NOTE: tiles have to shrink by half at least, otherwise the pack is not worth it
+		if (succeeded && kind == 0 && Pack_Compress(raw, PACK_BLOCK_SIZE, packed, pack_case->table) > PACK_BLOCK_SIZE/2)
+		{
+			fprintf(stderr, "pack: tiles compressed to more than half their size\n");
+			succeeded = false;
+		}
+	}
+
+	FillTiles(raw, PACK_BLOCK_SIZE, seed);
+	umm packed_size = Pack_Compress(raw, PACK_BLOCK_SIZE, packed, pack_case->table);
+	u8* damaged     = packed + PACK_BLOCK_SIZE*2;
+
+	for (u32 i = 0; i < 10000 && succeeded; ++i)
+	{
+		umm size = (i % 2 ? packed_size : Random(&seed) % (packed_size + 1));
+		memcpy(damaged, packed, size);
+		for (u32 j = Random(&seed) % 4; j < 4; ++j) damaged[Random(&seed) % (size + 1)] ^= (u8)(1 << (Random(&seed) % 8));
+
+		// NOTE: decompressing into the end of out, nothing past it can be written without the canary knowing
+		u8* dst = out + PACK_BLOCK_SIZE*2;
+		dst[PACK_BLOCK_SIZE] = 0xCD;
+		Pack_Decompress(damaged, size, dst, PACK_BLOCK_SIZE);
+		succeeded &= (dst[PACK_BLOCK_SIZE] == 0xCD);
+	}
+
+	if (!succeeded) fprintf(stderr, "pack: a damaged block was decompressed past the end of its buffer\n");
+
+	if (succeeded)
+	{
+		Pack_Asset* asset = 0;
+
+		Job_Counter counter = {0};
+		asset = Pack_Load(pack_case->pack, STRING("tiles"), pack_case->bump, Jobs_ParallelFor, &counter);
+		Jobs_Wait(&counter);
+
+		succeeded &= (asset != 0 && !asset->failed && asset->size == BENCH_PACK_SIZE &&
+		              memcmp(asset->data, pack_case->raw, BENCH_PACK_SIZE) == 0);
+		succeeded &= (Pack_Load(pack_case->pack, STRING("missing"), pack_case->bump, Jobs_ParallelFor, &counter) == 0);
+
+		if (!succeeded) fprintf(stderr, "pack: the loaded entry differs from what was built\n");
+	}
+
+	return succeeded;
+}
+
+static bool
+BenchPack(void)
+{
+	if (!Bench_Enabled("pack/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 28, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	u32 block_count = BENCH_PACK_SIZE/PACK_BLOCK_SIZE;
+
+	Pack_Case pack_case = {
+		.raw          = Bump_Push(&bump, BENCH_PACK_SIZE, 64),
+		.block        = Bump_Push(&bump, PACK_BLOCK_SIZE, 64),
+		.packed       = Bump_Push(&bump, (umm)block_count*PACK_BLOCK_SIZE + Pack_CompressBound(PACK_BLOCK_SIZE), 64),
+		.packed_sizes = Bump_Push(&bump, block_count*sizeof(umm), 8),
+		.out          = Bump_Push(&bump, BENCH_PACK_SIZE + 64, 64),
+		.table        = Bump_Push(&bump, sizeof(u32) << PACK_HASH_BITS, 64),
+		.block_count  = block_count,
+		.bump         = &bump,
+	};
+
+	// NOTE: the entry the load cases read
+	FillTiles(pack_case.raw, BENCH_PACK_SIZE, 0x7111);
+
+	Bump image;
+	if (!Bump_Create(1ULL << 28, BUMP_DEFAULT_COMMIT_CHUNK, 0, &image)) return false;
+
+	String name = STRING("tiles");
+	u64 size    = BENCH_PACK_SIZE;
+	pack_case.pack = Pack_Build(&image, &bump, &name, &pack_case.raw, &size, 1);
+
+	bool succeeded = Pack_Validate(pack_case.pack, pack_case.pack->file_size);
+	if (!succeeded) fprintf(stderr, "pack: the built pack does not validate\n");
+
+	u32 processor_count = OS_GetProcessorCount();
+	for (u32 worker_count = 1; succeeded && worker_count <= JOBS_MAX_WORKERS; worker_count *= 2)
+	{
+		Bump_Mark mark = Bump_GetMark(&bump);
+
+		Job_System jobs;
+		if (!Jobs_Create(&jobs, &bump, worker_count)) return false;
+
+		// NOTE: loading needs a job system, so the verification waits for the first one
+		if (worker_count == 1) succeeded = VerifyPack(&pack_case);
+
+		if (succeeded)
+		{
+			char name_buffer[64];
+			snprintf(name_buffer, sizeof(name_buffer), "pack/load/bytes=%u/workers=%u", BENCH_PACK_SIZE, worker_count);
+			Bench_Run(name_buffer, BenchPackLoad, &pack_case, BENCH_PACK_SIZE);
+		}
+
+		Jobs_Destroy(&jobs);
+		Bump_PopToMark(&bump, mark);
+
+		if (worker_count >= processor_count) break;
+	}
+
+	if (succeeded)
+	{
+		for (u32 i = 0; i < block_count; ++i)
+		{
+			umm offset = (umm)i*PACK_BLOCK_SIZE;
+			pack_case.packed_sizes[i] = Pack_Compress(pack_case.raw + offset, PACK_BLOCK_SIZE, pack_case.packed + offset, pack_case.table);
+		}
+
+		char name_buffer[64];
+		snprintf(name_buffer, sizeof(name_buffer), "pack/decompress/bytes=%u", BENCH_PACK_SIZE);
+		Bench_Run(name_buffer, BenchPackDecompress, &pack_case, BENCH_PACK_SIZE);
+		snprintf(name_buffer, sizeof(name_buffer), "pack/decompress/bytes=%u/memcpy", BENCH_PACK_SIZE);
+		Bench_Run(name_buffer, BenchPackCopy, &pack_case, BENCH_PACK_SIZE);
+		snprintf(name_buffer, sizeof(name_buffer), "pack/compress/bytes=%u", BENCH_PACK_SIZE);
+		Bench_Run(name_buffer, BenchPackCompress, &pack_case, BENCH_PACK_SIZE);
+	}
+
+	Bump_Destroy(&image);
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+/// Tilemap
+
+#define BENCH_TILEMAP_SIZE 4096 // NOTE: in tiles, 32 MB of tiles
+
+typedef struct Tilemap_Case
+{
+	Tilemap* map;
+	Framebuffer* framebuffer;
+	s32 scroll_x;
+	s32 scroll_y;
+	s32 step_x;
+	s32 step_y;
+	u32 seed;
+} Tilemap_Case;
+
+// NOTE: What drawing a map costs without the chunk cache, every visible tile blitted on its own every frame
+static void
+TilemapRedrawTiles(Tilemap* map, Framebuffer* framebuffer, s32 scroll_x, s32 scroll_y)
+{
+	Blit_FillRect(framebuffer, 0, 0, AZUR_WIDTH, AZUR_HEIGHT, map->outside_index);
+
+	s32 first_x = (scroll_x < 0 ? -((-scroll_x + TILEMAP_TILE_SIZE - 1)/TILEMAP_TILE_SIZE) : scroll_x/TILEMAP_TILE_SIZE);
+	s32 first_y = (scroll_y < 0 ? -((-scroll_y + TILEMAP_TILE_SIZE - 1)/TILEMAP_TILE_SIZE) : scroll_y/TILEMAP_TILE_SIZE);
+
+	for (s32 ty = first_y; ty*TILEMAP_TILE_SIZE < scroll_y + AZUR_HEIGHT; ++ty)
+	{
+		for (s32 tx = first_x; tx*TILEMAP_TILE_SIZE < scroll_x + AZUR_WIDTH; ++tx)
+		{
+			if (tx < 0 || ty < 0 || (u32)tx >= map->width || (u32)ty >= map->height) continue;
+
+			Tile tile = Tilemap_GetTile(map, (u32)tx, (u32)ty);
+			if (tile >= map->tile_count) tile = 0;
+
+			Sprite sprite = {
+				.pixels = map->tileset.pixels + (umm)(tile/map->tileset_columns)*TILEMAP_TILE_SIZE*map->tileset.stride +
+				          (tile%map->tileset_columns)*TILEMAP_TILE_SIZE,
+				.width  = TILEMAP_TILE_SIZE,
+				.height = TILEMAP_TILE_SIZE,
+				.stride = map->tileset.stride,
+			};
+
+			Blit_Sprite(framebuffer, &sprite, tx*TILEMAP_TILE_SIZE - scroll_x, ty*TILEMAP_TILE_SIZE - scroll_y, BLIT_OPAQUE, 0);
+		}
+	}
+}
+
+static void
+BenchTilemapRedraw(void* data, u64 count)
+{
+	Tilemap_Case* tilemap_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		tilemap_case->scroll_x += tilemap_case->step_x;
+		tilemap_case->scroll_y += tilemap_case->step_y;
+		TilemapRedrawTiles(tilemap_case->map, Bench_Opaque(tilemap_case->framebuffer), tilemap_case->scroll_x, tilemap_case->scroll_y);
+	}
+}
+
+static void
+BenchTilemapDraw(void* data, u64 count)
+{
+	Tilemap_Case* tilemap_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		tilemap_case->scroll_x += tilemap_case->step_x;
+		tilemap_case->scroll_y += tilemap_case->step_y;
+		Tilemap_Draw(tilemap_case->map, Bench_Opaque(tilemap_case->framebuffer), tilemap_case->scroll_x, tilemap_case->scroll_y);
+	}
+}
+
+// NOTE: one changed tile somewhere in view per frame, then the frame is drawn
+static void
+BenchTilemapEditDraw(void* data, u64 count)
+{
+	Tilemap_Case* tilemap_case = data;
+	Tilemap* map = tilemap_case->map;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		u32 x = (u32)tilemap_case->scroll_x/TILEMAP_TILE_SIZE + Random(&tilemap_case->seed) % (AZUR_WIDTH/TILEMAP_TILE_SIZE);
+		u32 y = (u32)tilemap_case->scroll_y/TILEMAP_TILE_SIZE + Random(&tilemap_case->seed) % (AZUR_HEIGHT/TILEMAP_TILE_SIZE);
+
+		Tilemap_SetTile(map, x, y, (Tile)(Random(&tilemap_case->seed) % map->tile_count));
+		Tilemap_Draw(map, Bench_Opaque(tilemap_case->framebuffer), tilemap_case->scroll_x, tilemap_case->scroll_y);
+	}
+}
+
+// NOTE: Scrolls diagonally across edges and corners of the map with tile edits in between, so chunks get evicted and
+//       come back, and edits land in cached and uncached chunks
+static bool
+VerifyTilemap(Tilemap* map)
+{
+	bool succeeded = true;
+
+	u32 seed = 0x68E31DA4;
+	s32 scroll_x = -200;
+	s32 scroll_y = -150;
+
+	for (u32 i = 0; i < 2000 && succeeded; ++i)
+	{
+		scroll_x += 13;
+		scroll_y += 7;
+		if (i == 1000) scroll_x = (s32)map->width*TILEMAP_TILE_SIZE - 250, scroll_y = (s32)map->height*TILEMAP_TILE_SIZE - 100;
+
+		for (u32 j = 0; j < 4; ++j)
+		{
+			u32 x = (u32)(scroll_x + (s32)(Random(&seed) % 1024) - 512)/TILEMAP_TILE_SIZE;
+			u32 y = (u32)(scroll_y + (s32)(Random(&seed) % 1024) - 512)/TILEMAP_TILE_SIZE;
+			Tilemap_SetTile(map, x, y, (Tile)(Random(&seed) % (map->tile_count + 4)));
+		}
+
+		Tilemap_Draw(map, &Framebuffers[0], scroll_x, scroll_y);
+		TilemapRedrawTiles(map, &Framebuffers[1], scroll_x, scroll_y);
+
+		succeeded = (memcmp(Framebuffers[0].pixels, Framebuffers[1].pixels, sizeof(Framebuffers[0].pixels)) == 0);
+	}
+
+	if (!succeeded) fprintf(stderr, "tilemap: cached chunks differ from drawing every tile\n");
+
+	return succeeded;
+}
+
+static bool
+BenchTilemap(void)
+{
+	if (!Bench_Enabled("tilemap/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	u32 seed = 0x0BADF00D;
+	for (u32 i = 0; i < 128*128; ++i) SpritePixels[i] = (u8)(Random(&seed) & 0x7);
+
+	// NOTE: 256 tiles of 8x8
+	Sprite tileset = {
+		.pixels = SpritePixels,
+		.width  = 128,
+		.height = 128,
+		.stride = 128,
+	};
+
+	Tilemap map;
+	Tilemap_Create(&map, &bump, &tileset, BENCH_TILEMAP_SIZE, BENCH_TILEMAP_SIZE, 0, 3);
+
+	for (u32 y = 0; y < map.height; ++y)
+	{
+		for (u32 x = 0; x < map.width; ++x) *Tilemap_TileAt(&map, x, y) = (Tile)(Random(&seed) % map.tile_count);
+	}
+
+	bool succeeded = VerifyTilemap(&map);
+
+	if (succeeded)
+	{
+		f64 frame_size = (f64)sizeof(Framebuffers[0].pixels);
+		s32 middle = BENCH_TILEMAP_SIZE*TILEMAP_TILE_SIZE/2;
+
+		// NOTE: the cases scroll 3 pixels right and 1 down per frame from the middle of the map, unless they are static
+		Tilemap_Case redraw    = { &map, &Framebuffers[0], middle, middle, 3, 1, seed };
+		Tilemap_Case scrolling = { &map, &Framebuffers[0], middle, middle, 3, 1, seed };
+		Tilemap_Case still     = { &map, &Framebuffers[0], middle + 5, middle + 3, 0, 0, seed };
+		Tilemap_Case edit      = { &map, &Framebuffers[0], middle + 5, middle + 3, 0, 0, seed };
+
+		char name[64];
+		snprintf(name, sizeof(name), "tilemap/%ux%u/redraw_tiles", BENCH_TILEMAP_SIZE, BENCH_TILEMAP_SIZE);
+		Bench_Run(name, BenchTilemapRedraw, &redraw, frame_size);
+		snprintf(name, sizeof(name), "tilemap/%ux%u/cached/scrolling", BENCH_TILEMAP_SIZE, BENCH_TILEMAP_SIZE);
+		Bench_Run(name, BenchTilemapDraw, &scrolling, frame_size);
+		snprintf(name, sizeof(name), "tilemap/%ux%u/cached/static", BENCH_TILEMAP_SIZE, BENCH_TILEMAP_SIZE);
+		Bench_Run(name, BenchTilemapDraw, &still, frame_size);
+		snprintf(name, sizeof(name), "tilemap/%ux%u/cached/edit_one_tile", BENCH_TILEMAP_SIZE, BENCH_TILEMAP_SIZE);
+		Bench_Run(name, BenchTilemapEditDraw, &edit, frame_size);
+	}
+
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+/// Font
+
+#define BENCH_FONT_LINES      100
+#define BENCH_FONT_LINE_CHARS (AZUR_WIDTH/FONT_GLYPH_SIZE)
+
+// NOTE: The obvious per-pixel loop, every pixel of every glyph is looked up, tested and clipped on its own
+static void
+FontNaive(Framebuffer* framebuffer, s32 x, s32 y, String text, u8 index)
+{
+	s32 pen_x = x;
+	s32 pen_y = y;
+
+	for (u32 i = 0; i < text.len; ++i)
+	{
+		if (text.data[i] == '\n')
+		{
+			pen_x  = x;
+			pen_y += FONT_GLYPH_SIZE;
+			continue;
+		}
+
+		u8* glyph = Font_Glyph(text.data[i]);
+		for (s32 j = 0; j < FONT_GLYPH_SIZE; ++j)
+		{
+			for (s32 k = 0; k < FONT_GLYPH_SIZE; ++k)
+			{
+				s32 dx = pen_x + k;
+				s32 dy = pen_y + j;
+				if (dx < 0 || dx >= AZUR_WIDTH || dy < 0 || dy >= AZUR_HEIGHT) continue;
+
+				if ((glyph[j] >> k) & 1) framebuffer->pixels[dy][dx] = index;
+			}
+		}
+
+		pen_x += FONT_GLYPH_SIZE;
+	}
+
+	Framebuffer_MarkAll(framebuffer);
+}
+
+typedef struct Font_Case
+{
+	String* lines;
+	u32 line_count;
+	Font_Cache* cache;
+	u32 mode; // NOTE: 0 is the naive loop, 1 scalar, 2 vector and 3 vector with the cache
+} Font_Case;
+
+// NOTE: a screen and then some of text, like a debug overlay, every line at the left edge and one row of glyphs down
+static void
+BenchFontDraw(void* data, u64 count)
+{
+	Font_Case* font_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		Framebuffer* framebuffer = Bench_Opaque(&Framebuffers[0]);
+
+		for (u32 j = 0; j < font_case->line_count; ++j)
+		{
+			s32 y = (s32)(j*FONT_GLYPH_SIZE % AZUR_HEIGHT);
+			u8 index = (u8)(j & 0x7);
+
+			if      (font_case->mode == 0) FontNaive(framebuffer, 0, y, font_case->lines[j], index);
+			else if (font_case->mode == 1) Font_DrawTextScalar(framebuffer, 0, y, font_case->lines[j], index);
+			else if (font_case->mode == 2) Font_DrawText(framebuffer, 0, y, font_case->lines[j], index);
+			else                           Font_DrawTextCached(framebuffer, font_case->cache, 0, y, font_case->lines[j], index);
+		}
+	}
+}
+
+static void
+RandomText(u32* seed, u8* text, u32 length)
+{
+	for (u32 i = 0; i < length; ++i)
+	{
+		u32 r = Random(seed);
+
+		// NOTE: mostly printable, with line breaks and bytes that have no glyph thrown in
+		if      (r % 32 == 0) text[i] = '\n';
+		else if (r % 32 == 1) text[i] = (u8)(r >> 8);
+		else                  text[i] = (u8)(FONT_FIRST_CHAR + (r >> 8) % (FONT_GLYPH_COUNT - 1));
+	}
+}
+
+// NOTE: Text of every length up to a few runs, anywhere on and around the framebuffer, drawn by every path. The cache
+//       is small, so runs get evicted and gathered again, and every string is drawn twice in a row so they also get
+//       drawn from the cache.
+static bool
+VerifyFont(Font_Cache* cache)
+{
+	static u8 text[FONT_RUN_CHARS*4];
+
+	bool succeeded = true;
+
+	memset(Framebuffers, 0, sizeof(Framebuffers));
+
+	u32 seed = 0xF0E7;
+	for (u32 i = 0; i < 20000 && succeeded; ++i)
+	{
+		u32 length = Random(&seed) % (sizeof(text) + 1);
+		RandomText(&seed, text, length);
+
+		String string = { .data = text, .len = length };
+		s32 x    = (s32)(Random(&seed) % (AZUR_WIDTH  + 256)) - 128;
+		s32 y    = (s32)(Random(&seed) % (AZUR_HEIGHT + 32)) - 16;
+		u8 index = (u8)Random(&seed);
+
+		FontNaive(&Framebuffers[0], x, y, string, index);
+
+		u32 path = i % 3;
+		if      (path == 0) Font_DrawTextScalar(&Framebuffers[1], x, y, string, index);
+		else if (path == 1) Font_DrawText(&Framebuffers[1], x, y, string, index);
+		else                Font_DrawTextCached(&Framebuffers[1], cache, x, y, string, index);
+
+		x += 1;
+		FontNaive(&Framebuffers[0], x, y, string, (u8)(index + 1));
+		Font_DrawTextCached(&Framebuffers[1], cache, x, y, string, (u8)(index + 1));
+
+		succeeded = (memcmp(Framebuffers[0].pixels, Framebuffers[1].pixels, sizeof(Framebuffers[0].pixels)) == 0);
+	}
+
+	if (!succeeded) fprintf(stderr, "font: text differs from the naive loop\n");
+
+	return succeeded;
+}
+
+static bool
+BenchFont(void)
+{
+	if (!Bench_Enabled("font/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 26, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	Font_Cache small_cache;
+	Font_CreateCache(&small_cache, &bump, 8);
+
+	bool succeeded = VerifyFont(&small_cache);
+
+	if (succeeded)
+	{
+		// NOTE: printable text only, every line as wide as the framebuffer
+		u32 seed = 0x7E47;
+		String* lines = Bump_Push(&bump, BENCH_FONT_LINES*sizeof(String), 8);
+		for (u32 i = 0; i < BENCH_FONT_LINES; ++i)
+		{
+			lines[i] = (String){ .data = Bump_Push(&bump, BENCH_FONT_LINE_CHARS, 1), .len = BENCH_FONT_LINE_CHARS };
+			for (u32 j = 0; j < BENCH_FONT_LINE_CHARS; ++j) lines[i].data[j] = (u8)(FONT_FIRST_CHAR + Random(&seed) % (FONT_GLYPH_COUNT - 1));
+		}
+
+		Font_Cache cache;
+		Font_CreateCache(&cache, &bump, BENCH_FONT_LINES*2);
+
+		Font_Case naive  = { lines, BENCH_FONT_LINES, 0,      0 };
+		Font_Case scalar = { lines, BENCH_FONT_LINES, 0,      1 };
+		Font_Case vector = { lines, BENCH_FONT_LINES, 0,      2 };
+		Font_Case cached = { lines, BENCH_FONT_LINES, &cache, 3 };
+
+		// NOTE: pixels are one byte, so GB/s reads as pixels per nanosecond
+		f64 pixels = (f64)BENCH_FONT_LINES*BENCH_FONT_LINE_CHARS*FONT_GLYPH_SIZE*FONT_GLYPH_SIZE;
+
+		char name[64];
+		snprintf(name, sizeof(name), "font/draw_text/chars=%u/naive", BENCH_FONT_LINES*BENCH_FONT_LINE_CHARS);
+		Bench_Run(name, BenchFontDraw, &naive, pixels);
+		snprintf(name, sizeof(name), "font/draw_text/chars=%u/scalar", BENCH_FONT_LINES*BENCH_FONT_LINE_CHARS);
+		Bench_Run(name, BenchFontDraw, &scalar, pixels);
+		snprintf(name, sizeof(name), "font/draw_text/chars=%u/simd", BENCH_FONT_LINES*BENCH_FONT_LINE_CHARS);
+		Bench_Run(name, BenchFontDraw, &vector, pixels);
+		snprintf(name, sizeof(name), "font/draw_text/chars=%u/cached", BENCH_FONT_LINES*BENCH_FONT_LINE_CHARS);
+		Bench_Run(name, BenchFontDraw, &cached, pixels);
+	}
+
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+/// Rewind
+
+#define BENCH_REWIND_SIZE    (1 << 21)
+#define BENCH_REWIND_HISTORY 8192
+
+typedef struct Rewind_Case
+{
+	Rewind rewind;
+	u8* state;
+	u8* snapshot;
+	u32 changed_words;
+	u32 seed;
+} Rewind_Case;
+
+// NOTE: what a frame of the game does to its state, a few words changed in places all over it
+static void
+ScribbleState(u8* state, u64 size, u32 changed_words, u32* seed)
+{
+	for (u32 i = 0; i < changed_words; ++i)
+	{
+		u64 offset = (u64)Random(seed) % (size/8)*8;
+
+		u64 word;
+		memcpy(&word, state + offset, sizeof(word));
+		word += Random(seed) | 1;
+		memcpy(state + offset, &word, sizeof(word));
+	}
+}
+
+static void
+BenchRewindCapture(void* data, u64 count)
+{
+	Rewind_Case* rewind_case = data;
+
+	u64 sizes[] = { BENCH_REWIND_SIZE };
+	for (u64 i = 0; i < count; ++i)
+	{
+		ScribbleState(rewind_case->state, BENCH_REWIND_SIZE, rewind_case->changed_words, &rewind_case->seed);
+		Rewind_Capture(&rewind_case->rewind, sizes);
+	}
+}
+
+// NOTE: the alternative, keeping a whole snapshot of the state every frame
+static void
+BenchRewindSnapshot(void* data, u64 count)
+{
+	Rewind_Case* rewind_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		ScribbleState(rewind_case->state, BENCH_REWIND_SIZE, rewind_case->changed_words, &rewind_case->seed);
+		memcpy(rewind_case->snapshot, rewind_case->state, BENCH_REWIND_SIZE);
+		Bench_Opaque(rewind_case->snapshot);
+	}
+}
+
+// NOTE: Random captures and step backs of two regions, one of which grows and shrinks, in a ring small enough that it
+//       wraps and drops frames all the time. Every state captured is kept whole, stepping back has to hand it back.
+static bool
+VerifyRewind(Bump* bump)
+{
+	u64 max_sizes[] = { 4096, 1001 };
+	u64 state_size  = max_sizes[0] + max_sizes[1];
+
+	u8* memory  = Bump_Push(bump, state_size + 16, 64);
+	u8* history = Bump_Push(bump, BENCH_REWIND_HISTORY*state_size, 64);
+	u64* history_sizes = Bump_Push(bump, BENCH_REWIND_HISTORY*2*sizeof(u64), 8);
+
+	Rewind_Region regions[] = {
+		{ memory,                    max_sizes[0] },
+		{ memory + max_sizes[0] + 8, max_sizes[1] },
+	};
+
+	Rewind rewind;
+	if (!Rewind_Create(&rewind, bump, 1 << 13, regions, 2)) return false;
+
+	bool succeeded = true;
+
+	u32 seed     = 0x4E3D;
+	u64 sizes[2] = { 1000, max_sizes[1] };
+	u64 current  = 0;
+	for (u32 i = 0; i < 20000 && succeeded; ++i)
+	{
+		u32 roll = Random(&seed) % 16;
+		if (i == 0 || roll >= 4)
+		{
+			if      (roll == 4) sizes[0] = Random(&seed) % (max_sizes[0] + 1);
+			else if (roll == 5) for (u64 j = 0; j < sizes[0]; ++j) regions[0].memory[j] = (u8)Random(&seed);
+
+			for (u32 j = 0; j < 2; ++j)
+			{
+				if (sizes[j] >= 8) ScribbleState(regions[j].memory, sizes[j], Random(&seed) % 8, &seed);
+			}
+
+			Rewind_Capture(&rewind, sizes);
+
+			current += (i != 0);
+			u8* copy = history + current % BENCH_REWIND_HISTORY*state_size;
+			memcpy(copy,                regions[0].memory, (umm)max_sizes[0]);
+			memcpy(copy + max_sizes[0], regions[1].memory, (umm)max_sizes[1]);
+			memcpy(history_sizes + current % BENCH_REWIND_HISTORY*2, sizes, sizeof(sizes));
+
+			succeeded = (Rewind_FrameCount(&rewind) < BENCH_REWIND_HISTORY && Rewind_BytesHeld(&rewind) <= rewind.ring_size);
+		}
+		else
+		{
+			u64 held = Rewind_FrameCount(&rewind);
+
+			// NOTE: the memory past the end of a region is the game's to scribble on
+			for (u64 j = sizes[0]; j < max_sizes[0]; ++j) regions[0].memory[j] = (u8)Random(&seed);
+
+			if (Rewind_StepBack(&rewind, sizes))
+			{
+				current -= 1;
+				u8* copy  = history + current % BENCH_REWIND_HISTORY*state_size;
+				u64* want = history_sizes + current % BENCH_REWIND_HISTORY*2;
+
+				succeeded = (held != 0 && sizes[0] == want[0] && sizes[1] == want[1] &&
+				             memcmp(copy,                regions[0].memory, (umm)sizes[0]) == 0 &&
+				             memcmp(copy + max_sizes[0], regions[1].memory, (umm)sizes[1]) == 0);
+			}
+			else
+			{
+				succeeded = (held == 0);
+			}
+		}
+	}
+
+	succeeded &= (rewind.dropped_frames != 0 && rewind.resets == 0);
+
+	if (!succeeded) fprintf(stderr, "rewind: stepping back handed back something else than what was captured\n");
+
+	Rewind_Destroy(&rewind);
+
+	return succeeded;
+}
+
+static bool
+BenchRewind(void)
+{
+	if (!Bench_Enabled("rewind/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 28, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	bool succeeded = VerifyRewind(&bump);
+
+	if (succeeded)
+	{
+		Rewind_Case rewind_case = {
+			.state    = Bump_Push(&bump, BENCH_REWIND_SIZE, 64),
+			.snapshot = Bump_Push(&bump, BENCH_REWIND_SIZE, 64),
+			.seed     = 0x2E71,
+		};
+
+		FillTiles(rewind_case.state, BENCH_REWIND_SIZE, 0x2E71);
+
+		Rewind_Region region = { rewind_case.state, BENCH_REWIND_SIZE };
+		if (!Rewind_Create(&rewind_case.rewind, &bump, 1 << 26, &region, 1)) return false;
+
+		u32 changed_words[] = { 0, 256, 4096 };
+		for (umm i = 0; i < sizeof(changed_words)/sizeof(changed_words[0]); ++i)
+		{
+			rewind_case.changed_words = changed_words[i];
+
+			char name[64];
+			snprintf(name, sizeof(name), "rewind/capture/bytes=%u/changed=%u", BENCH_REWIND_SIZE, changed_words[i]);
+			Bench_Run(name, BenchRewindCapture, &rewind_case, BENCH_REWIND_SIZE);
+		}
+
+		rewind_case.changed_words = 256;
+
+		char name[64];
+		snprintf(name, sizeof(name), "rewind/capture/bytes=%u/changed=256/snapshot", BENCH_REWIND_SIZE);
+		Bench_Run(name, BenchRewindSnapshot, &rewind_case, BENCH_REWIND_SIZE);
+
+		Rewind_Destroy(&rewind_case.rewind);
+	}
+
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+/// FrameQueue
+
+#define BENCH_FRAME_QUEUE_FRAMES 4000
+
+typedef struct Frame_Queue_Case
+{
+	Frame_Queue queue;
+	Framebuffer* framebuffer;
+	Palette* palette;
+	u32 changed_rows;
+	u32 frame;
+	OS_Semaphore published;
+} Frame_Queue_Case;
+
+// NOTE: What the game draws into frame number frame, rows already changed are left alone. Row 0 and colors[0] hold
+//       the frame number, so the presenting side can tell which frame it got.
+static void
+DrawQueuedFrame(Framebuffer* framebuffer, Palette* palette, u32 frame, u32 changed_rows)
+{
+	memset(framebuffer->pixels[0], (u8)frame, AZUR_WIDTH);
+	for (u32 i = 1; i < changed_rows; ++i) memset(framebuffer->pixels[1 + (frame*7 + i*13) % (AZUR_HEIGHT - 1)], (u8)(frame + i), AZUR_WIDTH);
+
+	palette->colors[0]                = frame;
+	palette->colors[frame % 255 + 1] ^= frame;
+}
+
+// NOTE: the simulation thread of the platform, with the presenting side told about every frame so it never has to spin
+static void
+FrameQueueProducer(void* data)
+{
+	Frame_Queue_Case* queue_case = data;
+
+	for (u32 frame = 1; frame <= BENCH_FRAME_QUEUE_FRAMES && FrameQueue_WaitTaken(&queue_case->queue); ++frame)
+	{
+		DrawQueuedFrame(queue_case->framebuffer, queue_case->palette, frame, frame % 8);
+		FrameQueue_Publish(&queue_case->queue, queue_case->framebuffer, queue_case->palette, frame);
+		OS_SignalSemaphore(&queue_case->published);
+	}
+}
+
+static void
+BenchFrameQueuePublishTake(void* data, u64 count)
+{
+	Frame_Queue_Case* queue_case = data;
+
+	for (u64 i = 0; i < count; ++i)
+	{
+		queue_case->frame += 1;
+		DrawQueuedFrame(queue_case->framebuffer, queue_case->palette, queue_case->frame, queue_case->changed_rows);
+		FrameQueue_Publish(&queue_case->queue, queue_case->framebuffer, queue_case->palette, queue_case->frame);
+		FrameQueue_Take(&queue_case->queue);
+
+		Framebuffer_ClearDirty(queue_case->queue.framebuffer);
+		Palette_ClearDirty(queue_case->queue.palette);
+	}
+}
+
+// NOTE: Frames taken have to be whole, in order and one after the other, with every row that changed since the last
+//       one marked. Presenting ahead of the simulation side duplicates frames.
+static bool
+VerifyFrameQueue(Bump* bump)
+{
+	Frame_Queue_Case queue_case = {
+		.framebuffer = Bump_Push(bump, sizeof(Framebuffer), 64),
+		.palette     = Bump_Push(bump, sizeof(Palette), 64),
+	};
+
+	Framebuffer* expected     = Bump_Push(bump, sizeof(Framebuffer), 64);
+	Framebuffer* before       = Bump_Push(bump, sizeof(Framebuffer), 64);
+	Palette* expected_colors  = Bump_Push(bump, sizeof(Palette), 64);
+	Framebuffer* presented    = Bump_Push(bump, sizeof(Framebuffer), 64);
+	Palette* presented_colors = Bump_Push(bump, sizeof(Palette), 64);
+
+	Palette_Init(queue_case.palette);
+	*expected_colors  = *queue_case.palette;
+	*presented_colors = *queue_case.palette;
+
+	if (!FrameQueue_Create(&queue_case.queue, bump, presented, presented_colors)) return false;
+
+	bool succeeded = OS_CreateSemaphore(&queue_case.published, 0);
+
+	{ /// Duplicated
+		succeeded &= (!FrameQueue_Take(&queue_case.queue) && queue_case.queue.duplicated == 1);
+
+		FrameQueue_Publish(&queue_case.queue, queue_case.framebuffer, queue_case.palette, 0);
+
+		succeeded &= (FrameQueue_Take(&queue_case.queue) && queue_case.queue.slots[queue_case.queue.front].sim_tick == 0);
+		succeeded &= (!FrameQueue_Take(&queue_case.queue) && queue_case.queue.duplicated == 2);
+
+		Framebuffer_ClearDirty(presented);
+		Palette_ClearDirty(presented_colors);
+		queue_case.queue.published = queue_case.queue.presented = queue_case.queue.duplicated = 0;
+	}
+
+	OS_Thread producer = {0};
+	succeeded = succeeded && OS_CreateThread(&producer, FrameQueueProducer, &queue_case);
+
+	for (u32 frame = 1; frame <= BENCH_FRAME_QUEUE_FRAMES && succeeded; ++frame)
+	{
+		OS_WaitSemaphore(&queue_case.published);
+
+		memcpy(before->pixels, expected->pixels, sizeof(expected->pixels));
+		DrawQueuedFrame(expected, expected_colors, frame, frame % 8);
+
+		succeeded &= FrameQueue_Take(&queue_case.queue);
+		succeeded &= (presented->pixels[0][0] == (u8)frame && presented_colors->colors[0] == frame);
+		succeeded &= (memcmp(presented->pixels, expected->pixels, sizeof(expected->pixels)) == 0);
+		succeeded &= (memcmp(presented_colors->colors, expected_colors->colors, sizeof(expected_colors->colors)) == 0);
+
+		for (u32 row = 0; row < AZUR_HEIGHT && succeeded; ++row)
+		{
+			bool changed = (memcmp(before->pixels[row], expected->pixels[row], AZUR_WIDTH) != 0);
+			bool marked  = (presented->dirty_rows[row/64] >> (row%64)) & 1;
+			succeeded &= (!changed || marked);
+		}
+
+		Framebuffer_ClearDirty(presented);
+		Palette_ClearDirty(presented_colors);
+	}
+
+	FrameQueue_Stop(&queue_case.queue);
+	if (producer.handle != 0) OS_JoinThread(&producer);
+
+	succeeded &= (queue_case.queue.published == BENCH_FRAME_QUEUE_FRAMES && queue_case.queue.presented == BENCH_FRAME_QUEUE_FRAMES &&
+	              queue_case.queue.duplicated == 0);
+
+	if (!succeeded) fprintf(stderr, "framequeue: the presenting side got frames other than the ones published\n");
+
+	OS_DestroySemaphore(&queue_case.published);
+	FrameQueue_Destroy(&queue_case.queue);
+
+	return succeeded;
+}
+
+static bool
+BenchFrameQueue(void)
+{
+	if (!Bench_Enabled("framequeue/")) return true;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 24, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	bool succeeded = VerifyFrameQueue(&bump);
+
+	if (succeeded)
+	{
+		Frame_Queue_Case queue_case = {
+			.framebuffer = Bump_Push(&bump, sizeof(Framebuffer), 64),
+			.palette     = Bump_Push(&bump, sizeof(Palette), 64),
+		};
+
+		Palette_Init(queue_case.palette);
+		Framebuffer* presented    = Bump_Push(&bump, sizeof(Framebuffer), 64);
+		Palette* presented_colors = Bump_Push(&bump, sizeof(Palette), 64);
+
+		if (!FrameQueue_Create(&queue_case.queue, &bump, presented, presented_colors)) return false;
+
+		u32 changed_rows[] = { 1, 16, AZUR_HEIGHT };
+		for (umm i = 0; i < sizeof(changed_rows)/sizeof(changed_rows[0]); ++i)
+		{
+			queue_case.changed_rows = changed_rows[i];
+
+			char name[64];
+			snprintf(name, sizeof(name), "framequeue/publish_take/rows=%u", changed_rows[i]);
+			Bench_Run(name, BenchFrameQueuePublishTake, &queue_case, sizeof(Framebuffer));
+		}
+
+		FrameQueue_Destroy(&queue_case.queue);
+	}
+
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+/// Present
+
+typedef struct Present_Case
+{
+	Present present;
+	Palette* palette;
+	Job_Range_Func* rows;
+} Present_Case;
+
+static void
+BenchPresentRows(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i)
+	{
+		Present_Case* present_case = Bench_Opaque(data);
+		present_case->rows(&present_case->present, 0, present_case->present.height, 0);
+	}
+}
+
+static void
+BenchPresentFrame(void* data, u64 count)
+{
+	for (u64 i = 0; i < count; ++i)
+	{
+		Present_Case* present_case = Bench_Opaque(data);
+		Present_Frame(&present_case->present, present_case->present.framebuffer, present_case->palette, Jobs_ParallelFor, Jobs_Wait);
+	}
+}
+
+// NOTE: What the fragment shader computes, in floats. Only used at whole multiples of 320x180, where no sample lands
+//       close enough to a texel edge for float rounding to matter.
+static u32
+PresentShader(Present* present, s32 x, s32 y)
+{
+	s32* viewport = present->viewport;
+	s32 vx = x - viewport[0];
+	s32 vy = y - viewport[1];
+
+	if (vx < 0 || vx >= viewport[2] || vy < 0 || vy >= viewport[3]) return PRESENT_CLEAR_COLOR;
+
+	u32 u = (u32)(((f32)vx + 0.5f)/(f32)viewport[2]*AZUR_WIDTH);
+	u32 v = (u32)(((f32)vy + 0.5f)/(f32)viewport[3]*AZUR_HEIGHT);
+
+	return present->lut[present->framebuffer->pixels[v][u]];
+}
+
+// NOTE: Covers integer and fractional scales, margins of odd width, targets wider than tall and the other way
+//       around, and viewports narrower than the framebuffer, which take the scalar path
+static bool
+VerifyPresent(Bump* bump, Palette* palette, u32* pixels, u32* reference)
+{
+	u32 sizes[][2] = {
+		{ 3840, 2160 }, { 2560, 1440 }, { 1920, 1080 }, { 1920, 1200 }, { 1366, 768 }, { 1000, 1000 },
+		{  641,  361 }, {  320,  180 }, {  319,  181 }, {  200,  120 }, {   15,    8 },
+	};
+
+	bool succeeded = true;
+
+	for (umm i = 0; i < sizeof(sizes)/sizeof(sizes[0]) && succeeded; ++i)
+	{
+		u32 width  = sizes[i][0];
+		u32 height = sizes[i][1];
+
+		// NOTE: a stride wider than the target catches writes past the end of a row
+		u32 stride = width + 5;
+
+		Bump_Mark mark = Bump_GetMark(bump);
+
+		Present present;
+		Present_Create(&present, bump, pixels, width, height, stride);
+		present.framebuffer = &Framebuffers[0];
+		Present_SetPalette(&present, palette);
+
+		memset(pixels,    0, (umm)stride*height*sizeof(u32));
+		memset(reference, 0, (umm)stride*height*sizeof(u32));
+
+		Present_Rows(&present, 0, height, 0);
+		present.pixels = reference;
+		Present_RowsScalar(&present, 0, height, 0);
+
+		succeeded = (memcmp(pixels, reference, (umm)stride*height*sizeof(u32)) == 0);
+
+		bool integer_scale = (present.viewport[2] % AZUR_WIDTH == 0);
+		for (u32 y = 0; y < height && succeeded && integer_scale; ++y)
+		{
+			for (u32 x = 0; x < width && succeeded; ++x) succeeded = (reference[(umm)y*stride + x] == PresentShader(&present, (s32)x, (s32)y));
+		}
+
+		if (!succeeded) fprintf(stderr, "present/%ux%u: output differs from the reference\n", width, height);
+
+		Bump_PopToMark(bump, mark);
+	}
+
+	return succeeded;
+}
+
+static bool
+BenchPresent(void)
+{
+	if (!Bench_Enabled("present/")) return true;
+
+	u32 width  = 3840;
+	u32 height = 2160;
+
+	Bump bump;
+	if (!Bump_Create(1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, 0, &bump)) return false;
+
+	u32* pixels    = Bump_Push(&bump, (umm)(width + 5)*height*sizeof(u32), 64);
+	u32* reference = Bump_Push(&bump, (umm)(width + 5)*height*sizeof(u32), 64);
+
+	// NOTE: every index and every entry random, so a wrong entry or a wrong column shows
+	u32 seed = 0x2545F491;
+	u8* indices = &Framebuffers[0].pixels[0][0];
+	for (umm i = 0; i < sizeof(Framebuffers[0].pixels); ++i) indices[i] = (u8)Random(&seed);
+
+	Palette palette;
+	Palette_Init(&palette);
+	for (u32 i = 0; i < AZUR_PALETTE_SIZE; ++i) palette.colors[i] = Random(&seed) & 0xFFFFFF;
+
+	bool succeeded = VerifyPresent(&bump, &palette, pixels, reference);
+
+	u32 sizes[][2] = { { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+	for (umm i = 0; i < sizeof(sizes)/sizeof(sizes[0]) && succeeded; ++i)
+	{
+		Present_Case present_case = { .palette = &palette };
+		Present_Create(&present_case.present, &bump, pixels, sizes[i][0], sizes[i][1], sizes[i][0]);
+		present_case.present.framebuffer = &Framebuffers[0];
+		Present_SetPalette(&present_case.present, &palette);
+
+		f64 bytes_per_op = (f64)sizes[i][0]*sizes[i][1]*sizeof(u32);
+
+		char name[64];
+		snprintf(name, sizeof(name), "present/%ux%u/scalar", sizes[i][0], sizes[i][1]);
+		present_case.rows = Present_RowsScalar;
+		Bench_Run(name, BenchPresentRows, &present_case, bytes_per_op);
+
+		snprintf(name, sizeof(name), "present/%ux%u/simd", sizes[i][0], sizes[i][1]);
+		present_case.rows = Present_Rows;
+		Bench_Run(name, BenchPresentRows, &present_case, bytes_per_op);
+
+		// NOTE: whole frames split into bands on the job system, doubling the workers up to the processor count
+		u32 processor_count = OS_GetProcessorCount();
+		for (u32 worker_count = 1; worker_count <= JOBS_MAX_WORKERS; worker_count *= 2)
+		{
+			Bump_Mark mark = Bump_GetMark(&bump);
+
+			Job_System jobs;
+			if (!Jobs_Create(&jobs, &bump, worker_count)) return false;
+
+			snprintf(name, sizeof(name), "present/%ux%u/simd/workers=%u", sizes[i][0], sizes[i][1], worker_count);
+			Bench_Run(name, BenchPresentFrame, &present_case, bytes_per_op);
+
+			Jobs_Destroy(&jobs);
+			Bump_PopToMark(&bump, mark);
+
+			if (worker_count >= processor_count) break;
+		}
+	}
+
+	Bump_Destroy(&bump);
+
+	return succeeded;
+}
+
+static void
+PrintUsage(const char* exe)
+{
+	fprintf(stderr,
+		"Usage: %s [--filter TEXT] [--json PATH] [--quick]\n"
+		"  --filter TEXT  only run cases with TEXT in their name, like \"blit/\" or \"len=64\"\n"
+		"  --json PATH    write the results to PATH as JSON\n"
+		"  --quick        fewer and shorter samples, for checking that every case runs\n",
+		exe);
+}
+
+int
+main(int argc, char** argv)
+{
+	const char* json_path = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool has_value = (i + 1 < argc);
+
+		if      (strcmp(argv[i], "--filter") == 0 && has_value) BenchState.filter = argv[++i];
+		else if (strcmp(argv[i], "--json")   == 0 && has_value) json_path         = argv[++i];
+		else if (strcmp(argv[i], "--quick")  == 0)              BenchState.quick  = true;
+		else
+		{
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	bool succeeded = true;
+
+	succeeded &= BenchBump();
+	succeeded &= BenchString();
+	succeeded &= BenchIntern();
+	succeeded &= BenchFrame();
+	succeeded &= BenchProfileZone();
+	succeeded &= BenchJobs();
+	succeeded &= BenchEntity();
+	succeeded &= BenchSpatial();
+	succeeded &= BenchAudio();
+	succeeded &= BenchPack();
+	succeeded &= BenchPresent();
+	succeeded &= BenchTilemap();
+	succeeded &= BenchFont();
+	succeeded &= BenchRewind();
+	succeeded &= BenchFrameQueue();
+
+	u32 sizes[] = { 8, 16, 32, 64, 128 };
+	for (umm i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i)
+	{
+		succeeded &= BenchBlit(sizes[i], 0, false);
+		succeeded &= BenchBlit(sizes[i], BLIT_OPAQUE, false);
+		succeeded &= BenchBlit(sizes[i], BLIT_FLIP_X | BLIT_FLIP_Y, false);
+		succeeded &= BenchBlit(sizes[i], 0, true);
+	}
+
+	if (json_path != 0 && !Bench_WriteJSON(json_path))
+	{
+		//// ERROR
+		fprintf(stderr, "Failed to write results to %s\n", json_path);
+		succeeded = false;
+	}
+
+	return (succeeded ? 0 : 1);
+}
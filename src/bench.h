@@ -0,0 +1,176 @@
+// NOTE: Harness for azur_bench. A case is a function running count operations. The harness doubles count until one
+//       call takes at least the minimum sample time, keeps calling it until the warm-up time has passed so caches,
+//       branch predictors and clock speeds settle, then times a fixed number of samples. Every sample is timed with
+//       the OS clock and the TSC, results are per operation: min, median, mean and max nanoseconds and median TSC
+//       ticks. The TSC ticks at a constant rate, which only matches core cycles when the core runs at that rate.
+//
+//       Results are printed as they finish and can be written as JSON at the end, for comparing two builds.
+
+#define BENCH_MAX_RESULTS     512
+#define BENCH_MAX_SAMPLES     64
+#define BENCH_DEFAULT_SAMPLES 25
+#define BENCH_MIN_SAMPLE_NS   500000ULL
+#define BENCH_WARMUP_NS       20000000ULL
+
+// NOTE: --quick trades precision for time, for checking that every case still runs
+#define BENCH_QUICK_SAMPLES       5
+#define BENCH_QUICK_MIN_SAMPLE_NS 50000ULL
+#define BENCH_QUICK_WARMUP_NS     1000000ULL
+
+typedef void Bench_Func(void* data, u64 count);
+
+typedef struct Bench_Result
+{
+	char name[64];
+	u64 count; // NOTE: operations per sample
+	u32 samples;
+	f64 ns_min;
+	f64 ns_median;
+	f64 ns_mean;
+	f64 ns_max;
+	f64 ticks_median;
+	f64 bytes_per_op; // NOTE: 0 when throughput means nothing for the case
+} Bench_Result;
+
+typedef struct Bench
+{
+	const char* filter;
+	bool quick;
+	u32 result_count;
+	Bench_Result results[BENCH_MAX_RESULTS];
+} Bench;
+
+static Bench BenchState;
+
+// NOTE: Reads through these keep the compiler from hoisting work on loop invariant inputs out of the timed loop
+static void* volatile BenchOpaquePointer;
+static volatile u64 BenchSink;
+
+static void*
+Bench_Opaque(void* pointer)
+{
+	BenchOpaquePointer = pointer;
+	return BenchOpaquePointer;
+}
+
+static bool
+Bench_Enabled(const char* name)
+{
+	return (BenchState.filter == 0 || strstr(name, BenchState.filter) != 0);
+}
+
+static void
+Bench_SortU64(u64* values, u32 count)
+{
+	for (u32 i = 1; i < count; ++i)
+	{
+		u64 value = values[i];
+
+		u32 j = i;
+		for (; j > 0 && values[j-1] > value; --j) values[j] = values[j-1];
+		values[j] = value;
+	}
+}
+
+// NOTE: count 0 calibrates the operations per sample, samples 0 takes the default
+static Bench_Result*
+Bench_RunCount(const char* name, Bench_Func* func, void* data, f64 bytes_per_op, u64 count, u32 samples)
+{
+	if (!Bench_Enabled(name) || BenchState.result_count == BENCH_MAX_RESULTS) return 0;
+
+	u64 min_sample_ns = (BenchState.quick ? BENCH_QUICK_MIN_SAMPLE_NS : BENCH_MIN_SAMPLE_NS);
+	u64 warmup_ns     = (BenchState.quick ? BENCH_QUICK_WARMUP_NS     : BENCH_WARMUP_NS);
+
+	if (samples == 0)                samples = (BenchState.quick ? BENCH_QUICK_SAMPLES : BENCH_DEFAULT_SAMPLES);
+	if (samples > BENCH_MAX_SAMPLES) samples = BENCH_MAX_SAMPLES;
+
+	/// Calibrate and warm up
+	u64 warmup_start = OS_GetTimeNS();
+
+	if (count == 0)
+	{
+		for (count = 1;; count *= 2)
+		{
+			u64 start = OS_GetTimeNS();
+			func(data, count);
+			if (OS_GetTimeNS() - start >= min_sample_ns || count >= (1ULL << 40)) break;
+		}
+	}
+
+	while (OS_GetTimeNS() - warmup_start < warmup_ns) func(data, count);
+
+	/// Sample
+	u64 times[BENCH_MAX_SAMPLES];
+	u64 ticks[BENCH_MAX_SAMPLES];
+
+	for (u32 i = 0; i < samples; ++i)
+	{
+		u64 start     = OS_GetTimeNS();
+		u64 start_tsc = __rdtsc();
+
+		func(data, count);
+
+		ticks[i] = __rdtsc() - start_tsc;
+		times[i] = OS_GetTimeNS() - start;
+	}
+
+	u64 total = 0;
+	for (u32 i = 0; i < samples; ++i) total += times[i];
+
+	Bench_SortU64(times, samples);
+	Bench_SortU64(ticks, samples);
+
+	Bench_Result* result = &BenchState.results[BenchState.result_count++];
+
+	*result = (Bench_Result){
+		.count        = count,
+		.samples      = samples,
+		.ns_min       = (f64)times[0]/count,
+		.ns_median    = (f64)times[samples/2]/count,
+		.ns_mean      = (f64)total/samples/count,
+		.ns_max       = (f64)times[samples-1]/count,
+		.ticks_median = (f64)ticks[samples/2]/count,
+		.bytes_per_op = bytes_per_op,
+	};
+
+	snprintf(result->name, sizeof(result->name), "%s", name);
+
+	printf("%-44s %11.3f ns/op  min %11.3f  max %11.3f  %10.1f ticks/op",
+				 result->name, result->ns_median, result->ns_min, result->ns_max, result->ticks_median);
+	if (bytes_per_op != 0) printf("  %8.3f GB/s", bytes_per_op/result->ns_median);
+	printf("\n");
+
+	return result;
+}
+
+static Bench_Result*
+Bench_Run(const char* name, Bench_Func* func, void* data, f64 bytes_per_op)
+{
+	return Bench_RunCount(name, func, data, bytes_per_op, 0, 0);
+}
+
+static bool
+Bench_WriteJSON(const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == 0) return false;
+
+	fprintf(file, "{\n\t\"results\": [\n");
+
+	for (u32 i = 0; i < BenchState.result_count; ++i)
+	{
+		Bench_Result* result = &BenchState.results[i];
+
+		// NOTE: case names are plain ASCII without quotes or backslashes, they are written as they are
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"ops_per_sample\": %llu, \"samples\": %u, "
+		              "\"ns_per_op\": { \"min\": %.4f, \"median\": %.4f, \"mean\": %.4f, \"max\": %.4f }, "
+		              "\"tsc_ticks_per_op\": %.4f, \"bytes_per_op\": %.4f }%s\n",
+		        result->name, (unsigned long long)result->count, result->samples,
+		        result->ns_min, result->ns_median, result->ns_mean, result->ns_max,
+		        result->ticks_median, result->bytes_per_op, (i + 1 < BenchState.result_count ? "," : ""));
+	}
+
+	fprintf(file, "\t]\n}\n");
+
+	return (fclose(file) == 0);
+}
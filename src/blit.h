@@ -0,0 +1,269 @@
+// NOTE: Sprite blitting into the indexed framebuffer. Every entry point clips against the framebuffer and marks the
+//       rows it touched dirty. Vector paths are selected at compile time, the scalar versions are the reference
+//       implementation and must produce identical output.
+
+typedef struct Sprite
+{
+	u8* pixels;
+	u32 width;
+	u32 height;
+	u32 stride;
+	u8 color_key;
+} Sprite;
+
+// NOTE: Maps source indices to framebuffer indices. Only indices below 16 are remapped, matching pshufb semantics:
+//       indices with the top bit set map to 0 and all others use their low nibble.
+typedef struct Blit_Remap
+{
+	u8 map[16];
+} Blit_Remap;
+
+typedef enum BLIT_FLAGS
+{
+	BLIT_FLIP_X = 1 << 0,
+	BLIT_FLIP_Y = 1 << 1,
+	BLIT_OPAQUE = 1 << 2, // NOTE: ignore the sprite color key
+} BLIT_FLAGS;
+
+typedef struct Blit_Rect
+{
+	s32 dst_x;
+	s32 dst_y;
+	s32 src_x;
+	s32 src_y;
+	s32 width;
+	s32 height;
+} Blit_Rect;
+
+static bool
+Blit_Clip(Sprite* sprite, s32 x, s32 y, u32 flags, Blit_Rect* rect)
+{
+	s32 x0 = (x < 0 ? 0 : x);
+	s32 y0 = (y < 0 ? 0 : y);
+	s32 x1 = (x + (s32)sprite->width  > AZUR_WIDTH  ? AZUR_WIDTH  : x + (s32)sprite->width);
+	s32 y1 = (y + (s32)sprite->height > AZUR_HEIGHT ? AZUR_HEIGHT : y + (s32)sprite->height);
+
+	if (x0 >= x1 || y0 >= y1) return false;
+
+	// NOTE: src_x/src_y name the sprite texel written to (dst_x, dst_y), flipped sprites walk backwards from there
+	*rect = (Blit_Rect){
+		.dst_x  = x0,
+		.dst_y  = y0,
+		.src_x  = ((flags & BLIT_FLIP_X) ? (s32)sprite->width  - 1 - (x0 - x) : x0 - x),
+		.src_y  = ((flags & BLIT_FLIP_Y) ? (s32)sprite->height - 1 - (y0 - y) : y0 - y),
+		.width  = x1 - x0,
+		.height = y1 - y0,
+	};
+
+	return true;
+}
+
+static u8
+Blit_RemapIndex(Blit_Remap* remap, u8 index)
+{
+	return ((index & 0x80) ? 0 : remap->map[index & 0x0F]);
+}
+
+static void
+Blit_RowScalar(u8* dst, u8* src, s32 count, s32 step, bool keyed, u8 color_key, Blit_Remap* remap)
+{
+	for (s32 i = 0; i < count; ++i, src += step)
+	{
+		u8 index = *src;
+
+		if (keyed && index == color_key) continue;
+
+		dst[i] = (remap != 0 ? Blit_RemapIndex(remap, index) : index);
+	}
+}
+
+#ifdef __AVX2__
+static void
+Blit_Chunk32(u8* dst, u8* src, s32 step, bool keyed, __m256i key, __m256i table, bool remapped)
+{
+	__m256i pixels;
+	if (step > 0)
+	{
+		pixels = _mm256_loadu_si256((__m256i*)src);
+	}
+	else
+	{
+		__m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+		                                   15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+		pixels = _mm256_loadu_si256((__m256i*)(src - 31));
+		pixels = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(pixels, reverse), 0x4E);
+	}
+
+	__m256i transparent = _mm256_cmpeq_epi8(pixels, key);
+
+	if (remapped) pixels = _mm256_shuffle_epi8(table, pixels);
+
+	if (keyed)
+	{
+		// NOTE: fully transparent spans are common in sprites, skipping them also skips the store
+		if (_mm256_movemask_epi8(transparent) == -1) return;
+
+		pixels = _mm256_blendv_epi8(pixels, _mm256_loadu_si256((__m256i*)dst), transparent);
+	}
+
+	_mm256_storeu_si256((__m256i*)dst, pixels);
+}
+
+static void
+Blit_Chunk16(u8* dst, u8* src, s32 step, bool keyed, __m256i key, __m256i table, bool remapped)
+{
+	__m128i pixels;
+	if (step > 0)
+	{
+		pixels = _mm_loadu_si128((__m128i*)src);
+	}
+	else
+	{
+		__m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+		pixels = _mm_shuffle_epi8(_mm_loadu_si128((__m128i*)(src - 15)), reverse);
+	}
+
+	__m128i transparent = _mm_cmpeq_epi8(pixels, _mm256_castsi256_si128(key));
+
+	if (remapped) pixels = _mm_shuffle_epi8(_mm256_castsi256_si128(table), pixels);
+
+	if (keyed)
+	{
+		if (_mm_movemask_epi8(transparent) == 0xFFFF) return;
+
+		pixels = _mm_blendv_epi8(pixels, _mm_loadu_si128((__m128i*)dst), transparent);
+	}
+
+	_mm_storeu_si128((__m128i*)dst, pixels);
+}
+
+static void
+Blit_Chunk8(u8* dst, u8* src, s32 step, bool keyed, __m256i key, __m256i table, bool remapped)
+{
+	__m128i pixels;
+	if (step > 0)
+	{
+		pixels = _mm_loadl_epi64((__m128i*)src);
+	}
+	else
+	{
+		__m128i reverse = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, -1, -1, -1, -1, -1, -1, -1, -1);
+
+		pixels = _mm_shuffle_epi8(_mm_loadl_epi64((__m128i*)(src - 7)), reverse);
+	}
+
+	__m128i transparent = _mm_cmpeq_epi8(pixels, _mm256_castsi256_si128(key));
+
+	if (remapped) pixels = _mm_shuffle_epi8(_mm256_castsi256_si128(table), pixels);
+
+	if (keyed)
+	{
+		if ((_mm_movemask_epi8(transparent) & 0xFF) == 0xFF) return;
+
+		pixels = _mm_blendv_epi8(pixels, _mm_loadl_epi64((__m128i*)dst), transparent);
+	}
+
+	_mm_storel_epi64((__m128i*)dst, pixels);
+}
+
+// NOTE: Rows are covered by whole chunks, a ragged end is handled by one more chunk aligned to the end of the row that
+//       overlaps the previous one. Blitting a pixel twice gives the same result, and no store ever leaves the clip rect.
+static void
+Blit_RowAVX2(u8* dst, u8* src, s32 count, s32 step, bool keyed, u8 color_key, Blit_Remap* remap)
+{
+	__m256i key   = _mm256_set1_epi8((char)color_key);
+	__m256i table = (remap != 0 ? _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)remap->map)) : _mm256_setzero_si256());
+
+	if (count >= 32)
+	{
+		s32 i = 0;
+		for (; i + 32 <= count; i += 32) Blit_Chunk32(dst + i, src + i*step, step, keyed, key, table, remap != 0);
+
+		if (i < count) Blit_Chunk32(dst + count - 32, src + (count - 32)*step, step, keyed, key, table, remap != 0);
+	}
+	else if (count >= 16)
+	{
+		Blit_Chunk16(dst, src, step, keyed, key, table, remap != 0);
+		Blit_Chunk16(dst + count - 16, src + (count - 16)*step, step, keyed, key, table, remap != 0);
+	}
+	else if (count >= 8)
+	{
+		Blit_Chunk8(dst, src, step, keyed, key, table, remap != 0);
+		Blit_Chunk8(dst + count - 8, src + (count - 8)*step, step, keyed, key, table, remap != 0);
+	}
+	else
+	{
+		Blit_RowScalar(dst, src, count, step, keyed, color_key, remap);
+	}
+}
+#endif
+
+static void
+Blit_SpriteScalar(Framebuffer* framebuffer, Sprite* sprite, s32 x, s32 y, u32 flags, Blit_Remap* remap)
+{
+	Blit_Rect rect;
+	if (!Blit_Clip(sprite, x, y, flags, &rect)) return;
+
+	s32 step     = ((flags & BLIT_FLIP_X) ? -1 : 1);
+	s32 row_step = ((flags & BLIT_FLIP_Y) ? -(s32)sprite->stride : (s32)sprite->stride);
+	bool keyed   = !(flags & BLIT_OPAQUE);
+	u8* src      = sprite->pixels + (smm)rect.src_y*sprite->stride + rect.src_x;
+
+	for (s32 j = 0; j < rect.height; ++j, src += row_step)
+	{
+		Blit_RowScalar(&framebuffer->pixels[rect.dst_y + j][rect.dst_x], src, rect.width, step, keyed, sprite->color_key, remap);
+	}
+
+	Framebuffer_MarkRows(framebuffer, rect.dst_y, rect.height);
+}
+
+static void
+Blit_Sprite(Framebuffer* framebuffer, Sprite* sprite, s32 x, s32 y, u32 flags, Blit_Remap* remap)
+{
+#ifdef __AVX2__
+	Blit_Rect rect;
+	if (!Blit_Clip(sprite, x, y, flags, &rect)) return;
+
+	s32 step     = ((flags & BLIT_FLIP_X) ? -1 : 1);
+	s32 row_step = ((flags & BLIT_FLIP_Y) ? -(s32)sprite->stride : (s32)sprite->stride);
+	bool keyed   = !(flags & BLIT_OPAQUE);
+	u8* src      = sprite->pixels + (smm)rect.src_y*sprite->stride + rect.src_x;
+
+	for (s32 j = 0; j < rect.height; ++j, src += row_step)
+	{
+		Blit_RowAVX2(&framebuffer->pixels[rect.dst_y + j][rect.dst_x], src, rect.width, step, keyed, sprite->color_key, remap);
+	}
+
+	Framebuffer_MarkRows(framebuffer, rect.dst_y, rect.height);
+#else
+	Blit_SpriteScalar(framebuffer, sprite, x, y, flags, remap);
+#endif
+}
+
+static void
+Blit_FillRect(Framebuffer* framebuffer, s32 x, s32 y, s32 width, s32 height, u8 index)
+{
+	s32 x0 = (x < 0 ? 0 : x);
+	s32 y0 = (y < 0 ? 0 : y);
+	s32 x1 = (x + width  > AZUR_WIDTH  ? AZUR_WIDTH  : x + width);
+	s32 y1 = (y + height > AZUR_HEIGHT ? AZUR_HEIGHT : y + height);
+
+	if (x0 >= x1 || y0 >= y1) return;
+
+	for (s32 j = y0; j < y1; ++j)
+	{
+		u8* dst = &framebuffer->pixels[j][x0];
+		s32 i   = 0;
+
+#ifdef __AVX2__
+		__m256i fill = _mm256_set1_epi8((char)index);
+		for (; i + 32 <= x1 - x0; i += 32) _mm256_storeu_si256((__m256i*)(dst + i), fill);
+#endif
+
+		for (; i < x1 - x0; ++i) dst[i] = index;
+	}
+
+	Framebuffer_MarkRows(framebuffer, y0, y1 - y0);
+}
@@ -0,0 +1,317 @@
+// NOTE: Where bump memory goes. Bumps attached to a Bump_Trace log every push and pop along with the file, line and
+//       function it was made from, see Bump_TraceRecord in common.h, which only happens in AZUR_BUMP_TRACE builds.
+//       Once a frame the platform folds the log into call sites, one per file, line and arena, and writes what the
+//       frame pushed to a text file: for every arena the peak cursor, the bytes pushed and popped and the bytes lost
+//       to alignment, followed by the call sites that pushed the most. Bump_TraceFinish appends the same for the
+//       whole run.
+//
+//       Names are copied out of the log when it is folded, so records of a game module that is reloaded afterwards
+//       are still attributed to the right place.
+//
+//       Requires stdio.h.
+
+#define BUMP_TRACE_MAX_ARENAS 8
+#define BUMP_TRACE_MAX_SITES  1024     // NOTE: a power of two, sites past three quarters of it are lumped together
+#define BUMP_TRACE_LOG_SIZE   (1 << 16) // NOTE: records per frame
+#define BUMP_TRACE_TOP        8
+#define BUMP_TRACE_NAME_LEN   48
+
+typedef struct Bump_Trace_Totals
+{
+	u64 pushes;
+	u64 bytes;
+	u64 padding;
+	u64 pops;
+	u64 popped;
+	u64 peak;
+} Bump_Trace_Totals;
+
+typedef struct Bump_Trace_Site
+{
+	char file[BUMP_TRACE_NAME_LEN];
+	char tag[BUMP_TRACE_NAME_LEN];
+	u32 line;
+	u32 arena;
+	u32 frame_touched; // NOTE: frame_count of the last frame the site was touched in, plus one
+	bool used;
+	Bump_Trace_Totals frame;
+	Bump_Trace_Totals run;
+} Bump_Trace_Site;
+
+typedef struct Bump_Trace_Arena
+{
+	char name[BUMP_TRACE_NAME_LEN];
+	Bump_Trace_Totals frame;
+	Bump_Trace_Totals run;
+} Bump_Trace_Arena;
+
+typedef struct Bump_Trace
+{
+	Bump_Trace_Log log;
+	FILE* file;
+
+	u32 arena_count;
+	Bump_Trace_Arena arenas[BUMP_TRACE_MAX_ARENAS];
+
+	u32 site_count;
+	Bump_Trace_Site sites[BUMP_TRACE_MAX_SITES];
+	Bump_Trace_Site overflow; // NOTE: every site that did not fit
+	Bump_Trace_Site* frame_sites[BUMP_TRACE_MAX_SITES + 1];
+	u32 frame_site_count;
+
+	u32 frame_count;
+	u64 record_count;
+	u64 dropped_records;
+} Bump_Trace;
+
+static void
+Bump_TraceCopyName(char* dst, const char* src)
+{
+	umm i = 0;
+	for (; i < BUMP_TRACE_NAME_LEN-1 && src[i] != 0; ++i) dst[i] = src[i];
+	dst[i] = 0;
+}
+
+// NOTE: file is __FILE__, which is whatever path the compiler was given, only the name of the file is kept
+static const char*
+Bump_TraceFileName(const char* file)
+{
+	const char* name = file;
+	for (const char* c = file; *c != 0; ++c)
+	{
+		if (*c == '/' || *c == '\\') name = c + 1;
+	}
+
+	return name;
+}
+
+// NOTE: The trace and its log come from bump, which can be attached to the trace itself afterwards. The report goes
+//       to file, the caller still owns and closes it.
+static Bump_Trace*
+Bump_TraceCreate(Bump* bump, FILE* file)
+{
+	Bump_Trace* trace = Bump_Push(bump, sizeof(Bump_Trace), 64);
+	*trace = (Bump_Trace){
+		.log = {
+			.records  = Bump_Push(bump, BUMP_TRACE_LOG_SIZE*sizeof(Bump_Trace_Record), 64),
+			.capacity = BUMP_TRACE_LOG_SIZE,
+		},
+		.file = file,
+	};
+
+	Bump_TraceCopyName(trace->overflow.file, "(other)");
+	Bump_TraceCopyName(trace->overflow.tag, "");
+
+	fprintf(file, "# bump trace, all sizes in bytes. peak is the highest cursor reached by a push in the frame\n");
+
+	return trace;
+}
+
+// NOTE: Bumps attached under the same name count towards the same arena, like the two frame bumps
+static bool
+Bump_TraceAttach(Bump_Trace* trace, Bump* bump, const char* name)
+{
+	u32 arena = 0;
+	while (arena < trace->arena_count && strcmp(trace->arenas[arena].name, name) != 0) arena += 1;
+
+	if (arena == trace->arena_count)
+	{
+		if (trace->arena_count == BUMP_TRACE_MAX_ARENAS) return false;
+
+		trace->arena_count += 1;
+		Bump_TraceCopyName(trace->arenas[arena].name, name);
+	}
+
+	bump->trace       = &trace->log;
+	bump->trace_arena = arena;
+
+	return true;
+}
+
+static Bump_Trace_Site*
+Bump_TraceFindSite(Bump_Trace* trace, Bump_Trace_Record* record)
+{
+	const char* file = Bump_TraceFileName(record->file);
+
+	u32 hash = 2166136261U ^ record->line*16777619U ^ record->arena;
+	for (const char* c = file; *c != 0; ++c) hash = (hash ^ (u8)*c)*16777619U;
+
+	Bump_Trace_Site* site = 0;
+	for (u32 i = hash & (BUMP_TRACE_MAX_SITES-1);; i = (i + 1) & (BUMP_TRACE_MAX_SITES-1))
+	{
+		Bump_Trace_Site* slot = &trace->sites[i];
+
+		if (!slot->used)
+		{
+			if (trace->site_count >= BUMP_TRACE_MAX_SITES/4*3)
+			{
+				site = &trace->overflow;
+			}
+			else
+			{
+				site = slot;
+				site->used  = true;
+				site->line  = record->line;
+				site->arena = record->arena;
+				Bump_TraceCopyName(site->file, file);
+				Bump_TraceCopyName(site->tag, record->tag);
+
+				trace->site_count += 1;
+			}
+
+			break;
+		}
+		else if (slot->line == record->line && slot->arena == record->arena && strncmp(slot->file, file, BUMP_TRACE_NAME_LEN-1) == 0)
+		{
+			site = slot;
+			break;
+		}
+	}
+
+	return site;
+}
+
+static void
+Bump_TraceAdd(Bump_Trace_Totals* totals, Bump_Trace_Record* record)
+{
+	if (record->kind == BUMP_TRACE_PUSH)
+	{
+		totals->pushes  += 1;
+		totals->bytes   += record->size;
+		totals->padding += record->padding;
+		totals->peak     = (record->cursor > totals->peak ? record->cursor : totals->peak);
+	}
+	else
+	{
+		totals->pops   += 1;
+		totals->popped += record->size;
+	}
+}
+
+static void
+Bump_TraceMerge(Bump_Trace_Totals* run, Bump_Trace_Totals* frame)
+{
+	run->pushes  += frame->pushes;
+	run->bytes   += frame->bytes;
+	run->padding += frame->padding;
+	run->pops    += frame->pops;
+	run->popped  += frame->popped;
+	run->peak     = (frame->peak > run->peak ? frame->peak : run->peak);
+}
+
+static void
+Bump_TraceWriteTotals(Bump_Trace* trace, Bump_Trace_Arena* arena, Bump_Trace_Totals* totals)
+{
+	fprintf(trace->file, "  arena %-20s peak %10llu  pushed %10llu in %6llu  padding %8llu  popped %10llu in %6llu\n",
+	        arena->name, (unsigned long long)totals->peak, (unsigned long long)totals->bytes, (unsigned long long)totals->pushes,
+	        (unsigned long long)totals->padding, (unsigned long long)totals->popped, (unsigned long long)totals->pops);
+}
+
+// NOTE: The BUMP_TRACE_TOP sites that pushed the most, by selection, the lists are short
+static void
+Bump_TraceWriteTop(Bump_Trace* trace, Bump_Trace_Site** sites, u32 site_count, bool run)
+{
+	for (u32 i = 0; i < site_count && i < BUMP_TRACE_TOP; ++i)
+	{
+		u32 top = i;
+		for (u32 j = i + 1; j < site_count; ++j)
+		{
+			u64 bytes     = (run ? sites[j]->run.bytes   : sites[j]->frame.bytes);
+			u64 top_bytes = (run ? sites[top]->run.bytes : sites[top]->frame.bytes);
+			if (bytes > top_bytes) top = j;
+		}
+
+		Bump_Trace_Site* site = sites[top];
+		sites[top] = sites[i];
+		sites[i]   = site;
+
+		Bump_Trace_Totals* totals = (run ? &site->run : &site->frame);
+		if (totals->pushes == 0) break;
+
+		const char* arena = (site == &trace->overflow ? "" : trace->arenas[site->arena].name);
+
+		char location[BUMP_TRACE_NAME_LEN + 16];
+		snprintf(location, sizeof(location), "%s:%u", site->file, site->line);
+
+		fprintf(trace->file, "  site  %-32s %-24s %-16s pushed %10llu in %6llu  padding %8llu\n", location, site->tag, arena,
+		        (unsigned long long)totals->bytes, (unsigned long long)totals->pushes, (unsigned long long)totals->padding);
+	}
+}
+
+// NOTE: Folds the log into the sites and writes the report of the frame, then empties the log. The first frame is
+//       everything pushed before it, it is reported as setup. Nothing may push to a traced bump while this runs.
+static void
+Bump_TraceFrame(Bump_Trace* trace)
+{
+	u32 count = Atomic_LoadAcquire32(&trace->log.count);
+	u32 kept  = (count < trace->log.capacity ? count : trace->log.capacity);
+
+	trace->record_count    += count;
+	trace->dropped_records += count - kept;
+	trace->frame_site_count = 0;
+
+	for (u32 i = 0; i < kept; ++i)
+	{
+		Bump_Trace_Record* record = &trace->log.records[i];
+
+		Bump_Trace_Site* site = Bump_TraceFindSite(trace, record);
+		if (site->frame_touched != trace->frame_count + 1)
+		{
+			site->frame_touched = trace->frame_count + 1;
+			site->frame         = (Bump_Trace_Totals){0};
+
+			trace->frame_sites[trace->frame_site_count++] = site;
+		}
+
+		Bump_TraceAdd(&site->frame, record);
+		Bump_TraceAdd(&trace->arenas[record->arena].frame, record);
+	}
+
+	if (kept != 0)
+	{
+		if (trace->frame_count == 0) fprintf(trace->file, "setup\n");
+		else                         fprintf(trace->file, "frame %u\n", trace->frame_count - 1);
+
+		if (count != kept) fprintf(trace->file, "  dropped %u records, the log holds %u\n", count - kept, trace->log.capacity);
+	}
+
+	for (u32 i = 0; i < trace->arena_count; ++i)
+	{
+		Bump_Trace_Arena* arena = &trace->arenas[i];
+		if (arena->frame.pushes != 0 || arena->frame.pops != 0) Bump_TraceWriteTotals(trace, arena, &arena->frame);
+
+		Bump_TraceMerge(&arena->run, &arena->frame);
+		arena->frame = (Bump_Trace_Totals){0};
+	}
+
+	for (u32 i = 0; i < trace->frame_site_count; ++i)
+	{
+		Bump_Trace_Site* site = trace->frame_sites[i];
+		Bump_TraceMerge(&site->run, &site->frame);
+	}
+
+	Bump_TraceWriteTop(trace, trace->frame_sites, trace->frame_site_count, false);
+
+	trace->frame_count += 1;
+	Atomic_StoreRelease32(&trace->log.count, 0);
+}
+
+// NOTE: Writes the totals of the whole run, records logged after the last Bump_TraceFrame are left out
+static void
+Bump_TraceFinish(Bump_Trace* trace)
+{
+	fprintf(trace->file, "run of %u frames, %llu records, %llu dropped\n", (trace->frame_count > 0 ? trace->frame_count - 1 : 0),
+	        (unsigned long long)trace->record_count, (unsigned long long)trace->dropped_records);
+
+	for (u32 i = 0; i < trace->arena_count; ++i) Bump_TraceWriteTotals(trace, &trace->arenas[i], &trace->arenas[i].run);
+
+	// NOTE: frame_sites is free between frames
+	u32 site_count = 0;
+	for (u32 i = 0; i < BUMP_TRACE_MAX_SITES; ++i)
+	{
+		if (trace->sites[i].used) trace->frame_sites[site_count++] = &trace->sites[i];
+	}
+	if (trace->overflow.run.pushes != 0) trace->frame_sites[site_count++] = &trace->overflow;
+
+	Bump_TraceWriteTop(trace, trace->frame_sites, site_count, true);
+}
@@ -0,0 +1,451 @@
+// NOTE: Streaming GIF capture of the presented framebuffer. The platform thread only copies the dirty rows of each
+//       frame into a single-producer/single-consumer ring, a worker thread owns everything else: frame deltas, LZW
+//       encoding and file I/O. When the ring is full the frame is dropped instead of waiting, its dirty rows are
+//       carried over to the next submitted frame so the worker's copy of the screen never goes stale.
+//
+//       GIF players clamp delays below 2 centiseconds, so frames are sampled to at most 50 per second. Every emitted
+//       frame only covers the bounding box of pixels that changed since the previous one, unchanged pixels inside it
+//       are transparent. The transparent index is one the frame does not draw with, a frame that draws with all 256
+//       has no transparent pixels.
+//
+//       The global color table holds the palette at the start. Frames drawn with other colors carry a local color
+//       table, and the first frame after the palette changed covers the whole screen, every pixel on it changes color.
+
+#define CAPTURE_SLOT_COUNT      8
+#define CAPTURE_MIN_DELAY_NS    20000000ULL
+#define CAPTURE_LZW_MAX_CODE    4095
+#define CAPTURE_LZW_TABLE_SIZE  8192 // NOTE: a power of two, at least twice CAPTURE_LZW_MAX_CODE keeps probes short
+#define CAPTURE_LZW_EMPTY       0xFFFFFFFFU
+
+// NOTE: only the rows marked dirty in frame hold valid pixels, colors only holds the palette when palette_changed
+typedef struct Capture_Slot
+{
+	Framebuffer frame;
+	u32 colors[AZUR_PALETTE_SIZE];
+	bool palette_changed;
+	u64 time_ns;
+} Capture_Slot;
+
+typedef struct Capture
+{
+	FILE* file;
+	Capture_Slot* slots;
+	volatile u32 read_index;
+	volatile u32 write_index;
+	volatile u32 stop;
+	OS_Semaphore wake;
+	OS_Thread thread;
+
+	/// Platform thread
+	u64 carried_dirty_rows[(AZUR_HEIGHT + 63)/64];
+	bool carried_palette_changed;
+	u64 submitted;
+	u64 dropped;
+
+	/// Worker thread
+	u8 (*canvas)[AZUR_WIDTH];
+	u8 (*emitted)[AZUR_WIDTH];
+	u64 changed_rows[(AZUR_HEIGHT + 63)/64];
+	u32 colors[AZUR_PALETTE_SIZE];        // NOTE: of the canvas
+	u32 global_colors[AZUR_PALETTE_SIZE];
+	bool palette_changed;                 // NOTE: since the last emitted frame
+	u32* lzw_table;                       // NOTE: prefix code << 20 | symbol << 12 | code
+	u8* lzw_out;
+	umm lzw_len;
+	u32 lzw_bits;
+	u32 lzw_bit_count;
+	bool has_pending;
+	u64 pending_time_ns;
+	u16 pending_rect[4];
+	s32 pending_transparent; // NOTE: -1 when every pixel is drawn
+	u32 pending_min_code_size;
+	bool pending_local_colors;
+	u32 pending_colors[AZUR_PALETTE_SIZE];
+	u64 start_time_ns;
+	u64 last_time_ns;
+	u64 emitted_frames;
+	bool write_failed;
+} Capture;
+
+static void
+Capture_PutU16(u8* out, u32 value)
+{
+	out[0] = (u8)value;
+	out[1] = (u8)(value >> 8);
+}
+
+static void
+Capture_WriteCode(Capture* capture, u32 code, u32 code_size)
+{
+	capture->lzw_bits      |= code << capture->lzw_bit_count;
+	capture->lzw_bit_count += code_size;
+
+	while (capture->lzw_bit_count >= 8)
+	{
+		capture->lzw_out[capture->lzw_len++] = (u8)capture->lzw_bits;
+		capture->lzw_bits      >>= 8;
+		capture->lzw_bit_count  -= 8;
+	}
+}
+
+// NOTE: Pixels equal to what was emitted are written as transparent, when there is a transparent index. The dictionary
+//       is a hash table of prefix code and symbol, cleared along with the codes.
+static void
+Capture_EncodeRect(Capture* capture, u32 x0, u32 y0, u32 x1, u32 y1, s32 transparent, u32 min_code_size)
+{
+	u32 clear_code = 1u << min_code_size;
+	u32 code_size  = min_code_size + 1;
+	u32 max_code   = clear_code + 1;
+
+	capture->lzw_len       = 0;
+	capture->lzw_bits      = 0;
+	capture->lzw_bit_count = 0;
+
+	memset(capture->lzw_table, 0xFF, CAPTURE_LZW_TABLE_SIZE*sizeof(capture->lzw_table[0]));
+	Capture_WriteCode(capture, clear_code, code_size);
+
+	s32 code = -1;
+	for (u32 y = y0; y < y1; ++y)
+	{
+		for (u32 x = x0; x < x1; ++x)
+		{
+			u32 index = capture->canvas[y][x];
+			if (transparent >= 0 && index == capture->emitted[y][x]) index = (u32)transparent;
+
+			if (code < 0)
+			{
+				code = (s32)index;
+				continue;
+			}
+
+			u32 key  = (u32)code << 8 | index;
+			u32 slot = (key*2654435761U >> 19) & (CAPTURE_LZW_TABLE_SIZE-1);
+			while (capture->lzw_table[slot] != CAPTURE_LZW_EMPTY && capture->lzw_table[slot] >> 12 != key)
+			{
+				slot = (slot + 1) & (CAPTURE_LZW_TABLE_SIZE-1);
+			}
+
+			if (capture->lzw_table[slot] != CAPTURE_LZW_EMPTY)
+			{
+				code = (s32)(capture->lzw_table[slot] & 0xFFF);
+			}
+			else
+			{
+				Capture_WriteCode(capture, (u32)code, code_size);
+
+				capture->lzw_table[slot] = key << 12 | ++max_code;
+				if (max_code >= (1u << code_size)) code_size += 1;
+
+				if (max_code == CAPTURE_LZW_MAX_CODE)
+				{
+					Capture_WriteCode(capture, clear_code, code_size);
+					memset(capture->lzw_table, 0xFF, CAPTURE_LZW_TABLE_SIZE*sizeof(capture->lzw_table[0]));
+
+					code_size = min_code_size + 1;
+					max_code  = clear_code + 1;
+				}
+
+				code = (s32)index;
+			}
+		}
+	}
+
+	Capture_WriteCode(capture, (u32)code, code_size);
+	Capture_WriteCode(capture, clear_code + 1, code_size);
+	if (capture->lzw_bit_count != 0) Capture_WriteCode(capture, 0, 8 - capture->lzw_bit_count);
+}
+
+static void
+Capture_WriteColors(u8* out, u32* colors)
+{
+	for (u32 i = 0; i < AZUR_PALETTE_SIZE; ++i)
+	{
+		out[i*3 + 0] = (u8)(colors[i] >> 16);
+		out[i*3 + 1] = (u8)(colors[i] >>  8);
+		out[i*3 + 2] = (u8)(colors[i] >>  0);
+	}
+}
+
+static void
+Capture_Write(Capture* capture, void* data, umm size)
+{
+	if (!capture->write_failed && fwrite(data, 1, size, capture->file) != size) capture->write_failed = true;
+}
+
+// NOTE: The delay of a frame is only known once the next one is emitted, so the encoded frame is held back until then
+static void
+Capture_FlushPending(Capture* capture, u64 end_time_ns)
+{
+	if (!capture->has_pending) return;
+
+	u64 start_cs = (capture->pending_time_ns - capture->start_time_ns)/10000000;
+	u64 end_cs   = (end_time_ns              - capture->start_time_ns)/10000000;
+	u64 delay    = end_cs - start_cs;
+	if (delay < 2)      delay = 2;
+	if (delay > 0xFFFF) delay = 0xFFFF;
+
+	// NOTE: do not dispose, a 256 entry local color table follows the image descriptor when there is one
+	bool has_transparent = (capture->pending_transparent >= 0);
+	u8 header[8 + 10] = {
+		0x21, 0xF9, 0x04, (1 << 2) | has_transparent, 0, 0, (u8)(has_transparent ? capture->pending_transparent : 0), 0,
+		0x2C, 0, 0, 0, 0, 0, 0, 0, 0, (capture->pending_local_colors ? 0x87 : 0),
+	};
+	Capture_PutU16(header +  4, (u32)delay);
+	Capture_PutU16(header +  9, capture->pending_rect[0]);
+	Capture_PutU16(header + 11, capture->pending_rect[1]);
+	Capture_PutU16(header + 13, capture->pending_rect[2]);
+	Capture_PutU16(header + 15, capture->pending_rect[3]);
+	Capture_Write(capture, header, sizeof(header));
+
+	if (capture->pending_local_colors)
+	{
+		u8 colors[AZUR_PALETTE_SIZE*3];
+		Capture_WriteColors(colors, capture->pending_colors);
+		Capture_Write(capture, colors, sizeof(colors));
+	}
+
+	u8 min_code_size = (u8)capture->pending_min_code_size;
+	Capture_Write(capture, &min_code_size, 1);
+
+	for (umm offset = 0; offset < capture->lzw_len; offset += 255)
+	{
+		u8 block_len = (u8)(capture->lzw_len - offset < 255 ? capture->lzw_len - offset : 255);
+		Capture_Write(capture, &block_len, 1);
+		Capture_Write(capture, capture->lzw_out + offset, block_len);
+	}
+
+	u8 terminator = 0;
+	Capture_Write(capture, &terminator, 1);
+
+	capture->has_pending     = false;
+	capture->emitted_frames += 1;
+}
+
+static void
+Capture_Consume(Capture* capture, Capture_Slot* slot)
+{
+	bool first_frame = (capture->emitted_frames == 0 && !capture->has_pending);
+
+	if (first_frame) capture->start_time_ns = slot->time_ns;
+	capture->last_time_ns = slot->time_ns;
+
+	if (slot->palette_changed && memcmp(capture->colors, slot->colors, sizeof(capture->colors)) != 0)
+	{
+		memcpy(capture->colors, slot->colors, sizeof(capture->colors));
+		capture->palette_changed = true;
+	}
+
+	for (u32 row = 0, row_count = 0; Framebuffer_NextDirtySpan(&slot->frame, &row, &row_count); row += row_count)
+	{
+		memcpy(capture->canvas[row], slot->frame.pixels[row], (umm)row_count*AZUR_WIDTH);
+
+		for (u32 y = row; y < row + row_count; ++y) capture->changed_rows[y/64] |= 1ULL << (y%64);
+	}
+
+	bool due = (!capture->has_pending || slot->time_ns - capture->pending_time_ns >= CAPTURE_MIN_DELAY_NS);
+	if (!due) return;
+
+	u32 x0 = AZUR_WIDTH, y0 = AZUR_HEIGHT, x1 = 0, y1 = 0;
+	for (u32 y = 0; y < AZUR_HEIGHT; ++y)
+	{
+		if (!(capture->changed_rows[y/64] & (1ULL << (y%64)))) continue;
+
+		for (u32 x = 0; x < AZUR_WIDTH; ++x)
+		{
+			if (capture->canvas[y][x] != capture->emitted[y][x])
+			{
+				if (x < x0) x0 = x;
+				if (x >= x1) x1 = x + 1;
+				if (y < y0) y0 = y;
+				y1 = y + 1;
+			}
+		}
+	}
+
+	// NOTE: nothing is transparent in a frame that covers the whole screen, nothing on it is shown yet in these colors
+	bool whole_screen = (first_frame || capture->palette_changed);
+	if (whole_screen) x0 = 0, y0 = 0, x1 = AZUR_WIDTH, y1 = AZUR_HEIGHT;
+
+	if (x0 >= x1) return;
+
+	// NOTE: the transparent index is the first one no drawn pixel uses, the code size fits every index written
+	u64 used[AZUR_PALETTE_SIZE/64] = {0};
+	for (u32 y = y0; y < y1; ++y)
+	{
+		for (u32 x = x0; x < x1; ++x)
+		{
+			u8 index = capture->canvas[y][x];
+			if (whole_screen || index != capture->emitted[y][x]) used[index/64] |= 1ULL << (index%64);
+		}
+	}
+
+	s32 transparent = -1;
+	for (u32 i = 0; i < AZUR_PALETTE_SIZE/64 && transparent < 0 && !whole_screen; ++i)
+	{
+		if (~used[i] != 0) transparent = (s32)(i*64 + CountTrailingZeros64(~used[i]));
+	}
+
+	if (transparent >= 0) used[transparent/64] |= 1ULL << (transparent%64);
+
+	u32 max_index = AZUR_PALETTE_SIZE - 1;
+	while (max_index > 0 && !(used[max_index/64] & (1ULL << (max_index%64)))) max_index -= 1;
+
+	u32 min_code_size = 2;
+	while ((1u << min_code_size) <= max_index) min_code_size += 1;
+
+	Capture_FlushPending(capture, slot->time_ns);
+
+	Capture_EncodeRect(capture, x0, y0, x1, y1, transparent, min_code_size);
+
+	for (u32 y = y0; y < y1; ++y) memcpy(&capture->emitted[y][x0], &capture->canvas[y][x0], x1 - x0);
+	memset(capture->changed_rows, 0, sizeof(capture->changed_rows));
+
+	capture->has_pending     = true;
+	capture->pending_time_ns = slot->time_ns;
+	capture->pending_rect[0] = (u16)x0;
+	capture->pending_rect[1] = (u16)y0;
+	capture->pending_rect[2] = (u16)(x1 - x0);
+	capture->pending_rect[3] = (u16)(y1 - y0);
+
+	capture->pending_transparent   = transparent;
+	capture->pending_min_code_size = min_code_size;
+	capture->pending_local_colors  = (memcmp(capture->colors, capture->global_colors, sizeof(capture->colors)) != 0);
+	memcpy(capture->pending_colors, capture->colors, sizeof(capture->colors));
+
+	capture->palette_changed = false;
+}
+
+static void
+Capture_Worker(void* data)
+{
+	Capture* capture = data;
+
+	PROFILE_THREAD("capture");
+
+	for (;;)
+	{
+		OS_WaitSemaphore(&capture->wake);
+
+		u32 read_index = capture->read_index;
+		while (read_index != Atomic_LoadAcquire32(&capture->write_index))
+		{
+			PROFILE_BEGIN(CaptureConsume);
+			Capture_Consume(capture, &capture->slots[read_index % CAPTURE_SLOT_COUNT]);
+			PROFILE_END(CaptureConsume);
+
+			read_index += 1;
+			Atomic_StoreRelease32(&capture->read_index, read_index);
+		}
+
+		if (Atomic_LoadAcquire32(&capture->stop)) break;
+	}
+
+	// NOTE: the last frame is shown for as long as one more sampling interval
+	Capture_FlushPending(capture, capture->last_time_ns + CAPTURE_MIN_DELAY_NS);
+
+	u8 trailer = 0x3B;
+	Capture_Write(capture, &trailer, 1);
+}
+
+// NOTE: palette holds the 0xRRGGBB colors of every palette entry at the start, the file stays owned by the caller
+static bool
+Capture_Start(Capture* capture, Bump* bump, FILE* file, u32* palette)
+{
+	*capture = (Capture){
+		.file      = file,
+		.slots     = Bump_Push(bump, CAPTURE_SLOT_COUNT*sizeof(Capture_Slot), 64),
+		.canvas    = Bump_Push(bump, (umm)AZUR_WIDTH*AZUR_HEIGHT, 64),
+		.emitted   = Bump_Push(bump, (umm)AZUR_WIDTH*AZUR_HEIGHT, 64),
+		.lzw_table = Bump_Push(bump, CAPTURE_LZW_TABLE_SIZE*sizeof(u32), 64),
+		.lzw_out   = Bump_Push(bump, (umm)AZUR_WIDTH*AZUR_HEIGHT*2, 64), // NOTE: at most one 12 bit code per pixel
+	};
+
+	memcpy(capture->colors, palette, sizeof(capture->colors));
+	memcpy(capture->global_colors, palette, sizeof(capture->global_colors));
+
+	// NOTE: touch the ring up front, page faults on first use would otherwise land on the platform thread
+	memset(capture->slots, 0, CAPTURE_SLOT_COUNT*sizeof(Capture_Slot));
+	memset(capture->canvas, 0, (umm)AZUR_WIDTH*AZUR_HEIGHT);
+
+	// NOTE: the first submitted frame carries every row, the worker has no earlier picture of the screen
+	for (u32 row = 0; row < AZUR_HEIGHT; ++row) capture->carried_dirty_rows[row/64] |= 1ULL << (row%64);
+	capture->carried_palette_changed = true;
+
+	/// Header, logical screen with a 256 entry global color table, loop forever
+	u8 header[6 + 7 + AZUR_PALETTE_SIZE*3 + 19] = {
+		'G', 'I', 'F', '8', '9', 'a',
+		0, 0, 0, 0, 0xF7, 0, 0,
+	};
+	Capture_PutU16(header + 6, AZUR_WIDTH);
+	Capture_PutU16(header + 8, AZUR_HEIGHT);
+
+	Capture_WriteColors(header + 13, palette);
+
+	u8 loop[19] = { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+	memcpy(header + 6 + 7 + AZUR_PALETTE_SIZE*3, loop, sizeof(loop));
+
+	Capture_Write(capture, header, sizeof(header));
+
+	if (capture->write_failed || !OS_CreateSemaphore(&capture->wake, 0)) return false;
+
+	if (!OS_CreateThread(&capture->thread, Capture_Worker, capture))
+	{
+		OS_DestroySemaphore(&capture->wake);
+		return false;
+	}
+
+	return true;
+}
+
+// NOTE: Called by the platform after Tick and before the dirty rows and colors are cleared. Never blocks.
+static void
+Capture_Submit(Capture* capture, Framebuffer* framebuffer, Palette* palette, u64 time_ns)
+{
+	u32 write_index = capture->write_index;
+
+	for (umm i = 0; i < sizeof(framebuffer->dirty_rows)/sizeof(framebuffer->dirty_rows[0]); ++i)
+	{
+		capture->carried_dirty_rows[i] |= framebuffer->dirty_rows[i];
+	}
+
+	capture->carried_palette_changed |= (palette->dirty_end > palette->dirty_first);
+
+	capture->submitted += 1;
+
+	if (write_index - Atomic_LoadAcquire32(&capture->read_index) == CAPTURE_SLOT_COUNT)
+	{
+		capture->dropped += 1;
+	}
+	else
+	{
+		Capture_Slot* slot = &capture->slots[write_index % CAPTURE_SLOT_COUNT];
+
+		slot->time_ns = time_ns;
+		memcpy(slot->frame.dirty_rows, capture->carried_dirty_rows, sizeof(slot->frame.dirty_rows));
+		memset(capture->carried_dirty_rows, 0, sizeof(capture->carried_dirty_rows));
+
+		slot->palette_changed = capture->carried_palette_changed;
+		if (slot->palette_changed) memcpy(slot->colors, palette->colors, sizeof(slot->colors));
+		capture->carried_palette_changed = false;
+
+		for (u32 row = 0, row_count = 0; Framebuffer_NextDirtySpan(&slot->frame, &row, &row_count); row += row_count)
+		{
+			memcpy(slot->frame.pixels[row], framebuffer->pixels[row], (umm)row_count*AZUR_WIDTH);
+		}
+
+		Atomic_StoreRelease32(&capture->write_index, write_index + 1);
+		OS_SignalSemaphore(&capture->wake);
+	}
+}
+
+// NOTE: Drains the ring, finishes the file and joins the worker. Returns false if any write failed.
+static bool
+Capture_Stop(Capture* capture)
+{
+	Atomic_StoreRelease32(&capture->stop, 1);
+	OS_SignalSemaphore(&capture->wake);
+	OS_JoinThread(&capture->thread);
+	OS_DestroySemaphore(&capture->wake);
+
+	return !capture->write_failed;
+}
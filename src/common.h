@@ -1,5 +1,15 @@
 #include <stdint.h>
+#include <string.h>
+
+#ifdef _MSC_VER
 #include <intrin.h>
+#define AZUR_EXPORT __declspec(dllexport)
+#define AZUR_THREAD_LOCAL __declspec(thread)
+#else
+#include <x86intrin.h>
+#define AZUR_EXPORT __attribute__((visibility("default")))
+#define AZUR_THREAD_LOCAL __thread
+#endif
 
 typedef int8_t  s8;
 typedef int16_t s16;
@@ -40,6 +50,8 @@ typedef u8 bool;
 typedef float f32;
 typedef double f64;
 
+#define F32_MAX 3.402823466e+38f
+
 typedef struct String
 {
 	u8* data;
@@ -49,55 +61,216 @@ typedef struct String
 #define STRING(S) (String){ .data = (u8*)(S), .len = sizeof(S) - 1 }
 #define MS_STRING(S) { .data = (u8*)(S), .len = sizeof(S) - 1 }
 
-static bool
-String_Equal(String s0, String s1)
+// NOTE: Atomics only promise what x64 gives for free plus a compiler barrier. Loads acquire, stores release, and
+//       read-modify-write operations are full barriers.
+#ifdef _MSC_VER
+static u32
+Atomic_LoadAcquire32(volatile u32* value)
 {
-	bool result = (s0.len == s1.len);
+	u32 result = *value;
+	_ReadWriteBarrier();
+	return result;
+}
 
-	for (umm i = 0; i < s0.len && result; ++i)
-	{
-		if (s0.data[i] != s1.data[i])
-		{
-			result = false;
-		}
-	}
+static void
+Atomic_StoreRelease32(volatile u32* value, u32 new_value)
+{
+	_ReadWriteBarrier();
+	*value = new_value;
+}
 
+static u32
+Atomic_FetchAdd32(volatile u32* value, u32 addend)
+{
+	return (u32)_InterlockedExchangeAdd((volatile long*)value, (long)addend);
+}
+
+static u32
+Atomic_Exchange32(volatile u32* value, u32 new_value)
+{
+	return (u32)_InterlockedExchange((volatile long*)value, (long)new_value);
+}
+
+static bool
+Atomic_CompareExchange32(volatile u32* value, u32 expected, u32 desired)
+{
+	return ((u32)_InterlockedCompareExchange((volatile long*)value, (long)desired, (long)expected) == expected);
+}
+
+static u64
+Atomic_LoadAcquire64(volatile u64* value)
+{
+	u64 result = *value;
+	_ReadWriteBarrier();
 	return result;
 }
 
+static void
+Atomic_StoreRelease64(volatile u64* value, u64 new_value)
+{
+	_ReadWriteBarrier();
+	*value = new_value;
+}
+
+static bool
+Atomic_CompareExchange64(volatile u64* value, u64 expected, u64 desired)
+{
+	return ((u64)_InterlockedCompareExchange64((volatile __int64*)value, (__int64)desired, (__int64)expected) == expected);
+}
+
+// NOTE: the one reordering x64 does allow, a store followed by a load from another location
+static void
+Atomic_FenceSeqCst(void)
+{
+	_mm_mfence();
+}
+#else
+static u32
+Atomic_LoadAcquire32(volatile u32* value)
+{
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void
+Atomic_StoreRelease32(volatile u32* value, u32 new_value)
+{
+	__atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+static u32
+Atomic_FetchAdd32(volatile u32* value, u32 addend)
+{
+	return __atomic_fetch_add(value, addend, __ATOMIC_SEQ_CST);
+}
+
+static u32
+Atomic_Exchange32(volatile u32* value, u32 new_value)
+{
+	return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST);
+}
+
+static bool
+Atomic_CompareExchange32(volatile u32* value, u32 expected, u32 desired)
+{
+	return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static u64
+Atomic_LoadAcquire64(volatile u64* value)
+{
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void
+Atomic_StoreRelease64(volatile u64* value, u64 new_value)
+{
+	__atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+static bool
+Atomic_CompareExchange64(volatile u64* value, u64 expected, u64 desired)
+{
+	return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static void
+Atomic_FenceSeqCst(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#endif
+
 #define ASSERT(EX) ((EX) ? 1 : ((*(volatile int*)0 = 0), 0))
 #define NOT_IMPLEMENTED ASSERT(!"NOT_IMPLEMENTED")
 
-typedef struct Bump
+// NOTE: A Bump owns a reserved range of address space and commits it in commit_chunk steps as the cursor crosses the
+//       commit line. Committing is done by the platform through the commit callback, which also shrinks the
+//       committed range again when popping leaves more than decommit_threshold bytes committed past the cursor.
+//       Bumps without a callback are fully committed up front, committed == reserved.
+typedef struct Bump Bump;
+typedef bool Bump_Commit_Func(Bump* bump, u64 new_committed);
+
+#define BUMP_TRACE_PUSH 0
+#define BUMP_TRACE_POP  1
+
+// NOTE: One push or pop of a traced bump, file and tag point into the module that made it, see Bump_TraceRecord
+typedef struct Bump_Trace_Record
 {
-	u8* memory;
-	u32 cursor;
+	const char* file;
+	const char* tag;
+	u32 line;
+	u8 kind;     // NOTE: BUMP_TRACE_PUSH or BUMP_TRACE_POP
+	u8 arena;
+	u16 padding; // NOTE: bytes skipped to align the push
+	u64 size;    // NOTE: pushed or popped
+	u64 cursor;  // NOTE: of the bump after the push or pop
+} Bump_Trace_Record;
+
+typedef struct Bump_Trace_Log
+{
+	Bump_Trace_Record* records;
 	u32 capacity;
-	u32 high_watermark;
-} Bump;
+	volatile u32 count; // NOTE: keeps counting past capacity, records that did not fit are dropped
+} Bump_Trace_Log;
 
-typedef u32 Bump_Mark;
+struct Bump
+{
+	u8* memory;
+	u64 cursor;
+	u64 committed;
+	u64 reserved;
+	u64 high_watermark;
+	u64 commit_chunk;
+	u64 decommit_threshold;
+	Bump_Commit_Func* commit;
+	u32 flags;       // NOTE: BUMP_FLAGS the platform created the bump with
+	u32 trace_arena; // NOTE: which arena of the trace the bump counts towards
+	Bump_Trace_Log* trace;
+};
+
+typedef u64 Bump_Mark;
 
 static void*
 Bump_Push(Bump* bump, umm size, u8 alignment)
 {
 	ASSERT(alignment > 0 && ((alignment-1) & alignment) == 0);
 
-	u64 aligned_cursor = ((u64)bump->cursor + (alignment-1)) & (u64)-(s64)alignment;
+	u64 aligned_cursor = (bump->cursor + (alignment-1)) & (u64)-(s64)alignment;
+
+	ASSERT(size <= bump->reserved && aligned_cursor <= bump->reserved - size);
+
+	u64 end = aligned_cursor + size;
+	if (end > bump->committed)
+	{
+		u64 new_committed = (end + (bump->commit_chunk-1)) / bump->commit_chunk * bump->commit_chunk;
+		if (new_committed > bump->reserved) new_committed = bump->reserved;
 
-	ASSERT(size < U64_MAX - aligned_cursor && aligned_cursor + size <= bump->capacity);
+		//// ERROR: the OS is out of memory or the bump was never given a commit callback
+		bool committed = (bump->commit != 0 && bump->commit(bump, new_committed));
+		ASSERT(committed);
+	}
 
-	bump->cursor = (u32)(aligned_cursor + size);
+	bump->cursor = end;
 	bump->high_watermark = (bump->cursor > bump->high_watermark ? bump->cursor : bump->high_watermark);
 
 	return &bump->memory[aligned_cursor];
 }
 
+static void
+Bump_Trim(Bump* bump)
+{
+	if (bump->commit != 0)
+	{
+		u64 keep = (bump->cursor + (bump->commit_chunk-1)) / bump->commit_chunk * bump->commit_chunk;
+		if (keep < bump->committed && bump->committed - keep > bump->decommit_threshold) bump->commit(bump, keep);
+	}
+}
+
 static void
 Bump_Pop(Bump* bump, umm size)
 {
 	ASSERT(bump->cursor >= size);
-	bump->cursor -= (u32)size;
+	bump->cursor -= size;
 }
 
 static Bump_Mark
@@ -111,14 +284,506 @@ Bump_PopToMark(Bump* bump, Bump_Mark mark)
 {
 	ASSERT(mark <= bump->cursor);
 	bump->cursor = mark;
+	Bump_Trim(bump);
+}
+
+static void
+Bump_Clear(Bump* bump)
+{
+	bump->cursor = 0;
+	Bump_Trim(bump);
+}
+
+#define BUMP_POISON 0xDDDDDDDDDDDDDDDDULL
+
+// NOTE: Clears a frame arena for reuse, high_watermark restarts so it reads as the peak of the frame being built. In
+//       AZUR_DEBUG the freed memory is filled with BUMP_POISON, so anything still pointing into the old frame reads
+//       obvious garbage.
+static void
+Bump_ResetFrame(Bump* bump)
+{
+#ifdef AZUR_DEBUG
+	u64 peak = bump->high_watermark;
+#endif
+
+	bump->cursor         = 0;
+	bump->high_watermark = 0;
+	Bump_Trim(bump);
+
+#ifdef AZUR_DEBUG
+	u64 poisoned = (peak < bump->committed ? peak : bump->committed);
+	for (u64 i = 0; i < poisoned/8; ++i) ((u64*)bump->memory)[i] = BUMP_POISON;
+	for (u64 i = poisoned/8*8; i < poisoned; ++i) bump->memory[i] = (u8)BUMP_POISON;
+#endif
+}
+
+// NOTE: With AZUR_BUMP_TRACE defined, Bump_Push, Bump_Pop and Bump_PopToMark record where they were called from into
+//       the log of bumps that have one, see bumptrace.h. Every module has to be built with the same setting. The log
+//       is shared by every traced bump and may be written from any thread, it is only read between frames.
+static void
+Bump_TraceRecord(Bump* bump, u8 kind, u64 size, u64 padding, const char* file, u32 line, const char* tag)
+{
+	Bump_Trace_Log* log = bump->trace;
+
+	u32 index = Atomic_FetchAdd32(&log->count, 1);
+	if (index < log->capacity)
+	{
+		log->records[index] = (Bump_Trace_Record){
+			.file    = file,
+			.tag     = tag,
+			.line    = line,
+			.kind    = kind,
+			.arena   = (u8)bump->trace_arena,
+			.padding = (u16)padding,
+			.size    = size,
+			.cursor  = bump->cursor,
+		};
+	}
+}
+
+#ifdef AZUR_BUMP_TRACE
+static void*
+Bump_PushTraced(Bump* bump, umm size, u8 alignment, const char* file, u32 line, const char* tag)
+{
+	u64 cursor = bump->cursor;
+	u8* result = Bump_Push(bump, size, alignment);
+
+	if (bump->trace != 0) Bump_TraceRecord(bump, BUMP_TRACE_PUSH, size, (u64)(result - bump->memory) - cursor, file, line, tag);
+
+	return result;
+}
+
+static void
+Bump_PopTraced(Bump* bump, umm size, const char* file, u32 line, const char* tag)
+{
+	Bump_Pop(bump, size);
+
+	if (bump->trace != 0) Bump_TraceRecord(bump, BUMP_TRACE_POP, size, 0, file, line, tag);
+}
+
+static void
+Bump_PopToMarkTraced(Bump* bump, Bump_Mark mark, const char* file, u32 line, const char* tag)
+{
+	u64 size = bump->cursor - mark;
+	Bump_PopToMark(bump, mark);
+
+	if (bump->trace != 0) Bump_TraceRecord(bump, BUMP_TRACE_POP, size, 0, file, line, tag);
+}
+
+#define Bump_Push(BUMP, SIZE, ALIGNMENT) Bump_PushTraced((BUMP), (SIZE), (ALIGNMENT), __FILE__, __LINE__, __func__)
+#define Bump_Pop(BUMP, SIZE)             Bump_PopTraced((BUMP), (SIZE), __FILE__, __LINE__, __func__)
+#define Bump_PopToMark(BUMP, MARK)       Bump_PopToMarkTraced((BUMP), (MARK), __FILE__, __LINE__, __func__)
+#endif
+
+// NOTE: x must be non-zero
+static u32
+CountTrailingZeros64(u64 x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (u32)index;
+#else
+	return (u32)__builtin_ctzll(x);
+#endif
+}
+
+static u32
+PopCount32(u32 x)
+{
+#ifdef _MSC_VER
+	return __popcnt(x);
+#else
+	return (u32)__builtin_popcount(x);
+#endif
+}
+
+/// String
+
+static u64
+String_Load64(u8* data)
+{
+	u64 word;
+	memcpy(&word, data, 8);
+	return word;
+}
+
+static u32
+String_Load32(u8* data)
+{
+	u32 word;
+	memcpy(&word, data, 4);
+	return word;
+}
+
+// NOTE: Strings from 32 bytes on are compared 32 bytes at a time, the last block overlaps the one before it instead of
+//       falling back to a byte loop. Shorter strings compare two overlapping blocks of the largest size that fits.
+static bool
+String_Equal(String s0, String s1)
+{
+	bool result = (s0.len == s1.len);
+
+	u8* a   = s0.data;
+	u8* b   = s1.data;
+	umm len = s0.len;
+
+	if (!result || a == b)
+	{
+		// NOTE: nothing left to compare
+	}
+#ifdef __AVX2__
+	else if (len >= 32)
+	{
+		for (umm i = 0; i + 32 < len && result; i += 32)
+		{
+			__m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(a + i)), _mm256_loadu_si256((__m256i*)(b + i)));
+			result = ((u32)_mm256_movemask_epi8(eq) == U32_MAX);
+		}
+
+		if (result)
+		{
+			__m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(a + len - 32)), _mm256_loadu_si256((__m256i*)(b + len - 32)));
+			result = ((u32)_mm256_movemask_epi8(eq) == U32_MAX);
+		}
+	}
+	else if (len >= 16)
+	{
+		__m128i eq0 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)a),              _mm_loadu_si128((__m128i*)b));
+		__m128i eq1 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(a + len - 16)), _mm_loadu_si128((__m128i*)(b + len - 16)));
+		result = (_mm_movemask_epi8(_mm_and_si128(eq0, eq1)) == 0xFFFF);
+	}
+#endif
+	else if (len >= 8)
+	{
+		for (umm i = 0; i + 8 < len && result; i += 8) result = (String_Load64(a + i) == String_Load64(b + i));
+		if (result) result = (String_Load64(a + len - 8) == String_Load64(b + len - 8));
+	}
+	else if (len >= 4)
+	{
+		result = ((String_Load32(a) ^ String_Load32(b)) | (String_Load32(a + len - 4) ^ String_Load32(b + len - 4))) == 0;
+	}
+	else
+	{
+		for (umm i = 0; i < len && result; ++i) result = (a[i] == b[i]);
+	}
+
+	return result;
+}
+
+// NOTE: Orders like memcmp on the bytes, a string sorts after its prefixes. Returns <0, 0 or >0.
+static s32
+String_Compare(String s0, String s1)
+{
+	u8* a   = s0.data;
+	u8* b   = s1.data;
+	umm len = (s0.len < s1.len ? s0.len : s1.len);
+
+	// NOTE: index of the first differing byte, len if there is none
+	umm diff = len;
+
+	umm i = 0;
+#ifdef __AVX2__
+	for (; i + 32 <= len && diff == len; i += 32)
+	{
+		__m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(a + i)), _mm256_loadu_si256((__m256i*)(b + i)));
+		u32 mask = ~(u32)_mm256_movemask_epi8(eq);
+		if (mask != 0) diff = i + CountTrailingZeros64(mask);
+	}
+#endif
+
+	// NOTE: little endian, the lowest set bit of the difference is in the first differing byte
+	for (; i + 8 <= len && diff == len; i += 8)
+	{
+		u64 x = String_Load64(a + i) ^ String_Load64(b + i);
+		if (x != 0) diff = i + CountTrailingZeros64(x)/8;
+	}
+
+	for (; i < len && diff == len; ++i)
+	{
+		if (a[i] != b[i]) diff = i;
+	}
+
+	s32 result;
+	if (diff < len) result = (s32)a[diff] - (s32)b[diff];
+	else            result = (s0.len > s1.len) - (s0.len < s1.len);
+
+	return result;
+}
+
+// NOTE: CRC32C over 8 byte words with the length folded in, then mixed so the low bits can index a table. The last
+//       word overlaps the one before it. The value depends on the instruction set the build targets and is never
+//       stored anywhere.
+static u32
+String_Hash(String string)
+{
+	u8* data = string.data;
+	umm len  = string.len;
+
+#ifdef __AVX2__
+	u64 crc = 0xFFFFFFFF ^ len;
+
+	if (len >= 8)
+	{
+		for (umm i = 0; i + 8 < len; i += 8) crc = _mm_crc32_u64(crc, String_Load64(data + i));
+		crc = _mm_crc32_u64(crc, String_Load64(data + len - 8));
+	}
+	else if (len >= 4)
+	{
+		crc = _mm_crc32_u64(crc, String_Load32(data) | ((u64)String_Load32(data + len - 4) << 32));
+	}
+	else
+	{
+		for (umm i = 0; i < len; ++i) crc = _mm_crc32_u8((u32)crc, data[i]);
+	}
+
+	u32 hash = (u32)crc;
+#else
+	u32 hash = 0x811C9DC5 ^ (u32)len;
+	for (umm i = 0; i < len; ++i) hash = (hash ^ data[i])*0x01000193;
+#endif
+
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+
+	return hash;
 }
 
 #define AZUR_WIDTH  320
 #define AZUR_HEIGHT 180
 
+// NOTE: 0xRRGGBB colors of the first 8 palette entries, see Palette_Init
+#define AZUR_DEFAULT_PALETTE { 0x000000, 0x555555, 0x7C34F4, 0x54DFBB, 0xFFFFFF, 0xFFCDE2, 0xFE7FB8, 0xFFF48D }
+
+// NOTE: The framebuffer is owned by the platform and persists across frames. Anything drawing into pixels must mark
+//       the touched rows dirty, the platform only uploads dirty rows and clears the bitmap once it has presented them.
+typedef struct Framebuffer
+{
+	u8 pixels[AZUR_HEIGHT][AZUR_WIDTH];
+	u64 dirty_rows[(AZUR_HEIGHT + 63)/64];
+} Framebuffer;
+
+static void
+Framebuffer_MarkRows(Framebuffer* framebuffer, s32 first_row, s32 row_count)
+{
+	s32 begin = (first_row < 0 ? 0 : first_row);
+	s32 end   = (first_row + row_count > AZUR_HEIGHT ? AZUR_HEIGHT : first_row + row_count);
+
+	for (s32 row = begin; row < end; ++row)
+	{
+		framebuffer->dirty_rows[row/64] |= 1ULL << (row%64);
+	}
+}
+
+static void
+Framebuffer_MarkAll(Framebuffer* framebuffer)
+{
+	Framebuffer_MarkRows(framebuffer, 0, AZUR_HEIGHT);
+}
+
+static void
+Framebuffer_ClearDirty(Framebuffer* framebuffer)
+{
+	for (umm i = 0; i < sizeof(framebuffer->dirty_rows)/sizeof(framebuffer->dirty_rows[0]); ++i)
+	{
+		framebuffer->dirty_rows[i] = 0;
+	}
+}
+
+// NOTE: Finds the first run of dirty rows starting at or after *first_row
+static bool
+Framebuffer_NextDirtySpan(Framebuffer* framebuffer, u32* first_row, u32* row_count)
+{
+	u32 begin = *first_row;
+	for (; begin < AZUR_HEIGHT; begin = (begin | 63) + 1)
+	{
+		u64 bits = framebuffer->dirty_rows[begin/64] >> (begin%64);
+		if (bits != 0)
+		{
+			begin += CountTrailingZeros64(bits);
+			break;
+		}
+	}
+
+	if (begin >= AZUR_HEIGHT) return false;
+
+	u32 end = begin;
+	for (; end < AZUR_HEIGHT; end = (end | 63) + 1)
+	{
+		u64 bits = ~framebuffer->dirty_rows[end/64] >> (end%64);
+		if (bits != 0)
+		{
+			end += CountTrailingZeros64(bits);
+			break;
+		}
+	}
+
+	if (end > AZUR_HEIGHT) end = AZUR_HEIGHT;
+
+	*first_row = begin;
+	*row_count = end - begin;
+
+	return true;
+}
+
+#define AZUR_PALETTE_SIZE 256
+
+// NOTE: The colors framebuffer indices resolve to, 0xRRGGBB. Owned by the platform and persists across frames like the
+//       framebuffer. Entries are changed through Palette_Set, which marks only what actually changed dirty, and the
+//       platform uploads the dirty range once it presents and then clears it. A frame that changes no color uploads
+//       nothing.
+typedef struct Palette
+{
+	u32 colors[AZUR_PALETTE_SIZE];
+	u32 dirty_first;
+	u32 dirty_end; // NOTE: equal to dirty_first when nothing is dirty
+} Palette;
+
+static void
+Palette_MarkRange(Palette* palette, u32 first, u32 count)
+{
+	u32 end = (first + count > AZUR_PALETTE_SIZE ? AZUR_PALETTE_SIZE : first + count);
+	if (first >= end) return;
+
+	if (palette->dirty_first == palette->dirty_end)
+	{
+		palette->dirty_first = first;
+		palette->dirty_end   = end;
+	}
+	else
+	{
+		palette->dirty_first = (first < palette->dirty_first ? first : palette->dirty_first);
+		palette->dirty_end   = (end   > palette->dirty_end   ? end   : palette->dirty_end);
+	}
+}
+
+static void
+Palette_Set(Palette* palette, u32 first, u32* colors, u32 count)
+{
+	if (first >= AZUR_PALETTE_SIZE) return;
+	if (count > AZUR_PALETTE_SIZE - first) count = AZUR_PALETTE_SIZE - first;
+
+	// NOTE: only the span between the first and last changed entry is marked
+	u32 begin = count;
+	u32 end   = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (palette->colors[first + i] != colors[i])
+		{
+			palette->colors[first + i] = colors[i];
+
+			begin = (i < begin ? i : begin);
+			end   = i + 1;
+		}
+	}
+
+	if (begin < end) Palette_MarkRange(palette, first + begin, end - begin);
+}
+
+// NOTE: Every entry gets AZUR_DEFAULT_PALETTE[index & 0x7], which is what the 8 color palette showed for any index
+static void
+Palette_Init(Palette* palette)
+{
+	u32 defaults[8] = AZUR_DEFAULT_PALETTE;
+	for (u32 i = 0; i < AZUR_PALETTE_SIZE; ++i) palette->colors[i] = defaults[i & 0x7];
+
+	palette->dirty_first = 0;
+	palette->dirty_end   = AZUR_PALETTE_SIZE;
+}
+
+static void
+Palette_ClearDirty(Palette* palette)
+{
+	palette->dirty_first = 0;
+	palette->dirty_end   = 0;
+}
+
+// NOTE: Jobs run on the platform's worker threads. A counter is bumped when a job is submitted against it and dropped
+//       when the job finishes, waiting on it runs other jobs until it reaches zero. Every job gets the scratch Bump of
+//       the worker running it, anything pushed onto it is popped again when the job returns.
+typedef struct Job_Counter
+{
+	volatile u32 pending;
+} Job_Counter;
+
+typedef void Job_Func(void* data, Bump* scratch);
+typedef void Job_Range_Func(void* data, u32 first, u32 count, Bump* scratch);
+
+typedef void Job_Submit_Func(Job_Func* func, void* data, Job_Counter* counter);
+typedef void Job_Parallel_For_Func(Job_Range_Func* func, void* data, u32 count, u32 batch_size, Job_Counter* counter);
+typedef void Job_Wait_Func(Job_Counter* counter);
+
+// NOTE: Starts loading a named entry of the asset pack onto bump, see Pack_Load in pack.h. Decompression runs on the
+//       platform's workers and may carry on across frames and reloads of the game code, as long as bump outlives it.
+typedef struct Pack_Asset* Pack_Load_Func(String name, Bump* bump, Job_Counter* counter);
+
+typedef enum INPUT_BUTTON
+{
+	INPUT_LEFT        = 1 << 0,
+	INPUT_RIGHT       = 1 << 1,
+	INPUT_UP          = 1 << 2,
+	INPUT_DOWN        = 1 << 3,
+	INPUT_A           = 1 << 4,
+	INPUT_B           = 1 << 5,
+	INPUT_START       = 1 << 6,
+	INPUT_MOUSE_LEFT  = 1 << 7,
+	INPUT_MOUSE_RIGHT = 1 << 8,
+} INPUT_BUTTON;
+
+// NOTE: Snapshot of the input taken once per frame, before Tick. buttons holds the INPUT_BUTTONs that are down,
+//       pressed and released the ones that went down or up since the last frame that simulated at least one step, so
+//       a tap shorter than a frame or landing on a frame without steps is not lost. The mouse is in framebuffer
+//       pixels and may lie outside of it.
+typedef struct Platform_Input
+{
+	u32 buttons;
+	u32 pressed;
+	u32 released;
+	s16 mouse_x;
+	s16 mouse_y;
+} Platform_Input;
+
+// NOTE: Both hosts reserve the persistent bump here, so a snapshot of it can be restored with the pointers inside it
+//       intact, see replay.h. Falls back to anywhere when the range is taken.
+#define AZUR_PERSISTENT_BASE 0x0000200000000000ULL
+
 typedef struct Platform_Link
 {
+	// NOTE: frame_bump is reset before every Tick. prev_frame_bump holds what the previous Tick allocated and stays
+	//       readable until the end of this one, then the two swap.
 	Bump* frame_bump;
+	Bump* prev_frame_bump;
+
+	// NOTE: Owned by the platform and never reset, so what the game keeps here survives reloading the game code.
+	//       reloaded is set on the first Tick of new code. Pointers into the old module, to functions or string
+	//       literals, are dangling by then, and every job has to be finished by the time Tick returns.
+	Bump* persistent_bump;
+	bool reloaded;
+
+	Framebuffer* framebuffer;
+	Palette* palette;
+	struct Atlas_Header* atlas; // NOTE: loaded from the asset pack before the first Tick, 0 when there is none
+	struct Pack_Header* pack;   // NOTE: read-only mapping of the asset pack, 0 when there is none
+	struct Profiler* profiler;  // NOTE: 0 unless the platform is profiling, see profile.h
+	struct Audio_Queue* audio;  // NOTE: 0 when the platform has no audio, see audio.h
+
+	// NOTE: The game simulates sim_steps fixed steps of dt seconds each, then renders once. sim_steps may be 0 when
+	//       frames are presented faster than the simulation rate. alpha is the fraction of a step that has passed
+	//       since the last simulated step, in [0, 1), for interpolating between the previous and current state.
+	f32 dt;
+	u32 sim_steps;
+	f32 alpha;
+	u64 sim_tick; // NOTE: steps simulated before this frame
+
+	Platform_Input input;
+
+	// NOTE: worker_count includes the thread calling Tick, which runs jobs while it waits on a counter. A batch_size
+	//       of 0 lets parallel_for pick one.
+	u32 worker_count;
+	Job_Submit_Func* job_submit;
+	Job_Parallel_For_Func* job_parallel_for;
+	Job_Wait_Func* job_wait;
+	Pack_Load_Func* pack_load; // NOTE: returns 0 for entries that are not in the pack
 } Platform_Link;
 
 typedef void Game_Tick_Func(Platform_Link* platform_link);
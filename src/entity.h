@@ -0,0 +1,242 @@
+// NOTE: Entities. An Entity is a 32 bit handle, a slot in the low ENTITY_SLOT_BITS and the generation of that slot
+//       above them. Destroying an entity bumps the generation of its slot, so handles to it stop resolving instead of
+//       quietly pointing at whatever gets the slot next. Freed slots are reused first in first out, a stale handle
+//       only resolves again after its slot went through every generation.
+//
+//       Components are kept as structure of arrays, dense and in no particular order: element i of every array
+//       belongs to entities[i], for i below count. Destroying an entity moves the last one into its place, so dense
+//       indices change whenever an entity is destroyed, while handles never do. Loops that destroy as they go should
+//       run from the end. Position and velocity are built in, Entity_AddColumn adds arrays of any other type.
+//
+//       The store is plain data on a Bump and does not keep it, so it can live in the persistent bump and carries
+//       over reloads of the game code unchanged.
+
+#define ENTITY_SLOT_BITS        20
+#define ENTITY_SLOT_MASK        ((1U << ENTITY_SLOT_BITS) - 1)
+#define ENTITY_GENERATION_MASK  (U32_MAX >> ENTITY_SLOT_BITS)
+#define ENTITY_MAX_CAPACITY     ((1U << ENTITY_SLOT_BITS) - 8) // NOTE: a multiple of 8 below the last slot
+#define ENTITY_MAX_COLUMNS      16
+
+typedef u32 Entity; // NOTE: 0 is never a live entity
+
+typedef struct Entity_Column
+{
+	u8* data;
+	u32 size; // NOTE: of one element
+} Entity_Column;
+
+typedef struct Entity_Store
+{
+	/// Dense, indexed by dense index. Arrays are 64 byte aligned and padded to a multiple of 8 elements.
+	Entity* entities;
+	f32* x;
+	f32* y;
+	f32* vx; // NOTE: per second
+	f32* vy;
+	Entity_Column columns[ENTITY_MAX_COLUMNS];
+	u32 column_count;
+	u32 count;
+	u32 capacity;
+
+	/// Sparse, indexed by slot
+	u32* dense;       // NOTE: dense index of a live slot, next free slot of a freed one
+	u32* generations;
+	u32 slot_count;   // NOTE: slots handed out so far, including slot 0
+	u32 free_first;   // NOTE: 0 when no slot is free
+	u32 free_last;
+} Entity_Store;
+
+static u32
+Entity_Slot(Entity entity)
+{
+	return entity & ENTITY_SLOT_MASK;
+}
+
+static u32
+Entity_Generation(Entity entity)
+{
+	return entity >> ENTITY_SLOT_BITS;
+}
+
+static void*
+Entity_PushArray(Entity_Store* store, Bump* bump, u32 size)
+{
+	return Bump_Push(bump, (umm)store->capacity*size, 64);
+}
+
+static void
+Entity_CreateStore(Entity_Store* store, Bump* bump, u32 capacity)
+{
+	if (capacity > ENTITY_MAX_CAPACITY) capacity = ENTITY_MAX_CAPACITY;
+
+	*store = (Entity_Store){
+		.capacity   = (capacity + 7) & ~7U,
+		.slot_count = 1,
+	};
+
+	store->entities    = Entity_PushArray(store, bump, sizeof(Entity));
+	store->x           = Entity_PushArray(store, bump, sizeof(f32));
+	store->y           = Entity_PushArray(store, bump, sizeof(f32));
+	store->vx          = Entity_PushArray(store, bump, sizeof(f32));
+	store->vy          = Entity_PushArray(store, bump, sizeof(f32));
+	store->dense       = Bump_Push(bump, ((umm)store->capacity + 1)*sizeof(u32), 4);
+	store->generations = Bump_Push(bump, ((umm)store->capacity + 1)*sizeof(u32), 4);
+
+	// NOTE: the padding past count is read by the vector loops, it has to hold numbers
+	memset(store->x,  0, (umm)store->capacity*sizeof(f32));
+	memset(store->y,  0, (umm)store->capacity*sizeof(f32));
+	memset(store->vx, 0, (umm)store->capacity*sizeof(f32));
+	memset(store->vy, 0, (umm)store->capacity*sizeof(f32));
+}
+
+// NOTE: Returns the index of the new column, or U32_MAX when the store has ENTITY_MAX_COLUMNS already. Can be called
+//       with entities alive, they read zeros in the new column.
+static u32
+Entity_AddColumn(Entity_Store* store, Bump* bump, u32 size)
+{
+	if (store->column_count == ENTITY_MAX_COLUMNS) return U32_MAX;
+
+	u8* data = Entity_PushArray(store, bump, size);
+	memset(data, 0, (umm)store->capacity*size);
+
+	store->columns[store->column_count] = (Entity_Column){ .data = data, .size = size };
+
+	return store->column_count++;
+}
+
+static void*
+Entity_ColumnData(Entity_Store* store, u32 column)
+{
+	ASSERT(column < store->column_count);
+	return store->columns[column].data;
+}
+
+// NOTE: Dense index of entity, U32_MAX when it was destroyed or never existed
+static u32
+Entity_Index(Entity_Store* store, Entity entity)
+{
+	u32 slot = Entity_Slot(entity);
+
+	bool alive = (slot != 0 && slot < store->slot_count && store->generations[slot] == Entity_Generation(entity));
+
+	return (alive ? store->dense[slot] : U32_MAX);
+}
+
+static bool
+Entity_Alive(Entity_Store* store, Entity entity)
+{
+	return (Entity_Index(store, entity) != U32_MAX);
+}
+
+// NOTE: Every component of the new entity starts out as zero. Returns 0 when the store is full.
+static Entity
+Entity_Create(Entity_Store* store)
+{
+	if (store->count == store->capacity) return 0;
+
+	u32 slot;
+	if (store->free_first != 0)
+	{
+		slot = store->free_first;
+
+		store->free_first = store->dense[slot];
+		if (store->free_first == 0) store->free_last = 0;
+	}
+	else
+	{
+		ASSERT(store->slot_count <= store->capacity);
+
+		slot = store->slot_count++;
+		store->generations[slot] = 0;
+	}
+
+	u32 index = store->count++;
+	Entity entity = (store->generations[slot] << ENTITY_SLOT_BITS) | slot;
+
+	store->dense[slot] = index;
+
+	store->entities[index] = entity;
+	store->x[index]        = 0;
+	store->y[index]        = 0;
+	store->vx[index]       = 0;
+	store->vy[index]       = 0;
+
+	for (u32 i = 0; i < store->column_count; ++i)
+	{
+		Entity_Column* column = &store->columns[i];
+		memset(column->data + (umm)index*column->size, 0, column->size);
+	}
+
+	return entity;
+}
+
+// NOTE: Destroying an entity that is not alive does nothing
+static void
+Entity_Destroy(Entity_Store* store, Entity entity)
+{
+	u32 index = Entity_Index(store, entity);
+	if (index == U32_MAX) return;
+
+	u32 last = --store->count;
+	if (index != last)
+	{
+		Entity moved = store->entities[last];
+
+		store->entities[index] = moved;
+		store->x[index]        = store->x[last];
+		store->y[index]        = store->y[last];
+		store->vx[index]       = store->vx[last];
+		store->vy[index]       = store->vy[last];
+
+		for (u32 i = 0; i < store->column_count; ++i)
+		{
+			Entity_Column* column = &store->columns[i];
+			memcpy(column->data + (umm)index*column->size, column->data + (umm)last*column->size, column->size);
+		}
+
+		store->dense[Entity_Slot(moved)] = index;
+	}
+
+	// NOTE: keeps Entity_Integrate from moving the padding off towards infinity
+	store->vx[last] = 0;
+	store->vy[last] = 0;
+
+	u32 slot = Entity_Slot(entity);
+	store->generations[slot] = (store->generations[slot] + 1) & ENTITY_GENERATION_MASK;
+
+	store->dense[slot] = 0;
+	if (store->free_last != 0) store->dense[store->free_last] = slot;
+	else                       store->free_first = slot;
+	store->free_last = slot;
+}
+
+// NOTE: Moves entities [first, first + count) by their velocity times dt. Works in whole blocks of 8, so both ends of
+//       the range have to be multiples of 8, except for an end at count. The padding past count has no velocity and
+//       stays where it is. Ranges like that can run on different workers at the same time.
+static void
+Entity_Integrate(Entity_Store* store, u32 first, u32 count, f32 dt)
+{
+	ASSERT(first % 8 == 0 && ((first + count) % 8 == 0 || first + count == store->count) && first + count <= store->count);
+
+	u32 end = (first + count + 7) & ~7U;
+
+	f32* x  = store->x;
+	f32* y  = store->y;
+	f32* vx = store->vx;
+	f32* vy = store->vy;
+
+#ifdef __AVX2__
+	__m256 step = _mm256_set1_ps(dt);
+	for (u32 i = first; i < end; i += 8)
+	{
+		_mm256_store_ps(x + i, _mm256_add_ps(_mm256_load_ps(x + i), _mm256_mul_ps(_mm256_load_ps(vx + i), step)));
+		_mm256_store_ps(y + i, _mm256_add_ps(_mm256_load_ps(y + i), _mm256_mul_ps(_mm256_load_ps(vy + i), step)));
+	}
+#else
+	for (u32 i = first; i < end; ++i)
+	{
+		x[i] += vx[i]*dt;
+		y[i] += vy[i]*dt;
+	}
+#endif
+}
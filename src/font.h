@@ -0,0 +1,366 @@
+// NOTE: Bitmap text. Glyphs are 8x8 pixels at 1 bit per pixel, a byte per row with the leftmost pixel in the lowest
+//       bit, so a row of text is a run of bytes that expands into the framebuffer 8 pixels at a time. Text is drawn
+//       in a single palette index and only where glyphs have pixels, the framebuffer shows through everywhere else.
+//
+//       A line is drawn from a mask of its rows, FONT_GLYPH_SIZE rows of a byte per character, gathered from the
+//       glyphs and then expanded 32 pixels at a time. A cache keeps the masks of lines drawn recently, looked up by
+//       their text, so text that stays the same from one frame to the next is gathered once. Lines longer than
+//       FONT_RUN_CHARS are drawn and cached in pieces.
+//
+//       The scalar versions are the reference implementation, every other path must produce identical output.
+
+#define FONT_GLYPH_SIZE  8
+#define FONT_FIRST_CHAR  ' '
+#define FONT_GLYPH_COUNT 96 // NOTE: ' ' to '~', then a box that every other byte draws as
+#define FONT_RUN_CHARS   64
+#define FONT_CACHE_WAYS  4
+
+static u8 Font_Glyphs[FONT_GLYPH_COUNT][FONT_GLYPH_SIZE] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+	{ 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // '!'
+	{ 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+	{ 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // '#'
+	{ 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // '$'
+	{ 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // '%'
+	{ 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // '&'
+	{ 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '''
+	{ 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // '('
+	{ 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // ')'
+	{ 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // '*'
+	{ 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // '+'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ','
+	{ 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // '-'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // '.'
+	{ 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // '/'
+	{ 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // '0'
+	{ 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // '1'
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // '2'
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // '3'
+	{ 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // '4'
+	{ 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // '5'
+	{ 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // '6'
+	{ 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // '7'
+	{ 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // '8'
+	{ 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // '9'
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ';'
+	{ 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // '<'
+	{ 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // '='
+	{ 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // '>'
+	{ 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // '?'
+	{ 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // '@'
+	{ 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // 'A'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // 'B'
+	{ 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // 'C'
+	{ 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // 'D'
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // 'E'
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // 'F'
+	{ 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // 'G'
+	{ 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // 'H'
+	{ 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'I'
+	{ 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // 'J'
+	{ 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // 'K'
+	{ 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // 'L'
+	{ 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // 'M'
+	{ 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // 'N'
+	{ 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // 'O'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // 'P'
+	{ 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // 'Q'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // 'R'
+	{ 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // 'S'
+	{ 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'T'
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // 'U'
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'V'
+	{ 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // 'W'
+	{ 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // 'X'
+	{ 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // 'Y'
+	{ 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // 'Z'
+	{ 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // '['
+	{ 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // '\'
+	{ 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ']'
+	{ 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // '^'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // '_'
+	{ 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '`'
+	{ 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // 'a'
+	{ 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // 'b'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // 'c'
+	{ 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // 'd'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // 'e'
+	{ 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // 'f'
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'g'
+	{ 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // 'h'
+	{ 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'i'
+	{ 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // 'j'
+	{ 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // 'k'
+	{ 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'l'
+	{ 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // 'm'
+	{ 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // 'n'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // 'o'
+	{ 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // 'p'
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // 'q'
+	{ 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // 'r'
+	{ 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // 's'
+	{ 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // 't'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // 'u'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'v'
+	{ 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // 'w'
+	{ 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // 'x'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'y'
+	{ 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // 'z'
+	{ 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // '{'
+	{ 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // '|'
+	{ 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // '}'
+	{ 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '~'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 }, // NOTE: anything else
+};
+
+typedef struct Font_Run
+{
+	u32 hash;
+	u32 length;     // NOTE: 0 for a run that holds nothing
+	u64 last_drawn;
+	u8 text[FONT_RUN_CHARS];
+	u8 mask[FONT_GLYPH_SIZE][FONT_RUN_CHARS];
+} Font_Run;
+
+// NOTE: Set associative, a run only ever lives in one of the FONT_CACHE_WAYS runs of the set its hash picks, and
+//       replaces the least recently drawn of them
+typedef struct Font_Cache
+{
+	Font_Run* runs;
+	u32 set_count; // NOTE: a power of two
+	u64 draw_count;
+
+	/// Stats
+	u64 runs_gathered;
+	u64 runs_reused;
+} Font_Cache;
+
+// NOTE: run_count is rounded up to a power of two number of sets
+static void
+Font_CreateCache(Font_Cache* cache, Bump* bump, u32 run_count)
+{
+	u32 set_count = 1;
+	while (set_count*FONT_CACHE_WAYS < run_count) set_count *= 2;
+
+	*cache = (Font_Cache){
+		.runs      = Bump_Push(bump, (umm)set_count*FONT_CACHE_WAYS*sizeof(Font_Run), 64),
+		.set_count = set_count,
+	};
+
+	memset(cache->runs, 0, (umm)set_count*FONT_CACHE_WAYS*sizeof(Font_Run));
+}
+
+static u8*
+Font_Glyph(u8 c)
+{
+	u32 glyph = (u32)c - FONT_FIRST_CHAR;
+	return Font_Glyphs[glyph < FONT_GLYPH_COUNT - 1 ? glyph : FONT_GLYPH_COUNT - 1];
+}
+
+// NOTE: Lines are split at '\n', the size is of the longest line and all of them together
+static void
+Font_MeasureText(String text, s32* width, s32* height)
+{
+	u32 line_count   = 1;
+	umm line_length  = 0;
+	umm longest_line = 0;
+
+	for (umm i = 0; i < text.len; ++i)
+	{
+		if (text.data[i] == '\n')
+		{
+			line_count += 1;
+			line_length = 0;
+		}
+		else
+		{
+			line_length += 1;
+			if (line_length > longest_line) longest_line = line_length;
+		}
+	}
+
+	*width  = (s32)longest_line*FONT_GLYPH_SIZE;
+	*height = (s32)line_count*FONT_GLYPH_SIZE;
+}
+
+// NOTE: mask holds FONT_GLYPH_SIZE rows of stride bytes
+static void
+Font_GatherMask(u8* mask, umm stride, u8* text, u32 length)
+{
+	for (u32 i = 0; i < length; ++i)
+	{
+		u8* glyph = Font_Glyph(text[i]);
+		for (u32 row = 0; row < FONT_GLYPH_SIZE; ++row) mask[row*stride + i] = glyph[row];
+	}
+}
+
+// NOTE: Writes index to row[x + i] for every bit i that is set in mask, from bit first up to but not including end
+static void
+Font_ExpandRowScalar(u8* row, s32 x, u8* mask, s32 first, s32 end, u8 index)
+{
+	for (s32 i = first; i < end; ++i)
+	{
+		if ((mask[i >> 3] >> (i & 7)) & 1) row[x + i] = index;
+	}
+}
+
+#ifdef __AVX2__
+static void
+Font_ExpandRowAVX2(u8* row, s32 x, u8* mask, s32 first, s32 end, u8 index)
+{
+	// NOTE: the first 32 pixel step starts on a whole mask byte
+	s32 i = (first + 7) & ~7;
+	if (i > end) i = end;
+
+	Font_ExpandRowScalar(row, x, mask, first, i, index);
+
+	// NOTE: every byte of a lane picks the mask byte holding its pixel, then tests the bit of its pixel in there
+	__m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+	                                  2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+	__m256i bits   = _mm256_set1_epi64x(0x8040201008040201LL);
+	__m256i color  = _mm256_set1_epi8((char)index);
+
+	for (; i + 32 <= end; i += 32)
+	{
+		u32 mask_bits;
+		memcpy(&mask_bits, mask + (i >> 3), sizeof(mask_bits));
+
+		// NOTE: spaces, and the gaps above and below most glyphs, leave whole steps empty
+		if (mask_bits == 0) continue;
+
+		__m256i set = _mm256_shuffle_epi8(_mm256_set1_epi32((s32)mask_bits), spread);
+		set = _mm256_cmpeq_epi8(_mm256_and_si256(set, bits), bits);
+
+		u8* dst = row + x + i;
+		_mm256_storeu_si256((__m256i*)dst, _mm256_blendv_epi8(_mm256_loadu_si256((__m256i*)dst), color, set));
+	}
+
+	Font_ExpandRowScalar(row, x, mask, i, end, index);
+}
+#endif
+
+// NOTE: Draws length characters worth of mask with its top left corner at (x, y), clipped against the framebuffer
+static void
+Font_DrawMask(Framebuffer* framebuffer, s32 x, s32 y, u8* mask, umm stride, u32 length, u8 index, bool vector)
+{
+	s32 y0 = (y < 0 ? 0 : y);
+	s32 y1 = (y + FONT_GLYPH_SIZE > AZUR_HEIGHT ? AZUR_HEIGHT : y + FONT_GLYPH_SIZE);
+
+	// NOTE: in pixels of the mask
+	s32 first = (x < 0 ? -x : 0);
+	s32 end   = (x + (s64)length*FONT_GLYPH_SIZE > AZUR_WIDTH ? AZUR_WIDTH - x : (s32)length*FONT_GLYPH_SIZE);
+
+	if (y0 >= y1 || first >= end) return;
+
+	for (s32 j = y0; j < y1; ++j)
+	{
+		u8* mask_row = mask + (umm)(j - y)*stride;
+
+#ifdef __AVX2__
+		if (vector) Font_ExpandRowAVX2(framebuffer->pixels[j], x, mask_row, first, end, index);
+		else
+#endif
+		Font_ExpandRowScalar(framebuffer->pixels[j], x, mask_row, first, end, index);
+	}
+
+	Framebuffer_MarkRows(framebuffer, y0, y1 - y0);
+}
+
+// NOTE: Returns the run holding the mask of text, gathering it into the least recently drawn run of its set if it is
+//       not cached. text is at most FONT_RUN_CHARS long and never empty.
+static Font_Run*
+Font_CachedRun(Font_Cache* cache, String text)
+{
+	ASSERT(text.len != 0 && text.len <= FONT_RUN_CHARS);
+
+	u32 hash      = String_Hash(text);
+	Font_Run* set = &cache->runs[(hash & (cache->set_count - 1))*FONT_CACHE_WAYS];
+
+	cache->draw_count += 1;
+
+	Font_Run* run = &set[0];
+	for (u32 i = 0; i < FONT_CACHE_WAYS; ++i)
+	{
+		if (set[i].hash == hash && set[i].length == text.len && memcmp(set[i].text, text.data, text.len) == 0)
+		{
+			set[i].last_drawn = cache->draw_count;
+			cache->runs_reused += 1;
+
+			return &set[i];
+		}
+
+		if (set[i].last_drawn < run->last_drawn) run = &set[i];
+	}
+
+	run->hash       = hash;
+	run->length     = (u32)text.len;
+	run->last_drawn = cache->draw_count;
+	memcpy(run->text, text.data, text.len);
+	Font_GatherMask(&run->mask[0][0], FONT_RUN_CHARS, run->text, run->length);
+
+	cache->runs_gathered += 1;
+
+	return run;
+}
+
+static void
+Font_DrawTextInternal(Framebuffer* framebuffer, Font_Cache* cache, s32 x, s32 y, String text, u8 index, bool vector)
+{
+	s32 line_x = x;
+
+	for (umm i = 0; i < text.len; )
+	{
+		if (text.data[i] == '\n')
+		{
+			x  = line_x;
+			y += FONT_GLYPH_SIZE;
+			i += 1;
+			continue;
+		}
+
+		umm length = 0;
+		while (i + length < text.len && length < FONT_RUN_CHARS && text.data[i + length] != '\n') length += 1;
+
+		// NOTE: lines wholly above or below the framebuffer are never gathered, nor cached
+		if (y > -FONT_GLYPH_SIZE && y < AZUR_HEIGHT)
+		{
+			if (cache != 0)
+			{
+				Font_Run* run = Font_CachedRun(cache, (String){ .data = text.data + i, .len = (u32)length });
+				Font_DrawMask(framebuffer, x, y, &run->mask[0][0], FONT_RUN_CHARS, run->length, index, vector);
+			}
+			else
+			{
+				u8 mask[FONT_GLYPH_SIZE][FONT_RUN_CHARS];
+				Font_GatherMask(&mask[0][0], FONT_RUN_CHARS, text.data + i, (u32)length);
+				Font_DrawMask(framebuffer, x, y, &mask[0][0], FONT_RUN_CHARS, (u32)length, index, vector);
+			}
+		}
+
+		x += (s32)length*FONT_GLYPH_SIZE;
+		i += length;
+	}
+}
+
+static void
+Font_DrawTextScalar(Framebuffer* framebuffer, s32 x, s32 y, String text, u8 index)
+{
+	Font_DrawTextInternal(framebuffer, 0, x, y, text, index, false);
+}
+
+// NOTE: Draws text with the top left corner of its first character at (x, y), a '\n' starts a new line below the
+//       first character
+static void
+Font_DrawText(Framebuffer* framebuffer, s32 x, s32 y, String text, u8 index)
+{
+	Font_DrawTextInternal(framebuffer, 0, x, y, text, index, true);
+}
+
+// NOTE: The same as Font_DrawText for text that stays the same for a while, text that changes every frame is better
+//       off uncached
+static void
+Font_DrawTextCached(Framebuffer* framebuffer, Font_Cache* cache, s32 x, s32 y, String text, u8 index)
+{
+	Font_DrawTextInternal(framebuffer, cache, x, y, text, index, true);
+}
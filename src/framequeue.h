@@ -0,0 +1,158 @@
+// NOTE: Hands finished frames from a simulation thread to the thread presenting them. There are three slots, one the
+//       simulation thread copies the framebuffer and palette into, one holding the newest finished frame and one the
+//       presenting thread reads from. Publishing a frame swaps it with the newest, taking one swaps the newest with
+//       the one read from, so neither thread ever waits on the other for a slot while copying. A present without a
+//       new frame shows the last one again, that frame is duplicated.
+//
+//       The simulation thread is lock-stepped with presentation: it waits for the newest frame to be taken before it
+//       starts on the next one, so it runs at most one frame ahead and simulates while the presenting thread blocks on
+//       the swap. Every frame published is presented, none are dropped.
+//
+//       The presenting thread keeps its own framebuffer and palette holding what it presented last. Taking a frame
+//       copies what changed into them and marks it dirty, so uploads stay as small as without the queue.
+//
+//       Requires os.h.
+
+#define FRAME_QUEUE_SLOTS 3
+#define FRAME_QUEUE_FRESH 0x80000000U // NOTE: set on ready until the presenting thread takes the frame
+
+typedef struct Frame_Queue_Slot
+{
+	u8 pixels[AZUR_HEIGHT][AZUR_WIDTH];
+	u32 colors[AZUR_PALETTE_SIZE];
+	u64 sim_tick;
+	u64 published_ns;
+} Frame_Queue_Slot;
+
+typedef struct Frame_Queue
+{
+	Frame_Queue_Slot* slots;
+	volatile u32 ready;   // NOTE: slot index of the newest frame, with FRAME_QUEUE_FRESH until it is taken
+	volatile u32 waiting; // NOTE: set while the simulation thread waits on taken
+	volatile u32 stop;
+	OS_Semaphore taken;
+
+	/// Simulation thread
+	u32 back;
+	u64 published;
+	u64 wait_ns;
+
+	/// Presenting thread
+	u32 front;
+	Framebuffer* framebuffer;
+	Palette* palette;
+	u64 presented;
+	u64 duplicated;
+	u64 latency_ns;
+	u64 latency_max_ns;
+} Frame_Queue;
+
+// NOTE: framebuffer and palette are the presenting thread's, they start out as the first frame shown
+static bool
+FrameQueue_Create(Frame_Queue* queue, Bump* bump, Framebuffer* framebuffer, Palette* palette)
+{
+	*queue = (Frame_Queue){
+		.slots       = Bump_Push(bump, FRAME_QUEUE_SLOTS*sizeof(Frame_Queue_Slot), 64),
+		.ready       = 1,
+		.back        = 0,
+		.front       = 2,
+		.framebuffer = framebuffer,
+		.palette     = palette,
+	};
+
+	return OS_CreateSemaphore(&queue->taken, 0);
+}
+
+static void
+FrameQueue_Destroy(Frame_Queue* queue)
+{
+	OS_DestroySemaphore(&queue->taken);
+}
+
+/// Simulation thread
+
+// NOTE: Copies the frame into the back slot and makes it the newest, the frame before it has to have been taken, see
+//       FrameQueue_WaitTaken
+static void
+FrameQueue_Publish(Frame_Queue* queue, Framebuffer* framebuffer, Palette* palette, u64 sim_tick)
+{
+	Frame_Queue_Slot* slot = &queue->slots[queue->back];
+	memcpy(slot->pixels, framebuffer->pixels, sizeof(slot->pixels));
+	memcpy(slot->colors, palette->colors, sizeof(slot->colors));
+	slot->sim_tick     = sim_tick;
+	slot->published_ns = OS_GetTimeNS();
+
+	u32 previous = Atomic_Exchange32(&queue->ready, queue->back | FRAME_QUEUE_FRESH);
+	ASSERT(!(previous & FRAME_QUEUE_FRESH));
+
+	queue->back       = previous;
+	queue->published += 1;
+}
+
+// NOTE: Returns once the newest frame has been taken, or false once the queue is stopped
+static bool
+FrameQueue_WaitTaken(Frame_Queue* queue)
+{
+	u64 wait_start = OS_GetTimeNS();
+
+	while (!Atomic_LoadAcquire32(&queue->stop) && (Atomic_LoadAcquire32(&queue->ready) & FRAME_QUEUE_FRESH))
+	{
+		// NOTE: the presenting thread only signals when it sees waiting set, if it cleared it after the check above the
+		//       signal is on its way and has to be waited for, or it would wake a later wait early
+		Atomic_Exchange32(&queue->waiting, 1);
+		if ((Atomic_LoadAcquire32(&queue->ready) & FRAME_QUEUE_FRESH) || Atomic_Exchange32(&queue->waiting, 0) == 0)
+		{
+			OS_WaitSemaphore(&queue->taken);
+		}
+	}
+
+	queue->wait_ns += OS_GetTimeNS() - wait_start;
+
+	return !Atomic_LoadAcquire32(&queue->stop);
+}
+
+/// Presenting thread
+
+// NOTE: Takes the newest frame when there is one, copying and marking what changed in framebuffer and palette. Returns
+//       false when there was none and the last frame is presented again.
+static bool
+FrameQueue_Take(Frame_Queue* queue)
+{
+	if (!(Atomic_LoadAcquire32(&queue->ready) & FRAME_QUEUE_FRESH))
+	{
+		queue->duplicated += 1;
+		return false;
+	}
+
+	queue->front = Atomic_Exchange32(&queue->ready, queue->front) & ~FRAME_QUEUE_FRESH;
+	if (Atomic_Exchange32(&queue->waiting, 0)) OS_SignalSemaphore(&queue->taken);
+
+	Frame_Queue_Slot* slot = &queue->slots[queue->front];
+
+	u64 latency = OS_GetTimeNS() - slot->published_ns;
+	queue->presented      += 1;
+	queue->latency_ns     += latency;
+	queue->latency_max_ns  = (latency > queue->latency_max_ns ? latency : queue->latency_max_ns);
+
+	Framebuffer* framebuffer = queue->framebuffer;
+	for (u32 row = 0; row < AZUR_HEIGHT; ++row)
+	{
+		if (memcmp(framebuffer->pixels[row], slot->pixels[row], AZUR_WIDTH) != 0)
+		{
+			memcpy(framebuffer->pixels[row], slot->pixels[row], AZUR_WIDTH);
+			Framebuffer_MarkRows(framebuffer, row, 1);
+		}
+	}
+
+	Palette_Set(queue->palette, 0, slot->colors, AZUR_PALETTE_SIZE);
+
+	return true;
+}
+
+// NOTE: Wakes the simulation thread for good, FrameQueue_WaitTaken returns false from then on
+static void
+FrameQueue_Stop(Frame_Queue* queue)
+{
+	Atomic_StoreRelease32(&queue->stop, 1);
+	OS_SignalSemaphore(&queue->taken);
+}
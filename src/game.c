@@ -1,6 +1,292 @@
 #include "common.h"
+#include "blit.h"
+#include "font.h"
+#include "intern.h"
+#include "palette.h"
+#include "entity.h"
+#include "audio.h"
+#include "atlas.h"
+#include "profile.h"
 
-__declspec(dllexport) void
+#define GAME_BACKGROUND_INDEX 1
+#define GAME_RUN_SPEED        40.0f // NOTE: pixels per second
+#define GAME_NIGHT_FADE_SPEED 1.0f  // NOTE: full fades per second
+#define GAME_MAX_ENTITIES     (1 << 16)
+#define GAME_CHIME_FRAMES     (AUDIO_SAMPLE_RATE/2)
+#define GAME_OVERLAY_INDEX    4
+#define GAME_OVERLAY_RUNS     64
+
+// NOTE: The first thing pushed on the persistent bump, so it survives reloading the game code. Holds plain data only,
+//       see the note on Platform_Link::persistent_bump
+typedef struct Game_State
+{
+	Entity_Store entities;
+	Entity runner;
+	f32 prev_x;
+	u64 anim_time_ms;
+	s32 drawn_x;
+	s32 drawn_y;
+	s32 drawn_width;
+	s32 drawn_height;
+	f32 direction; // NOTE: 1 runs right, -1 runs left
+	Atlas_Index atlas_index;
+	String_ID run_cycle;
+	Palette_Bank palettes;
+	String_ID day;
+	String_ID night;
+	f32 night_amount; // NOTE: 0 shows day, 1 night, A fades towards the other one
+	f32 night_target;
+	Audio_Sound chime;
+	Font_Cache font_cache;
+	bool show_overlay; // NOTE: B toggles it
+	s32 overlay_width;
+	s32 overlay_height;
+} Game_State;
+
+static void
+Simulate(Game_State* game, Platform_Input* input, f32 dt)
+{
+	Entity_Store* entities = &game->entities;
+
+	if (input->buttons & INPUT_LEFT)  game->direction = -1;
+	if (input->buttons & INPUT_RIGHT) game->direction =  1;
+
+	u32 runner = Entity_Index(entities, game->runner);
+
+	entities->vx[runner] = GAME_RUN_SPEED*game->direction;
+	game->prev_x         = entities->x[runner];
+
+	Entity_Integrate(entities, 0, entities->count, dt);
+
+	f32* x = &entities->x[runner];
+	if (*x >= AZUR_WIDTH)
+	{
+		*x          -= AZUR_WIDTH + 16;
+		game->prev_x = *x;
+	}
+	else if (*x < -16)
+	{
+		*x          += AZUR_WIDTH + 16;
+		game->prev_x = *x;
+	}
+
+	game->anim_time_ms += (u64)(dt*1000 + 0.5f);
+
+	f32 fade = GAME_NIGHT_FADE_SPEED*dt;
+	if      (game->night_amount < game->night_target) game->night_amount = (game->night_amount + fade > game->night_target ? game->night_target : game->night_amount + fade);
+	else if (game->night_amount > game->night_target) game->night_amount = (game->night_amount - fade < game->night_target ? game->night_target : game->night_amount - fade);
+}
+
+static void
+CreatePalettes(Game_State* game, Bump* persistent_bump)
+{
+	u32 defaults[8] = AZUR_DEFAULT_PALETTE;
+
+	u32 day[AZUR_PALETTE_SIZE];
+	u32 night[AZUR_PALETTE_SIZE];
+	for (u32 i = 0; i < AZUR_PALETTE_SIZE; ++i)
+	{
+		u32 color = defaults[i & 0x7];
+		u32 r = (color >> 16) & 0xFF;
+		u32 g = (color >>  8) & 0xFF;
+		u32 b = (color >>  0) & 0xFF;
+
+		// NOTE: darker and shifted towards blue
+		day[i]   = color;
+		night[i] = ((r*3/10) << 16) | ((g*4/10) << 8) | (16 + b*6/10);
+	}
+
+	Palette_CreateBank(&game->palettes, persistent_bump, 4);
+	game->day   = Palette_AddNamed(&game->palettes, persistent_bump, STRING("day"),   day,   AZUR_PALETTE_SIZE);
+	game->night = Palette_AddNamed(&game->palettes, persistent_bump, STRING("night"), night, AZUR_PALETTE_SIZE);
+}
+
+// NOTE: A decaying 880 Hz sine with a quieter octave on top. The oscillators are the usual two term recurrence, the
+//       cosines come from a short series, which is plenty for angles this small.
+static void
+CreateChime(Game_State* game, Bump* persistent_bump, Bump* frame_bump)
+{
+	s16* samples = Bump_Push(frame_bump, GAME_CHIME_FRAMES*sizeof(s16), 4);
+
+	f32 w = 2*3.14159265f*880/AUDIO_SAMPLE_RATE;
+	f32 k_low  = 2*(1 - w*w/2 + w*w*w*w/24);
+	f32 k_high = 2*(1 - 4*w*w/2 + 16*w*w*w*w/24);
+
+	f32 low[2]  = { 0, 0 };
+	f32 high[2] = { 0, 0 };
+	f32 envelope = 12000;
+	for (u32 i = 0; i < GAME_CHIME_FRAMES; ++i)
+	{
+		f32 next_low  = (i == 0 ? 0 : (i == 1 ? w   : k_low*low[1]   - low[0]));
+		f32 next_high = (i == 0 ? 0 : (i == 1 ? 2*w : k_high*high[1] - high[0]));
+		low[0]  = low[1],  low[1]  = next_low;
+		high[0] = high[1], high[1] = next_high;
+
+		samples[i] = (s16)(envelope*(next_low/w + 0.3f*next_high/(2*w)));
+		envelope  *= 0.99985f;
+	}
+
+	game->chime = Audio_PushSound(persistent_bump, samples, GAME_CHIME_FRAMES);
+}
+
+// NOTE: Appends value in decimal to text and returns the new length
+static u32
+AppendNumber(u8* text, u32 len, s32 value)
+{
+	if (value < 0) text[len++] = '-';
+
+	u8 digits[10];
+	u32 digit_count = 0;
+	u32 magnitude   = (value < 0 ? (u32)-(s64)value : (u32)value);
+	do
+	{
+		digits[digit_count++] = (u8)('0' + magnitude%10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	while (digit_count != 0) text[len++] = digits[--digit_count];
+
+	return len;
+}
+
+static u32
+AppendString(u8* text, u32 len, String string)
+{
+	memcpy(text + len, string.data, string.len);
+	return len + string.len;
+}
+
+// NOTE: Only shows simulation state, so a replay draws the same overlay. The labels stay the same from frame to frame
+//       and come from the cache, the numbers change all the time and are drawn as they are.
+static void
+DrawOverlay(Game_State* game, Framebuffer* framebuffer)
+{
+	Entity_Store* entities = &game->entities;
+	u32 runner = Entity_Index(entities, game->runner);
+
+	String labels = STRING("x\ntime\nentities\nnight");
+	Font_DrawTextCached(framebuffer, &game->font_cache, 4, 4, labels, GAME_OVERLAY_INDEX);
+
+	u8 text[64];
+	u32 len = 0;
+	len = AppendNumber(text, len, (s32)entities->x[runner]);
+	text[len++] = '\n';
+	len = AppendNumber(text, len, (s32)(game->anim_time_ms/1000));
+	text[len++] = '.';
+	len = AppendNumber(text, len, (s32)(game->anim_time_ms/100%10));
+	text[len++] = '\n';
+	len = AppendNumber(text, len, (s32)entities->count);
+	text[len++] = '\n';
+	len = AppendNumber(text, len, (s32)(game->night_amount*100 + 0.5f));
+	len = AppendString(text, len, STRING("%"));
+
+	Font_DrawText(framebuffer, 4 + 9*FONT_GLYPH_SIZE, 4, (String){ .data = text, .len = len }, GAME_OVERLAY_INDEX);
+
+	// NOTE: wide enough for every number the overlay can show, so clearing it never leaves digits behind
+	game->overlay_width  = 4 + 21*FONT_GLYPH_SIZE;
+	game->overlay_height = 4 + 4*FONT_GLYPH_SIZE;
+}
+
+AZUR_EXPORT void
 Tick(Platform_Link* platform_link)
 {
+	Framebuffer* framebuffer = platform_link->framebuffer;
+
+	PROFILE_ATTACH(platform_link->profiler);
+
+	Bump* persistent_bump = platform_link->persistent_bump;
+	Game_State* game      = (Game_State*)persistent_bump->memory;
+
+	if (persistent_bump->cursor == 0)
+	{
+		game = Bump_Push(persistent_bump, sizeof(Game_State), 64);
+		*game = (Game_State){
+			.prev_x    = -16,
+			.direction = 1,
+		};
+
+		Entity_CreateStore(&game->entities, persistent_bump, GAME_MAX_ENTITIES);
+		game->runner = Entity_Create(&game->entities);
+		game->entities.x[Entity_Index(&game->entities, game->runner)] = -16;
+
+		Blit_FillRect(framebuffer, 0, 0, AZUR_WIDTH, AZUR_HEIGHT, GAME_BACKGROUND_INDEX);
+
+		CreatePalettes(game, persistent_bump);
+	}
+
+	if (game->chime.samples == 0) CreateChime(game, persistent_bump, platform_link->frame_bump);
+	if (game->font_cache.runs == 0) Font_CreateCache(&game->font_cache, persistent_bump, GAME_OVERLAY_RUNS);
+
+	// NOTE: presses are latched until a frame that simulates, so a press is handled exactly once
+	if (platform_link->sim_steps != 0 && (platform_link->input.pressed & INPUT_B)) game->show_overlay = !game->show_overlay;
+
+	if (platform_link->sim_steps != 0 && (platform_link->input.pressed & INPUT_A))
+	{
+		game->night_target = 1 - game->night_target;
+
+		// NOTE: rings from where the runner is, a fifth lower going into the night
+		if (platform_link->audio != 0)
+		{
+			f32 pan = game->entities.x[Entity_Index(&game->entities, game->runner)]*(2.0f/AZUR_WIDTH) - 1;
+			Audio_Play(platform_link->audio, &game->chime, 0.5f, pan, (game->night_target != 0 ? 2.0f/3 : 1), false);
+		}
+	}
+
+	PROFILE_BEGIN(Simulate);
+	for (u32 i = 0; i < platform_link->sim_steps; ++i) Simulate(game, &platform_link->input, platform_link->dt);
+	PROFILE_END(Simulate);
+
+	/// Render
+	PROFILE_BEGIN(Render);
+
+	// NOTE: the sprite is drawn between the last two simulated positions, so motion stays smooth when the
+	//       presentation rate is not a multiple of the simulation rate
+	f32 runner_x = game->entities.x[Entity_Index(&game->entities, game->runner)];
+
+	s32 x = (s32)(game->prev_x + (runner_x - game->prev_x)*platform_link->alpha + 0.5f);
+	s32 y = AZUR_HEIGHT/2;
+
+	Blit_FillRect(framebuffer, game->drawn_x, game->drawn_y, game->drawn_width, game->drawn_height, GAME_BACKGROUND_INDEX);
+
+	Atlas_Header* atlas = platform_link->atlas;
+
+	// NOTE: names are looked up once, every frame after that goes by ID
+	if (atlas != 0 && game->atlas_index.sprites == 0)
+	{
+		Atlas_CreateIndex(&game->atlas_index, atlas, persistent_bump);
+		game->run_cycle = Atlas_FindSpriteID(&game->atlas_index, STRING("run_cycle"));
+	}
+
+	Atlas_Sprite* sprite = (atlas != 0 ? Atlas_SpriteByID(atlas, &game->atlas_index, game->run_cycle) : 0);
+
+	if (sprite != 0)
+	{
+		Sprite frame = Atlas_FrameSprite(atlas, sprite, Atlas_FrameAtTime(atlas, sprite, (u32)game->anim_time_ms));
+		Blit_Sprite(framebuffer, &frame, x, y, (game->direction < 0 ? BLIT_FLIP_X : 0), 0);
+
+		game->drawn_width  = sprite->width;
+		game->drawn_height = sprite->height;
+	}
+	else
+	{
+		Blit_FillRect(framebuffer, x, y, 8, 8, 4);
+
+		game->drawn_width  = 8;
+		game->drawn_height = 8;
+	}
+
+	game->drawn_x = x;
+	game->drawn_y = y;
+
+	Blit_FillRect(framebuffer, 0, 0, game->overlay_width, game->overlay_height, GAME_BACKGROUND_INDEX);
+	game->overlay_width  = 0;
+	game->overlay_height = 0;
+
+	if (game->show_overlay) DrawOverlay(game, framebuffer);
+
+	// NOTE: the whole screen changes color without touching a pixel, and a fade that is not moving uploads nothing
+	Palette_Fade(platform_link->palette, Palette_Named(&game->palettes, game->day), Palette_Named(&game->palettes, game->night),
+	             0, AZUR_PALETTE_SIZE, game->night_amount);
+
+	PROFILE_END(Render);
 }
@@ -0,0 +1,126 @@
+// NOTE: Interned strings. Every distinct string added gets an ID, IDs are handed out in order starting at 1, never
+//       change and compare as integers. Lookups are open addressing with linear probing over slots that keep the
+//       hash next to the ID, so a probe only touches the string itself when the hashes match.
+//
+//       Everything lives on a Bump and nothing is removed. Growing pushes new arrays twice the size and leaves the old
+//       ones behind, which at most doubles what the table uses. Strings are copied in, with a 0 after them. The table
+//       does not keep the Bump, adding takes it, so a table can live in the persistent bump.
+
+#define INTERN_MIN_SLOTS 16
+
+typedef u32 String_ID; // NOTE: 0 is never handed out, it means not found
+
+typedef struct Intern_Slot
+{
+	u32 hash;
+	String_ID id;
+} Intern_Slot;
+
+typedef struct Intern_Table
+{
+	Intern_Slot* slots;
+	String* strings; // NOTE: indexed by ID, strings[0] is empty
+	u32 slot_count;  // NOTE: power of two, kept at least twice count
+	u32 count;
+	u32 string_capacity;
+} Intern_Table;
+
+static void
+Intern_Create(Intern_Table* table, Bump* bump, u32 expected_count)
+{
+	u32 slot_count = INTERN_MIN_SLOTS;
+	while (slot_count < expected_count*2) slot_count *= 2;
+
+	*table = (Intern_Table){
+		.slots           = Bump_Push(bump, slot_count*sizeof(Intern_Slot), 8),
+		.strings         = Bump_Push(bump, (slot_count/2 + 1)*sizeof(String), 8),
+		.slot_count      = slot_count,
+		.count           = 0,
+		.string_capacity = slot_count/2 + 1,
+	};
+
+	memset(table->slots, 0, slot_count*sizeof(Intern_Slot));
+	table->strings[0] = (String){0};
+}
+
+// NOTE: returns the slot holding string, or the empty slot it would go in
+static Intern_Slot*
+Intern_Probe(Intern_Table* table, String string, u32 hash)
+{
+	u32 mask  = table->slot_count - 1;
+	u32 index = hash & mask;
+
+	for (;; index = (index + 1) & mask)
+	{
+		Intern_Slot* slot = &table->slots[index];
+		if (slot->id == 0 || (slot->hash == hash && String_Equal(table->strings[slot->id], string))) return slot;
+	}
+}
+
+static String_ID
+Intern_Find(Intern_Table* table, String string)
+{
+	return Intern_Probe(table, string, String_Hash(string))->id;
+}
+
+static void
+Intern_Grow(Intern_Table* table, Bump* bump)
+{
+	u32 slot_count = table->slot_count*2;
+
+	Intern_Slot* slots = Bump_Push(bump, slot_count*sizeof(Intern_Slot), 8);
+	String* strings    = Bump_Push(bump, (slot_count/2 + 1)*sizeof(String), 8);
+
+	memset(slots, 0, slot_count*sizeof(Intern_Slot));
+	memcpy(strings, table->strings, (table->count + 1)*sizeof(String));
+
+	for (u32 i = 0; i < table->slot_count; ++i)
+	{
+		Intern_Slot slot = table->slots[i];
+		if (slot.id == 0) continue;
+
+		u32 index = slot.hash & (slot_count - 1);
+		while (slots[index].id != 0) index = (index + 1) & (slot_count - 1);
+		slots[index] = slot;
+	}
+
+	table->slots           = slots;
+	table->strings         = strings;
+	table->slot_count      = slot_count;
+	table->string_capacity = slot_count/2 + 1;
+}
+
+static String_ID
+Intern_Add(Intern_Table* table, Bump* bump, String string)
+{
+	u32 hash = String_Hash(string);
+
+	Intern_Slot* slot = Intern_Probe(table, string, hash);
+
+	if (slot->id == 0)
+	{
+		if (table->count + 1 >= table->string_capacity)
+		{
+			Intern_Grow(table, bump);
+			slot = Intern_Probe(table, string, hash);
+		}
+
+		u8* data = Bump_Push(bump, (umm)string.len + 1, 1);
+		memcpy(data, string.data, string.len);
+		data[string.len] = 0;
+
+		table->count += 1;
+		table->strings[table->count] = (String){ .data = data, .len = string.len };
+
+		*slot = (Intern_Slot){ .hash = hash, .id = table->count };
+	}
+
+	return slot->id;
+}
+
+static String
+Intern_String(Intern_Table* table, String_ID id)
+{
+	ASSERT(id <= table->count);
+	return table->strings[id];
+}
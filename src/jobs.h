@@ -0,0 +1,364 @@
+// NOTE: Work-stealing job system owned by the platform and handed to the game through Platform_Link. Every worker
+//       has a Chase-Lev deque: the owner pushes and takes at the bottom without locking, other workers steal from
+//       the top with a single compare-exchange. Jobs are stored in the deque by value, so submitting allocates
+//       nothing. The thread that creates the system is worker 0 and only runs jobs while it waits on a counter.
+//
+//       Chase-Lev, "Dynamic Circular Work-Stealing Deque", SPAA 2005, with the fences from Le et al., "Correct and
+//       Efficient Work-Stealing for Weak Memory Models", PPoPP 2013. On x64 only the one seq_cst fence is a real
+//       instruction, everything else just keeps the compiler from reordering.
+//
+//       Requires os.h and profile.h.
+
+#define JOBS_MAX_WORKERS   64
+#define JOBS_DEQUE_SIZE    4096 // NOTE: must be a power of two, submitting to a full deque runs the job inline
+#define JOBS_SPIN_COUNT    256  // NOTE: failed attempts to find work before a worker goes to sleep
+#define JOBS_SCRATCH_SIZE  (1ULL << 28)
+
+typedef struct Job
+{
+	Job_Func* func;
+	Job_Range_Func* range_func;
+	void* data;
+	Job_Counter* counter;
+	u32 first;
+	u32 count;
+} Job;
+
+typedef struct Job_System Job_System;
+
+typedef struct Job_Worker
+{
+	// NOTE: top is written by thieves, bottom only by the owner, they live on separate cache lines
+	volatile u64 top;
+	u8 pad0[56];
+	volatile u64 bottom;
+	u8 pad1[56];
+
+	Job* jobs;
+	Bump scratch;
+	OS_Thread thread;
+	Job_System* system;
+	u32 index;
+	u32 random_state;
+} Job_Worker;
+
+struct Job_System
+{
+	Job_Worker* workers[JOBS_MAX_WORKERS];
+	u32 worker_count;
+	volatile u32 sleeping;
+	volatile u32 stop;
+	OS_Semaphore wake;
+};
+
+static AZUR_THREAD_LOCAL Job_Worker* JobWorker;
+
+static bool
+Jobs_Push(Job_Worker* worker, Job* job)
+{
+	u64 bottom = worker->bottom;
+	u64 top    = Atomic_LoadAcquire64(&worker->top);
+
+	if (bottom - top >= JOBS_DEQUE_SIZE) return false;
+
+	worker->jobs[bottom & (JOBS_DEQUE_SIZE-1)] = *job;
+	Atomic_StoreRelease64(&worker->bottom, bottom + 1);
+
+	return true;
+}
+
+static bool
+Jobs_Take(Job_Worker* worker, Job* job)
+{
+	bool succeeded = false;
+
+	u64 bottom = worker->bottom - 1;
+	worker->bottom = bottom;
+
+	Atomic_FenceSeqCst();
+
+	u64 top = worker->top;
+
+	if ((s64)(bottom - top) >= 0)
+	{
+		*job      = worker->jobs[bottom & (JOBS_DEQUE_SIZE-1)];
+		succeeded = true;
+
+		// NOTE: the last job can be stolen at the same time, whoever moves top first gets it
+		if (bottom == top)
+		{
+			succeeded = Atomic_CompareExchange64(&worker->top, top, top + 1);
+			worker->bottom = bottom + 1;
+		}
+	}
+	else
+	{
+		worker->bottom = bottom + 1;
+	}
+
+	return succeeded;
+}
+
+static bool
+Jobs_Steal(Job_Worker* victim, Job* job)
+{
+	bool succeeded = false;
+
+	u64 top = Atomic_LoadAcquire64(&victim->top);
+
+	Atomic_FenceSeqCst();
+
+	u64 bottom = Atomic_LoadAcquire64(&victim->bottom);
+
+	if ((s64)(bottom - top) > 0)
+	{
+		// NOTE: the copy may race with the owner reusing the slot, that only happens after top moved past it, in
+		//       which case the exchange fails and the copy is thrown away
+		Job copy  = victim->jobs[top & (JOBS_DEQUE_SIZE-1)];
+		succeeded = Atomic_CompareExchange64(&victim->top, top, top + 1);
+		if (succeeded) *job = copy;
+	}
+
+	return succeeded;
+}
+
+static bool
+Jobs_StealAny(Job_Worker* worker, Job* job)
+{
+	Job_System* system = worker->system;
+
+	u32 x = worker->random_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	worker->random_state = x;
+
+	bool succeeded = false;
+	for (u32 i = 0; i < system->worker_count && !succeeded; ++i)
+	{
+		Job_Worker* victim = system->workers[(x + i) % system->worker_count];
+		if (victim != worker) succeeded = Jobs_Steal(victim, job);
+	}
+
+	return succeeded;
+}
+
+static bool
+Jobs_AnyQueued(Job_System* system)
+{
+	bool result = false;
+
+	for (u32 i = 0; i < system->worker_count && !result; ++i)
+	{
+		Job_Worker* worker = system->workers[i];
+		result = ((s64)(Atomic_LoadAcquire64(&worker->bottom) - Atomic_LoadAcquire64(&worker->top)) > 0);
+	}
+
+	return result;
+}
+
+static void
+Jobs_Run(Job_Worker* worker, Job* job)
+{
+	PROFILE_BEGIN(Job);
+
+	Bump_Mark mark = Bump_GetMark(&worker->scratch);
+
+	if (job->range_func != 0) job->range_func(job->data, job->first, job->count, &worker->scratch);
+	else                      job->func(job->data, &worker->scratch);
+
+	Bump_PopToMark(&worker->scratch, mark);
+
+	PROFILE_END(Job);
+
+	if (job->counter != 0) Atomic_FetchAdd32(&job->counter->pending, (u32)-1);
+}
+
+// NOTE: submitting pairs with a worker going to sleep, the fence orders the pushed jobs before reading sleeping and
+//       the worker increments sleeping before it looks at the deques one last time, so one of them always sees the other
+static void
+Jobs_Wake(Job_System* system, u32 job_count)
+{
+	Atomic_FenceSeqCst();
+
+	u32 sleeping = Atomic_LoadAcquire32(&system->sleeping);
+	for (u32 i = 0; i < job_count && i < sleeping; ++i) OS_SignalSemaphore(&system->wake);
+}
+
+static void
+Jobs_SubmitJob(Job_Worker* worker, Job* job)
+{
+	if (job->counter != 0) Atomic_FetchAdd32(&job->counter->pending, 1);
+
+	if (!Jobs_Push(worker, job)) Jobs_Run(worker, job);
+}
+
+/// Platform_Link entry points, only callable from the thread that created the system or from inside a job
+
+static void
+Jobs_Submit(Job_Func* func, void* data, Job_Counter* counter)
+{
+	Job_Worker* worker = JobWorker;
+	ASSERT(worker != 0);
+
+	Job job = { .func = func, .data = data, .counter = counter };
+	Jobs_SubmitJob(worker, &job);
+
+	Jobs_Wake(worker->system, 1);
+}
+
+static void
+Jobs_ParallelFor(Job_Range_Func* func, void* data, u32 count, u32 batch_size, Job_Counter* counter)
+{
+	Job_Worker* worker = JobWorker;
+	ASSERT(worker != 0);
+
+	// NOTE: a few batches per worker leaves room to balance uneven batches by stealing
+	if (batch_size == 0) batch_size = count / (worker->system->worker_count*4);
+	if (batch_size == 0) batch_size = 1;
+
+	u32 job_count = 0;
+	for (u32 first = 0; first < count; first += batch_size)
+	{
+		Job job = {
+			.range_func = func,
+			.data       = data,
+			.counter    = counter,
+			.first      = first,
+			.count      = (count - first < batch_size ? count - first : batch_size),
+		};
+
+		Jobs_SubmitJob(worker, &job);
+		job_count += 1;
+	}
+
+	Jobs_Wake(worker->system, job_count);
+}
+
+static void
+Jobs_Wait(Job_Counter* counter)
+{
+	Job_Worker* worker = JobWorker;
+	ASSERT(worker != 0);
+
+	while (Atomic_LoadAcquire32(&counter->pending) != 0)
+	{
+		Job job;
+		if (Jobs_Take(worker, &job) || Jobs_StealAny(worker, &job)) Jobs_Run(worker, &job);
+		else                                                        _mm_pause();
+	}
+}
+
+///
+
+static void
+Jobs_WorkerMain(void* data)
+{
+	Job_Worker* worker = data;
+	Job_System* system = worker->system;
+
+	JobWorker = worker;
+
+#ifdef AZUR_PROFILING
+	char name[] = "worker 00";
+	name[7] = (char)('0' + worker->index/10);
+	name[8] = (char)('0' + worker->index%10);
+	PROFILE_THREAD(name);
+#endif
+
+	u32 idle = 0;
+	while (!Atomic_LoadAcquire32(&system->stop))
+	{
+		Job job;
+		if (Jobs_Take(worker, &job) || Jobs_StealAny(worker, &job))
+		{
+			Jobs_Run(worker, &job);
+			idle = 0;
+		}
+		else if (++idle < JOBS_SPIN_COUNT)
+		{
+			_mm_pause();
+		}
+		else
+		{
+			Atomic_FetchAdd32(&system->sleeping, 1);
+
+			if (!Jobs_AnyQueued(system) && !Atomic_LoadAcquire32(&system->stop)) OS_WaitSemaphore(&system->wake);
+
+			Atomic_FetchAdd32(&system->sleeping, (u32)-1);
+			idle = 0;
+		}
+	}
+}
+
+static void Jobs_Destroy(Job_System* system);
+
+// NOTE: worker_count includes the calling thread, which becomes worker 0
+static bool
+Jobs_Create(Job_System* system, Bump* bump, u32 worker_count)
+{
+	ASSERT(worker_count >= 1 && worker_count <= JOBS_MAX_WORKERS);
+
+	*system = (Job_System){0};
+
+	if (!OS_CreateSemaphore(&system->wake, 0)) return false;
+
+	bool succeeded = true;
+
+	for (u32 i = 0; i < worker_count && succeeded; ++i)
+	{
+		Job_Worker* worker = Bump_Push(bump, sizeof(Job_Worker), 64);
+
+		*worker = (Job_Worker){
+			.jobs         = Bump_Push(bump, JOBS_DEQUE_SIZE*sizeof(Job), 64),
+			.system       = system,
+			.index        = i,
+			.random_state = 0x9E3779B9u*(i + 1),
+		};
+
+		succeeded = Bump_Create(JOBS_SCRATCH_SIZE, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &worker->scratch);
+
+		system->workers[i]    = worker;
+		system->worker_count += 1;
+	}
+
+	// NOTE: the other workers only start once every deque they might steal from exists
+	JobWorker = system->workers[0];
+
+	for (u32 i = 1; i < worker_count && succeeded; ++i)
+	{
+		succeeded = OS_CreateThread(&system->workers[i]->thread, Jobs_WorkerMain, system->workers[i]);
+	}
+
+	if (!succeeded) Jobs_Destroy(system);
+
+	return succeeded;
+}
+
+// NOTE: Makes the calling thread worker 0 in place of the thread that created the system, which must not submit or
+//       wait on jobs from then on
+static void
+Jobs_TakeOverMainWorker(Job_System* system)
+{
+	JobWorker = system->workers[0];
+}
+
+static void
+Jobs_Destroy(Job_System* system)
+{
+	Atomic_StoreRelease32(&system->stop, 1);
+
+	for (u32 i = 1; i < system->worker_count; ++i) OS_SignalSemaphore(&system->wake);
+
+	for (u32 i = 0; i < system->worker_count; ++i)
+	{
+		Job_Worker* worker = system->workers[i];
+		if (i != 0 && worker->thread.handle != 0) OS_JoinThread(&worker->thread);
+		Bump_Destroy(&worker->scratch);
+	}
+
+	OS_DestroySemaphore(&system->wake);
+
+	JobWorker = 0;
+	*system = (Job_System){0};
+}
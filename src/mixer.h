@@ -0,0 +1,410 @@
+// NOTE: The mixer behind audio.h. A mixer thread keeps a ring of AUDIO_PERIOD_COUNT mixed periods full, a sink thread
+//       stands in for the audio device and takes one period off the ring every AUDIO_PERIOD_FRAMES frames of real
+//       time, writing it to a WAV file or nowhere. Every period the sink takes wakes the mixer, which applies the
+//       queued commands and mixes the period that replaces it, so a command is heard at most one period plus the
+//       periods already in the ring after it was queued, about 8 ms. Neither thread ever waits on the game.
+//
+//       Voices are mixed in 16.16 fixed point, eight output frames at a time: one gather fetches both samples a frame
+//       interpolates between, and everything after that is integer math on 32 bit lanes that gives the same bits as
+//       the scalar tail. A sink that finds the ring empty plays silence and counts an underrun.
+//
+//       Requires audio.h and os.h.
+
+#define AUDIO_PERIOD_FRAMES 96 // NOTE: 2 ms, a multiple of 8
+#define AUDIO_PERIOD_COUNT  4  // NOTE: a power of two
+
+typedef struct Mixer_Voice
+{
+	Audio_Voice voice;
+	s16* samples;
+	u32 frame_count;
+	u32 step;
+	u64 position; // NOTE: 16.16 frames into the sound
+	s32 gain_left;
+	s32 gain_right;
+	bool loop;
+} Mixer_Voice;
+
+typedef struct Mixer
+{
+	Audio_Queue queue; // NOTE: handed to the game
+	FILE* file;        // NOTE: 0 for the null sink
+	s16 (*periods)[AUDIO_PERIOD_FRAMES*2];
+	volatile u32 read_index;
+	volatile u32 write_index;
+	volatile u32 stop;
+	OS_Semaphore wake;
+	OS_Thread mixer_thread;
+	OS_Thread sink_thread;
+
+	/// Mixer thread
+	Mixer_Voice* voices;
+	u32 voice_count;
+	s32* mix_left;
+	s32* mix_right;
+	u64 mixed_periods;
+	u64 mix_ns_total;
+	u64 mix_ns_max;
+	u32 voice_count_max;
+	u64 voices_dropped;
+
+	/// Sink thread
+	u64 played_periods;
+	u64 underruns;
+	u64 late_ns_max;
+	bool write_failed;
+} Mixer;
+
+// NOTE: Mixes count frames of a voice that all lie before the end of its sound into left and right
+static void
+Mixer_MixRun(Mixer_Voice* voice, s32* left, s32* right, u32 count)
+{
+	s16* samples  = voice->samples;
+	u64 position  = voice->position;
+	u32 step      = voice->step;
+
+	u32 i = 0;
+#ifdef __AVX2__
+	__m256i lane_offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((s32)step));
+	__m256i gain_left    = _mm256_set1_epi32(voice->gain_left);
+	__m256i gain_right   = _mm256_set1_epi32(voice->gain_right);
+	__m256i frac_mask    = _mm256_set1_epi32(0xFFFF);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		// NOTE: offsets are relative to the frame at position, which keeps them well within 32 bits
+		__m256i offsets = _mm256_add_epi32(_mm256_set1_epi32((s32)(position & 0xFFFF)), lane_offsets);
+		__m256i frac    = _mm256_srli_epi32(_mm256_and_si256(offsets, frac_mask), 1);
+
+		__m256i index = _mm256_srli_epi32(offsets, 16);
+		s16* base     = samples + (position >> 16);
+
+		__m256i s0, s1;
+		if (step <= 0x10000)
+		{
+			// NOTE: at pitch 1 and below the 8 frames stay within 9 samples, two loads and a permute each beat a gather
+			s0 = _mm256_permutevar8x32_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i*)base)),       index);
+			s1 = _mm256_permutevar8x32_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i*)(base + 1))), index);
+		}
+		else
+		{
+			// NOTE: one 32 bit load per frame picks up the sample and the one after it
+			__m256i pair = _mm256_i32gather_epi32((const int*)base, index, 2);
+			s0 = _mm256_srai_epi32(_mm256_slli_epi32(pair, 16), 16);
+			s1 = _mm256_srai_epi32(pair, 16);
+		}
+
+		__m256i sample = _mm256_add_epi32(s0, _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(s1, s0), frac), 15));
+
+		__m256i l = _mm256_loadu_si256((__m256i*)(left + i));
+		__m256i r = _mm256_loadu_si256((__m256i*)(right + i));
+		_mm256_storeu_si256((__m256i*)(left + i),  _mm256_add_epi32(l, _mm256_srai_epi32(_mm256_mullo_epi32(sample, gain_left),  15)));
+		_mm256_storeu_si256((__m256i*)(right + i), _mm256_add_epi32(r, _mm256_srai_epi32(_mm256_mullo_epi32(sample, gain_right), 15)));
+
+		position += 8*(u64)step;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		s16* pair   = samples + (position >> 16);
+		s32 frac    = (s32)(position & 0xFFFF) >> 1;
+		s32 sample  = pair[0] + (((pair[1] - pair[0])*frac) >> 15);
+
+		left[i]  += (sample*voice->gain_left)  >> 15;
+		right[i] += (sample*voice->gain_right) >> 15;
+
+		position += step;
+	}
+
+	voice->position = position;
+}
+
+// NOTE: Adds count frames of a voice to left and right. Returns false once a voice that does not loop is done.
+static bool
+Mixer_MixVoice(Mixer_Voice* voice, s32* left, s32* right, u32 count)
+{
+	u64 end = (u64)voice->frame_count << 16;
+
+	for (u32 i = 0; i < count; )
+	{
+		if (voice->position >= end)
+		{
+			if (!voice->loop) return false;
+			voice->position %= end;
+		}
+
+		u64 remaining = (end - voice->position + voice->step - 1)/voice->step;
+		u32 run = (remaining < count - i ? (u32)remaining : count - i);
+
+		Mixer_MixRun(voice, left + i, right + i, run);
+		i += run;
+	}
+
+	return (voice->loop || voice->position < end);
+}
+
+// NOTE: Mixes a period of every voice into out as interleaved stereo, voices that finish are removed
+static void
+Mixer_MixPeriod(Mixer_Voice* voices, u32* voice_count, s32* left, s32* right, s16* out)
+{
+	memset(left,  0, AUDIO_PERIOD_FRAMES*sizeof(s32));
+	memset(right, 0, AUDIO_PERIOD_FRAMES*sizeof(s32));
+
+	for (u32 i = 0; i < *voice_count; )
+	{
+		if (Mixer_MixVoice(&voices[i], left, right, AUDIO_PERIOD_FRAMES)) i += 1;
+		else                                                             voices[i] = voices[--*voice_count];
+	}
+
+	u32 i = 0;
+#ifdef __AVX2__
+	for (; i < AUDIO_PERIOD_FRAMES; i += 8)
+	{
+		__m256i l = _mm256_loadu_si256((__m256i*)(left + i));
+		__m256i r = _mm256_loadu_si256((__m256i*)(right + i));
+
+		// NOTE: the unpacks pair up frames within 128 bit lanes, the saturating pack puts them back in order
+		__m256i frames = _mm256_packs_epi32(_mm256_unpacklo_epi32(l, r), _mm256_unpackhi_epi32(l, r));
+		_mm256_storeu_si256((__m256i*)(out + i*2), frames);
+	}
+#endif
+
+	for (; i < AUDIO_PERIOD_FRAMES; ++i)
+	{
+		out[i*2 + 0] = (s16)(left[i]  < S16_MIN ? S16_MIN : (left[i]  > S16_MAX ? S16_MAX : left[i]));
+		out[i*2 + 1] = (s16)(right[i] < S16_MIN ? S16_MIN : (right[i] > S16_MAX ? S16_MAX : right[i]));
+	}
+}
+
+static Mixer_Voice*
+Mixer_FindVoice(Mixer* mixer, Audio_Voice voice)
+{
+	for (u32 i = 0; i < mixer->voice_count; ++i)
+	{
+		if (mixer->voices[i].voice == voice) return &mixer->voices[i];
+	}
+
+	return 0;
+}
+
+static void
+Mixer_ApplyCommands(Mixer* mixer)
+{
+	Audio_Command command;
+	while (Audio_PopCommand(&mixer->queue, &command))
+	{
+		Mixer_Voice* voice = (command.kind != AUDIO_COMMAND_PLAY ? Mixer_FindVoice(mixer, command.voice) : 0);
+
+		if (command.kind == AUDIO_COMMAND_PLAY)
+		{
+			if (mixer->voice_count == AUDIO_MAX_VOICES)
+			{
+				mixer->voices_dropped += 1;
+				continue;
+			}
+
+			mixer->voices[mixer->voice_count++] = (Mixer_Voice){
+				.voice       = command.voice,
+				.samples     = command.samples,
+				.frame_count = command.frame_count,
+				.step        = command.step,
+				.gain_left   = command.gain_left,
+				.gain_right  = command.gain_right,
+				.loop        = command.loop,
+			};
+		}
+		else if (command.kind == AUDIO_COMMAND_STOP && voice != 0)
+		{
+			*voice = mixer->voices[--mixer->voice_count];
+		}
+		else if (command.kind == AUDIO_COMMAND_VOLUME && voice != 0)
+		{
+			voice->gain_left  = command.gain_left;
+			voice->gain_right = command.gain_right;
+		}
+	}
+
+	if (mixer->voice_count > mixer->voice_count_max) mixer->voice_count_max = mixer->voice_count;
+}
+
+static void
+Mixer_Worker(void* data)
+{
+	Mixer* mixer = data;
+
+	PROFILE_THREAD("mixer");
+
+	for (;;)
+	{
+		OS_WaitSemaphore(&mixer->wake);
+		if (Atomic_LoadAcquire32(&mixer->stop)) break;
+
+		u32 write_index = mixer->write_index;
+		while (write_index - Atomic_LoadAcquire32(&mixer->read_index) < AUDIO_PERIOD_COUNT)
+		{
+			u64 mix_start = OS_GetTimeNS();
+
+			PROFILE_BEGIN(MixPeriod);
+			Mixer_ApplyCommands(mixer);
+			Mixer_MixPeriod(mixer->voices, &mixer->voice_count, mixer->mix_left, mixer->mix_right,
+			                mixer->periods[write_index % AUDIO_PERIOD_COUNT]);
+			PROFILE_END(MixPeriod);
+
+			write_index += 1;
+			Atomic_StoreRelease32(&mixer->write_index, write_index);
+
+			u64 time = OS_GetTimeNS() - mix_start;
+			mixer->mixed_periods += 1;
+			mixer->mix_ns_total  += time;
+			mixer->mix_ns_max     = (time > mixer->mix_ns_max ? time : mixer->mix_ns_max);
+		}
+	}
+}
+
+static void
+Mixer_Write(Mixer* mixer, void* data, umm size)
+{
+	if (mixer->file != 0 && !mixer->write_failed && fwrite(data, 1, size, mixer->file) != size) mixer->write_failed = true;
+}
+
+// NOTE: A device takes periods on its own clock. When the sink wakes up late it catches up on every period it missed,
+//       like a device would have, so the file always holds real time worth of audio.
+static void
+Mixer_Sink(void* data)
+{
+	Mixer* mixer = data;
+
+	PROFILE_THREAD("audio sink");
+
+	// NOTE: spinning the last bit of every wait would burn a core for a clock nobody listens to this precisely
+	OS_Timer timer;
+	OS_CreateTimer(&timer);
+	timer.spin_ns = 0;
+
+	u64 period_ns = AUDIO_PERIOD_FRAMES*1000000000ULL/AUDIO_SAMPLE_RATE;
+	u64 next      = OS_GetTimeNS() + period_ns;
+
+	while (!Atomic_LoadAcquire32(&mixer->stop))
+	{
+		OS_WaitUntilNS(&timer, next);
+
+		u64 late = OS_GetTimeNS() - next;
+		mixer->late_ns_max = (late > mixer->late_ns_max ? late : mixer->late_ns_max);
+
+		for (u64 now = OS_GetTimeNS(); next <= now; next += period_ns)
+		{
+			u32 read_index = mixer->read_index;
+			if (read_index != Atomic_LoadAcquire32(&mixer->write_index))
+			{
+				Mixer_Write(mixer, mixer->periods[read_index % AUDIO_PERIOD_COUNT], sizeof(mixer->periods[0]));
+				Atomic_StoreRelease32(&mixer->read_index, read_index + 1);
+			}
+			else
+			{
+				s16 silence[AUDIO_PERIOD_FRAMES*2] = {0};
+				Mixer_Write(mixer, silence, sizeof(silence));
+
+				mixer->underruns += 1;
+			}
+
+			mixer->played_periods += 1;
+		}
+
+		OS_SignalSemaphore(&mixer->wake);
+	}
+
+	OS_DestroyTimer(&timer);
+}
+
+static void
+Mixer_PutU32(u8* out, u32 value)
+{
+	out[0] = (u8)value;
+	out[1] = (u8)(value >>  8);
+	out[2] = (u8)(value >> 16);
+	out[3] = (u8)(value >> 24);
+}
+
+// NOTE: The sizes in the header are only known once the sink stops, they are filled in by Mixer_Stop
+static void
+Mixer_WriteWAVHeader(Mixer* mixer, u32 data_size)
+{
+	u8 header[44] = {
+		'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+		'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 16, 0, // NOTE: PCM, stereo, 16 bit
+		'd', 'a', 't', 'a', 0, 0, 0, 0,
+	};
+	Mixer_PutU32(header +  4, 36 + data_size);
+	Mixer_PutU32(header + 24, AUDIO_SAMPLE_RATE);
+	Mixer_PutU32(header + 28, AUDIO_SAMPLE_RATE*4);
+	Mixer_PutU32(header + 40, data_size);
+
+	Mixer_Write(mixer, header, sizeof(header));
+}
+
+// NOTE: file is 0 for the null sink, otherwise it stays owned by the caller and receives a 16 bit stereo WAV
+static bool
+Mixer_Start(Mixer* mixer, Bump* bump, FILE* file)
+{
+	*mixer = (Mixer){
+		.queue = {
+			.commands = Bump_Push(bump, AUDIO_COMMAND_COUNT*sizeof(Audio_Command), 64),
+		},
+		.file      = file,
+		.periods   = Bump_Push(bump, AUDIO_PERIOD_COUNT*sizeof(mixer->periods[0]), 64),
+		.voices    = Bump_Push(bump, AUDIO_MAX_VOICES*sizeof(Mixer_Voice), 64),
+		.mix_left  = Bump_Push(bump, AUDIO_PERIOD_FRAMES*sizeof(s32), 64),
+		.mix_right = Bump_Push(bump, AUDIO_PERIOD_FRAMES*sizeof(s32), 64),
+	};
+
+	// NOTE: touch everything up front, page faults on first use would otherwise land on the audio threads
+	memset(mixer->queue.commands, 0, AUDIO_COMMAND_COUNT*sizeof(Audio_Command));
+	memset(mixer->periods, 0, AUDIO_PERIOD_COUNT*sizeof(mixer->periods[0]));
+	memset(mixer->voices, 0, AUDIO_MAX_VOICES*sizeof(Mixer_Voice));
+
+	Mixer_WriteWAVHeader(mixer, 0);
+
+	// NOTE: starts out signaled, so the ring is full before the sink takes its first period
+	if (mixer->write_failed || !OS_CreateSemaphore(&mixer->wake, 1)) return false;
+
+	if (!OS_CreateThread(&mixer->mixer_thread, Mixer_Worker, mixer))
+	{
+		OS_DestroySemaphore(&mixer->wake);
+		return false;
+	}
+
+	if (!OS_CreateThread(&mixer->sink_thread, Mixer_Sink, mixer))
+	{
+		Atomic_StoreRelease32(&mixer->stop, 1);
+		OS_SignalSemaphore(&mixer->wake);
+		OS_JoinThread(&mixer->mixer_thread);
+		OS_DestroySemaphore(&mixer->wake);
+		return false;
+	}
+
+	return true;
+}
+
+// NOTE: Stops both threads and finishes the file. Returns false if any write failed.
+static bool
+Mixer_Stop(Mixer* mixer)
+{
+	Atomic_StoreRelease32(&mixer->stop, 1);
+	OS_JoinThread(&mixer->sink_thread);
+
+	OS_SignalSemaphore(&mixer->wake);
+	OS_JoinThread(&mixer->mixer_thread);
+	OS_DestroySemaphore(&mixer->wake);
+
+	if (mixer->file != 0 && !mixer->write_failed)
+	{
+		u64 data_size = mixer->played_periods*sizeof(mixer->periods[0]);
+		if (data_size > U32_MAX - 36) data_size = U32_MAX - 36;
+
+		if (fseek(mixer->file, 0, SEEK_SET) != 0) mixer->write_failed = true;
+		else                                      Mixer_WriteWAVHeader(mixer, (u32)data_size);
+	}
+
+	return !mixer->write_failed;
+}
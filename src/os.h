@@ -0,0 +1,373 @@
+// NOTE: Thin OS layer shared by the platform hosts and tools. On Win32 windows.h must be included before this file.
+//       Nothing in here is visible to the game, it only gets what the platform hands it through Platform_Link.
+
+#ifdef _WIN32
+#include <mmsystem.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <time.h>
+#endif
+
+typedef void OS_Thread_Func(void* data);
+
+// NOTE: the OS_Thread must stay at the same address until the thread is joined, it is handed to the entry point
+typedef struct OS_Thread
+{
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+	OS_Thread_Func* func;
+	void* data;
+} OS_Thread;
+
+typedef struct OS_Semaphore
+{
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	sem_t handle;
+#endif
+} OS_Semaphore;
+
+// NOTE: Sleeps until shortly before a deadline and spins the rest of the way, spin_ns covers the scheduler's wakeup slack
+typedef struct OS_Timer
+{
+#ifdef _WIN32
+	HANDLE handle;
+	bool raised_timer_period;
+#endif
+	u64 spin_ns;
+} OS_Timer;
+
+static u64
+OS_GetTimeNS()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = {0};
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	u64 seconds = (u64)counter.QuadPart / (u64)frequency.QuadPart;
+	u64 rest    = (u64)counter.QuadPart % (u64)frequency.QuadPart;
+	return seconds*1000000000ULL + rest*1000000000ULL/(u64)frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec*1000000000ULL + (u64)ts.tv_nsec;
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI
+OS_ThreadEntry(LPVOID param)
+{
+	OS_Thread* thread = param;
+	thread->func(thread->data);
+	return 0;
+}
+#else
+static void*
+OS_ThreadEntry(void* param)
+{
+	OS_Thread* thread = param;
+	thread->func(thread->data);
+	return 0;
+}
+#endif
+
+static bool
+OS_CreateThread(OS_Thread* thread, OS_Thread_Func* func, void* data)
+{
+	thread->func = func;
+	thread->data = data;
+
+#ifdef _WIN32
+	thread->handle = CreateThread(0, 0, OS_ThreadEntry, thread, 0, 0);
+	return (thread->handle != 0);
+#else
+	return (pthread_create(&thread->handle, 0, OS_ThreadEntry, thread) == 0);
+#endif
+}
+
+static void
+OS_JoinThread(OS_Thread* thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, 0);
+#endif
+}
+
+static bool
+OS_CreateSemaphore(OS_Semaphore* semaphore, u32 initial_count)
+{
+#ifdef _WIN32
+	semaphore->handle = CreateSemaphoreW(0, (LONG)initial_count, S32_MAX, 0);
+	return (semaphore->handle != 0);
+#else
+	return (sem_init(&semaphore->handle, 0, initial_count) == 0);
+#endif
+}
+
+static void
+OS_DestroySemaphore(OS_Semaphore* semaphore)
+{
+#ifdef _WIN32
+	CloseHandle(semaphore->handle);
+#else
+	sem_destroy(&semaphore->handle);
+#endif
+}
+
+static void
+OS_SignalSemaphore(OS_Semaphore* semaphore)
+{
+#ifdef _WIN32
+	ReleaseSemaphore(semaphore->handle, 1, 0);
+#else
+	sem_post(&semaphore->handle);
+#endif
+}
+
+static void
+OS_WaitSemaphore(OS_Semaphore* semaphore)
+{
+#ifdef _WIN32
+	WaitForSingleObject(semaphore->handle, INFINITE);
+#else
+	while (sem_wait(&semaphore->handle) != 0);
+#endif
+}
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+static bool
+OS_CreateTimer(OS_Timer* timer)
+{
+	*timer = (OS_Timer){0};
+
+#ifdef _WIN32
+	// NOTE: high resolution timers need Windows 10 1803, older versions fall back to a regular timer with the
+	//       system timer period raised to 1 ms, which wakes up less precisely and needs a longer spin
+	timer->handle  = CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	timer->spin_ns = 500000;
+
+	if (timer->handle == 0)
+	{
+		timer->handle              = CreateWaitableTimerExW(0, 0, 0, TIMER_ALL_ACCESS);
+		timer->raised_timer_period = (timeBeginPeriod(1) == TIMERR_NOERROR);
+		timer->spin_ns             = 2000000;
+	}
+
+	return (timer->handle != 0);
+#else
+	timer->spin_ns = 100000;
+	return true;
+#endif
+}
+
+static void
+OS_DestroyTimer(OS_Timer* timer)
+{
+#ifdef _WIN32
+	if (timer->raised_timer_period) timeEndPeriod(1);
+	CloseHandle(timer->handle);
+#endif
+	*timer = (OS_Timer){0};
+}
+
+static void
+OS_WaitUntilNS(OS_Timer* timer, u64 deadline_ns)
+{
+	u64 now = OS_GetTimeNS();
+
+	if (deadline_ns > now + timer->spin_ns)
+	{
+#ifdef _WIN32
+		// NOTE: negative due times are relative, in 100 ns units
+		LARGE_INTEGER due_time = { .QuadPart = -(LONGLONG)((deadline_ns - timer->spin_ns - now)/100) };
+		if (SetWaitableTimerEx(timer->handle, &due_time, 0, 0, 0, 0, 0)) WaitForSingleObject(timer->handle, INFINITE);
+#else
+		u64 wakeup = deadline_ns - timer->spin_ns;
+		struct timespec ts = { .tv_sec = (time_t)(wakeup/1000000000ULL), .tv_nsec = (long)(wakeup%1000000000ULL) };
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR);
+#endif
+	}
+
+	while (OS_GetTimeNS() < deadline_ns) _mm_pause();
+}
+
+// NOTE: Times the TSC against the OS clock for about 10 ms. Invariant TSCs tick at a constant rate, so this only
+//       needs to happen once at startup.
+static u64
+OS_EstimateTSCFrequency(void)
+{
+	u64 start_ns  = OS_GetTimeNS();
+	u64 start_tsc = __rdtsc();
+
+	u64 end_ns;
+	do end_ns = OS_GetTimeNS(); while (end_ns - start_ns < 10000000);
+
+	u64 end_tsc = __rdtsc();
+
+	return (u64)((f64)(end_tsc - start_tsc)*1e9/(f64)(end_ns - start_ns));
+}
+
+/// Memory
+
+static u64
+OS_PageSize(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return (u64)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static bool
+OS_BumpCommit(Bump* bump, u64 new_committed)
+{
+	bool succeeded = true;
+
+	if (new_committed > bump->committed)
+	{
+		u8* start = bump->memory + bump->committed;
+		u64 size  = new_committed - bump->committed;
+#ifdef _WIN32
+		succeeded = (VirtualAlloc(start, size, MEM_COMMIT, PAGE_READWRITE) != 0);
+#else
+		succeeded = (mprotect(start, size, PROT_READ | PROT_WRITE) == 0);
+#endif
+	}
+	else if (new_committed < bump->committed)
+	{
+		u8* start = bump->memory + new_committed;
+		u64 size  = bump->committed - new_committed;
+#ifdef _WIN32
+		succeeded = (VirtualFree(start, size, MEM_DECOMMIT) != 0);
+#else
+		// NOTE: MADV_DONTNEED drops the pages, they read back as zero if the range is ever committed again
+		succeeded = (madvise(start, size, MADV_DONTNEED) == 0 && mprotect(start, size, PROT_NONE) == 0);
+#endif
+	}
+
+	if (succeeded) bump->committed = new_committed;
+
+	return succeeded;
+}
+
+typedef enum BUMP_FLAGS
+{
+	// NOTE: Reserves one more page past the end that is never committed, so running off the end of the arena faults
+	//       instead of scribbling over whatever is mapped after it. Reserved but uncommitted pages fault anyway, this
+	//       only matters once the arena is fully committed.
+	BUMP_GUARD_PAGE = 0x1,
+
+	// NOTE: Commits the whole reservation up front, for arenas whose size is known. Popping never decommits it.
+	BUMP_COMMIT_ALL = 0x2,
+} BUMP_FLAGS;
+
+#define BUMP_DEFAULT_COMMIT_CHUNK      (64*1024)
+#define BUMP_DEFAULT_DECOMMIT_CHUNKS   16
+
+// NOTE: Reserves reserve_size bytes of address space and commits it commit_chunk bytes at a time, both are rounded
+//       up to whole pages. Reservations are cheap, size them for the worst case rather than the common one.
+// NOTE: base is where the arena has to start, creation fails when that range is taken. 0 lets the OS pick.
+static bool
+Bump_CreateAt(u64 base, u64 reserve_size, u64 commit_chunk, u32 flags, Bump* bump)
+{
+	u64 page_size = OS_PageSize();
+
+	reserve_size = (reserve_size + (page_size-1)) / page_size * page_size;
+	commit_chunk = (commit_chunk + (page_size-1)) / page_size * page_size;
+	if (commit_chunk == 0) commit_chunk = page_size;
+
+	u64 guard_size = ((flags & BUMP_GUARD_PAGE) ? page_size : 0);
+
+#ifdef _WIN32
+	u8* memory = VirtualAlloc((void*)(umm)base, reserve_size + guard_size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	// NOTE: the address is only a hint to mmap, it maps somewhere else instead of failing
+	u8* memory = mmap((void*)(umm)base, reserve_size + guard_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (memory == MAP_FAILED) memory = 0;
+
+	if (memory != 0 && base != 0 && memory != (u8*)(umm)base)
+	{
+		munmap(memory, reserve_size + guard_size);
+		memory = 0;
+	}
+#endif
+
+	*bump = (Bump){
+		.memory             = memory,
+		.cursor             = 0,
+		.committed          = 0,
+		.reserved           = reserve_size,
+		.high_watermark     = 0,
+		.commit_chunk       = commit_chunk,
+		.decommit_threshold = BUMP_DEFAULT_DECOMMIT_CHUNKS*commit_chunk,
+		.commit             = OS_BumpCommit,
+		.flags              = flags,
+	};
+
+	bool succeeded = (memory != 0);
+
+	if (succeeded && (flags & BUMP_COMMIT_ALL))
+	{
+		bump->decommit_threshold = reserve_size;
+		succeeded = OS_BumpCommit(bump, reserve_size);
+	}
+
+	return succeeded;
+}
+
+static bool
+Bump_Create(u64 reserve_size, u64 commit_chunk, u32 flags, Bump* bump)
+{
+	return Bump_CreateAt(0, reserve_size, commit_chunk, flags, bump);
+}
+
+static void
+Bump_Destroy(Bump* bump)
+{
+	if (bump->memory != 0)
+	{
+#ifdef _WIN32
+		VirtualFree(bump->memory, 0, MEM_RELEASE);
+#else
+		munmap(bump->memory, bump->reserved + ((bump->flags & BUMP_GUARD_PAGE) ? OS_PageSize() : 0));
+#endif
+	}
+
+	*bump = (Bump){0};
+}
+
+static u32
+OS_GetProcessorCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (u32)info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (u32)(count > 0 ? count : 1);
+#endif
+}
@@ -0,0 +1,433 @@
+// NOTE: Asset pack, produced offline by bake.c and mapped into memory as is. Entries are found by name in a table of
+//       contents at the start of the file. Every entry is cut into blocks of PACK_BLOCK_SIZE bytes that are compressed
+//       on their own, so loading an entry is a parallel for over its blocks, each decompressing straight to its place
+//       in the destination. Blocks that would not shrink are stored as they are and only copied.
+//
+//       Layout: Pack_Header, Pack_Entry[entry_count], then per entry its Pack_Block[block_count] and the blocks. The
+//       tables start on PACK_ALIGNMENT boundaries, loaded entries land on one too.
+//
+//       Blocks are LZ77 in the style of LZ4 blocks: a sequence is a token holding a literal count and a match length,
+//       the literals, and a 16 bit offset back into what was already decompressed. Counts that do not fit in the 4
+//       bits of the token continue in bytes of 255. The last sequence of a block has literals only.
+
+#define PACK_MAGIC      0x4B434150 // "PACK"
+#define PACK_VERSION    1
+#define PACK_ALIGNMENT  64
+#define PACK_BLOCK_SIZE (1 << 16)
+#define PACK_MIN_MATCH  4
+#define PACK_HASH_BITS  14
+
+typedef struct Pack_Header
+{
+	u32 magic;
+	u32 version;
+	u64 file_size;
+	u32 entry_count;
+	u32 reserved;
+	u64 entry_offset;
+} Pack_Header;
+
+typedef struct Pack_Entry
+{
+	u8 name_len;
+	u8 name[31];
+	u64 size;        // NOTE: decompressed
+	u64 packed_size; // NOTE: of the blocks, without the table
+	u64 block_offset;
+	u32 block_count;
+	u32 reserved;
+} Pack_Entry;
+
+typedef struct Pack_Block
+{
+	u64 offset;
+	u32 size; // NOTE: stored as is when equal to the decompressed size
+	u32 reserved;
+} Pack_Block;
+
+// NOTE: What Pack_Load hands back, data is only valid once the counter of the load drops to zero. failed is set when
+//       a block turns out to be corrupt, it reads as zeros.
+typedef struct Pack_Asset
+{
+	u8* data;
+	u64 size;
+	volatile u32 failed;
+
+	Pack_Header* pack;
+	Pack_Entry* entry;
+} Pack_Asset;
+
+static Pack_Entry*
+Pack_Entries(Pack_Header* pack)
+{
+	return (Pack_Entry*)((u8*)pack + pack->entry_offset);
+}
+
+static Pack_Block*
+Pack_Blocks(Pack_Header* pack, Pack_Entry* entry)
+{
+	return (Pack_Block*)((u8*)pack + entry->block_offset);
+}
+
+static String
+Pack_EntryName(Pack_Entry* entry)
+{
+	return (String){ .data = entry->name, .len = entry->name_len };
+}
+
+// NOTE: Checks that every table and block lies within the file, the blocks themselves are checked while decompressing
+static bool
+Pack_Validate(void* memory, u64 size)
+{
+	Pack_Header* pack = memory;
+
+	if (size < sizeof(Pack_Header) || ((umm)memory & (PACK_ALIGNMENT-1)) != 0) return false;
+	if (pack->magic != PACK_MAGIC || pack->version != PACK_VERSION || pack->file_size != size) return false;
+	if (pack->entry_offset > size || (size - pack->entry_offset)/sizeof(Pack_Entry) < pack->entry_count) return false;
+	if (pack->entry_offset & (PACK_ALIGNMENT-1)) return false;
+
+	Pack_Entry* entries = Pack_Entries(pack);
+	for (u32 i = 0; i < pack->entry_count; ++i)
+	{
+		Pack_Entry* entry = &entries[i];
+
+		if (entry->name_len > sizeof(entry->name)) return false;
+		if (entry->block_count != (entry->size + PACK_BLOCK_SIZE - 1)/PACK_BLOCK_SIZE) return false;
+		if (entry->block_offset > size || (size - entry->block_offset)/sizeof(Pack_Block) < entry->block_count) return false;
+		if (entry->block_offset & (PACK_ALIGNMENT-1)) return false;
+
+		Pack_Block* blocks = Pack_Blocks(pack, entry);
+		for (u32 j = 0; j < entry->block_count; ++j)
+		{
+			u64 raw_size = (j + 1 < entry->block_count ? PACK_BLOCK_SIZE : entry->size - (u64)j*PACK_BLOCK_SIZE);
+			if (blocks[j].size > raw_size || blocks[j].offset > size || size - blocks[j].offset < blocks[j].size) return false;
+		}
+	}
+
+	return true;
+}
+
+static Pack_Entry*
+Pack_FindEntry(Pack_Header* pack, String name)
+{
+	Pack_Entry* entries = Pack_Entries(pack);
+	for (u32 i = 0; i < pack->entry_count; ++i)
+	{
+		if (String_Equal(Pack_EntryName(&entries[i]), name)) return &entries[i];
+	}
+
+	return 0;
+}
+
+/// Decompression
+
+// NOTE: Copies in 32 byte steps and may write up to 31 bytes past dst + size, callers make sure there is room
+static void
+Pack_WildCopy(u8* dst, u8* src, umm size)
+{
+#ifdef __AVX2__
+	for (umm i = 0; i < size; i += 32) _mm256_storeu_si256((__m256i*)(dst + i), _mm256_loadu_si256((__m256i*)(src + i)));
+#else
+	for (umm i = 0; i < size; i += 8) memcpy(dst + i, src + i, 8);
+#endif
+}
+
+static bool
+Pack_ReadCount(u8** in, u8* in_end, umm* count)
+{
+	u32 byte;
+	do
+	{
+		if (*in == in_end) return false;
+
+		byte    = *(*in)++;
+		*count += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+// NOTE: Returns false when the block is malformed or does not decompress to exactly dst_size bytes. Never reads or
+//       writes outside of either buffer, whatever the input.
+static bool
+Pack_Decompress(u8* src, umm src_size, u8* dst, umm dst_size)
+{
+	u8* in      = src;
+	u8* in_end  = src + src_size;
+	u8* out     = dst;
+	u8* out_end = dst + dst_size;
+
+	for (;;)
+	{
+		if (in == in_end) return false;
+		u32 token = *in++;
+
+		umm literals = token >> 4;
+		if (literals == 15 && !Pack_ReadCount(&in, in_end, &literals)) return false;
+		if (literals > (umm)(in_end - in) || literals > (umm)(out_end - out)) return false;
+
+		// NOTE: nearly every sequence is far enough from the ends of both buffers for copies to overshoot
+		if ((umm)(in_end - in) - literals >= 32 && (umm)(out_end - out) - literals >= 32) Pack_WildCopy(out, in, literals);
+		else                                                                               memcpy(out, in, literals);
+
+		in  += literals;
+		out += literals;
+
+		if (in == in_end) return (out == out_end);
+
+		if (in_end - in < 2) return false;
+		umm offset = in[0] | ((umm)in[1] << 8);
+		in += 2;
+
+		umm length = token & 15;
+		if (length == 15 && !Pack_ReadCount(&in, in_end, &length)) return false;
+		length += PACK_MIN_MATCH;
+
+		if (offset == 0 || offset > (umm)(out - dst) || length > (umm)(out_end - out)) return false;
+
+		u8* match = out - offset;
+		if (offset >= 32 && (umm)(out_end - out) - length >= 32)
+		{
+			Pack_WildCopy(out, match, length);
+		}
+		else if (offset == 1)
+		{
+			memset(out, match[0], length);
+		}
+		else
+		{
+			for (umm i = 0; i < length; ++i) out[i] = match[i];
+		}
+
+		out += length;
+	}
+}
+
+/// Compression, used offline
+
+static umm
+Pack_CompressBound(umm size)
+{
+	return size + size/255 + 16;
+}
+
+static u8*
+Pack_WriteCount(u8* out, umm count)
+{
+	for (; count >= 255; count -= 255) *out++ = 255;
+	*out++ = (u8)count;
+
+	return out;
+}
+
+// NOTE: length is 0 for the last sequence, which has no match
+static u8*
+Pack_WriteSequence(u8* out, u8* literals, umm literal_count, umm offset, umm length)
+{
+	u8* token = out++;
+
+	*token = (u8)((literal_count < 15 ? literal_count : 15) << 4);
+	if (literal_count >= 15) out = Pack_WriteCount(out, literal_count - 15);
+
+	memcpy(out, literals, literal_count);
+	out += literal_count;
+
+	if (length != 0)
+	{
+		out[0] = (u8)offset;
+		out[1] = (u8)(offset >> 8);
+		out += 2;
+
+		umm extra = length - PACK_MIN_MATCH;
+		*token |= (u8)(extra < 15 ? extra : 15);
+		if (extra >= 15) out = Pack_WriteCount(out, extra - 15);
+	}
+
+	return out;
+}
+
+// NOTE: Greedy, with a hash table of the last position every 4 byte sequence was seen at. table holds
+//       1 << PACK_HASH_BITS entries. Returns the compressed size, dst needs room for Pack_CompressBound(size) bytes.
+static umm
+Pack_Compress(u8* src, umm size, u8* dst, u32* table)
+{
+	ASSERT(size <= PACK_BLOCK_SIZE);
+
+	memset(table, 0xFF, sizeof(u32) << PACK_HASH_BITS);
+
+	u8* out    = dst;
+	u8* anchor = src;
+	u8* end    = src + size;
+
+	for (u8* p = src; p + PACK_MIN_MATCH <= end; )
+	{
+		u32 sequence  = String_Load32(p);
+		u32 hash      = (sequence*2654435761U) >> (32 - PACK_HASH_BITS);
+		u32 candidate = table[hash];
+		table[hash]   = (u32)(p - src);
+
+		if (candidate == U32_MAX || String_Load32(src + candidate) != sequence)
+		{
+			p += 1;
+			continue;
+		}
+
+		u8* match  = src + candidate;
+		umm length = PACK_MIN_MATCH;
+
+		while (p + length + 8 <= end)
+		{
+			u64 diff = String_Load64(p + length) ^ String_Load64(match + length);
+			if (diff != 0)
+			{
+				length += CountTrailingZeros64(diff)/8;
+				break;
+			}
+
+			length += 8;
+		}
+
+		if (p + length + 8 > end)
+		{
+			while (p + length < end && p[length] == match[length]) length += 1;
+		}
+
+		while (p > anchor && match > src && p[-1] == match[-1])
+		{
+			p      -= 1;
+			match  -= 1;
+			length += 1;
+		}
+
+		out = Pack_WriteSequence(out, anchor, (umm)(p - anchor), (umm)(p - match), length);
+
+		p     += length;
+		anchor = p;
+	}
+
+	out = Pack_WriteSequence(out, anchor, (umm)(end - anchor), 0, 0);
+
+	return (umm)(out - dst);
+}
+
+static u64
+Pack_AlignUp(u64 value, u64 alignment)
+{
+	return (value + (alignment-1)) & ~(alignment-1);
+}
+
+// NOTE: Builds the image of a whole pack on bump, ready to be written out or mapped, and returns it. The image is
+//       everything pushed onto bump from here on, scratch holds the hash table and one compressed block at a time.
+static Pack_Header*
+Pack_Build(Bump* bump, Bump* scratch, String* names, u8** data, u64* sizes, u32 count)
+{
+	Bump_Mark mark = Bump_GetMark(scratch);
+
+	u32* table = Bump_Push(scratch, sizeof(u32) << PACK_HASH_BITS, 4);
+	u8* packed = Bump_Push(scratch, Pack_CompressBound(PACK_BLOCK_SIZE), 8);
+
+	u64 entry_offset = Pack_AlignUp(sizeof(Pack_Header), PACK_ALIGNMENT);
+
+	Pack_Header* pack = Bump_Push(bump, (umm)(entry_offset + (u64)count*sizeof(Pack_Entry)), PACK_ALIGNMENT);
+	memset(pack, 0, (umm)(entry_offset + (u64)count*sizeof(Pack_Entry)));
+
+	*pack = (Pack_Header){
+		.magic        = PACK_MAGIC,
+		.version      = PACK_VERSION,
+		.entry_count  = count,
+		.entry_offset = entry_offset,
+	};
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 block_count = (u32)((sizes[i] + PACK_BLOCK_SIZE - 1)/PACK_BLOCK_SIZE);
+
+		Pack_Block* blocks = Bump_Push(bump, (umm)block_count*sizeof(Pack_Block), PACK_ALIGNMENT);
+		u64 block_offset   = (u64)((u8*)blocks - (u8*)pack);
+		u64 packed_size    = 0;
+
+		for (u32 j = 0; j < block_count; ++j)
+		{
+			u8* src  = data[i] + (u64)j*PACK_BLOCK_SIZE;
+			umm size = (umm)(j + 1 < block_count ? PACK_BLOCK_SIZE : sizes[i] - (u64)j*PACK_BLOCK_SIZE);
+
+			// NOTE: a block that does not shrink is stored
+			umm packed_block = Pack_Compress(src, size, packed, table);
+			u8* block_data   = packed;
+			if (packed_block >= size) packed_block = size, block_data = src;
+
+			u8* dst = Bump_Push(bump, packed_block, 1);
+			memcpy(dst, block_data, packed_block);
+
+			blocks[j] = (Pack_Block){ .offset = (u64)(dst - (u8*)pack), .size = (u32)packed_block };
+
+			packed_size += packed_block;
+		}
+
+		Pack_Entry* entry = &Pack_Entries(pack)[i];
+		*entry = (Pack_Entry){
+			.name_len     = (u8)(names[i].len < sizeof(entry->name) ? names[i].len : sizeof(entry->name)),
+			.size         = sizes[i],
+			.packed_size  = packed_size,
+			.block_offset = block_offset,
+			.block_count  = block_count,
+		};
+		memcpy(entry->name, names[i].data, entry->name_len);
+	}
+
+	u64 image_size  = (u64)(bump->memory + bump->cursor - (u8*)pack);
+	pack->file_size = Pack_AlignUp(image_size, PACK_ALIGNMENT);
+	memset(Bump_Push(bump, (umm)(pack->file_size - image_size), 1), 0, (umm)(pack->file_size - image_size));
+
+	Bump_PopToMark(scratch, mark);
+
+	return pack;
+}
+
+/// Loading
+
+static void
+Pack_DecompressBlocks(void* data, u32 first, u32 count, Bump* scratch)
+{
+	Pack_Asset* asset   = data;
+	Pack_Entry* entry   = asset->entry;
+	Pack_Block* blocks  = Pack_Blocks(asset->pack, entry);
+
+	for (u32 i = first; i < first + count; ++i)
+	{
+		u8* dst      = asset->data + (u64)i*PACK_BLOCK_SIZE;
+		u8* src      = (u8*)asset->pack + blocks[i].offset;
+		umm raw_size = (umm)(i + 1 < entry->block_count ? PACK_BLOCK_SIZE : entry->size - (u64)i*PACK_BLOCK_SIZE);
+
+		if (blocks[i].size == raw_size)
+		{
+			memcpy(dst, src, raw_size);
+		}
+		else if (!Pack_Decompress(src, blocks[i].size, dst, raw_size))
+		{
+			memset(dst, 0, raw_size);
+			Atomic_StoreRelease32(&asset->failed, 1);
+		}
+	}
+}
+
+// NOTE: Pushes the asset and room for the entry onto bump and starts decompressing it on the workers, the data is
+//       there once counter drops to zero. Returns 0 when the pack has no such entry. bump has to outlive the load.
+static Pack_Asset*
+Pack_Load(Pack_Header* pack, String name, Bump* bump, Job_Parallel_For_Func* parallel_for, Job_Counter* counter)
+{
+	Pack_Entry* entry = (pack != 0 ? Pack_FindEntry(pack, name) : 0);
+	if (entry == 0) return 0;
+
+	Pack_Asset* asset = Bump_Push(bump, sizeof(Pack_Asset), 8);
+	*asset = (Pack_Asset){
+		.data  = Bump_Push(bump, (umm)entry->size, PACK_ALIGNMENT),
+		.size  = entry->size,
+		.pack  = pack,
+		.entry = entry,
+	};
+
+	if (entry->block_count != 0) parallel_for(Pack_DecompressBlocks, asset, entry->block_count, 1, counter);
+
+	return asset;
+}
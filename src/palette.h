@@ -0,0 +1,106 @@
+// NOTE: Palette effects for the game. Named palettes are kept in a Palette_Bank, cycling and fades write their result
+//       into the platform's Palette through Palette_Set. An effect costs one pass over the entries it covers per
+//       frame, instead of recoloring pixels, and only the entries that changed get uploaded.
+//
+//       Like the intern table the bank lives on a Bump and does not keep it, so it can live in the persistent bump.
+//       Requires intern.h.
+
+typedef struct Palette_Bank
+{
+	Intern_Table names;
+	u32 (*colors)[AZUR_PALETTE_SIZE]; // NOTE: indexed by the String_ID of the name, colors[0] is unused
+	u32 capacity;
+} Palette_Bank;
+
+static void
+Palette_CreateBank(Palette_Bank* bank, Bump* bump, u32 capacity)
+{
+	Intern_Create(&bank->names, bump, capacity);
+
+	bank->colors   = Bump_Push(bump, (umm)(capacity + 1)*sizeof(bank->colors[0]), 8);
+	bank->capacity = capacity;
+}
+
+// NOTE: Adding a name that is already there replaces its colors. Entries past count are black. Returns 0 when the
+//       bank is full.
+static String_ID
+Palette_AddNamed(Palette_Bank* bank, Bump* bump, String name, u32* colors, u32 count)
+{
+	String_ID id = Intern_Find(&bank->names, name);
+
+	if (id == 0 && bank->names.count < bank->capacity) id = Intern_Add(&bank->names, bump, name);
+
+	if (id != 0)
+	{
+		if (count > AZUR_PALETTE_SIZE) count = AZUR_PALETTE_SIZE;
+
+		memcpy(bank->colors[id], colors, count*sizeof(u32));
+		memset(bank->colors[id] + count, 0, (AZUR_PALETTE_SIZE - count)*sizeof(u32));
+	}
+
+	return id;
+}
+
+static String_ID
+Palette_FindNamed(Palette_Bank* bank, String name)
+{
+	return Intern_Find(&bank->names, name);
+}
+
+// NOTE: 0 for ID 0, so a name that was not found reads as no palette
+static u32*
+Palette_Named(Palette_Bank* bank, String_ID id)
+{
+	ASSERT(id <= bank->names.count);
+	return (id != 0 ? bank->colors[id] : 0);
+}
+
+// NOTE: Rotates entries [first, first + count) of src by shift places, entry first + i gets src[first + (i - shift)
+//       mod count]. Shifting by elapsed time animates water, fire and the like without touching a single pixel.
+static void
+Palette_Cycle(Palette* palette, u32* src, u32 first, u32 count, s32 shift)
+{
+	if (first >= AZUR_PALETTE_SIZE || count == 0) return;
+	if (count > AZUR_PALETTE_SIZE - first) count = AZUR_PALETTE_SIZE - first;
+
+	u32 offset = (u32)(((s64)shift % count + count) % count);
+
+	u32 colors[AZUR_PALETTE_SIZE];
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 j = (i >= offset ? i - offset : i + count - offset);
+		colors[i] = src[first + j];
+	}
+
+	Palette_Set(palette, first, colors, count);
+}
+
+// NOTE: Blends entries [first, first + count) from one palette to another, t 0 gives from and t 1 gives to exactly.
+//       Channels are blended in 1/256 steps, so calling this every frame with a t that did not move changes nothing
+//       and uploads nothing.
+static void
+Palette_Fade(Palette* palette, u32* from, u32* to, u32 first, u32 count, f32 t)
+{
+	if (first >= AZUR_PALETTE_SIZE) return;
+	if (count > AZUR_PALETTE_SIZE - first) count = AZUR_PALETTE_SIZE - first;
+
+	u32 weight = (t <= 0 ? 0 : (t >= 1 ? 256 : (u32)(t*256 + 0.5f)));
+
+	u32 colors[AZUR_PALETTE_SIZE];
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 a = from[first + i];
+		u32 b = to[first + i];
+
+		u32 color = 0;
+		for (u32 shift = 0; shift < 24; shift += 8)
+		{
+			u32 channel = (((a >> shift) & 0xFF)*(256 - weight) + ((b >> shift) & 0xFF)*weight + 128) >> 8;
+			color |= channel << shift;
+		}
+
+		colors[i] = color;
+	}
+
+	Palette_Set(palette, first, colors, count);
+}
@@ -3,6 +3,7 @@
 #define NOMINMAX 1
 #define WIN32_LEAN_AND_MEAN 1
 #include <windows.h>
+#include <shellapi.h>
 #include <GL/gl.h>
 #include "vendor/opengl/wglext.h"
 #include "vendor/opengl/glcorearb.h"
@@ -11,13 +12,31 @@
 #undef NOMINMAX
 #undef WIN32_LEAN_AND_MEAN
 
+#include <stdio.h>
+
 #include "common.h"
+#include "os.h"
+#include "profile.h"
+#include "jobs.h"
+#include "blit.h"
+#include "intern.h"
+#include "atlas.h"
+#include "pack.h"
+#include "capture.h"
+#include "audio.h"
+#include "mixer.h"
+#include "timestep.h"
+#include "replay.h"
+#include "present.h"
+#include "rewind.h"
+#include "bumptrace.h"
+#include "framequeue.h"
 
 typedef struct Game_Code
 {
 	HMODULE module;
 	Game_Tick_Func* tick_func;
-	FILETIME timestamp;
+	wchar_t loaded_path[32];
 } Game_Code;
 
 struct
@@ -27,44 +46,78 @@ struct
 	HDC dc;
 	HGLRC gl_context;
 	GLuint backbuffer;
+	GLuint palette_texture;
 	GLuint vao;
 	GLuint pipeline;
 	GLuint vert_shader;
 	GLuint frag_shader;
 	Bump platform_bump;
-	Bump frame_bump;
+	Bump frame_bumps[2];
+	Framebuffer* framebuffer;
+	Palette* palette;
+	Atlas_Header* atlas;
+	Pack_Header* pack;
 	Game_Code game_code;
+	Bump capture_bump;
+	FILE* capture_file;
+	Capture capture;
+	bool capturing;
+	wchar_t* capture_path;
+	u32 sim_hz;
+	u32 fps_cap;
+	OS_Timer frame_timer;
+	wchar_t* profile_path;
+	Bump profile_bump;
+	Profiler* profiler;
+	u32 worker_count;
+	Job_System jobs;
+	Bump persistent_bump;
+	wchar_t* record_path;
+	FILE* record_file;
+	Replay_Recorder recorder;
+	wchar_t* replay_path;
+	Bump replay_bump;
+	Replay replay;
+	Bump rewind_bump;
+	Rewind rewind;
+	wchar_t* bump_trace_path;
+	wchar_t* audio_path;
+	FILE* audio_file;
+	Mixer mixer;
+	FILE* bump_trace_file;
+	Bump_Trace* bump_trace;
+
+	// NOTE: With --threaded the simulation thread runs the game and publishes frames through frame_queue, the main
+	//       thread presents them. sim_resync is set by the main thread while the window is minimized.
+	bool threaded;
+	Frame_Queue frame_queue;
+	OS_Thread sim_thread;
+	volatile u32 sim_resync;
+
+	// NOTE: written by WndProc, snapshotted into Platform_Link once per frame. viewport is x, y, width, height of the
+	//       framebuffer in the client area, in GL coordinates. With --threaded the snapshot is taken on the simulation
+	//       thread, input_lock keeps it from seeing half of a message.
+	volatile u32 input_lock;
+	u32 input_buttons;
+	u32 input_pressed;
+	u32 input_released;
+	s16 input_mouse_x;
+	s16 input_mouse_y;
+	s32 viewport[4];
+	volatile bool rewinding;
+
+	// NOTE: The reload watcher thread prepares the new module and publishes it through reload_game_code and
+	//       reload_ready, the main thread swaps it in at the next frame boundary and hands the old module back through
+	//       retired_game_code, which the watcher unloads before it publishes another one.
+	HANDLE reload_stop;
+	OS_Thread reload_thread;
+	Game_Code reload_game_code;
+	Game_Code retired_game_code;
+	volatile u32 reload_ready;
+	u32 reload_generation;
 	bool running;
 } Globals = {0};
 
-static bool
-Bump_Create(u32 capacity, Bump* bump)
-{
-	u8* memory = VirtualAlloc(0, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
-
-	*bump = (Bump){
-		.memory         = memory,
-		.cursor         = 0,
-		.capacity       = capacity,
-		.high_watermark = 0,
-	};
-
-	return (memory != 0);
-}
-
-static void
-Bump_Destroy(Bump* bump)
-{
-	VirtualFree(bump->memory, 0, MEM_RELEASE);
-	*bump = (Bump){0};
-}
-
-static void
-Bump_Clear(Bump* bump)
-{
-	bump->cursor = 0;
-}
-
 // NOTE: Based on the OpenGL context tutorial by Mārtiņš Možeiko
 //https://gist.github.com/mmozeiko/ed2ad27f75edf9c26053ce332a1f6647
 static bool
@@ -137,6 +190,17 @@ LoadWGLFunctions(PFNWGLCHOOSEPIXELFORMATARBPROC* wglChoosePixelFormatARB, PFNWGL
 	*wglChoosePixelFormatARB    = 0;
 	*wglCreateContextAttribsARB = 0;
 	*wglSwapIntervalEXT         = 0;
+
+	// NOTE: the wanted extensions are interned up front, every token of the extension string is then one hash lookup
+	//       instead of a compare against each name
+	Bump_Mark mark = Bump_GetMark(&Globals.platform_bump);
+
+	Intern_Table extensions;
+	Intern_Create(&extensions, &Globals.platform_bump, 3);
+	String_ID pixel_format   = Intern_Add(&extensions, &Globals.platform_bump, STRING("WGL_ARB_pixel_format"));
+	String_ID create_context = Intern_Add(&extensions, &Globals.platform_bump, STRING("WGL_ARB_create_context"));
+	String_ID swap_control   = Intern_Add(&extensions, &Globals.platform_bump, STRING("WGL_EXT_swap_control"));
+
 	for (char* scan = extension_string; *scan != 0; ++scan)
 	{
 		while (*scan == ' ') ++scan;
@@ -144,22 +208,26 @@ LoadWGLFunctions(PFNWGLCHOOSEPIXELFORMATARBPROC* wglChoosePixelFormatARB, PFNWGL
 
 		while (*scan != 0 && *scan != ' ') ++scan;
 
-		String extension_name = (String){ .data = (u8*)start, .len = (u32)(scan - start) };
+		String_ID extension = Intern_Find(&extensions, (String){ .data = (u8*)start, .len = (u32)(scan - start) });
 
-		if (String_Equal(extension_name, STRING("WGL_ARB_pixel_format")))
+		if (extension == pixel_format)
 		{
 			*wglChoosePixelFormatARB = (PFNWGLCHOOSEPIXELFORMATARBPROC)wglGetProcAddress("wglChoosePixelFormatARB");
 		}
-		else if (String_Equal(extension_name, STRING("WGL_ARB_create_context")))
+		else if (extension == create_context)
 		{
 			*wglCreateContextAttribsARB = (PFNWGLCREATECONTEXTATTRIBSARBPROC)wglGetProcAddress("wglCreateContextAttribsARB");
 		}
-		else if (String_Equal(extension_name, STRING("WGL_EXT_swap_control")))
+		else if (extension == swap_control)
 		{
 			*wglSwapIntervalEXT = (PFNWGLSWAPINTERVALEXTPROC)wglGetProcAddress("wglSwapIntervalEXT");
 		}
+
+		if (*scan == 0) break;
 	}
 
+	Bump_PopToMark(&Globals.platform_bump, mark);
+
 	if (!*wglChoosePixelFormatARB || !*wglCreateContextAttribsARB || !*wglSwapIntervalEXT)
 	{
 		//// ERROR
@@ -196,7 +264,9 @@ static void APIENTRY GLDebugMessageCallback(GLenum source, GLenum type, GLuint i
 	X(PFNGLDEBUGMESSAGECALLBACKPROC, glDebugMessageCallback ) \
 	X(PFNGLCREATETEXTURESPROC,       glCreateTextures       ) \
 	X(PFNGLTEXTUREPARAMETERIPROC,    glTextureParameteri    ) \
+	X(PFNGLTEXTURESTORAGE1DPROC,     glTextureStorage1D     ) \
 	X(PFNGLTEXTURESTORAGE2DPROC,     glTextureStorage2D     ) \
+	X(PFNGLTEXTURESUBIMAGE1DPROC,    glTextureSubImage1D    ) \
 	X(PFNGLTEXTURESUBIMAGE2DPROC,    glTextureSubImage2D    ) \
 	X(PFNGLCREATESHADERPROGRAMVPROC, glCreateShaderProgramv ) \
 	X(PFNGLGETPROGRAMIVPROC,         glGetProgramiv         ) \
@@ -205,7 +275,6 @@ static void APIENTRY GLDebugMessageCallback(GLenum source, GLenum type, GLuint i
 	X(PFNGLUSEPROGRAMSTAGESPROC,     glUseProgramStages     ) \
 	X(PFNGLBINDPROGRAMPIPELINEPROC,  glBindProgramPipeline  ) \
 	X(PFNGLBINDTEXTUREUNITPROC,      glBindTextureUnit      ) \
-	X(PFNGLUNIFORM4FVPROC,           glUniform4fv           ) \
 	X(PFNGLCREATEVERTEXARRAYSPROC,   glCreateVertexArrays   ) \
 	X(PFNGLBINDVERTEXARRAYPROC,      glBindVertexArray      ) \
 	X(PFNGLUSEPROGRAMPROC,           glUseProgram           ) \
@@ -297,19 +366,23 @@ InitializeOpenGL()
 }
 
 #define AZUR_GAME_DLL L"azur_game.dll"
-#define AZUR_GAME_LOADED_DLL L"azur_game_loaded.dll"
+#define AZUR_GAME_RELOAD_SETTLE_MS 10
+#define AZUR_GAME_RELOAD_TIMEOUT_MS 5000
 
+// NOTE: The module is loaded from a copy, so the linker can replace the original while it is in use. Every load gets
+//       its own copy, the previous one stays locked until it is unloaded. Does not unload anything, the caller decides
+//       when the old module goes.
 static bool
-LoadGameCode(Game_Code* game_code)
+LoadGameCode(Game_Code* game_code, u32 generation)
 {
 	bool succeeded = false;
 
-	if (game_code->module != 0) FreeLibrary(game_code->module);
 	*game_code = (Game_Code){0};
+	_snwprintf(game_code->loaded_path, sizeof(game_code->loaded_path)/sizeof(wchar_t), L"azur_game_loaded_%u.dll", generation);
 
-	if (CopyFileW(AZUR_GAME_DLL, AZUR_GAME_LOADED_DLL, FALSE))
+	if (CopyFileW(AZUR_GAME_DLL, game_code->loaded_path, FALSE))
 	{
-		HMODULE module = LoadLibraryW(AZUR_GAME_LOADED_DLL);
+		HMODULE module = LoadLibraryW(game_code->loaded_path);
 
 		if (module != 0)
 		{
@@ -317,25 +390,255 @@ LoadGameCode(Game_Code* game_code)
 
 			if (tick_func != 0)
 			{
-				*game_code = (Game_Code){
-					.module    = module,
-					.tick_func = tick_func,
-					.timestamp = {0},
-				};
-
-				WIN32_FILE_ATTRIBUTE_DATA attrs;
-				if (GetFileAttributesExW(AZUR_GAME_DLL, GetFileExInfoStandard, &attrs)) game_code->timestamp = attrs.ftLastWriteTime;
+				game_code->module    = module;
+				game_code->tick_func = tick_func;
 
 				succeeded = true;
 			}
 		}
 
 		if (!succeeded && module != 0) FreeLibrary(module);
+		if (!succeeded) DeleteFileW(game_code->loaded_path);
+	}
+
+	return succeeded;
+}
+
+static void
+UnloadGameCode(Game_Code* game_code)
+{
+	if (game_code->module != 0)
+	{
+		FreeLibrary(game_code->module);
+		DeleteFileW(game_code->loaded_path);
+	}
+
+	*game_code = (Game_Code){0};
+}
+
+// NOTE: The linker writes the DLL in several steps, each raising a change notification. Opening it without sharing
+//       only succeeds once nobody is writing it anymore.
+static bool
+WaitForGameCode(void)
+{
+	bool succeeded = false;
+
+	for (u32 waited = 0; waited < AZUR_GAME_RELOAD_TIMEOUT_MS && !succeeded; waited += AZUR_GAME_RELOAD_SETTLE_MS)
+	{
+		if (WaitForSingleObject(Globals.reload_stop, AZUR_GAME_RELOAD_SETTLE_MS) == WAIT_OBJECT_0) break;
+
+		HANDLE file = CreateFileW(AZUR_GAME_DLL, GENERIC_READ, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+			succeeded = true;
+		}
+	}
+
+	return succeeded;
+}
+
+static void
+ReloadWatcher(void* data)
+{
+	// NOTE: the directory is watched rather than the file, so replacing the file is noticed as well
+	HANDLE dir = CreateFileW(L".", FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING,
+	                         FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, 0);
+	HANDLE dir_event = CreateEventW(0, TRUE, FALSE, 0);
+
+	if (dir == INVALID_HANDLE_VALUE || dir_event == 0)
+	{
+		//// ERROR
+		// NOTE: the game keeps running, it just does not reload
+		if (dir != INVALID_HANDLE_VALUE) CloseHandle(dir);
+		if (dir_event != 0) CloseHandle(dir_event);
+		return;
+	}
+
+	DWORD buffer[1 << 10];
+
+	for (;;)
+	{
+		OVERLAPPED overlapped = { .hEvent = dir_event };
+		if (!ReadDirectoryChangesW(dir, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+		                           0, &overlapped, 0))
+		{
+			//// ERROR
+			break;
+		}
+
+		HANDLE events[2] = { Globals.reload_stop, dir_event };
+		if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0 + 1)
+		{
+			DWORD ignored;
+			CancelIo(dir);
+			GetOverlappedResult(dir, &overlapped, &ignored, TRUE);
+			break;
+		}
+
+		DWORD size;
+		if (!GetOverlappedResult(dir, &overlapped, &size, FALSE)) continue;
+
+		/// Look for the game module among the changed files
+		// NOTE: a size of 0 means the buffer overflowed and the changes are lost, reloading is the safe guess
+		bool changed = (size == 0);
+
+		for (DWORD offset = 0; offset < size; )
+		{
+			FILE_NOTIFY_INFORMATION* info = (FILE_NOTIFY_INFORMATION*)((u8*)buffer + offset);
+
+			umm name_length = info->FileNameLength/sizeof(wchar_t);
+			if (name_length == sizeof(AZUR_GAME_DLL)/sizeof(wchar_t) - 1 && _wcsnicmp(info->FileName, AZUR_GAME_DLL, name_length) == 0) changed = true;
+
+			if (info->NextEntryOffset == 0) break;
+			offset += info->NextEntryOffset;
+		}
+
+		if (!changed || !WaitForGameCode()) continue;
+
+		/// Prepare the new module
+		Globals.reload_generation += 1;
+
+		Game_Code game_code;
+		if (!LoadGameCode(&game_code, Globals.reload_generation))
+		{
+			//// ERROR
+			// NOTE: probably a broken build, keep running the old code until the next one
+			continue;
+		}
+
+		/// Wait for the previous module to be swapped in, then unload the one it replaced
+		while (Atomic_LoadAcquire32(&Globals.reload_ready)) Sleep(1);
+
+		UnloadGameCode(&Globals.retired_game_code);
+
+		Globals.reload_game_code = game_code;
+		Atomic_StoreRelease32(&Globals.reload_ready, 1);
+	}
+
+	CloseHandle(dir_event);
+	CloseHandle(dir);
+}
+
+#define AZUR_PACK L"azur.pack"
+
+// NOTE: A missing pack is not an error, the game checks platform_link->atlas before using it
+static bool
+MapPack(Pack_Header** pack)
+{
+	bool succeeded = false;
+
+	*pack = 0;
+
+	HANDLE file = CreateFileW(AZUR_PACK, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		succeeded = (GetLastError() == ERROR_FILE_NOT_FOUND);
+	}
+	else
+	{
+		LARGE_INTEGER size;
+		HANDLE mapping = 0;
+		void* view     = 0;
+
+		if (GetFileSizeEx(file, &size) && size.QuadPart != 0) mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+		if (mapping != 0) view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if (view != 0 && Pack_Validate(view, (u64)size.QuadPart))
+		{
+			*pack     = view;
+			succeeded = true;
+		}
+		else if (view != 0)
+		{
+			UnmapViewOfFile(view);
+		}
+
+		// NOTE: the view keeps the mapping alive
+		if (mapping != 0) CloseHandle(mapping);
+		CloseHandle(file);
 	}
 
 	return succeeded;
 }
 
+static Pack_Asset*
+LoadAsset(String name, Bump* bump, Job_Counter* counter)
+{
+	return Pack_Load(Globals.pack, name, bump, Jobs_ParallelFor, counter);
+}
+
+static u32
+MapKey(WPARAM key)
+{
+	u32 button = 0;
+
+	if      (key == VK_LEFT  || key == 'A') button = INPUT_LEFT;
+	else if (key == VK_RIGHT || key == 'D') button = INPUT_RIGHT;
+	else if (key == VK_UP    || key == 'W') button = INPUT_UP;
+	else if (key == VK_DOWN  || key == 'S') button = INPUT_DOWN;
+	else if (key == VK_SPACE || key == 'Z') button = INPUT_A;
+	else if (key == 'X')                    button = INPUT_B;
+	else if (key == VK_RETURN)              button = INPUT_START;
+
+	return button;
+}
+
+static void
+LockInput(void)
+{
+	while (!Atomic_CompareExchange32(&Globals.input_lock, 0, 1)) _mm_pause();
+}
+
+static void
+UnlockInput(void)
+{
+	Atomic_StoreRelease32(&Globals.input_lock, 0);
+}
+
+static void
+SetButtons(u32 buttons, bool down)
+{
+	LockInput();
+
+	u32 changed = (down ? buttons & ~Globals.input_buttons : buttons & Globals.input_buttons);
+
+	if (down)
+	{
+		Globals.input_buttons |= buttons;
+		Globals.input_pressed |= changed;
+	}
+	else
+	{
+		Globals.input_buttons  &= ~buttons;
+		Globals.input_released |= changed;
+	}
+
+	UnlockInput();
+}
+
+static void
+SetMousePosition(HWND window, LPARAM lparam)
+{
+	s32* viewport = Globals.viewport;
+	if (viewport[2] == 0 || viewport[3] == 0) return;
+
+	RECT client_rect;
+	GetClientRect(window, &client_rect);
+
+	// NOTE: the viewport has y going up from the bottom of the client area, window messages have it going down
+	s32 x = (s16)(lparam & 0xFFFF);
+	s32 y = (client_rect.bottom - client_rect.top) - 1 - (s16)((lparam >> 16) & 0xFFFF);
+
+	s32 fb_x = (x - viewport[0])*AZUR_WIDTH/viewport[2];
+	s32 fb_y = (AZUR_HEIGHT - 1) - (y - viewport[1])*AZUR_HEIGHT/viewport[3];
+
+	LockInput();
+	Globals.input_mouse_x = (s16)(fb_x < S16_MIN ? S16_MIN : (fb_x > S16_MAX ? S16_MAX : fb_x));
+	Globals.input_mouse_y = (s16)(fb_y < S16_MIN ? S16_MIN : (fb_y > S16_MAX ? S16_MAX : fb_y));
+	UnlockInput();
+}
+
 static LRESULT
 WndProc(HWND window, UINT msg_code, WPARAM wparam, LPARAM lparam)
 {
@@ -344,10 +647,66 @@ WndProc(HWND window, UINT msg_code, WPARAM wparam, LPARAM lparam)
 		Globals.running = false;
 		return 0;
 	}
+	else if (msg_code == WM_KEYDOWN || msg_code == WM_KEYUP || msg_code == WM_SYSKEYDOWN || msg_code == WM_SYSKEYUP)
+	{
+		// NOTE: key repeats only keep the button down, pressed is set once per press
+		u32 button = MapKey(wparam);
+		if (wparam == VK_BACK)
+		{
+			Globals.rewinding = (msg_code == WM_KEYDOWN || msg_code == WM_SYSKEYDOWN);
+			return 0;
+		}
+		else if (button != 0)
+		{
+			SetButtons(button, (msg_code == WM_KEYDOWN || msg_code == WM_SYSKEYDOWN));
+			return 0;
+		}
+	}
+	else if (msg_code == WM_KILLFOCUS)
+	{
+		// NOTE: the key up of anything held while focus leaves goes to another window
+		SetButtons(Globals.input_buttons, false);
+		Globals.rewinding = false;
+	}
+	else if (msg_code == WM_MOUSEMOVE || msg_code == WM_LBUTTONDOWN || msg_code == WM_LBUTTONUP ||
+	         msg_code == WM_RBUTTONDOWN || msg_code == WM_RBUTTONUP)
+	{
+		SetMousePosition(window, lparam);
+
+		if      (msg_code == WM_LBUTTONDOWN) SetButtons(INPUT_MOUSE_LEFT,  true);
+		else if (msg_code == WM_LBUTTONUP)   SetButtons(INPUT_MOUSE_LEFT,  false);
+		else if (msg_code == WM_RBUTTONDOWN) SetButtons(INPUT_MOUSE_RIGHT, true);
+		else if (msg_code == WM_RBUTTONUP)   SetButtons(INPUT_MOUSE_RIGHT, false);
+
+		return 0;
+	}
 
 	return DefWindowProcW(window, msg_code, wparam, lparam);
 }
 
+// NOTE: pressed and released keep accumulating until a frame simulates, see Platform_Input
+static void
+SnapshotInput(Platform_Input* input, u32 sim_steps)
+{
+	LockInput();
+
+	*input = (Platform_Input){
+		.buttons  = Globals.input_buttons,
+		.pressed  = Globals.input_pressed,
+		.released = Globals.input_released,
+		.mouse_x  = Globals.input_mouse_x,
+		.mouse_y  = Globals.input_mouse_y,
+	};
+
+	if (sim_steps != 0)
+	{
+		Globals.input_pressed  = 0;
+		Globals.input_released = 0;
+	}
+
+	UnlockInput();
+}
+
 static void
 FatalError(const char* message)
 {
@@ -360,15 +719,129 @@ Setup_Error(const char* message)
 	MessageBoxA(Globals.window, message, "Azur Setup Failed", MB_OK | MB_ICONERROR);
 }
 
+static void
+ParseArguments_Error(void)
+{
+	MessageBoxA(0,
+	            "Usage: azur.exe [--sim-hz N] [--fps N] [--workers N] [--capture PATH] [--profile PATH] [--record PATH] [--replay PATH] [--bump-trace PATH] [--audio PATH] [--threaded]\n"
+	            "  --sim-hz N      fixed simulation rate (default 60)\n"
+	            "  --fps N         disable vsync and pace presentation to N frames per second\n"
+	            "  --workers N     job system threads including the main thread (default one per logical processor)\n"
+	            "  --capture PATH  stream presented frames to an animated GIF\n"
+	            "  --profile PATH  write a Chrome trace of the profiled zones to PATH on exit\n"
+	            "  --record PATH   record the session, input and frame hashes, to PATH\n"
+	            "  --replay PATH   replay a recorded session as fast as possible without vsync, then report and exit\n"
+	            "  --bump-trace PATH  write every frame's pushes to the platform, frame and persistent bumps, by arena and\n"
+	            "                  call site, to PATH, needs a build with AZUR_BUMP_TRACE\n"
+	            "  --audio PATH    write the mixed audio to a WAV file as it plays, in real time (default: mix into nothing)\n"
+	            "  --threaded      simulate on a thread of its own, at most one frame ahead of presentation, not with --replay",
+	            "Azur Setup Failed", MB_OK | MB_ICONERROR);
+}
+
+static bool
+ParseArguments(void)
+{
+	Globals.sim_hz       = TIMESTEP_DEFAULT_HZ;
+	Globals.fps_cap      = 0;
+	Globals.capture_path = 0;
+	Globals.profile_path = 0;
+	Globals.record_path  = 0;
+	Globals.replay_path  = 0;
+	Globals.worker_count = 0;
+	Globals.bump_trace_path = 0;
+	Globals.audio_path      = 0;
+	Globals.threaded        = false;
+
+	int argc;
+	wchar_t** argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (argv == 0) return false;
+
+	// NOTE: argv is never freed, capture_path points into it
+	for (int i = 1; i < argc; ++i)
+	{
+		bool has_value = (i + 1 < argc);
+
+		if      (wcscmp(argv[i], L"--sim-hz")  == 0 && has_value) Globals.sim_hz       = wcstoul(argv[++i], 0, 10);
+		else if (wcscmp(argv[i], L"--fps")     == 0 && has_value) Globals.fps_cap      = wcstoul(argv[++i], 0, 10);
+		else if (wcscmp(argv[i], L"--workers") == 0 && has_value) Globals.worker_count = wcstoul(argv[++i], 0, 10);
+		else if (wcscmp(argv[i], L"--capture") == 0 && has_value) Globals.capture_path = argv[++i];
+		else if (wcscmp(argv[i], L"--profile") == 0 && has_value) Globals.profile_path = argv[++i];
+		else if (wcscmp(argv[i], L"--record")  == 0 && has_value) Globals.record_path  = argv[++i];
+		else if (wcscmp(argv[i], L"--replay")  == 0 && has_value) Globals.replay_path  = argv[++i];
+		else if (wcscmp(argv[i], L"--bump-trace") == 0 && has_value) Globals.bump_trace_path = argv[++i];
+		else if (wcscmp(argv[i], L"--audio")      == 0 && has_value) Globals.audio_path      = argv[++i];
+		else if (wcscmp(argv[i], L"--threaded") == 0)                Globals.threaded        = true;
+		else return false;
+	}
+
+	// NOTE: a replay runs frames back to back as fast as it can, there is nothing for a second thread to overlap
+	return (Globals.sim_hz != 0 && Globals.sim_hz <= TIMESTEP_MAX_HZ && Globals.fps_cap <= TIMESTEP_MAX_HZ &&
+	        Globals.worker_count <= JOBS_MAX_WORKERS && !(Globals.threaded && Globals.replay_path != 0));
+}
+
 static bool
 Setup(HINSTANCE instance)
 {
 	Globals.instance = instance;
 
-	if (!Bump_Create(1 << 20, &Globals.platform_bump) || !Bump_Create(1 << 20, &Globals.frame_bump))
+	if (!ParseArguments())
+	{
+		//// ERROR
+		ParseArguments_Error();
+		return false;
+	}
+
+	if (!OS_CreateTimer(&Globals.frame_timer))
+	{
+		//// ERROR
+		Setup_Error("Failed to create frame timer");
+		return false;
+	}
+
+	if (!Bump_Create(1ULL << 26, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.platform_bump) ||
+	    !Bump_Create(1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.frame_bumps[0]) ||
+	    !Bump_Create(1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.frame_bumps[1]) ||
+	    (!Bump_CreateAt(AZUR_PERSISTENT_BASE, 1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.persistent_bump) &&
+	     !Bump_Create(1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.persistent_bump)))
+	{
+		//// ERROR
+		return false;
+	}
+
+	if (Globals.bump_trace_path != 0)
 	{
+#ifdef AZUR_BUMP_TRACE
+		Globals.bump_trace_file = _wfopen(Globals.bump_trace_path, L"wb");
+		if (Globals.bump_trace_file == 0)
+		{
+			//// ERROR
+			Setup_Error("Failed to open bump trace");
+			return false;
+		}
+
+		// NOTE: from here on everything pushed to the arenas is traced, up to the first frame it counts as setup
+		Globals.bump_trace = Bump_TraceCreate(&Globals.platform_bump, Globals.bump_trace_file);
+		Bump_TraceAttach(Globals.bump_trace, &Globals.platform_bump,   "platform_bump");
+		Bump_TraceAttach(Globals.bump_trace, &Globals.frame_bumps[0],  "frame_bumps");
+		Bump_TraceAttach(Globals.bump_trace, &Globals.frame_bumps[1],  "frame_bumps");
+		Bump_TraceAttach(Globals.bump_trace, &Globals.persistent_bump, "persistent_bump");
+#else
 		//// ERROR
+		Setup_Error("Bumps are only traced in builds with AZUR_BUMP_TRACE, build with build.bat trace");
 		return false;
+#endif
+	}
+
+	{ /// Allocate framebuffer
+		Globals.framebuffer = Bump_Push(&Globals.platform_bump, sizeof(Framebuffer), 64);
+
+		u8* b = &Globals.framebuffer->pixels[0][0];
+		for (umm i = 0; i < AZUR_WIDTH*AZUR_HEIGHT; ++i) b[i] = (u8)i;
+
+		Framebuffer_MarkAll(Globals.framebuffer);
+
+		Globals.palette = Bump_Push(&Globals.platform_bump, sizeof(Palette), 64);
+		Palette_Init(Globals.palette);
 	}
 
 	{ /// Set working directory
@@ -454,7 +927,8 @@ Setup(HINSTANCE instance)
 		glDisable(GL_DEPTH_TEST);
 		glDisable(GL_CULL_FACE);
 
-		wglSwapIntervalEXT(1);
+		// NOTE: with a frame cap presentation is paced by the frame timer instead of vsync, replays are not paced at all
+		wglSwapIntervalEXT(Globals.fps_cap != 0 || Globals.replay_path != 0 ? 0 : 1);
 
 		glCreateTextures(GL_TEXTURE_2D, 1, &Globals.backbuffer);
 		glTextureParameteri(Globals.backbuffer, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -464,6 +938,11 @@ Setup(HINSTANCE instance)
 
 		glTextureStorage2D(Globals.backbuffer, 1, GL_R8UI, AZUR_WIDTH, AZUR_HEIGHT);
 
+		glCreateTextures(GL_TEXTURE_1D, 1, &Globals.palette_texture);
+		glTextureParameteri(Globals.palette_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(Globals.palette_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureStorage1D(Globals.palette_texture, 1, GL_RGBA8, AZUR_PALETTE_SIZE);
+
 		glCreateVertexArrays(1, &Globals.vao);
 
 		const char* vert_shader_code =
@@ -472,7 +951,7 @@ Setup(HINSTANCE instance)
 			"out vec2 uv;\n"
 			"void main() {\n"
 			"	vec2 pos = vec2(gl_VertexID >> 1, (gl_VertexID == 0 ? 1 : 0));\n"
-			"	uv = pos;\n"
+			"	uv = 2*pos;\n"
 			"	gl_Position = vec4(vec2(4, -4)*pos + vec2(-1, 1), 0, 1);\n"
 			"}\n"
 		;
@@ -481,11 +960,11 @@ Setup(HINSTANCE instance)
 			"#version 450 core\n"
 			"in vec2 uv;\n"
 			"layout (binding=0) uniform usampler2D backbuffer;\n"
-			"layout (location=0) uniform vec4 color_lut[8];\n"
+			"layout (binding=1) uniform sampler1D palette;\n"
 			"layout (location=0) out vec4 color;\n"
 			"void main() {\n"
 			" uint index = texture(backbuffer, uv).r;\n"
-			"	color = color_lut[index & 0x7];\n"
+			"	color = vec4(texelFetch(palette, int(index), 0).rgb, 1);\n"
 			"}\n"
 		;
 
@@ -522,16 +1001,309 @@ Setup(HINSTANCE instance)
 		glUseProgramStages(Globals.pipeline, GL_FRAGMENT_SHADER_BIT, Globals.frag_shader);
 	}
 
-	if (!LoadGameCode(&Globals.game_code))
+	if (!MapPack(&Globals.pack))
+	{
+		//// ERROR
+		Setup_Error("Failed to map asset pack");
+		return false;
+	}
+
+	if (Globals.profile_path != 0)
+	{
+#ifdef AZUR_PROFILING
+		if (!Bump_Create(Profile_MemorySize(), BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.profile_bump))
+		{
+			//// ERROR
+			Setup_Error("Failed to allocate profiler");
+			return false;
+		}
+
+		Globals.profiler = Profile_Create(&Globals.profile_bump, OS_EstimateTSCFrequency(), Profile_GetThread);
+
+		// NOTE: the capture worker registers itself when it starts, so this has to happen before capture is started
+		PROFILE_ATTACH(Globals.profiler);
+		PROFILE_THREAD("main");
+#else
+		//// ERROR
+		Setup_Error("Profiling is compiled out, build with AZUR_DEBUG or AZUR_PROFILE defined");
+		return false;
+#endif
+	}
+
+	{ /// Start job system
+		u32 worker_count = Globals.worker_count;
+		if (worker_count == 0) worker_count = OS_GetProcessorCount();
+		if (worker_count > JOBS_MAX_WORKERS) worker_count = JOBS_MAX_WORKERS;
+
+		if (!Jobs_Create(&Globals.jobs, &Globals.platform_bump, worker_count))
+		{
+			//// ERROR
+			Setup_Error("Failed to start job system");
+			return false;
+		}
+	}
+
+	if (Globals.pack != 0)
+	{ /// Load what the first frame needs, everything else is up to the game
+		Job_Counter counter = {0};
+		Pack_Asset* atlas = Pack_Load(Globals.pack, STRING("atlas"), &Globals.platform_bump, Jobs_ParallelFor, &counter);
+		Jobs_Wait(&counter);
+
+		if (atlas != 0 && (atlas->failed || !Atlas_Validate(atlas->data, atlas->size)))
+		{
+			//// ERROR
+			Setup_Error("Failed to load sprite atlas");
+			return false;
+		}
+
+		Globals.atlas = (atlas != 0 ? (Atlas_Header*)atlas->data : 0);
+	}
+
+	if (Globals.capture_path != 0)
+	{
+		Globals.capture_file = _wfopen(Globals.capture_path, L"wb");
+
+		if (Globals.capture_file == 0 || !Bump_Create(1ULL << 26, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.capture_bump) ||
+		    !Capture_Start(&Globals.capture, &Globals.capture_bump, Globals.capture_file, Globals.palette->colors))
+		{
+			//// ERROR
+			Setup_Error("Failed to start capture");
+			return false;
+		}
+
+		Globals.capturing = true;
+	}
+
+	{ /// Start audio
+		// NOTE: there is no device sink yet, without a file the mixer runs against the null sink on the clock a device
+		//       would have, so the game's commands are mixed and timed the same either way
+		if (Globals.audio_path != 0) Globals.audio_file = _wfopen(Globals.audio_path, L"wb");
+
+		if ((Globals.audio_path != 0 && Globals.audio_file == 0) ||
+		    !Mixer_Start(&Globals.mixer, &Globals.platform_bump, Globals.audio_file))
+		{
+			//// ERROR
+			Setup_Error("Failed to start audio");
+			return false;
+		}
+	}
+
+	if (Globals.replay_path != 0)
+	{
+		FILE* file = _wfopen(Globals.replay_path, L"rb");
+
+		bool succeeded = (file != 0 && Bump_Create(1ULL << 36, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.replay_bump) &&
+		                  Replay_Load(&Globals.replay, file, &Globals.replay_bump) && Globals.replay.frame_count != 0 &&
+		                  Replay_Restore(&Globals.replay, &Globals.persistent_bump, Globals.framebuffer, Globals.palette));
+
+		if (file != 0) fclose(file);
+
+		if (!succeeded)
+		{
+			//// ERROR
+			Setup_Error("Failed to load replay");
+			return false;
+		}
+
+		Globals.sim_hz = Globals.replay.header->sim_hz;
+	}
+
+	if (Globals.record_path != 0)
+	{
+		u64 start_tick = (Globals.replay_path != 0 ? Globals.replay.tick : 0);
+
+		Globals.record_file = _wfopen(Globals.record_path, L"wb");
+
+		if (Globals.record_file == 0 ||
+		    !Replay_StartRecording(&Globals.recorder, Globals.record_file, Globals.sim_hz, start_tick, &Globals.persistent_bump, Globals.framebuffer,
+		                           Globals.palette))
+		{
+			//// ERROR
+			Setup_Error("Failed to start recording");
+			return false;
+		}
+	}
+
+	if (Globals.threaded)
+	{
+		// NOTE: the main thread presents from copies of its own, they start out as the frame the game starts from
+		Framebuffer* framebuffer = Bump_Push(&Globals.platform_bump, sizeof(Framebuffer), 64);
+		Palette* palette         = Bump_Push(&Globals.platform_bump, sizeof(Palette), 64);
+		memcpy(framebuffer, Globals.framebuffer, sizeof(Framebuffer));
+		memcpy(palette, Globals.palette, sizeof(Palette));
+
+		if (!FrameQueue_Create(&Globals.frame_queue, &Globals.platform_bump, framebuffer, palette))
+		{
+			//// ERROR
+			Setup_Error("Failed to create frame queue");
+			return false;
+		}
+	}
+
+	// NOTE: stepping back would make a recording or replay disagree with what it recorded, so neither can rewind
+	if (Globals.record_path == 0 && Globals.replay_path == 0)
+	{
+		u64 ring_size = 64ULL << 20;
+
+		Rewind_Region regions[] = {
+			{ Globals.persistent_bump.memory,     Globals.persistent_bump.reserved },
+			{ &Globals.framebuffer->pixels[0][0], sizeof(Globals.framebuffer->pixels) },
+			{ (u8*)Globals.palette->colors,       sizeof(Globals.palette->colors) },
+		};
+
+		if (!Bump_Create(ring_size + REWIND_MAX_FRAMES*sizeof(Rewind_Frame) + 64, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.rewind_bump) ||
+		    !Rewind_Create(&Globals.rewind, &Globals.rewind_bump, ring_size, regions, sizeof(regions)/sizeof(regions[0])))
+		{
+			//// ERROR
+			Setup_Error("Failed to allocate the rewind buffer");
+			return false;
+		}
+	}
+
+	if (!LoadGameCode(&Globals.game_code, 0))
 	{
 		//// ERROR
 		Setup_Error("Failed to load game code");
 		return false;
 	}
 
+	Globals.reload_stop = CreateEventW(0, TRUE, FALSE, 0);
+	if (Globals.reload_stop == 0 || !OS_CreateThread(&Globals.reload_thread, ReloadWatcher, 0))
+	{
+		//// ERROR
+		Setup_Error("Failed to watch game code");
+		return false;
+	}
+
 	return true;
 }
 
+static void
+WriteToFile(void* context, u8* data, umm size)
+{
+	fwrite(data, 1, size, context);
+}
+
+// NOTE: Simulates and draws a frame, or steps back one while backspace is held, on the main thread or with --threaded
+//       on the simulation thread. Returns the time spent hashing the frame, which replays leave out of frame times.
+static u64
+SimulateFrame(Platform_Link* platform_link, Timestep* timestep, u64 frame_start, u64 replay_frame)
+{
+	u64 hash_time = 0;
+
+	// NOTE: holding backspace steps the game back one frame per frame instead of simulating one
+	if (Globals.rewinding && Globals.rewind.ring != 0)
+	{
+		PROFILE_BEGIN(RewindStepBack);
+		u64 sizes[REWIND_MAX_REGIONS];
+		if (Rewind_StepBack(&Globals.rewind, sizes))
+		{
+			Globals.persistent_bump.cursor = sizes[0];
+			Framebuffer_MarkAll(Globals.framebuffer);
+			Palette_MarkRange(Globals.palette, 0, AZUR_PALETTE_SIZE);
+		}
+		PROFILE_END(RewindStepBack);
+
+		// NOTE: the game picks up from where it was stepped back to when backspace is let go, without catching up
+		Timestep_Resync(timestep, frame_start);
+	}
+	else
+	{
+		if (Globals.replay_path != 0)
+		{
+			Replay_ApplyFrame(&Globals.replay, replay_frame, platform_link);
+		}
+		else
+		{
+			Timestep_Advance(timestep, frame_start, platform_link);
+			SnapshotInput(&platform_link->input, platform_link->sim_steps);
+		}
+
+		{ /// Swap frame arenas
+			Bump* frame_bump = platform_link->prev_frame_bump;
+			platform_link->prev_frame_bump = platform_link->frame_bump;
+			platform_link->frame_bump      = frame_bump;
+
+			Bump_ResetFrame(frame_bump);
+		}
+
+		platform_link->reloaded = false;
+		if (Atomic_LoadAcquire32(&Globals.reload_ready))
+		{
+			Globals.retired_game_code = Globals.game_code;
+			Globals.game_code         = Globals.reload_game_code;
+			Atomic_StoreRelease32(&Globals.reload_ready, 0);
+
+			platform_link->reloaded = true;
+		}
+
+		PROFILE_BEGIN(Tick);
+		Globals.game_code.tick_func(platform_link);
+		PROFILE_END(Tick);
+
+		if (Globals.replay_path != 0 || Globals.record_path != 0)
+		{
+			u64 hash_start = OS_GetTimeNS();
+
+			if (Globals.replay_path != 0) Replay_CheckFrame(&Globals.replay, replay_frame, Globals.framebuffer, Globals.palette);
+			if (Globals.record_path != 0) Replay_RecordFrame(&Globals.recorder, platform_link);
+
+			hash_time = OS_GetTimeNS() - hash_start;
+		}
+
+		if (Globals.capturing)
+		{
+			PROFILE_BEGIN(CaptureSubmit);
+			Capture_Submit(&Globals.capture, Globals.framebuffer, Globals.palette, OS_GetTimeNS());
+			PROFILE_END(CaptureSubmit);
+		}
+
+		if (Globals.rewind.ring != 0)
+		{
+			PROFILE_BEGIN(RewindCapture);
+			u64 sizes[] = { Globals.persistent_bump.cursor, sizeof(Globals.framebuffer->pixels), sizeof(Globals.palette->colors) };
+			Rewind_Capture(&Globals.rewind, sizes);
+			PROFILE_END(RewindCapture);
+		}
+	}
+
+	// NOTE: everything that pushes to the traced bumps runs on this thread, and nothing does while the trace is written
+	if (Globals.bump_trace != 0) Bump_TraceFrame(Globals.bump_trace);
+
+	return hash_time;
+}
+
+// NOTE: With --threaded the game runs here, at most one frame ahead of the main thread presenting what it draws
+static void
+SimulationThread(void* data)
+{
+	Platform_Link* platform_link = data;
+	Frame_Queue* queue = &Globals.frame_queue;
+
+	PROFILE_THREAD("simulation");
+
+	// NOTE: the game submits jobs from here now, the main thread only presents
+	Jobs_TakeOverMainWorker(&Globals.jobs);
+
+	Timestep timestep;
+	Timestep_Init(&timestep, Globals.sim_hz, OS_GetTimeNS());
+
+	while (FrameQueue_WaitTaken(queue))
+	{
+		// NOTE: set while the window was minimized, the game picks up where it left off instead of catching up
+		if (Atomic_Exchange32(&Globals.sim_resync, 0)) Timestep_Resync(&timestep, OS_GetTimeNS());
+
+		SimulateFrame(platform_link, &timestep, OS_GetTimeNS(), 0);
+
+		PROFILE_BEGIN(Publish);
+		FrameQueue_Publish(queue, Globals.framebuffer, Globals.palette, timestep.tick);
+		PROFILE_END(Publish);
+
+		Framebuffer_ClearDirty(Globals.framebuffer);
+		Palette_ClearDirty(Globals.palette);
+	}
+}
+
 int WINAPI
 wWinMain(HINSTANCE instance, HINSTANCE prev_instance, PWSTR cmdline, int cmdshow)
 {
@@ -544,9 +1316,49 @@ wWinMain(HINSTANCE instance, HINSTANCE prev_instance, PWSTR cmdline, int cmdshow
 
 	ShowWindow(Globals.window, SW_SHOW);
 
+	Platform_Link platform_link = {
+		.frame_bump      = &Globals.frame_bumps[0],
+		.prev_frame_bump = &Globals.frame_bumps[1],
+		.persistent_bump = &Globals.persistent_bump,
+		.framebuffer     = Globals.framebuffer,
+		.palette         = Globals.palette,
+		.atlas           = Globals.atlas,
+		.pack            = Globals.pack,
+		.profiler        = Globals.profiler,
+		.audio           = &Globals.mixer.queue,
+
+		.worker_count     = Globals.jobs.worker_count,
+		.job_submit       = Jobs_Submit,
+		.job_parallel_for = Jobs_ParallelFor,
+		.job_wait         = Jobs_Wait,
+		.pack_load        = LoadAsset,
+	};
+
+	Timestep timestep;
+	Timestep_Init(&timestep, Globals.sim_hz, OS_GetTimeNS());
+
+	u64 frame_period = (Globals.fps_cap != 0 && Globals.replay_path == 0 ? 1000000000ULL/Globals.fps_cap : 0);
+	u64 next_frame   = OS_GetTimeNS();
+
+	if (Globals.bump_trace != 0) Bump_TraceFrame(Globals.bump_trace);
+
+	if (Globals.threaded && !OS_CreateThread(&Globals.sim_thread, SimulationThread, &platform_link))
+	{
+		//// ERROR
+		FatalError("Failed to start simulation thread");
+		return 1;
+	}
+
+	u64 replay_frame      = 0;
+	u64 replay_time_total = 0;
+	u64 replay_time_max   = 0;
+
 	Globals.running = true;
 	while (Globals.running)
 	{
+		PROFILE_FRAME_MARK();
+
+		// NOTE: messages are pumped right before simulating, so the newest input makes it into this frame
 		for (MSG msg; PeekMessageW(&msg, 0, 0, 0, PM_REMOVE); )
 		{
 			TranslateMessage(&msg);
@@ -560,54 +1372,199 @@ wWinMain(HINSTANCE instance, HINSTANCE prev_instance, PWSTR cmdline, int cmdshow
 
 		if (client_width == 0 || client_height == 0)
 		{
-			// NOTE: window is minimized
-			// TODO: pause game?
-			Sleep(16);
+			// NOTE: window is minimized, the game is paused and picks up where it left off when restored
+			OS_WaitUntilNS(&Globals.frame_timer, OS_GetTimeNS() + timestep.step_ns);
+			Timestep_Resync(&timestep, OS_GetTimeNS());
+
+			// NOTE: the simulation thread waits for the frame it published to be taken meanwhile
+			if (Globals.threaded) Atomic_StoreRelease32(&Globals.sim_resync, 1);
 		}
 		else
 		{
-			umm mw = client_width/16;
-			umm mh = client_height/9;
-			umm m = (mh < mw ? mh : mw);
+			// NOTE: shared with the CPU presenter, so both put the picture in the same place
+			Present_Viewport(client_width, client_height, Globals.viewport);
 
-			glViewport((GLint)(client_width - m*16)/2, (GLint)(client_height - m*9)/2, (GLsizei)m*16, (GLsizei)m*9);
+			glViewport(Globals.viewport[0], Globals.viewport[1], Globals.viewport[2], Globals.viewport[3]);
 
 			glClearColor(1, 0, 1, 1);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-			u8 b[AZUR_WIDTH*AZUR_HEIGHT] = {0};
-			for (umm i = 0; i < sizeof(b); ++i) b[i] = (u8)i;
-			glTextureSubImage2D(Globals.backbuffer, 0, 0, 0, AZUR_WIDTH, AZUR_HEIGHT, GL_RED_INTEGER, GL_UNSIGNED_BYTE, b);
+			u64 frame_start = OS_GetTimeNS();
+
+			Framebuffer* framebuffer = Globals.framebuffer;
+			Palette* palette         = Globals.palette;
+
+			if (Globals.threaded)
+			{
+				// NOTE: the texture is uploaded from the main thread's copy of the newest frame the simulation thread drew
+				PROFILE_BEGIN(TakeFrame);
+				FrameQueue_Take(&Globals.frame_queue);
+				PROFILE_END(TakeFrame);
+
+				framebuffer = Globals.frame_queue.framebuffer;
+				palette     = Globals.frame_queue.palette;
+			}
+			else
+			{
+				// NOTE: hashing is left out of the replay frame times
+				frame_start += SimulateFrame(&platform_link, &timestep, frame_start, replay_frame);
+			}
+
+			{ /// Upload dirty rows
+				PROFILE_BEGIN(Upload);
+
+				// NOTE: static frames upload nothing, the texture still holds the rows presented last time
+				for (u32 row = 0, row_count = 0; Framebuffer_NextDirtySpan(framebuffer, &row, &row_count); row += row_count)
+				{
+					glTextureSubImage2D(Globals.backbuffer, 0, 0, (GLint)row, AZUR_WIDTH, (GLsizei)row_count, GL_RED_INTEGER, GL_UNSIGNED_BYTE, framebuffer->pixels[row]);
+				}
+
+				Framebuffer_ClearDirty(framebuffer);
+
+				// NOTE: colors go up as one span from the first to the last changed entry
+				if (palette->dirty_end > palette->dirty_first)
+				{
+					glTextureSubImage1D(Globals.palette_texture, 0, (GLint)palette->dirty_first, (GLsizei)(palette->dirty_end - palette->dirty_first),
+					                    GL_BGRA, GL_UNSIGNED_BYTE, palette->colors + palette->dirty_first);
+				}
+
+				Palette_ClearDirty(palette);
+				PROFILE_END(Upload);
+			}
 
 			glUseProgram(0);
 			glBindProgramPipeline(Globals.pipeline);
 			glActiveShaderProgram(Globals.pipeline, Globals.frag_shader);
 			glBindTextureUnit(0, Globals.backbuffer);
+			glBindTextureUnit(1, Globals.palette_texture);
 			glBindVertexArray(Globals.vao);
 
+			glDrawArrays(GL_TRIANGLES, 0, 3);
 
-			#define HEX_TO_RGBA_TRIPLET(HEX) { (((HEX) >> 16) & 0xFF)/255.0f, (((HEX) >> 8) & 0xFF)/255.0f, (((HEX) >> 0) & 0xFF)/255.0f, 1 }
-			f32 lut[8][4] = {
-				HEX_TO_RGBA_TRIPLET(0x000000),
-				HEX_TO_RGBA_TRIPLET(0x555555),
-				HEX_TO_RGBA_TRIPLET(0x7C34F4),
-				HEX_TO_RGBA_TRIPLET(0x54DFBB),
-				HEX_TO_RGBA_TRIPLET(0xFFFFFF),
-				HEX_TO_RGBA_TRIPLET(0xFFCDE2),
-				HEX_TO_RGBA_TRIPLET(0xFE7FB8),
-				HEX_TO_RGBA_TRIPLET(0xFFF48D),
-			};
+			PROFILE_BEGIN(Present);
 
-			glUniform4fv(0, 8, &lut[0][0]);
-			glDrawArrays(GL_TRIANGLES, 0, 3);
+			if (frame_period != 0)
+			{
+				// NOTE: a frame that missed its deadline starts the schedule over instead of rushing the next ones
+				next_frame += frame_period;
+				u64 now = OS_GetTimeNS();
+				if (next_frame < now) next_frame = now;
+				else                  OS_WaitUntilNS(&Globals.frame_timer, next_frame);
+			}
 
 			if (!SwapBuffers(Globals.dc))
 			{
 				// TODO: What to do when swapping fails?
 				FatalError("Failed to swap OpenGL buffers");
 			}
+
+			// NOTE: waiting for the swap to retire keeps the driver from queueing frames ahead of the display, each
+			//       queued frame would add a refresh interval between sampling input and the frame showing up
+			glFinish();
+
+			PROFILE_END(Present);
+
+			if (Globals.replay_path != 0)
+			{
+				u64 time = OS_GetTimeNS() - frame_start;
+				replay_time_total += time;
+				replay_time_max    = (time > replay_time_max ? time : replay_time_max);
+
+				replay_frame += 1;
+				if (replay_frame == Globals.replay.frame_count) Globals.running = false;
+			}
+		}
+	}
+
+	if (Globals.threaded)
+	{
+		FrameQueue_Stop(&Globals.frame_queue);
+		OS_JoinThread(&Globals.sim_thread);
+		FrameQueue_Destroy(&Globals.frame_queue);
+
+		Frame_Queue* queue = &Globals.frame_queue;
+
+		char report[320];
+		snprintf(report, sizeof(report),
+		         "threaded: simulation lock-stepped at most one frame ahead, %llu frames published, %llu presented, %llu duplicated, latency mean %.3f ms  max %.3f ms, simulation waited %.3f s\n",
+		         (unsigned long long)queue->published, (unsigned long long)queue->presented, (unsigned long long)queue->duplicated, (queue->presented != 0 ? queue->latency_ns/1e6/queue->presented : 0),
+		         queue->latency_max_ns/1e6, queue->wait_ns/1e9);
+		OutputDebugStringA(report);
+	}
+
+	SetEvent(Globals.reload_stop);
+	OS_JoinThread(&Globals.reload_thread);
+
+	if (Globals.reload_ready) UnloadGameCode(&Globals.reload_game_code);
+	UnloadGameCode(&Globals.retired_game_code);
+
+	Jobs_Destroy(&Globals.jobs);
+
+	if (Globals.record_path != 0)
+	{
+		bool succeeded = Replay_StopRecording(&Globals.recorder);
+		if (fclose(Globals.record_file) != 0 || !succeeded)
+		{
+			//// ERROR
+			FatalError("Failed to write recording");
 		}
 	}
 
-	return 0;
+	{
+		bool succeeded = Mixer_Stop(&Globals.mixer);
+		if ((Globals.audio_file != 0 && fclose(Globals.audio_file) != 0) || !succeeded)
+		{
+			//// ERROR
+			FatalError("Failed to write audio");
+		}
+	}
+
+	if (Globals.capturing)
+	{
+		bool succeeded = Capture_Stop(&Globals.capture);
+		if (fclose(Globals.capture_file) != 0 || !succeeded)
+		{
+			//// ERROR
+			FatalError("Failed to write capture");
+		}
+	}
+
+	if (Globals.bump_trace != 0)
+	{
+		Bump_TraceFinish(Globals.bump_trace);
+		if (fclose(Globals.bump_trace_file) != 0)
+		{
+			//// ERROR
+			FatalError("Failed to write bump trace");
+		}
+	}
+
+	if (Globals.profiler != 0)
+	{
+		FILE* file = _wfopen(Globals.profile_path, L"wb");
+		if (file != 0) Profile_WriteChromeTrace(Globals.profiler, WriteToFile, file);
+
+		if (file == 0 || fclose(file) != 0)
+		{
+			//// ERROR
+			FatalError("Failed to write profile");
+		}
+	}
+
+	if (Globals.replay_path != 0)
+	{
+		char report[512];
+		snprintf(report, sizeof(report),
+		         "%llu of %llu frames replayed\n"
+		         "frame time mean %.3f ms  max %.3f ms\n"
+		         "%llu frame hashes differ, first at frame %llu",
+		         (unsigned long long)replay_frame, (unsigned long long)Globals.replay.frame_count,
+		         (replay_frame != 0 ? replay_time_total/1e6/replay_frame : 0), replay_time_max/1e6,
+		         (unsigned long long)Globals.replay.mismatches, (unsigned long long)Globals.replay.first_mismatch);
+
+		MessageBoxA(0, report, "Azur Replay", MB_OK | (Globals.replay.mismatches == 0 ? MB_ICONINFORMATION : MB_ICONWARNING));
+	}
+
+	// NOTE: a replay that drew something else than when it was recorded fails the run
+	return (Globals.replay.mismatches == 0 ? 0 : 1);
 }
@@ -0,0 +1,1237 @@
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "os.h"
+#include "profile.h"
+#include "jobs.h"
+#include "blit.h"
+#include "intern.h"
+#include "atlas.h"
+#include "pack.h"
+#include "capture.h"
+#include "audio.h"
+#include "mixer.h"
+#include "timestep.h"
+#include "replay.h"
+#include "present.h"
+#include "rewind.h"
+#include "bumptrace.h"
+
+typedef struct Game_Code
+{
+	void* module;
+	Game_Tick_Func* tick_func;
+} Game_Code;
+
+struct
+{
+	Bump platform_bump;
+	Bump frame_bumps[2];
+	Bump stats_bump;
+	Bump capture_bump;
+	Game_Code game_code;
+	Framebuffer* framebuffer;
+	Palette* palette;
+	Atlas_Header* atlas;
+	Pack_Header* pack;
+	u64 atlas_load_time;
+	u64* frame_times;
+	u64 frame_count;
+	u64 dump_interval;
+	const char* dump_dir;
+	const char* game_path;
+	const char* pack_path;
+	const char* capture_path;
+	FILE* capture_file;
+	Capture capture;
+	u32 sim_hz;
+	u32 pace_hz;
+	const char* profile_path;
+	Bump profile_bump;
+	Profiler* profiler;
+	u32 worker_count;
+	Job_System jobs;
+	Bump persistent_bump;
+	const char* record_path;
+	FILE* record_file;
+	Replay_Recorder recorder;
+	const char* replay_path;
+	Bump replay_bump;
+	Replay replay;
+	u32 present_width;
+	u32 present_height;
+	Bump present_bump;
+	Present present;
+	const char* audio_path;
+	FILE* audio_file;
+	Bump audio_bump;
+	Mixer mixer;
+	u64 rewind_mb;
+	Bump rewind_bump;
+	Rewind rewind;
+	u64 rewind_mismatches;
+	u64 rewind_first_mismatch;
+	const char* bump_trace_path;
+	FILE* bump_trace_file;
+	Bump_Trace* bump_trace;
+
+	// NOTE: The reload watcher thread prepares the new module and publishes it through reload_game_code and
+	//       reload_ready, the main thread swaps it in at the next frame boundary and hands the old module back through
+	//       retired_game_code, which the watcher unloads before it publishes another one.
+	bool watch;
+	int reload_inotify;
+	int reload_stop;
+	const char* game_name;
+	OS_Thread reload_thread;
+	Game_Code reload_game_code;
+	Game_Code retired_game_code;
+	volatile u32 reload_ready;
+	u32 reload_generation;
+	u32 reload_count;
+	u32 reload_failures;
+	u64 reload_prepare_max;
+} Globals = {0};
+
+#define AZUR_GAME_SO "azur_game.so"
+
+static bool
+CopyGameCode(const char* src_path, const char* dst_path)
+{
+	bool succeeded = false;
+
+	int src = open(src_path, O_RDONLY);
+	int dst = open(dst_path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+
+	if (src != -1 && dst != -1)
+	{
+		u8 buffer[1 << 16];
+
+		ssize_t read_size;
+		succeeded = true;
+		while (succeeded && (read_size = read(src, buffer, sizeof(buffer))) > 0)
+		{
+			succeeded = (write(dst, buffer, (size_t)read_size) == read_size);
+		}
+
+		succeeded = (succeeded && read_size == 0);
+	}
+
+	if (src != -1) close(src);
+	if (dst != -1 && close(dst) != 0) succeeded = false;
+
+	return succeeded;
+}
+
+// NOTE: The module is loaded from a copy, so the build can replace the original while it is in use and dlopen does
+//       not hand back the already loaded module for the same path. The copy is unlinked right after loading, the
+//       mapping keeps it alive. Does not unload anything, the caller decides when the old module goes.
+static bool
+LoadGameCode(Game_Code* game_code, const char* path, u32 generation)
+{
+	bool succeeded = false;
+
+	*game_code = (Game_Code){0};
+
+	char loaded_path[4096];
+	snprintf(loaded_path, sizeof(loaded_path), "%s.%u.loaded", path, generation);
+
+	void* module = 0;
+	if (CopyGameCode(path, loaded_path))
+	{
+		module = dlopen(loaded_path, RTLD_NOW | RTLD_LOCAL);
+	}
+	unlink(loaded_path);
+
+	if (module != 0)
+	{
+		Game_Tick_Func* tick_func = (Game_Tick_Func*)dlsym(module, "Tick");
+
+		if (tick_func != 0)
+		{
+			*game_code = (Game_Code){
+				.module    = module,
+				.tick_func = tick_func,
+			};
+
+			succeeded = true;
+		}
+	}
+
+	if (!succeeded)
+	{
+		fprintf(stderr, "dlopen: %s\n", (module == 0 ? dlerror() : "Tick not found"));
+		if (module != 0) dlclose(module);
+	}
+
+	return succeeded;
+}
+
+static void
+ReloadWatcher(void* data)
+{
+	for (;;)
+	{
+		struct pollfd fds[2] = {
+			{ .fd = Globals.reload_inotify, .events = POLLIN },
+			{ .fd = Globals.reload_stop,    .events = POLLIN },
+		};
+
+		if (poll(fds, 2, -1) < 0) continue;
+		if (fds[1].revents != 0) break;
+
+		/// Look for the game module among the changed files
+		bool changed = false;
+
+		u32 buffer[1 << 10];
+		ssize_t size = read(Globals.reload_inotify, buffer, sizeof(buffer));
+
+		for (ssize_t offset = 0; offset < size; )
+		{
+			struct inotify_event* event = (struct inotify_event*)((u8*)buffer + offset);
+			if (event->len != 0 && strcmp(event->name, Globals.game_name) == 0) changed = true;
+
+			offset += sizeof(struct inotify_event) + event->len;
+		}
+
+		if (!changed) continue;
+
+		/// Prepare the new module
+		u64 prepare_start = OS_GetTimeNS();
+
+		Globals.reload_generation += 1;
+
+		Game_Code game_code;
+		if (!LoadGameCode(&game_code, Globals.game_path, Globals.reload_generation))
+		{
+			//// ERROR
+			// NOTE: probably a broken build, keep running the old code until the next one
+			Globals.reload_failures += 1;
+			continue;
+		}
+
+		u64 prepare_time = OS_GetTimeNS() - prepare_start;
+		if (prepare_time > Globals.reload_prepare_max) Globals.reload_prepare_max = prepare_time;
+
+		/// Wait for the previous module to be swapped in, then unload the one it replaced
+		while (Atomic_LoadAcquire32(&Globals.reload_ready)) usleep(1000);
+
+		if (Globals.retired_game_code.module != 0) dlclose(Globals.retired_game_code.module);
+		Globals.retired_game_code = (Game_Code){0};
+
+		Globals.reload_game_code = game_code;
+		Atomic_StoreRelease32(&Globals.reload_ready, 1);
+	}
+}
+
+#define AZUR_PACK "azur.pack"
+
+// NOTE: A missing pack is not an error, the game checks platform_link->atlas before using it
+static bool
+MapPack(const char* path, Pack_Header** pack)
+{
+	bool succeeded = false;
+
+	*pack = 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		succeeded = (errno == ENOENT);
+	}
+	else
+	{
+		struct stat st;
+		void* view = MAP_FAILED;
+
+		if (fstat(fd, &st) == 0 && st.st_size != 0) view = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (view != MAP_FAILED && Pack_Validate(view, (u64)st.st_size))
+		{
+			*pack     = view;
+			succeeded = true;
+		}
+		else if (view != MAP_FAILED)
+		{
+			munmap(view, (size_t)st.st_size);
+		}
+
+		// NOTE: the mapping stays valid after the descriptor is closed
+		close(fd);
+	}
+
+	return succeeded;
+}
+
+static Pack_Asset*
+LoadAsset(String name, Bump* bump, Job_Counter* counter)
+{
+	return Pack_Load(Globals.pack, name, bump, Jobs_ParallelFor, counter);
+}
+
+static void
+Setup_Error(const char* message)
+{
+	fprintf(stderr, "Azur Setup Failed: %s\n", message);
+}
+
+static bool
+DumpFramebuffer(u64 frame_index)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/frame_%08llu.pgm", Globals.dump_dir, (unsigned long long)frame_index);
+
+	FILE* file = fopen(path, "wb");
+	if (file == 0) return false;
+
+	// NOTE: the raw palette indices are written as an 8-bit graymap, so dumps from two builds can be compared byte for byte
+	fprintf(file, "P5\n%u %u\n255\n", AZUR_WIDTH, AZUR_HEIGHT);
+	bool succeeded = (fwrite(Globals.framebuffer->pixels, 1, AZUR_WIDTH*AZUR_HEIGHT, file) == AZUR_WIDTH*AZUR_HEIGHT);
+
+	return (fclose(file) == 0 && succeeded);
+}
+
+// NOTE: the presented frame as a binary pixmap, what the Win32 host would show in a window of the same size
+static bool
+DumpPresented(u64 frame_index)
+{
+	Present* present = &Globals.present;
+
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/frame_%08llu.ppm", Globals.dump_dir, (unsigned long long)frame_index);
+
+	FILE* file = fopen(path, "wb");
+	if (file == 0) return false;
+
+	fprintf(file, "P6\n%u %u\n255\n", present->width, present->height);
+
+	u8* row = Bump_Push(&Globals.present_bump, (umm)present->width*3, 1);
+
+	bool succeeded = true;
+	for (u32 y = 0; y < present->height && succeeded; ++y)
+	{
+		u32* src = present->pixels + (umm)y*present->stride;
+		for (u32 x = 0; x < present->width; ++x)
+		{
+			row[x*3 + 0] = (u8)(src[x] >>  0);
+			row[x*3 + 1] = (u8)(src[x] >>  8);
+			row[x*3 + 2] = (u8)(src[x] >> 16);
+		}
+
+		succeeded = (fwrite(row, 3, present->width, file) == present->width);
+	}
+
+	Bump_Pop(&Globals.present_bump, (umm)present->width*3);
+
+	return (fclose(file) == 0 && succeeded);
+}
+
+static bool
+Setup()
+{
+	if (!Bump_Create(1ULL << 26, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.platform_bump) ||
+	    !Bump_Create(1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.frame_bumps[0]) ||
+	    !Bump_Create(1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.frame_bumps[1]) ||
+	    (!Bump_CreateAt(AZUR_PERSISTENT_BASE, 1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.persistent_bump) &&
+	     !Bump_Create(1ULL << 30, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.persistent_bump)))
+	{
+		//// ERROR
+		Setup_Error("Failed to create memory arenas");
+		return false;
+	}
+
+	if (Globals.bump_trace_path != 0)
+	{
+#ifdef AZUR_BUMP_TRACE
+		Globals.bump_trace_file = fopen(Globals.bump_trace_path, "wb");
+		if (Globals.bump_trace_file == 0)
+		{
+			//// ERROR
+			Setup_Error("Failed to open bump trace");
+			return false;
+		}
+
+		// NOTE: from here on everything pushed to the arenas is traced, up to the first frame it counts as setup
+		Globals.bump_trace = Bump_TraceCreate(&Globals.platform_bump, Globals.bump_trace_file);
+		Bump_TraceAttach(Globals.bump_trace, &Globals.platform_bump,   "platform_bump");
+		Bump_TraceAttach(Globals.bump_trace, &Globals.frame_bumps[0],  "frame_bumps");
+		Bump_TraceAttach(Globals.bump_trace, &Globals.frame_bumps[1],  "frame_bumps");
+		Bump_TraceAttach(Globals.bump_trace, &Globals.persistent_bump, "persistent_bump");
+#else
+		//// ERROR
+		Setup_Error("Bumps are only traced in builds with AZUR_BUMP_TRACE, build with ./build.sh trace");
+		return false;
+#endif
+	}
+
+	if (Globals.replay_path != 0)
+	{
+		FILE* file = fopen(Globals.replay_path, "rb");
+
+		bool succeeded = (file != 0 && Bump_Create(1ULL << 36, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.replay_bump) &&
+		                  Replay_Load(&Globals.replay, file, &Globals.replay_bump) && Globals.replay.frame_count != 0);
+
+		if (file != 0) fclose(file);
+
+		if (!succeeded)
+		{
+			//// ERROR
+			Setup_Error("Failed to load replay");
+			return false;
+		}
+
+		// NOTE: the recording decides how long the run is and how fast it simulates
+		Globals.frame_count = Globals.replay.frame_count;
+		Globals.sim_hz      = Globals.replay.header->sim_hz;
+	}
+
+	u64 stats_size = Globals.frame_count*sizeof(u64);
+	if (Globals.frame_count > U64_MAX/sizeof(u64) || !Bump_Create(stats_size, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.stats_bump))
+	{
+		//// ERROR
+		Setup_Error("Failed to allocate frame statistics, try fewer frames");
+		return false;
+	}
+
+	Globals.frame_times = Bump_Push(&Globals.stats_bump, stats_size, 8);
+
+	{ /// Allocate framebuffer
+		Globals.framebuffer = Bump_Push(&Globals.platform_bump, sizeof(Framebuffer), 64);
+
+		u8* b = &Globals.framebuffer->pixels[0][0];
+		for (umm i = 0; i < AZUR_WIDTH*AZUR_HEIGHT; ++i) b[i] = (u8)i;
+
+		Framebuffer_MarkAll(Globals.framebuffer);
+
+		Globals.palette = Bump_Push(&Globals.platform_bump, sizeof(Palette), 64);
+		Palette_Init(Globals.palette);
+	}
+
+	if (Globals.replay_path != 0 && !Replay_Restore(&Globals.replay, &Globals.persistent_bump, Globals.framebuffer, Globals.palette))
+	{
+		//// ERROR
+		Setup_Error("Failed to restore replay, the persistent bump is not at the address it was recorded at");
+		return false;
+	}
+
+	if (Globals.rewind_mb != 0)
+	{
+		u64 ring_size = Globals.rewind_mb << 20;
+
+		Rewind_Region regions[] = {
+			{ Globals.persistent_bump.memory,     Globals.persistent_bump.reserved },
+			{ &Globals.framebuffer->pixels[0][0], sizeof(Globals.framebuffer->pixels) },
+			{ (u8*)Globals.palette->colors,       sizeof(Globals.palette->colors) },
+		};
+
+		if (!Bump_Create(ring_size + REWIND_MAX_FRAMES*sizeof(Rewind_Frame) + 64, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.rewind_bump) ||
+		    !Rewind_Create(&Globals.rewind, &Globals.rewind_bump, ring_size, regions, sizeof(regions)/sizeof(regions[0])))
+		{
+			//// ERROR
+			Setup_Error("Failed to allocate the rewind buffer, try fewer megabytes");
+			return false;
+		}
+	}
+
+	if (Globals.record_path != 0)
+	{
+		u64 start_tick = (Globals.replay_path != 0 ? Globals.replay.tick : 0);
+
+		Globals.record_file = fopen(Globals.record_path, "wb");
+
+		if (Globals.record_file == 0 ||
+		    !Replay_StartRecording(&Globals.recorder, Globals.record_file, Globals.sim_hz, start_tick, &Globals.persistent_bump, Globals.framebuffer,
+		                           Globals.palette))
+		{
+			//// ERROR
+			Setup_Error("Failed to start recording");
+			return false;
+		}
+	}
+
+	if (Globals.present_width != 0)
+	{
+		u32 width  = Globals.present_width;
+		u32 height = Globals.present_height;
+
+		// NOTE: the tables for the target are pushed right after it
+		if (!Bump_Create((u64)width*height*sizeof(u32) + (1ULL << 20), BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.present_bump))
+		{
+			//// ERROR
+			Setup_Error("Failed to allocate presentation target");
+			return false;
+		}
+
+		u32* pixels = Bump_Push(&Globals.present_bump, (umm)width*height*sizeof(u32), 64);
+		Present_Create(&Globals.present, &Globals.present_bump, pixels, width, height, width);
+	}
+
+	if (Globals.dump_interval != 0 && mkdir(Globals.dump_dir, 0755) != 0)
+	{
+		struct stat st;
+		if (stat(Globals.dump_dir, &st) != 0 || !S_ISDIR(st.st_mode))
+		{
+			//// ERROR
+			Setup_Error("Failed to create dump directory");
+			return false;
+		}
+	}
+
+	{ /// Resolve game code and asset paths
+		// NOTE: like the Win32 host, files are looked up next to the executable unless given on the command line
+		u32 path_cap = 1 << 12;
+		char* exe_path = Bump_Push(&Globals.platform_bump, path_cap, 1);
+
+		ssize_t path_len = readlink("/proc/self/exe", exe_path, path_cap);
+
+		if (path_len <= 0 || path_len == path_cap)
+		{
+			//// ERROR
+			Setup_Error("Failed to get path of executable");
+			return false;
+		}
+
+		u32 dir_len = (u32)path_len;
+		while (dir_len > 0 && exe_path[dir_len-1] != '/') --dir_len;
+
+		if (Globals.game_path == 0)
+		{
+			char* path = Bump_Push(&Globals.platform_bump, dir_len + sizeof(AZUR_GAME_SO), 1);
+			memcpy(path, exe_path, dir_len);
+			memcpy(path + dir_len, AZUR_GAME_SO, sizeof(AZUR_GAME_SO));
+			Globals.game_path = path;
+		}
+
+		if (Globals.pack_path == 0)
+		{
+			char* path = Bump_Push(&Globals.platform_bump, dir_len + sizeof(AZUR_PACK), 1);
+			memcpy(path, exe_path, dir_len);
+			memcpy(path + dir_len, AZUR_PACK, sizeof(AZUR_PACK));
+			Globals.pack_path = path;
+		}
+	}
+
+	if (!MapPack(Globals.pack_path, &Globals.pack))
+	{
+		//// ERROR
+		Setup_Error("Failed to map asset pack");
+		return false;
+	}
+
+	if (Globals.profile_path != 0)
+	{
+#ifdef AZUR_PROFILING
+		if (!Bump_Create(Profile_MemorySize(), BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.profile_bump))
+		{
+			//// ERROR
+			Setup_Error("Failed to allocate profiler");
+			return false;
+		}
+
+		Globals.profiler = Profile_Create(&Globals.profile_bump, OS_EstimateTSCFrequency(), Profile_GetThread);
+
+		// NOTE: the capture worker registers itself when it starts, so this has to happen before capture is started
+		PROFILE_ATTACH(Globals.profiler);
+		PROFILE_THREAD("main");
+#else
+		//// ERROR
+		Setup_Error("Profiling is compiled out, build with AZUR_DEBUG or AZUR_PROFILE defined");
+		return false;
+#endif
+	}
+
+	{ /// Start job system
+		u32 worker_count = Globals.worker_count;
+		if (worker_count == 0) worker_count = OS_GetProcessorCount();
+		if (worker_count > JOBS_MAX_WORKERS) worker_count = JOBS_MAX_WORKERS;
+
+		if (!Jobs_Create(&Globals.jobs, &Globals.platform_bump, worker_count))
+		{
+			//// ERROR
+			Setup_Error("Failed to start job system");
+			return false;
+		}
+	}
+
+	if (Globals.pack != 0)
+	{ /// Load what the first frame needs, everything else is up to the game
+		u64 load_start = OS_GetTimeNS();
+
+		Job_Counter counter = {0};
+		Pack_Asset* atlas = Pack_Load(Globals.pack, STRING("atlas"), &Globals.platform_bump, Jobs_ParallelFor, &counter);
+		Jobs_Wait(&counter);
+
+		if (atlas != 0 && (atlas->failed || !Atlas_Validate(atlas->data, atlas->size)))
+		{
+			//// ERROR
+			Setup_Error("Failed to load sprite atlas");
+			return false;
+		}
+
+		Globals.atlas           = (atlas != 0 ? (Atlas_Header*)atlas->data : 0);
+		Globals.atlas_load_time = OS_GetTimeNS() - load_start;
+	}
+
+	if (Globals.capture_path != 0)
+	{
+		Globals.capture_file = fopen(Globals.capture_path, "wb");
+
+		if (Globals.capture_file == 0 || !Bump_Create(1ULL << 26, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.capture_bump) ||
+		    !Capture_Start(&Globals.capture, &Globals.capture_bump, Globals.capture_file, Globals.palette->colors))
+		{
+			//// ERROR
+			Setup_Error("Failed to start capture");
+			return false;
+		}
+	}
+
+	{ /// Start audio
+		// NOTE: without a file the mixer still runs against the null sink, on the same clock a device would have
+		if (Globals.audio_path != 0) Globals.audio_file = fopen(Globals.audio_path, "wb");
+
+		if ((Globals.audio_path != 0 && Globals.audio_file == 0) ||
+		    !Bump_Create(1ULL << 24, BUMP_DEFAULT_COMMIT_CHUNK, BUMP_GUARD_PAGE, &Globals.audio_bump) ||
+		    !Mixer_Start(&Globals.mixer, &Globals.audio_bump, Globals.audio_file))
+		{
+			//// ERROR
+			Setup_Error("Failed to start audio");
+			return false;
+		}
+	}
+
+	if (!LoadGameCode(&Globals.game_code, Globals.game_path, 0))
+	{
+		//// ERROR
+		Setup_Error("Failed to load game code");
+		return false;
+	}
+
+	if (Globals.watch)
+	{
+		Globals.game_name = strrchr(Globals.game_path, '/');
+		Globals.game_name = (Globals.game_name != 0 ? Globals.game_name + 1 : Globals.game_path);
+
+		char dir[4096];
+		umm dir_len = (umm)(Globals.game_name - Globals.game_path);
+		if (dir_len == 0) memcpy(dir, ".", 2);
+		else if (dir_len < sizeof(dir)) memcpy(dir, Globals.game_path, dir_len), dir[dir_len] = 0;
+
+		// NOTE: the directory is watched rather than the file, the linker replaces the file instead of rewriting it
+		Globals.reload_inotify = inotify_init1(IN_CLOEXEC);
+		Globals.reload_stop    = eventfd(0, EFD_CLOEXEC);
+
+		if (dir_len >= sizeof(dir) || Globals.reload_inotify == -1 || Globals.reload_stop == -1 ||
+		    inotify_add_watch(Globals.reload_inotify, dir, IN_CLOSE_WRITE | IN_MOVED_TO) == -1 ||
+		    !OS_CreateThread(&Globals.reload_thread, ReloadWatcher, 0))
+		{
+			//// ERROR
+			Setup_Error("Failed to watch game code");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+WriteToFile(void* context, u8* data, umm size)
+{
+	fwrite(data, 1, size, context);
+}
+
+static int
+CompareU64(const void* a, const void* b)
+{
+	u64 x = *(const u64*)a;
+	u64 y = *(const u64*)b;
+	return (x > y) - (x < y);
+}
+
+static f64
+Percentile(u64* sorted, u64 count, f64 p)
+{
+	umm index = (umm)(p*(f64)(count - 1) + 0.5);
+	return (f64)sorted[index];
+}
+
+static void
+PrintUsage(const char* exe)
+{
+	fprintf(stderr,
+		"Usage: %s [--frames N] [--sim-hz N] [--pace HZ] [--workers N] [--dump-every K] [--dump-dir DIR] [--game PATH] [--pack PATH] [--capture PATH] [--profile PATH] [--watch] [--record PATH] [--replay PATH] [--present WxH] [--audio PATH] [--rewind MB] [--bump-trace PATH]\n"
+		"  --frames N      number of frames to run (default 10000)\n"
+		"  --sim-hz N      fixed simulation rate (default 60)\n"
+		"  --pace HZ       present at HZ on the real clock like the Win32 host, instead of one step per frame uncapped\n"
+		"  --workers N     job system threads including the main thread (default one per logical processor)\n"
+		"  --dump-every K  write the indexed framebuffer to DIR every K frames (default 0, off)\n"
+		"  --dump-dir DIR  directory for framebuffer dumps (default \"dump\")\n"
+		"  --game PATH     game shared object to load (default " AZUR_GAME_SO " next to the executable)\n"
+		"  --pack PATH     asset pack to map (default " AZUR_PACK " next to the executable)\n"
+		"  --capture PATH  stream presented frames to an animated GIF, timed by simulation time\n"
+		"  --profile PATH  write a Chrome trace of the profiled zones to PATH and print a summary of them\n"
+		"  --watch         reload the game shared object when it is rebuilt, keeping the persistent game state\n"
+		"  --record PATH   record the input and timestep of every frame along with a hash of the framebuffer\n"
+		"  --replay PATH   replay a recording as fast as possible and compare frame hashes, overrides --frames,\n"
+		"                  --sim-hz and --pace\n"
+		"  --present WxH   present every frame on the CPU into a WxH RGBA image, dumps also write it as a pixmap\n"
+		"  --audio PATH    write the mixed audio to a WAV file as it plays, in real time (default: mix into nothing)\n"
+		"  --rewind MB     capture the game state into MB megabytes of rewind history every frame, a replay steps back\n"
+		"                  through all of it at the end and compares frame hashes on the way\n"
+		"  --bump-trace PATH  write every frame's pushes to the platform, frame and persistent bumps, by arena and call\n"
+		"                  site, to PATH, needs a build with AZUR_BUMP_TRACE\n",
+		exe);
+}
+
+int
+main(int argc, char** argv)
+{
+	Globals.frame_count   = 10000;
+	Globals.dump_interval = 0;
+	Globals.dump_dir      = "dump";
+	Globals.game_path     = 0;
+	Globals.pack_path     = 0;
+	Globals.capture_path  = 0;
+	Globals.sim_hz        = TIMESTEP_DEFAULT_HZ;
+	Globals.pace_hz       = 0;
+	Globals.worker_count  = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool has_value = (i + 1 < argc);
+
+		if      (strcmp(argv[i], "--frames")     == 0 && has_value) Globals.frame_count   = strtoull(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--sim-hz")     == 0 && has_value) Globals.sim_hz        = (u32)strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--pace")       == 0 && has_value) Globals.pace_hz       = (u32)strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--workers")    == 0 && has_value) Globals.worker_count  = (u32)strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--dump-every") == 0 && has_value) Globals.dump_interval = strtoull(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--dump-dir")   == 0 && has_value) Globals.dump_dir      = argv[++i];
+		else if (strcmp(argv[i], "--game")       == 0 && has_value) Globals.game_path     = argv[++i];
+		else if (strcmp(argv[i], "--pack")       == 0 && has_value) Globals.pack_path     = argv[++i];
+		else if (strcmp(argv[i], "--capture")    == 0 && has_value) Globals.capture_path  = argv[++i];
+		else if (strcmp(argv[i], "--profile")    == 0 && has_value) Globals.profile_path  = argv[++i];
+		else if (strcmp(argv[i], "--watch")      == 0)              Globals.watch         = true;
+		else if (strcmp(argv[i], "--record")     == 0 && has_value) Globals.record_path   = argv[++i];
+		else if (strcmp(argv[i], "--replay")     == 0 && has_value) Globals.replay_path   = argv[++i];
+		else if (strcmp(argv[i], "--audio")      == 0 && has_value) Globals.audio_path    = argv[++i];
+		else if (strcmp(argv[i], "--rewind")     == 0 && has_value) Globals.rewind_mb     = strtoull(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--bump-trace") == 0 && has_value) Globals.bump_trace_path = argv[++i];
+		else if (strcmp(argv[i], "--present")    == 0 && has_value &&
+		         sscanf(argv[i+1], "%ux%u", &Globals.present_width, &Globals.present_height) == 2) ++i;
+		else
+		{
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (Globals.frame_count == 0 || Globals.sim_hz == 0 || Globals.sim_hz > TIMESTEP_MAX_HZ || Globals.pace_hz > TIMESTEP_MAX_HZ ||
+	    Globals.worker_count > JOBS_MAX_WORKERS || (Globals.present_width == 0) != (Globals.present_height == 0) ||
+	    Globals.present_width > 16384 || Globals.present_height > 16384 || Globals.rewind_mb > (1 << 16))
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	bool setup_successful = Setup();
+	if (!setup_successful)
+	{
+		//// ERROR
+		return 1;
+	}
+
+	Platform_Link platform_link = {
+		.frame_bump      = &Globals.frame_bumps[0],
+		.prev_frame_bump = &Globals.frame_bumps[1],
+		.persistent_bump = &Globals.persistent_bump,
+		.framebuffer     = Globals.framebuffer,
+		.palette         = Globals.palette,
+		.atlas           = Globals.atlas,
+		.pack            = Globals.pack,
+		.profiler        = Globals.profiler,
+		.audio           = &Globals.mixer.queue,
+
+		.worker_count     = Globals.jobs.worker_count,
+		.job_submit       = Jobs_Submit,
+		.job_parallel_for = Jobs_ParallelFor,
+		.job_wait         = Jobs_Wait,
+		.pack_load        = LoadAsset,
+	};
+
+	u64 dump_count    = 0;
+	u64 dump_time     = 0;
+	u64 replay_time   = 0;
+	u64 upload_rows   = 0;
+	u64 upload_spans  = 0;
+	u64 static_frames = 0;
+	u64 palette_uploads = 0;
+	u64 palette_entries = 0;
+	u64 capture_time  = 0;
+	u64 capture_max   = 0;
+	u64 pace_late     = 0;
+	u64 pace_late_max = 0;
+	u64 step_frames[3] = {0};
+	u64 frame_bump_total = 0;
+	u64 frame_bump_peak  = 0;
+	u64 reload_swap_max  = 0;
+	u64 present_time     = 0;
+	u64 present_max      = 0;
+	u64 rewind_time      = 0;
+	u64 rewind_max       = 0;
+	u64 bump_trace_time  = 0;
+
+	OS_Timer frame_timer;
+	OS_CreateTimer(&frame_timer);
+
+	Timestep timestep;
+	Timestep_Init(&timestep, Globals.sim_hz, 0);
+
+	u64 frame_period = (Globals.pace_hz != 0 && Globals.replay_path == 0 ? 1000000000ULL/Globals.pace_hz : 0);
+
+	if (Globals.bump_trace != 0) Bump_TraceFrame(Globals.bump_trace);
+
+	u64 run_start  = OS_GetTimeNS();
+	u64 next_frame = run_start;
+	if (frame_period != 0) Timestep_Resync(&timestep, run_start);
+
+	for (u64 frame_index = 0; frame_index < Globals.frame_count; ++frame_index)
+	{
+		if (frame_period != 0)
+		{
+			next_frame += frame_period;
+			OS_WaitUntilNS(&frame_timer, next_frame);
+
+			u64 late = OS_GetTimeNS() - next_frame;
+			pace_late     += late;
+			pace_late_max  = (late > pace_late_max ? late : pace_late_max);
+		}
+
+		u64 frame_start = OS_GetTimeNS();
+
+		PROFILE_FRAME_MARK();
+		PROFILE_BEGIN(Frame);
+
+		platform_link.reloaded = false;
+		if (Atomic_LoadAcquire32(&Globals.reload_ready))
+		{
+			u64 swap_start = OS_GetTimeNS();
+
+			Globals.retired_game_code = Globals.game_code;
+			Globals.game_code         = Globals.reload_game_code;
+			Atomic_StoreRelease32(&Globals.reload_ready, 0);
+
+			platform_link.reloaded  = true;
+			Globals.reload_count   += 1;
+
+			u64 time = OS_GetTimeNS() - swap_start;
+			reload_swap_max = (time > reload_swap_max ? time : reload_swap_max);
+		}
+
+		if (Globals.replay_path != 0)
+		{
+			Replay_ApplyFrame(&Globals.replay, frame_index, &platform_link);
+			timestep.tick = Globals.replay.tick;
+		}
+		else
+		{
+			// NOTE: unpaced runs advance a virtual clock by exactly one step per frame, so runs are reproducible
+			Timestep_Advance(&timestep, (frame_period != 0 ? frame_start : (frame_index + 1)*timestep.step_ns), &platform_link);
+		}
+
+		step_frames[platform_link.sim_steps < 2 ? platform_link.sim_steps : 2] += 1;
+
+		{ /// Swap frame arenas
+			Bump* frame_bump = platform_link.prev_frame_bump;
+			platform_link.prev_frame_bump = platform_link.frame_bump;
+			platform_link.frame_bump      = frame_bump;
+
+			Bump_ResetFrame(frame_bump);
+		}
+
+		PROFILE_BEGIN(Tick);
+		Globals.game_code.tick_func(&platform_link);
+		PROFILE_END(Tick);
+
+		{ /// Record frame arena peak
+			u64 peak = platform_link.frame_bump->high_watermark;
+			frame_bump_total += peak;
+			frame_bump_peak   = (peak > frame_bump_peak ? peak : frame_bump_peak);
+		}
+
+		{ /// Account for the rows and colors the Win32 host would upload
+			u32 frame_spans = 0;
+			for (u32 row = 0, row_count = 0; Framebuffer_NextDirtySpan(Globals.framebuffer, &row, &row_count); row += row_count)
+			{
+				upload_rows += row_count;
+				frame_spans += 1;
+			}
+
+			upload_spans  += frame_spans;
+			static_frames += (frame_spans == 0);
+
+			Palette* palette = Globals.palette;
+			palette_uploads += (palette->dirty_end > palette->dirty_first);
+			palette_entries += palette->dirty_end - palette->dirty_first;
+		}
+
+		if (Globals.present_width != 0)
+		{
+			u64 present_start = OS_GetTimeNS();
+
+			PROFILE_BEGIN(Present);
+			Present_Frame(&Globals.present, Globals.framebuffer, Globals.palette, Jobs_ParallelFor, Jobs_Wait);
+			PROFILE_END(Present);
+
+			u64 time = OS_GetTimeNS() - present_start;
+			present_time += time;
+			present_max   = (time > present_max ? time : present_max);
+		}
+
+		if (Globals.capture_path != 0)
+		{
+			u64 capture_start = OS_GetTimeNS();
+
+			PROFILE_BEGIN(CaptureSubmit);
+			Capture_Submit(&Globals.capture, Globals.framebuffer, Globals.palette, timestep.tick*timestep.step_ns);
+			PROFILE_END(CaptureSubmit);
+
+			u64 time = OS_GetTimeNS() - capture_start;
+			capture_time += time;
+			capture_max   = (time > capture_max ? time : capture_max);
+		}
+
+		if (Globals.rewind_mb != 0)
+		{
+			u64 rewind_start = OS_GetTimeNS();
+
+			PROFILE_BEGIN(RewindCapture);
+			u64 sizes[] = { Globals.persistent_bump.cursor, sizeof(Globals.framebuffer->pixels), sizeof(Globals.palette->colors) };
+			Rewind_Capture(&Globals.rewind, sizes);
+			PROFILE_END(RewindCapture);
+
+			u64 time = OS_GetTimeNS() - rewind_start;
+			rewind_time += time;
+			rewind_max   = (time > rewind_max ? time : rewind_max);
+		}
+
+		PROFILE_END(Frame);
+
+		u64 frame_end = OS_GetTimeNS();
+		Globals.frame_times[frame_index] = frame_end - frame_start;
+
+		// NOTE: hashing is excluded from the frame time as well, replays exist to get comparable frame times
+		if (Globals.replay_path != 0 || Globals.record_path != 0)
+		{
+			if (Globals.replay_path != 0) Replay_CheckFrame(&Globals.replay, frame_index, Globals.framebuffer, Globals.palette);
+			if (Globals.record_path != 0) Replay_RecordFrame(&Globals.recorder, &platform_link);
+
+			replay_time += OS_GetTimeNS() - frame_end;
+			frame_end    = OS_GetTimeNS();
+		}
+
+		// NOTE: dumping is excluded from the frame time, it would otherwise dominate the measurement
+		if (Globals.dump_interval != 0 && frame_index % Globals.dump_interval == 0)
+		{
+			if (!DumpFramebuffer(frame_index) || (Globals.present_width != 0 && !DumpPresented(frame_index)))
+			{
+				//// ERROR
+				fprintf(stderr, "Failed to dump framebuffer of frame %llu\n", (unsigned long long)frame_index);
+				return 1;
+			}
+
+			dump_count += 1;
+			dump_time  += OS_GetTimeNS() - frame_end;
+		}
+
+		// NOTE: and so is writing the bump trace
+		if (Globals.bump_trace != 0)
+		{
+			u64 trace_start = OS_GetTimeNS();
+			Bump_TraceFrame(Globals.bump_trace);
+			bump_trace_time += OS_GetTimeNS() - trace_start;
+		}
+
+		Framebuffer_ClearDirty(Globals.framebuffer);
+		Palette_ClearDirty(Globals.palette);
+	}
+	u64 run_time = OS_GetTimeNS() - run_start - dump_time - replay_time - bump_trace_time;
+
+	u64 rewind_held       = Rewind_FrameCount(&Globals.rewind);
+	u64 rewind_bytes_held = Rewind_BytesHeld(&Globals.rewind);
+	u64 rewind_steps      = 0;
+	u64 rewind_step_time  = 0;
+	u64 rewind_step_max   = 0;
+	if (Globals.rewind_mb != 0 && Globals.replay_path != 0)
+	{ /// Step back through the replay
+		// NOTE: after stepping back j frames the game state is the one frame_count - 1 - j was recorded with
+		for (u64 frame_index = Globals.frame_count - 1;; --frame_index)
+		{
+			u64 step_start = OS_GetTimeNS();
+
+			u64 sizes[REWIND_MAX_REGIONS];
+			if (!Rewind_StepBack(&Globals.rewind, sizes)) break;
+
+			u64 time = OS_GetTimeNS() - step_start;
+			rewind_step_time += time;
+			rewind_step_max   = (time > rewind_step_max ? time : rewind_step_max);
+			rewind_steps     += 1;
+
+			Globals.persistent_bump.cursor = sizes[0];
+			Framebuffer_MarkAll(Globals.framebuffer);
+			Palette_MarkRange(Globals.palette, 0, AZUR_PALETTE_SIZE);
+
+			if (Replay_HashFrame(Globals.framebuffer, Globals.palette) != Globals.replay.frames[frame_index - 1].frame_hash &&
+			    Globals.rewind_mismatches++ == 0)
+			{
+				Globals.rewind_first_mismatch = frame_index - 1;
+			}
+		}
+	}
+
+	if (Globals.watch)
+	{
+		u64 stop = 1;
+		if (write(Globals.reload_stop, &stop, sizeof(stop)) == sizeof(stop)) OS_JoinThread(&Globals.reload_thread);
+
+		if (Globals.retired_game_code.module != 0) dlclose(Globals.retired_game_code.module);
+		if (Globals.reload_ready) dlclose(Globals.reload_game_code.module);
+
+		close(Globals.reload_stop);
+		close(Globals.reload_inotify);
+	}
+
+	Jobs_Destroy(&Globals.jobs);
+
+	if (Globals.capture_path != 0)
+	{
+		bool succeeded = Capture_Stop(&Globals.capture);
+		if (fclose(Globals.capture_file) != 0 || !succeeded)
+		{
+			//// ERROR
+			fprintf(stderr, "Failed to write capture to %s\n", Globals.capture_path);
+			return 1;
+		}
+	}
+
+	{
+		bool succeeded = Mixer_Stop(&Globals.mixer);
+		if ((Globals.audio_file != 0 && fclose(Globals.audio_file) != 0) || !succeeded)
+		{
+			//// ERROR
+			fprintf(stderr, "Failed to write audio to %s\n", Globals.audio_path);
+			return 1;
+		}
+	}
+
+	if (Globals.bump_trace != 0)
+	{
+		Bump_TraceFinish(Globals.bump_trace);
+		if (fclose(Globals.bump_trace_file) != 0)
+		{
+			//// ERROR
+			fprintf(stderr, "Failed to write bump trace to %s\n", Globals.bump_trace_path);
+			return 1;
+		}
+	}
+
+	if (Globals.record_path != 0)
+	{
+		bool succeeded = Replay_StopRecording(&Globals.recorder);
+		if (fclose(Globals.record_file) != 0 || !succeeded)
+		{
+			//// ERROR
+			fprintf(stderr, "Failed to write recording to %s\n", Globals.record_path);
+			return 1;
+		}
+	}
+
+	if (Globals.profiler != 0)
+	{
+		FILE* file = fopen(Globals.profile_path, "wb");
+		if (file != 0) Profile_WriteChromeTrace(Globals.profiler, WriteToFile, file);
+
+		if (file == 0 || fclose(file) != 0)
+		{
+			//// ERROR
+			fprintf(stderr, "Failed to write profile to %s\n", Globals.profile_path);
+			return 1;
+		}
+	}
+
+	{ /// Report
+		u64 n = Globals.frame_count;
+		u64* times = Globals.frame_times;
+
+		u64 total = 0;
+		for (u64 i = 0; i < n; ++i) total += times[i];
+
+		qsort(times, n, sizeof(u64), CompareU64);
+
+		printf("frames:          %llu\n", (unsigned long long)n);
+		printf("wall time:       %.3f ms\n", run_time/1e6);
+		printf("frames/sec:      %.1f\n", (f64)n/(run_time/1e9));
+		printf("frame time (us): mean %.3f  min %.3f  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+					 (f64)total/n/1e3, times[0]/1e3,
+					 Percentile(times, n, 0.50)/1e3, Percentile(times, n, 0.90)/1e3,
+					 Percentile(times, n, 0.99)/1e3, Percentile(times, n, 0.999)/1e3,
+					 times[n-1]/1e3);
+		printf("sim steps:       %u Hz, %llu steps, frames with 0/1/2+ steps %llu/%llu/%llu, %.3f ms dropped\n",
+					 Globals.sim_hz, (unsigned long long)timestep.tick, (unsigned long long)step_frames[0],
+					 (unsigned long long)step_frames[1], (unsigned long long)step_frames[2], timestep.dropped_ns/1e6);
+		if (frame_period != 0)
+		{
+			printf("pacing:          %u Hz, wakeup late by mean %.3f us  max %.3f us\n",
+						 Globals.pace_hz, (f64)pace_late/n/1e3, pace_late_max/1e3);
+		}
+		printf("upload:          %llu rows in %llu spans (%.1f KB/frame), %llu static frames\n",
+					 (unsigned long long)upload_rows, (unsigned long long)upload_spans,
+					 (f64)upload_rows*AZUR_WIDTH/n/1024, (unsigned long long)static_frames);
+		printf("palette:         %llu uploads of %llu entries in total\n",
+					 (unsigned long long)palette_uploads, (unsigned long long)palette_entries);
+		printf("platform_bump:   high watermark %llu, committed %llu / reserved %llu bytes\n",
+					 (unsigned long long)Globals.platform_bump.high_watermark, (unsigned long long)Globals.platform_bump.committed,
+					 (unsigned long long)Globals.platform_bump.reserved);
+		printf("frame_bumps:     per frame peak mean %.1f max %llu, committed %llu + %llu / reserved %llu bytes each\n",
+					 (f64)frame_bump_total/n, (unsigned long long)frame_bump_peak,
+					 (unsigned long long)Globals.frame_bumps[0].committed, (unsigned long long)Globals.frame_bumps[1].committed,
+					 (unsigned long long)Globals.frame_bumps[0].reserved);
+		printf("persistent_bump: high watermark %llu, committed %llu / reserved %llu bytes\n",
+					 (unsigned long long)Globals.persistent_bump.high_watermark, (unsigned long long)Globals.persistent_bump.committed,
+					 (unsigned long long)Globals.persistent_bump.reserved);
+		printf("jobs:            %u workers\n", platform_link.worker_count);
+		if (Globals.present_width != 0)
+		{
+			printf("present:         %ux%u on the CPU, mean %.3f us  max %.3f us\n",
+						 Globals.present_width, Globals.present_height, (f64)present_time/n/1e3, present_max/1e3);
+		}
+		if (Globals.watch)
+		{
+			printf("reload:          %u reloads, %u failed, prepare max %.3f ms on the watcher, swap max %.3f us on the main thread\n",
+						 Globals.reload_count, Globals.reload_failures, Globals.reload_prepare_max/1e6, reload_swap_max/1e3);
+		}
+		if (Globals.pack != 0)
+		{
+			printf("pack:            %u entries, %llu bytes mapped from %s\n",
+						 Globals.pack->entry_count, (unsigned long long)Globals.pack->file_size, Globals.pack_path);
+		}
+		if (Globals.atlas != 0)
+		{
+			printf("atlas:           %u sprites, %u frames, %llu bytes loaded in %.3f us\n", Globals.atlas->sprite_count,
+						 Globals.atlas->frame_count, (unsigned long long)Globals.atlas->file_size, Globals.atlas_load_time/1e3);
+		}
+		if (Globals.capture_path != 0)
+		{
+			printf("capture:         %llu submitted, %llu dropped, %llu GIF frames to %s\n",
+						 (unsigned long long)Globals.capture.submitted, (unsigned long long)Globals.capture.dropped,
+						 (unsigned long long)Globals.capture.emitted_frames, Globals.capture_path);
+			printf("capture submit:  mean %.3f us  max %.3f us  (%.2f%% of measured frame time, %.3f%% of a 60 Hz frame)\n",
+						 (f64)capture_time/n/1e3, capture_max/1e3, 100.0*capture_time/total, 100.0*capture_time/n/(1e9/60));
+		}
+		{
+			Mixer* mixer = &Globals.mixer;
+
+			printf("audio:           %llu periods of %u frames at %u Hz to %s, %llu underruns, sink late by max %.3f us\n",
+						 (unsigned long long)mixer->played_periods, AUDIO_PERIOD_FRAMES, AUDIO_SAMPLE_RATE,
+						 (Globals.audio_path != 0 ? Globals.audio_path : "the null sink"), (unsigned long long)mixer->underruns,
+						 mixer->late_ns_max/1e3);
+			printf("audio mix:       %llu periods, mean %.3f us  max %.3f us, up to %u voices, %llu commands, %llu dropped, %llu voices dropped\n",
+						 (unsigned long long)mixer->mixed_periods, (f64)mixer->mix_ns_total/(mixer->mixed_periods ? mixer->mixed_periods : 1)/1e3,
+						 mixer->mix_ns_max/1e3, mixer->voice_count_max, (unsigned long long)mixer->queue.queued,
+						 (unsigned long long)mixer->queue.dropped, (unsigned long long)mixer->voices_dropped);
+			printf("audio latency:   at most %.3f ms from queueing a command to the device taking it\n",
+						 (f64)AUDIO_PERIOD_COUNT*AUDIO_PERIOD_FRAMES*1e3/AUDIO_SAMPLE_RATE);
+		}
+		if (Globals.profiler != 0)
+		{
+			Profiler* profiler = Globals.profiler;
+
+			static Profile_Summary summary;
+			Profile_Summarize(profiler, profiler->start_tsc, U64_MAX, &summary);
+
+			printf("profile:         %.3f GHz TSC, trace written to %s\n", profiler->tsc_frequency/1e9, Globals.profile_path);
+			for (u32 i = 0; i < PROFILE_MAX_SITES; ++i)
+			{
+				if (summary.calls[i] == 0) continue;
+
+				f64 ns_per_cycle = 1e9/(f64)profiler->tsc_frequency;
+				printf("  %-24s %9llu calls  total %10.3f ms  self %10.3f ms  %10.3f us/call\n",
+							 profiler->sites[i].name, (unsigned long long)summary.calls[i],
+							 summary.total_cycles[i]*ns_per_cycle/1e6, summary.self_cycles[i]*ns_per_cycle/1e6,
+							 summary.total_cycles[i]*ns_per_cycle/1e3/summary.calls[i]);
+			}
+		}
+		if (Globals.record_path != 0)
+		{
+			printf("record:          %llu frames to %s\n", (unsigned long long)Globals.recorder.header.frame_count, Globals.record_path);
+		}
+		if (Globals.replay_path != 0)
+		{
+			printf("replay:          %llu frames from %s, ", (unsigned long long)Globals.replay.frame_count, Globals.replay_path);
+			if (Globals.replay.mismatches == 0) printf("every frame hash matches\n");
+			else                                printf("%llu frame hashes differ, first at frame %llu\n",
+			                                           (unsigned long long)Globals.replay.mismatches, (unsigned long long)Globals.replay.first_mismatch);
+		}
+		if (Globals.bump_trace != 0)
+		{
+			Bump_Trace* trace = Globals.bump_trace;
+
+			printf("bump trace:      %llu records, %llu dropped, %u call sites in %u arenas, mean %.3f us a frame, written to %s\n",
+						 (unsigned long long)trace->record_count, (unsigned long long)trace->dropped_records, trace->site_count,
+						 trace->arena_count, (f64)bump_trace_time/n/1e3, Globals.bump_trace_path);
+		}
+		if (Globals.rewind_mb != 0)
+		{
+			Rewind* rewind = &Globals.rewind;
+
+			printf("rewind:          %llu frames held in %.3f of %llu MB, %.1f bytes/frame mean, max %llu, %llu dropped, %llu resets\n",
+						 (unsigned long long)rewind_held, rewind_bytes_held/(f64)(1 << 20), (unsigned long long)Globals.rewind_mb,
+						 (f64)rewind->captured_bytes/(rewind->captured_frames ? rewind->captured_frames : 1),
+						 (unsigned long long)rewind->max_frame_bytes, (unsigned long long)rewind->dropped_frames,
+						 (unsigned long long)rewind->resets);
+			printf("rewind capture:  mean %.3f us  max %.3f us  (%.3f%% of a 60 Hz frame)\n",
+						 (f64)rewind_time/n/1e3, rewind_max/1e3, 100.0*rewind_time/n/(1e9/60));
+		}
+		if (Globals.rewind_mb != 0 && Globals.replay_path != 0)
+		{
+			printf("rewind check:    stepped back %llu frames, mean %.3f us  max %.3f us, ", (unsigned long long)rewind_steps,
+						 (f64)rewind_step_time/(rewind_steps ? rewind_steps : 1)/1e3, rewind_step_max/1e3);
+			if (Globals.rewind_mismatches == 0) printf("every frame hash matches\n");
+			else                                printf("%llu frame hashes differ, first at frame %llu\n",
+			                                           (unsigned long long)Globals.rewind_mismatches, (unsigned long long)Globals.rewind_first_mismatch);
+		}
+		if (dump_count != 0) printf("dumps:           %llu to %s/\n", (unsigned long long)dump_count, Globals.dump_dir);
+	}
+
+	OS_DestroyTimer(&frame_timer);
+	dlclose(Globals.game_code.module);
+	if (Globals.pack != 0) munmap(Globals.pack, Globals.pack->file_size);
+	if (Globals.capture_path != 0) Bump_Destroy(&Globals.capture_bump);
+	Bump_Destroy(&Globals.audio_bump);
+	if (Globals.profiler != 0) Bump_Destroy(&Globals.profile_bump);
+	Bump_Destroy(&Globals.stats_bump);
+	if (Globals.replay_path != 0) Bump_Destroy(&Globals.replay_bump);
+	if (Globals.present_width != 0) Bump_Destroy(&Globals.present_bump);
+	if (Globals.rewind_mb != 0)
+	{
+		Rewind_Destroy(&Globals.rewind);
+		Bump_Destroy(&Globals.rewind_bump);
+	}
+	Bump_Destroy(&Globals.persistent_bump);
+	Bump_Destroy(&Globals.frame_bumps[1]);
+	Bump_Destroy(&Globals.frame_bumps[0]);
+	Bump_Destroy(&Globals.platform_bump);
+
+	// NOTE: a replay that drew something else than when it was recorded, or when stepped back to, fails the run
+	return (Globals.replay.mismatches == 0 && Globals.rewind_mismatches == 0 ? 0 : 1);
+}
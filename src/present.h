@@ -0,0 +1,255 @@
+// NOTE: Presents the indexed framebuffer on the CPU. It is used for screenshots, headless runs and anything else
+//       without GL. The output is what the Win32 host's fragment shader draws:
+//         - every index resolves to its palette entry
+//         - the framebuffer is scaled with nearest sampling into the viewport Present_Viewport picks for the target
+//         - everything around the viewport gets the clear color
+//       Target pixels are 0xAABBGGRR, so the bytes in memory are R, G, B, A like a GL_RGBA8 readback.
+//
+//       The shader samples texel floor((x + 0.5)*AZUR_WIDTH/viewport width), and the same on y. At a whole multiple
+//       of 320x180 such a sample never lands on a texel edge, so the output matches the GL path bit for bit. At other
+//       sizes the GPU may round a sample that sits exactly on an edge the other way.
+//
+//       Target rows are independent. Present_Rows is a Job_Range_Func over them, so a frame splits into bands of rows
+//       with parallel_for. A band resolves each framebuffer row it shows once, then scales it into every target row
+//       that shows it. The scalar version is the reference implementation and must produce identical output.
+
+#define PRESENT_CLEAR_COLOR 0xFFFF00FF // NOTE: glClearColor(1, 0, 1, 1)
+
+typedef struct Present
+{
+	Framebuffer* framebuffer;
+	u32 lut[AZUR_PALETTE_SIZE];
+
+	u32* pixels;
+	u32 width;
+	u32 height;
+	u32 stride;      // NOTE: in pixels
+	s32 viewport[4]; // NOTE: x, y, width, height with y going down from the top of the target, unlike GL
+
+	// NOTE: Every 8 viewport columns sample at most 8 framebuffer columns when the viewport is at least as wide as
+	//       the framebuffer. Such a block is one unaligned load from the resolved row at block_bases, then one
+	//       permute by block_perms. block_count is 0 when the viewport is narrower, then the scalar path is used.
+	u32 (*block_perms)[8];
+	u16* block_bases;
+	u32 block_count;
+} Present;
+
+// NOTE: The largest 16:9 rect made of whole 16x9 steps, centered in width x height. y goes up from the bottom like
+//       glViewport takes it.
+static void
+Present_Viewport(u32 width, u32 height, s32 viewport[4])
+{
+	u32 mw = width/16;
+	u32 mh = height/9;
+	u32 m  = (mh < mw ? mh : mw);
+
+	viewport[0] = (s32)(width  - m*16)/2;
+	viewport[1] = (s32)(height - m*9)/2;
+	viewport[2] = (s32)(m*16);
+	viewport[3] = (s32)(m*9);
+}
+
+static u32
+Present_SampleColumn(Present* present, s32 x)
+{
+	return (u32)(((u64)(2*x + 1)*AZUR_WIDTH)/(2*(u64)present->viewport[2]));
+}
+
+static u32
+Present_SampleRow(Present* present, s32 y)
+{
+	return (u32)(((u64)(2*y + 1)*AZUR_HEIGHT)/(2*(u64)present->viewport[3]));
+}
+
+// NOTE: Sets up presenting into a width x height target and pushes the sampling tables onto bump. The result can
+//       be kept for as long as the target keeps its size.
+static void
+Present_Create(Present* present, Bump* bump, u32* pixels, u32 width, u32 height, u32 stride)
+{
+	*present = (Present){
+		.pixels = pixels,
+		.width  = width,
+		.height = height,
+		.stride = stride,
+	};
+
+	s32* viewport = present->viewport;
+	Present_Viewport(width, height, viewport);
+	viewport[1] = (s32)height - viewport[1] - viewport[3];
+
+	// NOTE: viewport widths are multiples of 16, so blocks cover the viewport exactly
+	if (viewport[2] >= AZUR_WIDTH)
+	{
+		u32 block_count = (u32)viewport[2]/8;
+
+		present->block_perms = Bump_Push(bump, block_count*sizeof(present->block_perms[0]), 32);
+		present->block_bases = Bump_Push(bump, block_count*sizeof(u16), 2);
+		present->block_count = block_count;
+
+		for (u32 i = 0; i < block_count; ++i)
+		{
+			u32 base = Present_SampleColumn(present, (s32)i*8);
+
+			present->block_bases[i] = (u16)base;
+			for (u32 j = 0; j < 8; ++j) present->block_perms[i][j] = Present_SampleColumn(present, (s32)(i*8 + j)) - base;
+		}
+	}
+}
+
+static void
+Present_Fill(u32* dst, s32 count, u32 color)
+{
+	s32 i = 0;
+
+#ifdef __AVX2__
+	__m256i fill = _mm256_set1_epi32((int)color);
+	for (; i + 8 <= count; i += 8) _mm256_storeu_si256((__m256i*)(dst + i), fill);
+#endif
+
+	for (; i < count; ++i) dst[i] = color;
+}
+
+static void
+Present_RowsScalar(void* data, u32 first, u32 count, Bump* scratch)
+{
+	Present* present = data;
+	s32* viewport    = present->viewport;
+
+	for (u32 y = first; y < first + count; ++y)
+	{
+		u32* dst = present->pixels + (umm)y*present->stride;
+		s32 vy   = (s32)y - viewport[1];
+
+		for (s32 x = 0; x < (s32)present->width; ++x)
+		{
+			s32 vx = x - viewport[0];
+
+			if (vx >= 0 && vx < viewport[2] && vy >= 0 && vy < viewport[3])
+			{
+				u8 index = present->framebuffer->pixels[Present_SampleRow(present, vy)][Present_SampleColumn(present, vx)];
+				dst[x] = present->lut[index];
+			}
+			else
+			{
+				dst[x] = PRESENT_CLEAR_COLOR;
+			}
+		}
+	}
+}
+
+#ifdef __AVX2__
+// NOTE: a gather is slow next to the permutes scaling the row, but it runs once per framebuffer row shown
+static void
+Present_ResolveRowAVX2(u32* dst, u8* src, u32* lut)
+{
+	for (u32 x = 0; x < AZUR_WIDTH; x += 8)
+	{
+		__m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i*)(src + x)));
+		_mm256_storeu_si256((__m256i*)(dst + x), _mm256_i32gather_epi32((int*)lut, indices, 4));
+	}
+}
+
+static void
+Present_RowsAVX2(void* data, u32 first, u32 count, Bump* scratch)
+{
+	Present* present = data;
+	s32* viewport    = present->viewport;
+
+	// NOTE: padded so the load of the last block can run past the end of the row
+	u32 resolved[AZUR_WIDTH + 8];
+	u32 resolved_row = U32_MAX;
+
+	for (u32 y = first; y < first + count; ++y)
+	{
+		u32* dst = present->pixels + (umm)y*present->stride;
+		s32 vy   = (s32)y - viewport[1];
+
+		if (vy < 0 || vy >= viewport[3])
+		{
+			Present_Fill(dst, (s32)present->width, PRESENT_CLEAR_COLOR);
+			continue;
+		}
+
+		Present_Fill(dst, viewport[0], PRESENT_CLEAR_COLOR);
+		Present_Fill(dst + viewport[0] + viewport[2], (s32)present->width - viewport[0] - viewport[2], PRESENT_CLEAR_COLOR);
+
+		u32 row = Present_SampleRow(present, vy);
+		if (row != resolved_row)
+		{
+			Present_ResolveRowAVX2(resolved, present->framebuffer->pixels[row], present->lut);
+			resolved_row = row;
+		}
+
+		u32* out = dst + viewport[0];
+		if (((umm)out & 31) == 0)
+		{
+			// NOTE: nothing reads the target back, streaming stores skip fetching the lines they overwrite
+			for (u32 i = 0; i < present->block_count; ++i)
+			{
+				__m256i colors = _mm256_loadu_si256((__m256i*)(resolved + present->block_bases[i]));
+				__m256i perm   = _mm256_load_si256((__m256i*)present->block_perms[i]);
+				_mm256_stream_si256((__m256i*)(out + i*8), _mm256_permutevar8x32_epi32(colors, perm));
+			}
+		}
+		else
+		{
+			for (u32 i = 0; i < present->block_count; ++i)
+			{
+				__m256i colors = _mm256_loadu_si256((__m256i*)(resolved + present->block_bases[i]));
+				__m256i perm   = _mm256_load_si256((__m256i*)present->block_perms[i]);
+				_mm256_storeu_si256((__m256i*)(out + i*8), _mm256_permutevar8x32_epi32(colors, perm));
+			}
+		}
+	}
+
+	// NOTE: streaming stores are weakly ordered, they have to be visible before the job counter says the band is done
+	_mm_sfence();
+}
+#endif
+
+static void
+Present_Rows(void* data, u32 first, u32 count, Bump* scratch)
+{
+#ifdef __AVX2__
+	Present* present = data;
+
+	if (present->block_count != 0) Present_RowsAVX2(data, first, count, scratch);
+	else                           Present_RowsScalar(data, first, count, scratch);
+#else
+	Present_RowsScalar(data, first, count, scratch);
+#endif
+}
+
+static u32
+Present_Color(u32 color)
+{
+	return 0xFF000000 | ((color & 0xFF) << 16) | (color & 0xFF00) | ((color >> 16) & 0xFF);
+}
+
+static void
+Present_SetPalette(Present* present, Palette* palette)
+{
+	for (u32 i = 0; i < AZUR_PALETTE_SIZE; ++i) present->lut[i] = Present_Color(palette->colors[i]);
+}
+
+// NOTE: Picks up the dirty range of palette and splits the target into bands with parallel_for, then waits for them.
+//       Has to see every change to the palette before its dirty range is cleared, after Present_SetPalette once.
+//       Without parallel_for everything runs on the calling thread.
+static void
+Present_Frame(Present* present, Framebuffer* framebuffer, Palette* palette, Job_Parallel_For_Func* parallel_for, Job_Wait_Func* wait)
+{
+	present->framebuffer = framebuffer;
+
+	for (u32 i = palette->dirty_first; i < palette->dirty_end; ++i) present->lut[i] = Present_Color(palette->colors[i]);
+
+	if (parallel_for != 0)
+	{
+		Job_Counter counter = {0};
+		parallel_for(Present_Rows, present, present->height, 0, &counter);
+		wait(&counter);
+	}
+	else
+	{
+		Present_Rows(present, 0, present->height, 0);
+	}
+}
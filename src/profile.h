@@ -0,0 +1,431 @@
+// NOTE: Scoped RDTSC profiler shared by the platform and the game. Each thread records finished zones into its own
+//       ring, so recording a zone is two timestamps and a 16 byte store with no locking. The Profiler and its rings
+//       are owned by the platform and handed to the game through Platform_Link. Zone names are copied into the
+//       Profiler the first time a zone runs, so nothing in it points into the game module and it survives reloads.
+//
+//       Zones compile to nothing unless AZUR_DEBUG or AZUR_PROFILE is defined.
+//
+//       PROFILE_BEGIN(Simulate);
+//       ...
+//       PROFILE_END(Simulate);
+
+#if defined(AZUR_DEBUG) || defined(AZUR_PROFILE)
+#define AZUR_PROFILING 1
+#endif
+
+#define PROFILE_MAX_THREADS 16
+#define PROFILE_MAX_SITES   256
+#define PROFILE_MAX_DEPTH   32
+#define PROFILE_RING_SIZE   (1 << 14) // NOTE: records per thread, must be a power of two
+#define PROFILE_FRAME_RING  256
+#define PROFILE_NAME_LEN    32
+
+// NOTE: returned once every site is taken, zones registered after that are all lumped together under this one
+#define PROFILE_OVERFLOW_SITE (PROFILE_MAX_SITES - 1)
+
+typedef struct Profile_Record
+{
+	u64 begin;
+	u32 cycles;
+	u16 site;
+	u16 depth;
+} Profile_Record;
+
+typedef struct Profile_Thread
+{
+	Profile_Record* records;
+	volatile u32 write_index;
+	u32 depth;
+	char name[PROFILE_NAME_LEN];
+} Profile_Thread;
+
+typedef struct Profile_Site
+{
+	char name[PROFILE_NAME_LEN];
+} Profile_Site;
+
+typedef struct Profiler Profiler;
+typedef Profile_Thread* Profile_Get_Thread_Func(void);
+
+struct Profiler
+{
+	u64 tsc_frequency;
+	u64 start_tsc;
+
+	// NOTE: the game module has its own copy of the thread local below, the first zone it runs on a thread asks the
+	//       platform which ring belongs to that thread
+	Profile_Get_Thread_Func* get_thread;
+
+	volatile u32 lock;
+	volatile u32 site_count;
+	volatile u32 thread_count;
+
+	u32 frame_count;
+	u64 frame_tsc[PROFILE_FRAME_RING];
+
+	Profile_Site sites[PROFILE_MAX_SITES];
+	Profile_Thread threads[PROFILE_MAX_THREADS];
+};
+
+// NOTE: per module, the game sets its copy from Platform_Link every Tick
+static Profiler* ProfilerInstance;
+static AZUR_THREAD_LOCAL Profile_Thread* ProfileThread;
+
+static void
+Profile_CopyName(char* dst, const char* src)
+{
+	// NOTE: names end up in JSON unescaped, anything that would need escaping is replaced
+	umm i = 0;
+	for (; i < PROFILE_NAME_LEN-1 && src[i] != 0; ++i)
+	{
+		char c = src[i];
+		dst[i] = (c >= 0x20 && c < 0x7F && c != '"' && c != '\\' ? c : '_');
+	}
+
+	dst[i] = 0;
+}
+
+static bool
+Profile_NameEqual(const char* stored, const char* name)
+{
+	umm i = 0;
+	for (; i < PROFILE_NAME_LEN-1 && name[i] != 0; ++i)
+	{
+		char c = name[i];
+		if (stored[i] != (c >= 0x20 && c < 0x7F && c != '"' && c != '\\' ? c : '_')) return false;
+	}
+
+	return (stored[i] == 0);
+}
+
+static void
+Profile_Lock(Profiler* profiler)
+{
+	while (!Atomic_CompareExchange32(&profiler->lock, 0, 1)) _mm_pause();
+}
+
+static void
+Profile_Unlock(Profiler* profiler)
+{
+	Atomic_StoreRelease32(&profiler->lock, 0);
+}
+
+static u32
+Profile_RegisterSite(Profiler* profiler, const char* name)
+{
+	u32 result = PROFILE_OVERFLOW_SITE;
+
+	Profile_Lock(profiler);
+
+	u32 site_count = profiler->site_count;
+	for (u32 i = 0; i < site_count; ++i)
+	{
+		if (Profile_NameEqual(profiler->sites[i].name, name))
+		{
+			result = i;
+			break;
+		}
+	}
+
+	if (result == PROFILE_OVERFLOW_SITE && site_count < PROFILE_OVERFLOW_SITE)
+	{
+		Profile_CopyName(profiler->sites[site_count].name, name);
+		Atomic_StoreRelease32(&profiler->site_count, site_count + 1);
+		result = site_count;
+	}
+
+	Profile_Unlock(profiler);
+
+	return result;
+}
+
+// NOTE: must be called on the thread being registered, zones on threads that never registered are not recorded
+static bool
+Profile_RegisterThread(Profiler* profiler, const char* name)
+{
+	bool succeeded = false;
+
+	if (profiler != 0 && ProfileThread == 0)
+	{
+		u32 index = Atomic_FetchAdd32(&profiler->thread_count, 1);
+		if (index < PROFILE_MAX_THREADS)
+		{
+			Profile_CopyName(profiler->threads[index].name, name);
+			ProfileThread = &profiler->threads[index];
+			succeeded     = true;
+		}
+	}
+
+	return succeeded;
+}
+
+static Profile_Thread*
+Profile_GetThread(void)
+{
+	return ProfileThread;
+}
+
+static Profile_Thread*
+Profile_CurrentThread(void)
+{
+	Profile_Thread* thread = ProfileThread;
+
+	if (thread == 0 && ProfilerInstance != 0)
+	{
+		thread        = ProfilerInstance->get_thread();
+		ProfileThread = thread;
+	}
+
+	return thread;
+}
+
+static u64
+Profile_Begin(u32* site, const char* name)
+{
+	Profile_Thread* thread = Profile_CurrentThread();
+	if (thread == 0) return 0;
+
+	// NOTE: sites are numbered from 1 in the per module statics, so 0 means not registered with this profiler yet
+	if (*site == 0) *site = Profile_RegisterSite(ProfilerInstance, name) + 1;
+
+	thread->depth += 1;
+
+	return __rdtsc();
+}
+
+static void
+Profile_End(u32 site, u64 begin)
+{
+	u64 end = __rdtsc();
+
+	if (begin != 0)
+	{
+		Profile_Thread* thread = ProfileThread;
+		thread->depth -= 1;
+
+		u64 cycles = end - begin;
+		u32 index  = thread->write_index;
+
+		thread->records[index & (PROFILE_RING_SIZE-1)] = (Profile_Record){
+			.begin  = begin,
+			.cycles = (u32)(cycles < U32_MAX ? cycles : U32_MAX),
+			.site   = (u16)(site - 1),
+			.depth  = (u16)thread->depth,
+		};
+
+		Atomic_StoreRelease32(&thread->write_index, index + 1);
+	}
+}
+
+// NOTE: called by the platform on the main thread once per frame, before the game ticks
+static void
+Profile_FrameMark(Profiler* profiler)
+{
+	profiler->frame_tsc[profiler->frame_count % PROFILE_FRAME_RING] = __rdtsc();
+	profiler->frame_count += 1;
+}
+
+#ifdef AZUR_PROFILING
+#define PROFILE_ATTACH(PROFILER) (ProfilerInstance = (PROFILER))
+#define PROFILE_THREAD(NAME)     Profile_RegisterThread(ProfilerInstance, (NAME))
+#define PROFILE_BEGIN(NAME)      static u32 Profile__Site_##NAME = 0; u64 Profile__Begin_##NAME = Profile_Begin(&Profile__Site_##NAME, #NAME)
+#define PROFILE_END(NAME)        Profile_End(Profile__Site_##NAME, Profile__Begin_##NAME)
+#define PROFILE_FRAME_MARK()     (ProfilerInstance != 0 ? Profile_FrameMark(ProfilerInstance) : (void)0)
+#else
+#define PROFILE_ATTACH(PROFILER)
+#define PROFILE_THREAD(NAME)
+#define PROFILE_BEGIN(NAME)
+#define PROFILE_END(NAME)
+#define PROFILE_FRAME_MARK()
+#endif
+
+/// Platform side
+
+static umm
+Profile_MemorySize(void)
+{
+	return sizeof(Profiler) + 64 + PROFILE_MAX_THREADS*PROFILE_RING_SIZE*sizeof(Profile_Record);
+}
+
+// NOTE: get_thread must return the calling thread's ring as registered in the platform module
+static Profiler*
+Profile_Create(Bump* bump, u64 tsc_frequency, Profile_Get_Thread_Func* get_thread)
+{
+	Profiler* profiler = Bump_Push(bump, sizeof(Profiler), 64);
+
+	*profiler = (Profiler){
+		.tsc_frequency = tsc_frequency,
+		.start_tsc     = __rdtsc(),
+		.get_thread    = get_thread,
+	};
+
+	for (u32 i = 0; i < PROFILE_MAX_THREADS; ++i)
+	{
+		profiler->threads[i].records = Bump_Push(bump, PROFILE_RING_SIZE*sizeof(Profile_Record), 64);
+	}
+
+	Profile_CopyName(profiler->sites[PROFILE_OVERFLOW_SITE].name, "(too many zones)");
+
+	return profiler;
+}
+
+typedef struct Profile_Summary
+{
+	u64 total_cycles[PROFILE_MAX_SITES];
+	u64 self_cycles[PROFILE_MAX_SITES];
+	u64 calls[PROFILE_MAX_SITES];
+} Profile_Summary;
+
+// NOTE: Accumulates every recorded zone that ended in [from_tsc, to_tsc). Records are written when a zone ends, so a
+//       zone's children always come before it in its thread's ring, one depth deeper. Self time is what is left of
+//       a zone's total once its direct children are subtracted.
+static void
+Profile_Summarize(Profiler* profiler, u64 from_tsc, u64 to_tsc, Profile_Summary* summary)
+{
+	*summary = (Profile_Summary){0};
+
+	u32 thread_count = Atomic_LoadAcquire32(&profiler->thread_count);
+	if (thread_count > PROFILE_MAX_THREADS) thread_count = PROFILE_MAX_THREADS;
+
+	for (u32 i = 0; i < thread_count; ++i)
+	{
+		Profile_Thread* thread = &profiler->threads[i];
+
+		u64 child_cycles[PROFILE_MAX_DEPTH + 1] = {0};
+
+		u32 end   = Atomic_LoadAcquire32(&thread->write_index);
+		u32 count = (end < PROFILE_RING_SIZE ? end : PROFILE_RING_SIZE);
+
+		for (u32 j = end - count; j != end; ++j)
+		{
+			Profile_Record* record = &thread->records[j & (PROFILE_RING_SIZE-1)];
+
+			u32 depth = (record->depth < PROFILE_MAX_DEPTH ? record->depth : PROFILE_MAX_DEPTH - 1);
+			u64 children = child_cycles[depth + 1];
+			child_cycles[depth + 1]  = 0;
+			child_cycles[depth]     += record->cycles;
+
+			u64 record_end = record->begin + record->cycles;
+			if (record_end < from_tsc || record_end >= to_tsc) continue;
+
+			summary->total_cycles[record->site] += record->cycles;
+			summary->self_cycles[record->site]  += (children < record->cycles ? record->cycles - children : 0);
+			summary->calls[record->site]        += 1;
+		}
+	}
+}
+
+typedef void Profile_Write_Func(void* context, u8* data, umm size);
+
+typedef struct Profile_Writer
+{
+	Profile_Write_Func* write;
+	void* context;
+	umm used;
+	u8 buffer[4096];
+} Profile_Writer;
+
+static void
+Profile_WriterFlush(Profile_Writer* writer)
+{
+	if (writer->used != 0) writer->write(writer->context, writer->buffer, writer->used);
+	writer->used = 0;
+}
+
+static void
+Profile_WriteString(Profile_Writer* writer, const char* string)
+{
+	for (umm i = 0; string[i] != 0; ++i)
+	{
+		if (writer->used == sizeof(writer->buffer)) Profile_WriterFlush(writer);
+		writer->buffer[writer->used++] = (u8)string[i];
+	}
+}
+
+static void
+Profile_WriteU64(Profile_Writer* writer, u64 value)
+{
+	char digits[21];
+	umm i = sizeof(digits) - 1;
+	digits[i] = 0;
+
+	do
+	{
+		digits[--i] = (char)('0' + value%10);
+		value /= 10;
+	} while (value != 0);
+
+	Profile_WriteString(writer, &digits[i]);
+}
+
+// NOTE: trace timestamps are in microseconds, written with nanosecond precision
+static void
+Profile_WriteMicroseconds(Profile_Writer* writer, Profiler* profiler, u64 cycles)
+{
+	u64 ns = (u64)((f64)cycles*1e9/(f64)profiler->tsc_frequency);
+
+	char fraction[5] = { '.', (char)('0' + ns/100%10), (char)('0' + ns/10%10), (char)('0' + ns%10), 0 };
+
+	Profile_WriteU64(writer, ns/1000);
+	Profile_WriteString(writer, fraction);
+}
+
+// NOTE: Writes everything still in the rings as Chrome trace_event JSON, loadable in chrome://tracing or Perfetto.
+//       Meant to run once the threads being profiled are done, records written during the dump may be torn.
+static void
+Profile_WriteChromeTrace(Profiler* profiler, Profile_Write_Func* write, void* context)
+{
+	static Profile_Writer writer;
+	writer = (Profile_Writer){ .write = write, .context = context };
+
+	Profile_WriteString(&writer, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	u32 thread_count = Atomic_LoadAcquire32(&profiler->thread_count);
+	if (thread_count > PROFILE_MAX_THREADS) thread_count = PROFILE_MAX_THREADS;
+
+	bool first = true;
+	for (u32 i = 0; i < thread_count; ++i)
+	{
+		Profile_Thread* thread = &profiler->threads[i];
+
+		Profile_WriteString(&writer, (first ? "" : ",\n"));
+		Profile_WriteString(&writer, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":");
+		Profile_WriteU64(&writer, i);
+		Profile_WriteString(&writer, ",\"args\":{\"name\":\"");
+		Profile_WriteString(&writer, thread->name);
+		Profile_WriteString(&writer, "\"}}");
+		first = false;
+
+		u32 end   = Atomic_LoadAcquire32(&thread->write_index);
+		u32 count = (end < PROFILE_RING_SIZE ? end : PROFILE_RING_SIZE);
+
+		for (u32 j = end - count; j != end; ++j)
+		{
+			Profile_Record* record = &thread->records[j & (PROFILE_RING_SIZE-1)];
+			if (record->begin < profiler->start_tsc) continue;
+
+			Profile_WriteString(&writer, ",\n{\"name\":\"");
+			Profile_WriteString(&writer, profiler->sites[record->site].name);
+			Profile_WriteString(&writer, "\",\"ph\":\"X\",\"pid\":0,\"tid\":");
+			Profile_WriteU64(&writer, i);
+			Profile_WriteString(&writer, ",\"ts\":");
+			Profile_WriteMicroseconds(&writer, profiler, record->begin - profiler->start_tsc);
+			Profile_WriteString(&writer, ",\"dur\":");
+			Profile_WriteMicroseconds(&writer, profiler, record->cycles);
+			Profile_WriteString(&writer, "}");
+		}
+	}
+
+	u32 frame_count = (profiler->frame_count < PROFILE_FRAME_RING ? profiler->frame_count : PROFILE_FRAME_RING);
+	for (u32 i = profiler->frame_count - frame_count; i != profiler->frame_count; ++i)
+	{
+		Profile_WriteString(&writer, (first ? "" : ",\n"));
+		Profile_WriteString(&writer, "{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":");
+		Profile_WriteMicroseconds(&writer, profiler, profiler->frame_tsc[i % PROFILE_FRAME_RING] - profiler->start_tsc);
+		Profile_WriteString(&writer, "}");
+		first = false;
+	}
+
+	Profile_WriteString(&writer, "\n]}\n");
+	Profile_WriterFlush(&writer);
+}
@@ -0,0 +1,252 @@
+// NOTE: Recording and replay of play sessions. A recording holds a snapshot of the persistent bump, the framebuffer and
+//       the palette taken before the first recorded frame, then one Replay_Frame per frame with the input and timestep
+//       the game was ticked with and a hash of the framebuffer and palette it produced. Replaying restores the
+//       snapshot and feeds the frames back without looking at the clock, so a session can be rerun on every build as
+//       fast as it goes and any frame that does not show the same picture as when it was recorded shows up as a hash
+//       mismatch.
+//
+//       The persistent bump is copied byte for byte, pointers the game keeps into it only stay valid because both
+//       hosts reserve it at AZUR_PERSISTENT_BASE. The file is native endian, like the atlas.
+
+#define REPLAY_MAGIC   0x50525A41 // NOTE: "AZRP"
+#define REPLAY_VERSION 2
+
+typedef struct Replay_Header
+{
+	u32 magic;
+	u32 version;
+	u32 sim_hz;
+	u32 _pad0;
+	u64 start_tick;
+	u64 persistent_base;
+	u64 persistent_size; // NOTE: padded to 8 bytes in the file, followed by the framebuffer pixels, the palette colors
+	                     //       and the frames
+	u64 frame_count;
+} Replay_Header;
+
+typedef struct Replay_Frame
+{
+	Platform_Input input;
+	u32 sim_steps;
+	f32 alpha;
+	u64 frame_hash;
+} Replay_Frame;
+
+typedef struct Replay_Recorder
+{
+	FILE* file;
+	Replay_Header header;
+	bool write_failed;
+} Replay_Recorder;
+
+typedef struct Replay
+{
+	Replay_Header* header;
+	u8* persistent;
+	u8* pixels;
+	u32* colors;
+	Replay_Frame* frames;
+	u64 frame_count;
+	u64 tick;
+	u64 mismatches;
+	u64 first_mismatch;
+} Replay;
+
+static void
+Replay_HashLanes(u64 lanes[4], u8* data, umm size)
+{
+	for (umm i = 0; i + 32 <= size; i += 32)
+	{
+		for (umm j = 0; j < 4; ++j)
+		{
+			u64 word;
+			memcpy(&word, data + i + j*8, 8);
+			lanes[j] = (lanes[j] ^ word)*0x100000001B3ULL;
+		}
+	}
+}
+
+// NOTE: Four interleaved FNV-1a style lanes over 8 byte words of the pixels and then the colors, folded and mixed at
+//       the end. Each step is a bijection of the lane, so a single changed word always changes the hash. Relies on
+//       both being a multiple of 32 bytes, which 320x180 pixels and 256 colors are.
+static u64
+Replay_HashFrame(Framebuffer* framebuffer, Palette* palette)
+{
+	u64 lanes[4] = { 0xCBF29CE484222325ULL, 0x84222325CBF29CE4ULL, 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL };
+
+	Replay_HashLanes(lanes, &framebuffer->pixels[0][0], sizeof(framebuffer->pixels));
+	Replay_HashLanes(lanes, (u8*)palette->colors, sizeof(palette->colors));
+
+	u64 hash = lanes[0] ^ (lanes[1]*31) ^ (lanes[2]*961) ^ (lanes[3]*29791);
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/// Recording
+
+static bool
+Replay_StartRecording(Replay_Recorder* recorder, FILE* file, u32 sim_hz, u64 start_tick, Bump* persistent_bump, Framebuffer* framebuffer,
+                      Palette* palette)
+{
+	Replay_Header header = {
+		.magic           = REPLAY_MAGIC,
+		.version         = REPLAY_VERSION,
+		.sim_hz          = sim_hz,
+		.start_tick      = start_tick,
+		.persistent_base = (u64)(umm)persistent_bump->memory,
+		.persistent_size = persistent_bump->cursor,
+		.frame_count     = 0,
+	};
+
+	*recorder = (Replay_Recorder){
+		.file   = file,
+		.header = header,
+	};
+
+	u8 padding[8] = {0};
+	umm padding_size = (umm)(-(s64)header.persistent_size & 7);
+
+	bool succeeded = (fwrite(&header, sizeof(header), 1, file) == 1);
+	if (succeeded && header.persistent_size != 0) succeeded = (fwrite(persistent_bump->memory, header.persistent_size, 1, file) == 1);
+	if (succeeded && padding_size != 0)           succeeded = (fwrite(padding, padding_size, 1, file) == 1);
+	if (succeeded)                                succeeded = (fwrite(framebuffer->pixels, sizeof(framebuffer->pixels), 1, file) == 1);
+	if (succeeded)                                succeeded = (fwrite(palette->colors, sizeof(palette->colors), 1, file) == 1);
+
+	recorder->write_failed = !succeeded;
+
+	return succeeded;
+}
+
+// NOTE: called after Tick, with platform_link holding the input and timestep that Tick saw
+static void
+Replay_RecordFrame(Replay_Recorder* recorder, Platform_Link* platform_link)
+{
+	Replay_Frame frame = {
+		.input      = platform_link->input,
+		.sim_steps  = platform_link->sim_steps,
+		.alpha      = platform_link->alpha,
+		.frame_hash = Replay_HashFrame(platform_link->framebuffer, platform_link->palette),
+	};
+
+	if (!recorder->write_failed) recorder->write_failed = (fwrite(&frame, sizeof(frame), 1, recorder->file) != 1);
+
+	recorder->header.frame_count += 1;
+}
+
+// NOTE: patches the frame count into the header, the caller still owns and closes the file
+static bool
+Replay_StopRecording(Replay_Recorder* recorder)
+{
+	bool succeeded = !recorder->write_failed;
+
+	if (succeeded)
+	{
+		succeeded = (fseek(recorder->file, 0, SEEK_SET) == 0 &&
+		             fwrite(&recorder->header, sizeof(Replay_Header), 1, recorder->file) == 1 &&
+		             fflush(recorder->file) == 0);
+	}
+
+	return succeeded;
+}
+
+/// Playback
+
+// NOTE: reads the whole recording into bump, replay points into it
+static bool
+Replay_Load(Replay* replay, FILE* file, Bump* bump)
+{
+	*replay = (Replay){0};
+
+	if (fseek(file, 0, SEEK_END) != 0) return false;
+	long file_size = ftell(file);
+	if (file_size < (long)sizeof(Replay_Header) || fseek(file, 0, SEEK_SET) != 0) return false;
+
+	u8* data = Bump_Push(bump, (u64)file_size, 8);
+	if (fread(data, (umm)file_size, 1, file) != 1) return false;
+
+	Replay_Header* header = (Replay_Header*)data;
+	if (header->magic != REPLAY_MAGIC || header->version != REPLAY_VERSION || header->sim_hz == 0) return false;
+
+	u64 persistent_size = (header->persistent_size + 7) & ~7ULL;
+	u64 pixels_offset   = sizeof(Replay_Header) + persistent_size;
+	u64 colors_offset   = pixels_offset + sizeof(((Framebuffer*)0)->pixels);
+	u64 frames_offset   = colors_offset + sizeof(((Palette*)0)->colors);
+
+	if (header->persistent_size > (u64)file_size || frames_offset > (u64)file_size ||
+	    header->frame_count > ((u64)file_size - frames_offset)/sizeof(Replay_Frame))
+	{
+		//// ERROR
+		// NOTE: truncated, most likely the host died before the recording was stopped
+		return false;
+	}
+
+	*replay = (Replay){
+		.header      = header,
+		.persistent  = data + sizeof(Replay_Header),
+		.pixels      = data + pixels_offset,
+		.colors      = (u32*)(data + colors_offset),
+		.frames      = (Replay_Frame*)(data + frames_offset),
+		.frame_count = header->frame_count,
+		.tick        = header->start_tick,
+	};
+
+	return true;
+}
+
+// NOTE: persistent_bump has to be empty and reserved at the address it was recorded at
+static bool
+Replay_Restore(Replay* replay, Bump* persistent_bump, Framebuffer* framebuffer, Palette* palette)
+{
+	Replay_Header* header = replay->header;
+
+	bool succeeded = (persistent_bump->cursor == 0 && header->persistent_size <= persistent_bump->reserved &&
+	                  (header->persistent_size == 0 || header->persistent_base == (u64)(umm)persistent_bump->memory));
+
+	if (succeeded)
+	{
+		if (header->persistent_size != 0)
+		{
+			void* persistent = Bump_Push(persistent_bump, header->persistent_size, 1);
+			memcpy(persistent, replay->persistent, header->persistent_size);
+		}
+
+		memcpy(framebuffer->pixels, replay->pixels, sizeof(framebuffer->pixels));
+		Framebuffer_MarkAll(framebuffer);
+
+		memcpy(palette->colors, replay->colors, sizeof(palette->colors));
+		Palette_MarkRange(palette, 0, AZUR_PALETTE_SIZE);
+	}
+
+	return succeeded;
+}
+
+// NOTE: Stands in for Timestep_Advance and the input snapshot, frames have to be applied in order. dt is computed the
+//       way Timestep_Advance does it, a different rounding would be enough to change what the game draws.
+static void
+Replay_ApplyFrame(Replay* replay, u64 frame_index, Platform_Link* platform_link)
+{
+	Replay_Frame* frame = &replay->frames[frame_index];
+
+	platform_link->input     = frame->input;
+	platform_link->dt        = (f32)(1000000000ULL/replay->header->sim_hz)/1e9f;
+	platform_link->sim_tick  = replay->tick;
+	platform_link->sim_steps = frame->sim_steps;
+	platform_link->alpha     = frame->alpha;
+
+	replay->tick += frame->sim_steps;
+}
+
+static bool
+Replay_CheckFrame(Replay* replay, u64 frame_index, Framebuffer* framebuffer, Palette* palette)
+{
+	bool matches = (Replay_HashFrame(framebuffer, palette) == replay->frames[frame_index].frame_hash);
+
+	if (!matches && replay->mismatches++ == 0) replay->first_mismatch = frame_index;
+
+	return matches;
+}
@@ -0,0 +1,304 @@
+// NOTE: Rewinding the game. The state of the game is a handful of regions, the persistent bump along with the
+//       framebuffer and palette it draws into, and every frame it is compared against a copy of how it was the frame
+//       before. What changed goes into a ring as a delta, the XOR of the state and the copy, which is zero nearly
+//       everywhere and stored as runs of unchanged words and the changed words in between. Stepping back a frame XORs
+//       the newest delta into both the state and the copy, which turns either back into the frame before.
+//
+//       Regions are compared 8 bytes at a time, memory up to the next multiple of 8 past the end of a region has to be
+//       readable and writable. A region may grow and shrink from frame to frame up to its max_size, stepping back
+//       hands back the sizes the regions had. Between a capture or step back and the next step back the regions must
+//       not change, only memory past their end may. When the ring runs out of room the oldest deltas are dropped,
+//       the oldest state that can be stepped back to moves forward with them.
+//
+//       Requires os.h.
+
+#define REWIND_MAX_REGIONS 4
+#define REWIND_MAX_FRAMES  (1 << 15) // NOTE: a power of two, 9 minutes at 60 Hz
+
+typedef struct Rewind_Region
+{
+	u8* memory;
+	u64 max_size;
+} Rewind_Region;
+
+typedef struct Rewind_Frame
+{
+	u64 offset;                           // NOTE: of the delta, counted from the start, so it never wraps
+	u64 size;
+	u64 sizes_before[REWIND_MAX_REGIONS]; // NOTE: the sizes the regions go back to when the frame is stepped back
+} Rewind_Frame;
+
+typedef struct Rewind
+{
+	Rewind_Region regions[REWIND_MAX_REGIONS];
+	Bump copies[REWIND_MAX_REGIONS];
+	u64 sizes[REWIND_MAX_REGIONS]; // NOTE: of the regions when they were captured last
+	u32 region_count;
+	bool has_baseline;
+
+	u8* ring;
+	u64 ring_size;
+	u64 write_offset;
+	Rewind_Frame* frames;
+	u64 first_frame; // NOTE: frames held are first_frame up to but not including end_frame
+	u64 end_frame;
+
+	/// Stats
+	u64 captured_frames;
+	u64 captured_bytes;
+	u64 max_frame_bytes;
+	u64 dropped_frames;
+	u64 resets;      // NOTE: captures whose worst case did not fit into the ring, history starts over from them
+} Rewind;
+
+// NOTE: The ring and the frame table come from bump, the copies get their own reservations as large as max_size
+static bool
+Rewind_Create(Rewind* rewind, Bump* bump, u64 ring_size, Rewind_Region* regions, u32 region_count)
+{
+	ASSERT(region_count <= REWIND_MAX_REGIONS);
+
+	*rewind = (Rewind){
+		.region_count = region_count,
+		.ring         = Bump_Push(bump, ring_size, 64),
+		.ring_size    = ring_size,
+		.frames       = Bump_Push(bump, REWIND_MAX_FRAMES*sizeof(Rewind_Frame), 8),
+	};
+
+	bool succeeded = true;
+	for (u32 i = 0; i < region_count && succeeded; ++i)
+	{
+		rewind->regions[i] = regions[i];
+		succeeded = Bump_Create(regions[i].max_size + 8, BUMP_DEFAULT_COMMIT_CHUNK, 0, &rewind->copies[i]);
+	}
+
+	return succeeded;
+}
+
+static void
+Rewind_Destroy(Rewind* rewind)
+{
+	for (u32 i = 0; i < rewind->region_count; ++i) Bump_Destroy(&rewind->copies[i]);
+}
+
+static u8*
+Rewind_WriteCount(u8* out, u64 count)
+{
+	for (; count >= 0x80; count >>= 7) *out++ = (u8)(count | 0x80);
+	*out++ = (u8)count;
+
+	return out;
+}
+
+static u64
+Rewind_ReadCount(u8** in)
+{
+	u64 count = 0;
+	for (u32 shift = 0;; shift += 7)
+	{
+		u8 byte = *(*in)++;
+		count |= (u64)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) break;
+	}
+
+	return count;
+}
+
+static u64
+Rewind_WordCount(u64 size)
+{
+	return (size + 7)/8;
+}
+
+// NOTE: The most a region of word_count words can take in a delta. There are at most word_count/2 + 2 runs, and a
+//       count of n takes at most 1 + n/64 bytes, the counts of all runs add up to word_count.
+static u64
+Rewind_DeltaBound(u64 word_count)
+{
+	return word_count*9 + word_count/64 + 8;
+}
+
+// NOTE: Returns the first word from i on that differs between memory and copy, or word_count when there is none
+static u64
+Rewind_NextChange(u64* memory, u64* copy, u64 i, u64 word_count)
+{
+#ifdef __AVX2__
+	// NOTE: nearly everything is unchanged, so this loop is the cost of a capture
+	for (; i + 4 <= word_count; i += 4)
+	{
+		__m256i x = _mm256_xor_si256(_mm256_loadu_si256((__m256i*)(memory + i)), _mm256_loadu_si256((__m256i*)(copy + i)));
+		if (!_mm256_testz_si256(x, x)) break;
+	}
+#endif
+
+	for (; i < word_count && memory[i] == copy[i]; ++i) {}
+
+	return i;
+}
+
+// NOTE: Runs of a count of unchanged words, a count of changed words and the changed words XORed with the copy, which
+//       is brought up to date along the way. A region that ends in unchanged words ends in a run without changes.
+static u8*
+Rewind_EncodeRegion(u8* out, u64* memory, u64* copy, u64 word_count)
+{
+	for (u64 i = 0; i < word_count; )
+	{
+		u64 start = Rewind_NextChange(memory, copy, i, word_count);
+
+		u64 end = start;
+		while (end < word_count && memory[end] != copy[end]) end += 1;
+
+		out = Rewind_WriteCount(out, start - i);
+		out = Rewind_WriteCount(out, end - start);
+
+		for (u64 j = start; j < end; ++j)
+		{
+			u64 delta = memory[j] ^ copy[j];
+			memcpy(out, &delta, sizeof(delta));
+			out += sizeof(delta);
+
+			copy[j] = memory[j];
+		}
+
+		i = end;
+	}
+
+	return out;
+}
+
+static u8*
+Rewind_ApplyRegion(u8* in, u64* memory, u64* copy, u64 word_count)
+{
+	for (u64 i = 0; i < word_count; )
+	{
+		i += Rewind_ReadCount(&in);
+		u64 end = i + Rewind_ReadCount(&in);
+
+		for (; i < end; ++i)
+		{
+			u64 delta;
+			memcpy(&delta, in, sizeof(delta));
+			in += sizeof(delta);
+
+			memory[i] ^= delta;
+			copy[i]   ^= delta;
+		}
+	}
+
+	return in;
+}
+
+// NOTE: Stores how the regions changed since the last capture, sizes holds their sizes now. The first capture only
+//       takes the copy, there is nothing to step back to from it.
+static void
+Rewind_Capture(Rewind* rewind, u64* sizes)
+{
+	u64 bound = 0;
+	for (u32 i = 0; i < rewind->region_count; ++i)
+	{
+		ASSERT(sizes[i] <= rewind->regions[i].max_size);
+
+		// NOTE: copies only ever grow, and bump memory that was never handed out reads as zero
+		Bump* copy = &rewind->copies[i];
+		u64 copy_size = Rewind_WordCount(sizes[i])*8;
+		if (copy_size > copy->cursor) Bump_Push(copy, (umm)(copy_size - copy->cursor), 1);
+
+		bound += Rewind_DeltaBound(Rewind_WordCount(sizes[i]));
+	}
+
+	// NOTE: a delta is never split, it starts over at the front of the ring when it might not fit before the end
+	u64 offset = rewind->write_offset;
+	if (offset % rewind->ring_size + bound > rewind->ring_size) offset += rewind->ring_size - offset % rewind->ring_size;
+
+	if (!rewind->has_baseline || bound > rewind->ring_size)
+	{
+		rewind->resets += rewind->has_baseline;
+		rewind->has_baseline = true;
+
+		for (u32 i = 0; i < rewind->region_count; ++i)
+		{
+			memcpy(rewind->copies[i].memory, rewind->regions[i].memory, (umm)(Rewind_WordCount(sizes[i])*8));
+			rewind->sizes[i] = sizes[i];
+		}
+
+		rewind->dropped_frames += rewind->end_frame - rewind->first_frame;
+		rewind->first_frame     = rewind->end_frame;
+
+		return;
+	}
+
+	// NOTE: drops the oldest frames whose deltas the new one may write over
+	while (rewind->first_frame != rewind->end_frame &&
+	       (rewind->frames[rewind->first_frame % REWIND_MAX_FRAMES].offset + rewind->ring_size < offset + bound ||
+	        rewind->end_frame - rewind->first_frame == REWIND_MAX_FRAMES))
+	{
+		rewind->first_frame    += 1;
+		rewind->dropped_frames += 1;
+	}
+
+	Rewind_Frame* frame = &rewind->frames[rewind->end_frame % REWIND_MAX_FRAMES];
+	frame->offset = offset;
+
+	u8* start = rewind->ring + offset % rewind->ring_size;
+	u8* out   = start;
+	for (u32 i = 0; i < rewind->region_count; ++i)
+	{
+		out = Rewind_EncodeRegion(out, (u64*)rewind->regions[i].memory, (u64*)rewind->copies[i].memory, Rewind_WordCount(sizes[i]));
+
+		frame->sizes_before[i] = rewind->sizes[i];
+		rewind->sizes[i]       = sizes[i];
+	}
+
+	frame->size = (u64)(out - start);
+
+	rewind->end_frame    += 1;
+	rewind->write_offset  = offset + frame->size;
+
+	rewind->captured_frames += 1;
+	rewind->captured_bytes  += frame->size;
+	rewind->max_frame_bytes  = (frame->size > rewind->max_frame_bytes ? frame->size : rewind->max_frame_bytes);
+}
+
+// NOTE: Puts the regions back the way they were one capture earlier and writes the sizes they had to sizes. Returns
+//       false when there is nothing left to step back to.
+static bool
+Rewind_StepBack(Rewind* rewind, u64* sizes)
+{
+	if (rewind->first_frame == rewind->end_frame) return false;
+
+	rewind->end_frame -= 1;
+	Rewind_Frame* frame = &rewind->frames[rewind->end_frame % REWIND_MAX_FRAMES];
+
+	u8* in = rewind->ring + frame->offset % rewind->ring_size;
+	for (u32 i = 0; i < rewind->region_count; ++i)
+	{
+		u8* memory = rewind->regions[i].memory;
+		u8* copy   = rewind->copies[i].memory;
+		u64 size   = rewind->sizes[i];
+
+		in = Rewind_ApplyRegion(in, (u64*)memory, (u64*)copy, Rewind_WordCount(size));
+
+		// NOTE: a region that shrank gets the rest back from the copy, which still holds it from the frame before
+		if (frame->sizes_before[i] > size) memcpy(memory + size, copy + size, (umm)(frame->sizes_before[i] - size));
+
+		rewind->sizes[i] = frame->sizes_before[i];
+		sizes[i]         = frame->sizes_before[i];
+	}
+
+	// NOTE: the next capture reuses the room the frame took
+	rewind->write_offset = frame->offset;
+
+	return true;
+}
+
+static u64
+Rewind_FrameCount(Rewind* rewind)
+{
+	return rewind->end_frame - rewind->first_frame;
+}
+
+// NOTE: from the oldest delta held to the end of the newest, including room skipped at the end of the ring
+static u64
+Rewind_BytesHeld(Rewind* rewind)
+{
+	return (rewind->first_frame == rewind->end_frame ? 0 : rewind->write_offset - rewind->frames[rewind->first_frame % REWIND_MAX_FRAMES].offset);
+}
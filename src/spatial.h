@@ -0,0 +1,630 @@
+// NOTE: Broadphase over boxes on the playfield. A uniform grid of square cells covers AZUR_WIDTH x AZUR_HEIGHT and is
+//       rebuilt from scratch every frame: a counting sort puts a reference to every box into each cell it touches,
+//       so building is two passes over the boxes and a few arrays pushed on a bump, usually the frame bump. Boxes
+//       past the edges of the playfield go into the cells along them, so every query stays exact, only slower.
+//
+//       Boxes are [x, x + width) by [y, y + height) and are named by their index in the arrays they were built from,
+//       like dense indices of an Entity_Store. The references of a cell keep a copy of their box next to each other,
+//       so testing a cell is a linear pass over a few floats.
+//
+//       A box in several cells could be reported once for each of them. Pairs and rect queries only report a box in
+//       the cell holding the top left corner of the overlap, which lies in both boxes and so in exactly one cell
+//       they share.
+
+#define SPATIAL_DEFAULT_CELL_SHIFT 3 // NOTE: 8x8 cells, for playfields full of objects a few pixels across
+#define SPATIAL_NO_ITEM            U32_MAX
+#define SPATIAL_MAX_CELL_PAIRS     (1 << 16) // NOTE: room pushed for a cell before its pairs are found, at most
+
+typedef struct Spatial_Pair
+{
+	u32 a; // NOTE: a < b
+	u32 b;
+} Spatial_Pair;
+
+typedef struct Spatial_Grid
+{
+	f32 inv_cell_size;
+	u32 columns;
+	u32 rows;
+	u32 cell_count;
+	u32 item_count;
+
+	// NOTE: the references of cell c are [cell_first[c], cell_first[c + 1]), arrays of references are padded by 8
+	//       so vector loops can read past the last one
+	u32* cell_first;
+	u32* items;
+	f32* min_x;
+	f32* min_y;
+	f32* max_x;
+	f32* max_y;
+	u32 reference_count;
+} Spatial_Grid;
+
+static u32
+Spatial_Cell(f32 v, f32 inv_cell_size, u32 limit)
+{
+	f32 cell = v*inv_cell_size;
+	return (cell < 0 ? 0 : (cell >= (f32)limit ? limit - 1 : (u32)cell));
+}
+
+// NOTE: First and last column and row of the cells a box touches, a byte each
+static u32
+Spatial_CellRange(Spatial_Grid* grid, f32 x, f32 y, f32 width, f32 height)
+{
+	u32 cx0 = Spatial_Cell(x,          grid->inv_cell_size, grid->columns);
+	u32 cy0 = Spatial_Cell(y,          grid->inv_cell_size, grid->rows);
+	u32 cx1 = Spatial_Cell(x + width,  grid->inv_cell_size, grid->columns);
+	u32 cy1 = Spatial_Cell(y + height, grid->inv_cell_size, grid->rows);
+
+	return cx0 | (cy0 << 8) | (cx1 << 16) | (cy1 << 24);
+}
+
+#ifdef __AVX2__
+static __m256i
+Spatial_CellAVX2(__m256 v, __m256 inv_cell_size, __m256 limit)
+{
+	return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(v, inv_cell_size), _mm256_setzero_ps()), limit));
+}
+#endif
+
+// NOTE: cell_shift picks cells of 1 << cell_shift pixels, at least 2 so a grid is never more than 255 cells across
+static void
+Spatial_Build(Spatial_Grid* grid, Bump* bump, f32* x, f32* y, f32* width, f32* height, u32 count, u32 cell_shift)
+{
+	ASSERT(cell_shift >= 2);
+
+	u32 cell_size = 1U << cell_shift;
+	u32 columns   = (AZUR_WIDTH  + cell_size - 1) >> cell_shift;
+	u32 rows      = (AZUR_HEIGHT + cell_size - 1) >> cell_shift;
+
+	*grid = (Spatial_Grid){
+		.inv_cell_size = 1.0f/(f32)cell_size,
+		.columns       = columns,
+		.rows          = rows,
+		.cell_count    = columns*rows,
+		.item_count    = count,
+		.cell_first    = Bump_Push(bump, ((umm)columns*rows + 1)*sizeof(u32), 4),
+	};
+
+	u32* cell_first = grid->cell_first;
+	memset(cell_first, 0, ((umm)grid->cell_count + 1)*sizeof(u32));
+
+	/// Cell ranges of every box
+	u32* ranges = Bump_Push(bump, (umm)count*sizeof(u32), 32);
+
+	u32 i = 0;
+#ifdef __AVX2__
+	__m256 inv_cell_size = _mm256_set1_ps(grid->inv_cell_size);
+	__m256 last_column   = _mm256_set1_ps((f32)(columns - 1));
+	__m256 last_row      = _mm256_set1_ps((f32)(rows - 1));
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 min_x = _mm256_loadu_ps(x + i);
+		__m256 min_y = _mm256_loadu_ps(y + i);
+		__m256 max_x = _mm256_add_ps(min_x, _mm256_loadu_ps(width + i));
+		__m256 max_y = _mm256_add_ps(min_y, _mm256_loadu_ps(height + i));
+
+		__m256i cx0 = Spatial_CellAVX2(min_x, inv_cell_size, last_column);
+		__m256i cy0 = Spatial_CellAVX2(min_y, inv_cell_size, last_row);
+		__m256i cx1 = Spatial_CellAVX2(max_x, inv_cell_size, last_column);
+		__m256i cy1 = Spatial_CellAVX2(max_y, inv_cell_size, last_row);
+
+		__m256i range = _mm256_or_si256(_mm256_or_si256(cx0, _mm256_slli_epi32(cy0, 8)),
+		                                _mm256_or_si256(_mm256_slli_epi32(cx1, 16), _mm256_slli_epi32(cy1, 24)));
+		_mm256_store_si256((__m256i*)(ranges + i), range);
+	}
+#endif
+	for (; i < count; ++i) ranges[i] = Spatial_CellRange(grid, x[i], y[i], width[i], height[i]);
+
+	/// Count the references of every cell, cell_first[c + 1] ends up holding the count of c
+	for (i = 0; i < count; ++i)
+	{
+		u32 cx0   = ranges[i] & 0xFF;
+		u32 cy0   = (ranges[i] >>  8) & 0xFF;
+		u32 right = ((ranges[i] >> 16) & 0xFF) - cx0;
+		u32 down  = (ranges[i] >> 24) - cy0;
+
+		// NOTE: Nearly every box is smaller than a cell and touches a 2x2 block at most. Which of the 4 cells it
+		//       reaches is random, so instead of branching on it the cells it misses get 0 added to the first one.
+		if (right <= 1 && down <= 1)
+		{
+			u32 cell = cy0*columns + cx0 + 1;
+
+			cell_first[cell]                        += 1;
+			cell_first[cell + right]                += right;
+			cell_first[cell + down*columns]         += down;
+			cell_first[cell + down*columns + right] += right & down;
+		}
+		else
+		{
+			for (u32 cy = cy0; cy <= cy0 + down; ++cy)
+			{
+				for (u32 cx = cx0; cx <= cx0 + right; ++cx) cell_first[cy*columns + cx + 1] += 1;
+			}
+		}
+	}
+
+	for (i = 0; i < grid->cell_count; ++i) cell_first[i + 1] += cell_first[i];
+
+	/// Scatter items to their cells
+	u32 reference_count = cell_first[grid->cell_count];
+
+	grid->reference_count = reference_count;
+	grid->items = Bump_Push(bump, ((umm)reference_count + 8)*sizeof(u32), 32);
+	grid->min_x = Bump_Push(bump, ((umm)reference_count + 8)*sizeof(f32), 32);
+	grid->min_y = Bump_Push(bump, ((umm)reference_count + 8)*sizeof(f32), 32);
+	grid->max_x = Bump_Push(bump, ((umm)reference_count + 8)*sizeof(f32), 32);
+	grid->max_y = Bump_Push(bump, ((umm)reference_count + 8)*sizeof(f32), 32);
+
+	u32* cursors = Bump_Push(bump, (umm)grid->cell_count*sizeof(u32), 4);
+	memcpy(cursors, cell_first, (umm)grid->cell_count*sizeof(u32));
+
+	for (i = 0; i < count; ++i)
+	{
+		u32 cx0   = ranges[i] & 0xFF;
+		u32 cy0   = (ranges[i] >>  8) & 0xFF;
+		u32 right = ((ranges[i] >> 16) & 0xFF) - cx0;
+		u32 down  = (ranges[i] >> 24) - cy0;
+
+		// NOTE: Same as counting, a cell the box misses is one it does touch, written without moving its cursor.
+		//       The first cell goes last, so such a write always lands in a slot the box still has to fill.
+		if (right <= 1 && down <= 1)
+		{
+			u32 cell = cy0*columns + cx0;
+
+			u32 bottom_right = cell + down*columns + right;
+			grid->items[cursors[bottom_right]] = i;
+			cursors[bottom_right] += right & down;
+
+			u32 bottom = cell + down*columns;
+			grid->items[cursors[bottom]] = i;
+			cursors[bottom] += down;
+
+			grid->items[cursors[cell + right]] = i;
+			cursors[cell + right] += right;
+
+			grid->items[cursors[cell]++] = i;
+		}
+		else
+		{
+			for (u32 cy = cy0; cy <= cy0 + down; ++cy)
+			{
+				for (u32 cx = cx0; cx <= cx0 + right; ++cx) grid->items[cursors[cy*columns + cx]++] = i;
+			}
+		}
+	}
+
+	// NOTE: Boxes are copied in a pass of their own, in the order the references are read. Scattering them with the
+	//       items is slower, a store to a different line in five arrays for every reference.
+	i = 0;
+#ifdef __AVX2__
+	for (; i + 8 <= reference_count; i += 8)
+	{
+		__m256i items = _mm256_load_si256((__m256i*)(grid->items + i));
+		__m256 min_x  = _mm256_i32gather_ps(x, items, 4);
+		__m256 min_y  = _mm256_i32gather_ps(y, items, 4);
+
+		_mm256_store_ps(grid->min_x + i, min_x);
+		_mm256_store_ps(grid->min_y + i, min_y);
+		_mm256_store_ps(grid->max_x + i, _mm256_add_ps(min_x, _mm256_i32gather_ps(width,  items, 4)));
+		_mm256_store_ps(grid->max_y + i, _mm256_add_ps(min_y, _mm256_i32gather_ps(height, items, 4)));
+	}
+#endif
+	for (; i < reference_count; ++i)
+	{
+		u32 item = grid->items[i];
+
+		grid->min_x[i] = x[item];
+		grid->min_y[i] = y[item];
+		grid->max_x[i] = x[item] + width[item];
+		grid->max_y[i] = y[item] + height[item];
+	}
+
+	// NOTE: padding overlaps nothing
+	for (i = reference_count; i < reference_count + 8; ++i)
+	{
+		grid->items[i] = SPATIAL_NO_ITEM;
+		grid->min_x[i] = grid->min_y[i] = 0;
+		grid->max_x[i] = grid->max_y[i] = 0;
+	}
+}
+
+#ifdef __AVX2__
+// NOTE: For every 4 bit mask, the permute that packs the 64 bit lanes it has set to the front
+static const u32 SpatialPackLanes[16][8] = {
+	{ 0, 1, 0, 1, 0, 1, 0, 1 }, { 0, 1, 0, 1, 0, 1, 0, 1 }, { 2, 3, 0, 1, 0, 1, 0, 1 }, { 0, 1, 2, 3, 0, 1, 0, 1 },
+	{ 4, 5, 0, 1, 0, 1, 0, 1 }, { 0, 1, 4, 5, 0, 1, 0, 1 }, { 2, 3, 4, 5, 0, 1, 0, 1 }, { 0, 1, 2, 3, 4, 5, 0, 1 },
+	{ 6, 7, 0, 1, 0, 1, 0, 1 }, { 0, 1, 6, 7, 0, 1, 0, 1 }, { 2, 3, 6, 7, 0, 1, 0, 1 }, { 0, 1, 2, 3, 6, 7, 0, 1 },
+	{ 4, 5, 6, 7, 0, 1, 0, 1 }, { 0, 1, 4, 5, 6, 7, 0, 1 }, { 2, 3, 4, 5, 6, 7, 0, 1 }, { 0, 1, 2, 3, 4, 5, 6, 7 },
+};
+#endif
+
+static void
+Spatial_WritePair(Spatial_Pair* pair, u32 a, u32 b)
+{
+	*pair = (Spatial_Pair){ .a = (a < b ? a : b), .b = (a < b ? b : a) };
+}
+
+// NOTE: Cells are a power of two wide, so a point falling in a cell is a compare against its edges, which gives the
+//       same answer as Spatial_Cell. The edges of the grid reach out to infinity.
+static void
+Spatial_CellEdges(Spatial_Grid* grid, u32 cx, u32 cy, f32* left, f32* right, f32* top, f32* bottom)
+{
+	f32 cell_size = 1.0f/grid->inv_cell_size;
+
+	*left   = (cx != 0                 ? (f32)cx*cell_size       : -F32_MAX);
+	*right  = (cx != grid->columns - 1 ? (f32)(cx + 1)*cell_size :  F32_MAX);
+	*top    = (cy != 0                 ? (f32)cy*cell_size       : -F32_MAX);
+	*bottom = (cy != grid->rows - 1    ? (f32)(cy + 1)*cell_size :  F32_MAX);
+}
+
+// NOTE: Finds the overlapping pairs of a cell and returns how many there are. They are written to pairs unless it is
+//       0, which has room for capacity of them. Room for 3 more than there are pairs lets every pair go out in
+//       stores of 4, with less it is one at a time near the end.
+static u32
+Spatial_CellPairs(Spatial_Grid* grid, u32 cell, Spatial_Pair* pairs, u32 capacity)
+{
+	u32 cx    = cell % grid->columns;
+	u32 cy    = cell / grid->columns;
+	u32 first = grid->cell_first[cell];
+	u32 end   = grid->cell_first[cell + 1];
+
+	f32 left, right, top, bottom;
+	Spatial_CellEdges(grid, cx, cy, &left, &right, &top, &bottom);
+
+	u32* items = grid->items;
+	f32* min_x = grid->min_x;
+	f32* min_y = grid->min_y;
+	f32* max_x = grid->max_x;
+	f32* max_y = grid->max_y;
+
+	u32 count = 0;
+	for (u32 i = first; i < end; ++i)
+	{
+#ifdef __AVX2__
+		__m256 a_min_x = _mm256_set1_ps(min_x[i]);
+		__m256 a_min_y = _mm256_set1_ps(min_y[i]);
+		__m256 a_max_x = _mm256_set1_ps(max_x[i]);
+		__m256 a_max_y = _mm256_set1_ps(max_y[i]);
+		__m256 lo_x    = _mm256_set1_ps(left);
+		__m256 hi_x    = _mm256_set1_ps(right);
+		__m256 lo_y    = _mm256_set1_ps(top);
+		__m256 hi_y    = _mm256_set1_ps(bottom);
+		__m256i a      = _mm256_set1_epi32((int)items[i]);
+
+		for (u32 j = i + 1; j < end; j += 8)
+		{
+			__m256 b_min_x = _mm256_loadu_ps(min_x + j);
+			__m256 b_min_y = _mm256_loadu_ps(min_y + j);
+
+			__m256 overlap = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(b_min_x, a_max_x, _CMP_LT_OQ),
+			                                             _mm256_cmp_ps(a_min_x, _mm256_loadu_ps(max_x + j), _CMP_LT_OQ)),
+			                               _mm256_and_ps(_mm256_cmp_ps(b_min_y, a_max_y, _CMP_LT_OQ),
+			                                             _mm256_cmp_ps(a_min_y, _mm256_loadu_ps(max_y + j), _CMP_LT_OQ)));
+
+			__m256 corner_x = _mm256_max_ps(a_min_x, b_min_x);
+			__m256 corner_y = _mm256_max_ps(a_min_y, b_min_y);
+			__m256 in_cell  = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(corner_x, lo_x, _CMP_GE_OQ), _mm256_cmp_ps(corner_x, hi_x, _CMP_LT_OQ)),
+			                                _mm256_and_ps(_mm256_cmp_ps(corner_y, lo_y, _CMP_GE_OQ), _mm256_cmp_ps(corner_y, hi_y, _CMP_LT_OQ)));
+
+			u32 mask = (u32)_mm256_movemask_ps(_mm256_and_ps(overlap, in_cell));
+			if (end - j < 8) mask &= (1U << (end - j)) - 1;
+
+			if (pairs == 0)
+			{
+				count += PopCount32(mask);
+			}
+			else if (count + PopCount32(mask) + 3 <= capacity)
+			{
+				// NOTE: pairs as 64 bit lanes, 0 to 3 in low and 4 to 7 in high, each half packed by its 4 bits
+				__m256i b  = _mm256_loadu_si256((__m256i*)(items + j));
+				__m256i lo = _mm256_min_epu32(a, b);
+				__m256i hi = _mm256_max_epu32(a, b);
+				__m256i interleaved_lo = _mm256_unpacklo_epi32(lo, hi);
+				__m256i interleaved_hi = _mm256_unpackhi_epi32(lo, hi);
+				__m256i low  = _mm256_permute2x128_si256(interleaved_lo, interleaved_hi, 0x20);
+				__m256i high = _mm256_permute2x128_si256(interleaved_lo, interleaved_hi, 0x31);
+
+				__m256i pack = _mm256_loadu_si256((__m256i*)SpatialPackLanes[mask & 0xF]);
+				_mm256_storeu_si256((__m256i*)(pairs + count), _mm256_permutevar8x32_epi32(low, pack));
+				count += PopCount32(mask & 0xF);
+
+				pack = _mm256_loadu_si256((__m256i*)SpatialPackLanes[mask >> 4]);
+				_mm256_storeu_si256((__m256i*)(pairs + count), _mm256_permutevar8x32_epi32(high, pack));
+				count += PopCount32(mask >> 4);
+			}
+			else
+			{
+				for (; mask != 0; mask &= mask - 1) Spatial_WritePair(&pairs[count++], items[i], items[j + CountTrailingZeros64(mask)]);
+			}
+		}
+#else
+		for (u32 k = i + 1; k < end; ++k)
+		{
+			f32 corner_x = (min_x[i] > min_x[k] ? min_x[i] : min_x[k]);
+			f32 corner_y = (min_y[i] > min_y[k] ? min_y[i] : min_y[k]);
+
+			if (min_x[k] < max_x[i] && min_x[i] < max_x[k] && min_y[k] < max_y[i] && min_y[i] < max_y[k] &&
+			    corner_x >= left && corner_x < right && corner_y >= top && corner_y < bottom)
+			{
+				if (pairs != 0) Spatial_WritePair(&pairs[count], items[i], items[k]);
+				count += 1;
+			}
+		}
+#endif
+	}
+
+	return count;
+}
+
+typedef struct Spatial_Pairs_Job
+{
+	Spatial_Grid* grid;
+	u32* cell_pairs;     // NOTE: first pair of every cell, filled with counts by the first pass
+	Spatial_Pair* pairs; // NOTE: 0 in the first pass
+} Spatial_Pairs_Job;
+
+static void
+Spatial_PairsCells(void* data, u32 first, u32 count, Bump* scratch)
+{
+	Spatial_Pairs_Job* job = data;
+
+	for (u32 cell = first; cell < first + count; ++cell)
+	{
+		if (job->pairs == 0)
+		{
+			job->cell_pairs[cell + 1] = Spatial_CellPairs(job->grid, cell, 0, 0);
+		}
+		else
+		{
+			u32 capacity = job->cell_pairs[cell + 1] - job->cell_pairs[cell];
+			Spatial_CellPairs(job->grid, cell, job->pairs + job->cell_pairs[cell], capacity);
+		}
+	}
+}
+
+// NOTE: Every overlapping pair once, pushed on bump, in the same order however the work is split.
+//
+//       With parallel_for cells are tested twice, once to count their pairs and once to write them where the counts
+//       say, over bands of cell rows. Without it cells are tested once, on the calling thread, and the pairs grow on
+//       bump as they are found: room for every pair a cell could have is pushed before it, what is left is popped
+//       after. A cell with too many boxes for that is counted first, like with parallel_for.
+static Spatial_Pair*
+Spatial_FindPairs(Spatial_Grid* grid, Bump* bump, Job_Parallel_For_Func* parallel_for, Job_Wait_Func* wait, u32* pair_count)
+{
+	if (parallel_for == 0)
+	{
+		Spatial_Pair* pairs = Bump_Push(bump, 0, 4);
+		u32 count = 0;
+
+		for (u32 cell = 0; cell < grid->cell_count; ++cell)
+		{
+			u64 references = grid->cell_first[cell + 1] - grid->cell_first[cell];
+			u64 most       = references*(references - (references != 0))/2;
+
+			u32 capacity = (u32)(most <= SPATIAL_MAX_CELL_PAIRS ? most : Spatial_CellPairs(grid, cell, 0, 0)) + 3;
+
+			Bump_Push(bump, capacity*sizeof(Spatial_Pair), 4);
+			u32 found = Spatial_CellPairs(grid, cell, pairs + count, capacity);
+			Bump_Pop(bump, (capacity - found)*sizeof(Spatial_Pair));
+
+			count += found;
+		}
+
+		*pair_count = count;
+
+		return pairs;
+	}
+
+	Spatial_Pairs_Job job = {
+		.grid       = grid,
+		.cell_pairs = Bump_Push(bump, ((umm)grid->cell_count + 1)*sizeof(u32), 4),
+	};
+
+	job.cell_pairs[0] = 0;
+
+	for (u32 pass = 0; pass < 2; ++pass)
+	{
+		if (pass == 1)
+		{
+			for (u32 i = 0; i < grid->cell_count; ++i) job.cell_pairs[i + 1] += job.cell_pairs[i];
+			job.pairs = Bump_Push(bump, (umm)job.cell_pairs[grid->cell_count]*sizeof(Spatial_Pair), 4);
+		}
+
+		Job_Counter counter = {0};
+		parallel_for(Spatial_PairsCells, &job, grid->cell_count, grid->columns, &counter);
+		wait(&counter);
+	}
+
+	*pair_count = job.cell_pairs[grid->cell_count];
+
+	return job.pairs;
+}
+
+// NOTE: Writes up to capacity boxes overlapping the rect to results. Returns how many there are, which may be more.
+static u32
+Spatial_QueryRect(Spatial_Grid* grid, f32 x, f32 y, f32 width, f32 height, u32* results, u32 capacity)
+{
+	u32 cx0 = Spatial_Cell(x,          grid->inv_cell_size, grid->columns);
+	u32 cy0 = Spatial_Cell(y,          grid->inv_cell_size, grid->rows);
+	u32 cx1 = Spatial_Cell(x + width,  grid->inv_cell_size, grid->columns);
+	u32 cy1 = Spatial_Cell(y + height, grid->inv_cell_size, grid->rows);
+
+	u32 count = 0;
+	for (u32 cy = cy0; cy <= cy1; ++cy)
+	{
+		for (u32 cx = cx0; cx <= cx1; ++cx)
+		{
+			u32 cell = cy*grid->columns + cx;
+
+			u32 first = grid->cell_first[cell];
+			u32 end   = grid->cell_first[cell + 1];
+
+			f32 left, right, top, bottom;
+			Spatial_CellEdges(grid, cx, cy, &left, &right, &top, &bottom);
+
+			u32 i = first;
+#ifdef __AVX2__
+			__m256 rect_min_x = _mm256_set1_ps(x);
+			__m256 rect_min_y = _mm256_set1_ps(y);
+			__m256 rect_max_x = _mm256_set1_ps(x + width);
+			__m256 rect_max_y = _mm256_set1_ps(y + height);
+
+			for (; i < end; i += 8)
+			{
+				__m256 min_x = _mm256_loadu_ps(grid->min_x + i);
+				__m256 min_y = _mm256_loadu_ps(grid->min_y + i);
+
+				__m256 overlap = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(min_x, rect_max_x, _CMP_LT_OQ),
+				                                             _mm256_cmp_ps(rect_min_x, _mm256_loadu_ps(grid->max_x + i), _CMP_LT_OQ)),
+				                               _mm256_and_ps(_mm256_cmp_ps(min_y, rect_max_y, _CMP_LT_OQ),
+				                                             _mm256_cmp_ps(rect_min_y, _mm256_loadu_ps(grid->max_y + i), _CMP_LT_OQ)));
+
+				__m256 corner_x = _mm256_max_ps(min_x, rect_min_x);
+				__m256 corner_y = _mm256_max_ps(min_y, rect_min_y);
+				__m256 in_cell  = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(corner_x, _mm256_set1_ps(left), _CMP_GE_OQ),
+				                                              _mm256_cmp_ps(corner_x, _mm256_set1_ps(right), _CMP_LT_OQ)),
+				                                _mm256_and_ps(_mm256_cmp_ps(corner_y, _mm256_set1_ps(top), _CMP_GE_OQ),
+				                                              _mm256_cmp_ps(corner_y, _mm256_set1_ps(bottom), _CMP_LT_OQ)));
+
+				u32 mask = (u32)_mm256_movemask_ps(_mm256_and_ps(overlap, in_cell));
+				if (end - i < 8) mask &= (1U << (end - i)) - 1;
+
+				for (; mask != 0; mask &= mask - 1)
+				{
+					if (count < capacity) results[count] = grid->items[i + CountTrailingZeros64(mask)];
+					count += 1;
+				}
+			}
+#else
+			for (; i < end; ++i)
+			{
+				f32 corner_x = (grid->min_x[i] > x ? grid->min_x[i] : x);
+				f32 corner_y = (grid->min_y[i] > y ? grid->min_y[i] : y);
+
+				if (grid->min_x[i] < x + width && x < grid->max_x[i] && grid->min_y[i] < y + height && y < grid->max_y[i] &&
+				    corner_x >= left && corner_x < right && corner_y >= top && corner_y < bottom)
+				{
+					if (count < capacity) results[count] = grid->items[i];
+					count += 1;
+				}
+			}
+#endif
+		}
+	}
+
+	return count;
+}
+
+// NOTE: Like Spatial_QueryRect for boxes holding the point, a point only ever lies in one cell
+static u32
+Spatial_QueryPoint(Spatial_Grid* grid, f32 x, f32 y, u32* results, u32 capacity)
+{
+	u32 cell = Spatial_Cell(y, grid->inv_cell_size, grid->rows)*grid->columns + Spatial_Cell(x, grid->inv_cell_size, grid->columns);
+
+	u32 count = 0;
+	for (u32 i = grid->cell_first[cell]; i < grid->cell_first[cell + 1]; ++i)
+	{
+		if (grid->min_x[i] <= x && x < grid->max_x[i] && grid->min_y[i] <= y && y < grid->max_y[i])
+		{
+			if (count < capacity) results[count] = grid->items[i];
+			count += 1;
+		}
+	}
+
+	return count;
+}
+
+// NOTE: Narrows [*t0, *t1] to where origin + t*direction lies in [min, max] along one axis. False when nothing is left.
+static bool
+Spatial_ClipSlab(f32 origin, f32 direction, f32 min, f32 max, f32* t0, f32* t1)
+{
+	if (direction == 0) return (origin >= min && origin <= max);
+
+	f32 inv  = 1.0f/direction;
+	f32 near = (min - origin)*inv;
+	f32 far  = (max - origin)*inv;
+	if (near > far)
+	{
+		f32 swap = near;
+		near = far;
+		far  = swap;
+	}
+
+	if (near > *t0) *t0 = near;
+	if (far  < *t1) *t1 = far;
+
+	return (*t0 <= *t1);
+}
+
+// NOTE: The first box along origin + t*direction for t in [0, max_t], or SPATIAL_NO_ITEM. t of the hit goes to hit_t,
+//       0 when origin is inside the box. Cells are walked in the order the ray crosses them (Amanatides and Woo, "A
+//       Fast Voxel Traversal Algorithm for Ray Tracing", 1987) until one holds a hit closer than where the ray leaves
+//       it. Only the part of the ray over the playfield is walked, hits past its edges can be missed.
+static u32
+Spatial_Raycast(Spatial_Grid* grid, f32 origin_x, f32 origin_y, f32 direction_x, f32 direction_y, f32 max_t, f32* hit_t)
+{
+	f32 cell_size = 1.0f/grid->inv_cell_size;
+
+	f32 t0 = 0;
+	f32 t1 = max_t;
+	if (!Spatial_ClipSlab(origin_x, direction_x, 0, (f32)AZUR_WIDTH,  &t0, &t1) ||
+	    !Spatial_ClipSlab(origin_y, direction_y, 0, (f32)AZUR_HEIGHT, &t0, &t1))
+	{
+		return SPATIAL_NO_ITEM;
+	}
+
+	s32 cx = (s32)Spatial_Cell(origin_x + direction_x*t0, grid->inv_cell_size, grid->columns);
+	s32 cy = (s32)Spatial_Cell(origin_y + direction_y*t0, grid->inv_cell_size, grid->rows);
+
+	s32 step_x = (direction_x > 0 ? 1 : (direction_x < 0 ? -1 : 0));
+	s32 step_y = (direction_y > 0 ? 1 : (direction_y < 0 ? -1 : 0));
+
+	// NOTE: t where the ray crosses the next cell edge on each axis, and how far t moves between edges
+	f32 next_x  = (step_x != 0 ? ((f32)(cx + (step_x > 0)) *cell_size - origin_x)/direction_x : max_t + 1);
+	f32 next_y  = (step_y != 0 ? ((f32)(cy + (step_y > 0)) *cell_size - origin_y)/direction_y : max_t + 1);
+	f32 delta_x = (step_x != 0 ? cell_size/(direction_x*(f32)step_x) : 0);
+	f32 delta_y = (step_y != 0 ? cell_size/(direction_y*(f32)step_y) : 0);
+
+	u32 hit = SPATIAL_NO_ITEM;
+	f32 best_t = max_t;
+
+	for (;;)
+	{
+		u32 cell = (u32)cy*grid->columns + (u32)cx;
+
+		for (u32 i = grid->cell_first[cell]; i < grid->cell_first[cell + 1]; ++i)
+		{
+			f32 near = 0;
+			f32 far  = best_t;
+			if (Spatial_ClipSlab(origin_x, direction_x, grid->min_x[i], grid->max_x[i], &near, &far) &&
+			    Spatial_ClipSlab(origin_y, direction_y, grid->min_y[i], grid->max_y[i], &near, &far) &&
+			    (near < best_t || hit == SPATIAL_NO_ITEM))
+			{
+				hit    = grid->items[i];
+				best_t = near;
+			}
+		}
+
+		f32 exit_t = (next_x < next_y ? next_x : next_y);
+		if ((hit != SPATIAL_NO_ITEM && best_t <= exit_t) || exit_t > t1) break;
+
+		if (next_x < next_y)
+		{
+			cx     += step_x;
+			next_x += delta_x;
+		}
+		else
+		{
+			cy     += step_y;
+			next_y += delta_y;
+		}
+
+		if (cx < 0 || cy < 0 || cx >= (s32)grid->columns || cy >= (s32)grid->rows) break;
+	}
+
+	if (hit != SPATIAL_NO_ITEM) *hit_t = best_t;
+
+	return hit;
+}
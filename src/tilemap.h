@@ -0,0 +1,258 @@
+// NOTE: Scrolling tilemaps. Tiles are TILEMAP_TILE_SIZE pixels square, cut from a tileset sprite left to right and top
+//       to bottom. A map is stored in chunks of TILEMAP_CHUNK_TILES x TILEMAP_CHUNK_TILES tiles, every chunk
+//       contiguous, so the tiles of one screen are a few compact blocks however wide the map is.
+//
+//       Drawing never touches tiles. A chunk that comes into view is rendered once into a slot of the chunk cache,
+//       and every frame after that is a copy of cached rows into the framebuffer, at any pixel offset. The cache keeps
+//       the least recently drawn chunks around until a new one needs their slot. Changing a tile redraws that tile in
+//       the cached chunk, if there is one, so a cache is never thrown away as a whole.
+//
+//       Requires blit.h.
+
+#define TILEMAP_TILE_SIZE    8
+#define TILEMAP_CHUNK_TILES  16
+#define TILEMAP_CHUNK_SIZE   (TILEMAP_TILE_SIZE*TILEMAP_CHUNK_TILES) // NOTE: in pixels
+#define TILEMAP_NO_SLOT      U16_MAX
+
+// NOTE: enough for every chunk a 320x180 view can touch with a ring around it to spare
+#define TILEMAP_MIN_CACHE_SLOTS 32
+
+typedef u16 Tile;
+
+typedef struct Tilemap_Slot
+{
+	u32 chunk;
+	u64 last_drawn;
+} Tilemap_Slot;
+
+typedef struct Tilemap
+{
+	Sprite tileset;
+	u32 tileset_columns;
+	u32 tile_count;
+
+	u32 width;  // NOTE: in tiles, multiples of TILEMAP_CHUNK_TILES
+	u32 height;
+	u32 chunk_columns;
+	u32 chunk_rows;
+	Tile (*tiles)[TILEMAP_CHUNK_TILES*TILEMAP_CHUNK_TILES]; // NOTE: per chunk, rows of tiles
+	u16* chunk_slots;                                      // NOTE: per chunk, TILEMAP_NO_SLOT when not cached
+
+	u8 (*slot_pixels)[TILEMAP_CHUNK_SIZE*TILEMAP_CHUNK_SIZE];
+	Tilemap_Slot* slots;
+	u32 slot_count;
+	u64 draw_count;
+
+	u8 outside_index; // NOTE: drawn where the view is past the edges of the map
+
+	/// Stats
+	u64 chunks_rendered;
+	u64 tiles_redrawn;
+} Tilemap;
+
+// NOTE: width and height are in tiles and get rounded up to whole chunks. Every tile starts out as 0.
+static void
+Tilemap_Create(Tilemap* map, Bump* bump, Sprite* tileset, u32 width, u32 height, u32 slot_count, u8 outside_index)
+{
+	u32 chunk_columns = (width  + TILEMAP_CHUNK_TILES - 1)/TILEMAP_CHUNK_TILES;
+	u32 chunk_rows    = (height + TILEMAP_CHUNK_TILES - 1)/TILEMAP_CHUNK_TILES;
+	u32 chunk_count   = chunk_columns*chunk_rows;
+
+	if (slot_count < TILEMAP_MIN_CACHE_SLOTS) slot_count = TILEMAP_MIN_CACHE_SLOTS;
+	if (slot_count > TILEMAP_NO_SLOT)         slot_count = TILEMAP_NO_SLOT;
+
+	*map = (Tilemap){
+		.tileset         = *tileset,
+		.tileset_columns = tileset->width/TILEMAP_TILE_SIZE,
+		.tile_count      = (tileset->width/TILEMAP_TILE_SIZE)*(tileset->height/TILEMAP_TILE_SIZE),
+		.width           = chunk_columns*TILEMAP_CHUNK_TILES,
+		.height          = chunk_rows*TILEMAP_CHUNK_TILES,
+		.chunk_columns   = chunk_columns,
+		.chunk_rows      = chunk_rows,
+		.tiles           = Bump_Push(bump, (umm)chunk_count*sizeof(map->tiles[0]), 64),
+		.chunk_slots     = Bump_Push(bump, (umm)chunk_count*sizeof(u16), 2),
+		.slot_pixels     = Bump_Push(bump, (umm)slot_count*sizeof(map->slot_pixels[0]), 64),
+		.slots           = Bump_Push(bump, (umm)slot_count*sizeof(Tilemap_Slot), 8),
+		.slot_count      = slot_count,
+		.outside_index   = outside_index,
+	};
+
+	memset(map->tiles, 0, (umm)chunk_count*sizeof(map->tiles[0]));
+	memset(map->chunk_slots, 0xFF, (umm)chunk_count*sizeof(u16));
+
+	for (u32 i = 0; i < slot_count; ++i) map->slots[i] = (Tilemap_Slot){ .chunk = U32_MAX };
+}
+
+static Tile*
+Tilemap_TileAt(Tilemap* map, u32 x, u32 y)
+{
+	u32 chunk = (y/TILEMAP_CHUNK_TILES)*map->chunk_columns + x/TILEMAP_CHUNK_TILES;
+	return &map->tiles[chunk][(y%TILEMAP_CHUNK_TILES)*TILEMAP_CHUNK_TILES + x%TILEMAP_CHUNK_TILES];
+}
+
+static Tile
+Tilemap_GetTile(Tilemap* map, u32 x, u32 y)
+{
+	return (x < map->width && y < map->height ? *Tilemap_TileAt(map, x, y) : 0);
+}
+
+// NOTE: Tiles past the end of the tileset draw as tile 0
+static void
+Tilemap_RenderTile(Tilemap* map, u8* dst, Tile tile)
+{
+	if (tile >= map->tile_count) tile = 0;
+
+	Sprite* tileset = &map->tileset;
+	u8* src = tileset->pixels + (umm)(tile/map->tileset_columns)*TILEMAP_TILE_SIZE*tileset->stride +
+	          (tile%map->tileset_columns)*TILEMAP_TILE_SIZE;
+
+	for (u32 y = 0; y < TILEMAP_TILE_SIZE; ++y)
+	{
+		memcpy(dst + y*TILEMAP_CHUNK_SIZE, src + (umm)y*tileset->stride, TILEMAP_TILE_SIZE);
+	}
+}
+
+static void
+Tilemap_SetTile(Tilemap* map, u32 x, u32 y, Tile tile)
+{
+	if (x >= map->width || y >= map->height) return;
+
+	Tile* stored = Tilemap_TileAt(map, x, y);
+	if (*stored == tile) return;
+
+	*stored = tile;
+
+	u16 slot = map->chunk_slots[(y/TILEMAP_CHUNK_TILES)*map->chunk_columns + x/TILEMAP_CHUNK_TILES];
+	if (slot != TILEMAP_NO_SLOT)
+	{
+		u32 tx = x%TILEMAP_CHUNK_TILES;
+		u32 ty = y%TILEMAP_CHUNK_TILES;
+		Tilemap_RenderTile(map, &map->slot_pixels[slot][(ty*TILEMAP_CHUNK_SIZE + tx)*TILEMAP_TILE_SIZE], tile);
+
+		map->tiles_redrawn += 1;
+	}
+}
+
+// NOTE: Returns the cached pixels of a chunk, rendering it into the least recently drawn slot first if it is not
+//       cached. A chunk drawn this frame is never evicted, the cache always has more slots than a view has chunks.
+static u8*
+Tilemap_CachedChunk(Tilemap* map, u32 chunk)
+{
+	u16 slot = map->chunk_slots[chunk];
+
+	if (slot == TILEMAP_NO_SLOT)
+	{
+		slot = 0;
+		for (u16 i = 1; i < map->slot_count; ++i)
+		{
+			if (map->slots[i].last_drawn < map->slots[slot].last_drawn) slot = i;
+		}
+
+		ASSERT(map->slots[slot].chunk == U32_MAX || map->slots[slot].last_drawn != map->draw_count);
+
+		if (map->slots[slot].chunk != U32_MAX) map->chunk_slots[map->slots[slot].chunk] = TILEMAP_NO_SLOT;
+
+		map->slots[slot].chunk = chunk;
+		map->chunk_slots[chunk] = slot;
+
+		u8* pixels = map->slot_pixels[slot];
+		Tile* tiles = map->tiles[chunk];
+		for (u32 ty = 0; ty < TILEMAP_CHUNK_TILES; ++ty)
+		{
+			for (u32 tx = 0; tx < TILEMAP_CHUNK_TILES; ++tx)
+			{
+				Tilemap_RenderTile(map, pixels + (ty*TILEMAP_CHUNK_SIZE + tx)*TILEMAP_TILE_SIZE, tiles[ty*TILEMAP_CHUNK_TILES + tx]);
+			}
+		}
+
+		map->chunks_rendered += 1;
+	}
+
+	map->slots[slot].last_drawn = map->draw_count;
+
+	return map->slot_pixels[slot];
+}
+
+// NOTE: Copies one row of a chunk. Rows are at most a chunk wide, a call to memcpy with a size it cannot see costs
+//       about as much as the copy itself. The ragged end is one more vector aligned to the end of the row.
+static void
+Tilemap_CopyRow(u8* dst, u8* src, s32 width)
+{
+#ifdef __AVX2__
+	if (width >= 32)
+	{
+		s32 i = 0;
+		for (; i + 32 <= width; i += 32) _mm256_storeu_si256((__m256i*)(dst + i), _mm256_loadu_si256((__m256i*)(src + i)));
+
+		if (i < width) _mm256_storeu_si256((__m256i*)(dst + width - 32), _mm256_loadu_si256((__m256i*)(src + width - 32)));
+	}
+	else
+#endif
+	{
+		memcpy(dst, src, (umm)width);
+	}
+}
+
+// NOTE: Covers the whole framebuffer with the map, the pixel at (scroll_x, scroll_y) of the map lands in its top left
+//       corner. Every framebuffer row is a handful of row copies, one per chunk it crosses.
+static void
+Tilemap_Draw(Tilemap* map, Framebuffer* framebuffer, s32 scroll_x, s32 scroll_y)
+{
+	map->draw_count += 1;
+
+	s64 map_width  = (s64)map->width*TILEMAP_TILE_SIZE;
+	s64 map_height = (s64)map->height*TILEMAP_TILE_SIZE;
+
+	for (s32 y = 0; y < AZUR_HEIGHT; )
+	{
+		s64 my = (s64)scroll_y + y;
+
+		// NOTE: rows that lie in the same chunk row, or all of them above or below the map
+		s32 span;
+		if      (my < 0)           span = (s32)(-my < AZUR_HEIGHT - y ? -my : AZUR_HEIGHT - y);
+		else if (my >= map_height) span = AZUR_HEIGHT - y;
+		else                       span = TILEMAP_CHUNK_SIZE - (s32)(my%TILEMAP_CHUNK_SIZE);
+
+		if (span > AZUR_HEIGHT - y) span = AZUR_HEIGHT - y;
+
+		if (my < 0 || my >= map_height)
+		{
+			Blit_FillRect(framebuffer, 0, y, AZUR_WIDTH, span, map->outside_index);
+			y += span;
+			continue;
+		}
+
+		u32 chunk_row = (u32)(my/TILEMAP_CHUNK_SIZE);
+		u32 chunk_y   = (u32)(my%TILEMAP_CHUNK_SIZE);
+
+		for (s32 x = 0; x < AZUR_WIDTH; )
+		{
+			s64 mx = (s64)scroll_x + x;
+
+			s32 width;
+			if      (mx < 0)          width = (s32)(-mx < AZUR_WIDTH - x ? -mx : AZUR_WIDTH - x);
+			else if (mx >= map_width) width = AZUR_WIDTH - x;
+			else                      width = TILEMAP_CHUNK_SIZE - (s32)(mx%TILEMAP_CHUNK_SIZE);
+
+			if (width > AZUR_WIDTH - x) width = AZUR_WIDTH - x;
+
+			if (mx < 0 || mx >= map_width)
+			{
+				for (s32 j = 0; j < span; ++j) memset(&framebuffer->pixels[y + j][x], map->outside_index, (umm)width);
+			}
+			else
+			{
+				u32 chunk   = chunk_row*map->chunk_columns + (u32)(mx/TILEMAP_CHUNK_SIZE);
+				u8* pixels  = Tilemap_CachedChunk(map, chunk) + chunk_y*TILEMAP_CHUNK_SIZE + (u32)(mx%TILEMAP_CHUNK_SIZE);
+
+				for (s32 j = 0; j < span; ++j) Tilemap_CopyRow(&framebuffer->pixels[y + j][x], pixels + j*TILEMAP_CHUNK_SIZE, width);
+			}
+
+			x += width;
+		}
+
+		y += span;
+	}
+
+	Framebuffer_MarkAll(framebuffer);
+}
@@ -0,0 +1,70 @@
+// NOTE: Fixed timestep clock shared by the platform hosts. Real time is accumulated and handed to the game as a
+//       whole number of fixed simulation steps plus the fraction of a step left over, which the game uses to
+//       interpolate what it renders between the last two simulated states.
+
+#define TIMESTEP_DEFAULT_HZ 60
+#define TIMESTEP_MAX_HZ     1000
+
+// NOTE: Caps the steps simulated in one frame. When the game can not keep up the excess time is dropped and the
+//       simulation slows down, instead of each frame taking longer to catch up than the one before it
+#define TIMESTEP_MAX_STEPS 8
+
+// NOTE: Frame deltas this close to a whole number of steps are snapped to it. At vsync the measured deltas jitter
+//       around the refresh period, without snapping that jitter turns into an occasional frame with 0 or 2 steps
+#define TIMESTEP_SNAP_NS 250000
+
+typedef struct Timestep
+{
+	u64 step_ns;
+	u64 last_ns;
+	u64 accumulator_ns;
+	u64 tick;
+	u64 dropped_ns;
+} Timestep;
+
+static void
+Timestep_Init(Timestep* timestep, u32 hz, u64 now_ns)
+{
+	ASSERT(hz != 0 && hz <= TIMESTEP_MAX_HZ);
+
+	*timestep = (Timestep){
+		.step_ns = 1000000000ULL/hz,
+		.last_ns = now_ns,
+	};
+}
+
+// NOTE: Forgets the time passed since the last frame, used when the host stops ticking the game for a while
+static void
+Timestep_Resync(Timestep* timestep, u64 now_ns)
+{
+	timestep->last_ns = now_ns;
+}
+
+static void
+Timestep_Advance(Timestep* timestep, u64 now_ns, Platform_Link* platform_link)
+{
+	u64 delta = (now_ns > timestep->last_ns ? now_ns - timestep->last_ns : 0);
+	timestep->last_ns = now_ns;
+
+	u64 snapped = (delta + timestep->step_ns/2)/timestep->step_ns*timestep->step_ns;
+	if (snapped != 0 && (delta > snapped ? delta - snapped : snapped - delta) < TIMESTEP_SNAP_NS) delta = snapped;
+
+	timestep->accumulator_ns += delta;
+
+	u64 max_ns = TIMESTEP_MAX_STEPS*timestep->step_ns;
+	if (timestep->accumulator_ns > max_ns)
+	{
+		timestep->dropped_ns     += timestep->accumulator_ns - max_ns;
+		timestep->accumulator_ns  = max_ns;
+	}
+
+	u32 steps = (u32)(timestep->accumulator_ns/timestep->step_ns);
+	timestep->accumulator_ns -= steps*timestep->step_ns;
+
+	platform_link->dt        = (f32)timestep->step_ns/1e9f;
+	platform_link->sim_tick  = timestep->tick;
+	platform_link->sim_steps = steps;
+	platform_link->alpha     = (f32)timestep->accumulator_ns/(f32)timestep->step_ns;
+
+	timestep->tick += steps;
+}